@@ -0,0 +1,87 @@
+#ifndef COMMANDLIST_H
+#define COMMANDLIST_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <gsl/gsl> // for gsl::span<>
+
+#include "glm/glm.hpp"
+
+#include "GLRenderer.h"
+#include "GLShaderProgram.h"
+#include "GLVertexArray.h"
+#include "GLIndexBuffer.h"
+#include "GLTexture.h"
+
+// draw commands that are recorded without touching GL and replayed later on the GL thread.
+// Commands are packed one after another into the list's own linear memory, which keeps its
+// capacity across reset() -> once warmed up recording does not allocate.
+// Recording is meant to happen on worker threads, one list per thread (or per chunk of work),
+// the GL thread then replays the lists in order with replay(..).
+// Recording only stores pointers and values:
+//  - uniform locations have to be looked up on the GL thread before recording
+//      (GLShaderProgram::getUniformLocation(..) caches and is not thread-safe)
+//  - referenced objects have to stay alive until the list was replayed
+class CommandList
+{
+public:
+    CommandList() = default;
+
+    // do not allow copy (lists are big), do allow move:
+    CommandList(const CommandList& other) = delete;
+    CommandList& operator=(const CommandList& other) = delete;
+    CommandList(CommandList&& other) noexcept = default;
+    CommandList& operator=(CommandList&& other) noexcept = default;
+
+    // forgets all commands but keeps the memory:
+    void reset();
+
+    // bindings (also binds ib, it belongs to the vertex array state):
+    void bindProgram(GLShaderProgram& sp);
+    void bindVertexArray(GLVertexArray& va, GLIndexBuffer& ib);
+    void bindTexture(GLTexture& texture, int texUnit);
+
+    // uniform data of the bound program:
+    void setUniform1i(GLint location, int v);
+    void setUniform1f(GLint location, float v);
+    void setUniform4f(GLint location, const glm::vec4& v);
+    void setUniformMat4f(GLint location, const glm::mat4& m);
+
+    // draws count indices starting at index first of the bound index buffer:
+    void draw(GLIndexBuffer::count_type first, GLIndexBuffer::count_type count);
+    // draws the whole index buffer bound with the last bindVertexArray(..):
+    void draw();
+
+    std::size_t getCommandCount() const {
+        return m_commandCount;
+    }
+
+    std::size_t getByteSize() const {
+        return m_bytes.size();
+    }
+
+    // replays the lists in order. Bindings that are equal to the current ones are skipped,
+    // also across lists. Afterwards the program and vertex array are unbound again
+    // (as after GLRenderer::draw(..)).
+    static void replay(GLRenderer& renderer, gsl::span<const CommandList> lists);
+
+private:
+    enum class CommandType : std::uint8_t {
+        BIND_PROGRAM, BIND_VERTEX_ARRAY, BIND_TEXTURE,
+        UNIFORM_1I, UNIFORM_1F, UNIFORM_4F, UNIFORM_MAT4F,
+        DRAW
+    };
+
+    template<typename Payload>
+    void push(CommandType type, const Payload& payload);
+
+    std::vector<std::byte> m_bytes;
+    std::size_t m_commandCount = 0;
+    GLIndexBuffer* m_lastIB = nullptr; // for draw()
+};
+
+#endif // COMMANDLIST_H
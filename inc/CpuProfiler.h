@@ -0,0 +1,125 @@
+#ifndef CPUPROFILER_H
+#define CPUPROFILER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// a finished zone. name points to a string literal (or __func__).
+struct CpuZoneEvent {
+    const char* name;
+    std::uint64_t begin_ns;
+    std::uint64_t end_ns;
+};
+
+// records the zones of CPU_PROFILE_SCOPE(..)/CPU_PROFILE_FUNCTION() on all threads.
+// Every thread writes its zones into its own ring without locks or allocations (single producer),
+// collect() moves them into a history (single consumer, serialized by a mutex). If a ring is
+// full because collect() was not called for a while, new zones of that thread are dropped
+// (and counted). Recording is compiled in if OPENGL_DEMOS_CPU_PROFILER is defined (cmake option).
+class CpuProfiler
+{
+public:
+    // zones per thread between two calls of collect()
+    static constexpr std::size_t ringCapacity = std::size_t(1) << 14;
+    // zones kept for writeChromeTrace(..), the oldest ones are discarded first
+    static constexpr std::size_t historyCapacity = std::size_t(1) << 19;
+
+    static CpuProfiler& shared();
+
+    // nanoseconds since the start of the program (steady clock)
+    static std::uint64_t now_ns();
+    // name of the calling thread in the trace (threads are numbered by their first zone otherwise)
+    static void setThreadName(std::string name);
+
+    // used by CpuProfileZone, called on the thread that executed the zone
+    void record(const char* name, std::uint64_t begin_ns, std::uint64_t end_ns);
+
+    // zones are not recorded while disabled
+    void setEnabled(bool enabled) {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+    bool isEnabled() const {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    // moves the zones of all threads into the history. Call it regularly, e.g. once per frame.
+    void collect();
+    std::size_t getHistorySize() const;
+    std::size_t getDroppedCount() const;
+
+    // collects and writes the history in the Chrome trace event format
+    // (chrome://tracing, https://ui.perfetto.dev)
+    bool writeChromeTrace(const std::filesystem::path& path);
+
+    // window with the number of zones and a button for the export
+    void OnImGuiRender();
+
+private:
+    struct ThreadRing {
+        std::array<CpuZoneEvent, ringCapacity> events;
+        std::atomic<std::size_t> head{0}; // only written by the thread of the ring
+        std::atomic<std::size_t> tail{0}; // only written by collect()
+        std::atomic<std::size_t> dropped{0};
+        std::size_t index = 0;
+        std::string name; // guarded by m_mutex
+    };
+    struct HistoryEntry {
+        CpuZoneEvent event;
+        std::size_t thread;
+    };
+
+    CpuProfiler() = default;
+    ThreadRing& getThreadRing();
+    void collectLocked();
+
+    std::atomic<bool> m_enabled{true};
+    mutable std::mutex m_mutex;
+    std::vector<std::shared_ptr<ThreadRing>> m_rings; // (rings of threads that ended are kept)
+    std::deque<HistoryEntry> m_history;
+    std::size_t m_discarded = 0; // old zones discarded from the history
+};
+
+// records the time between its construction and destruction as zone name on the calling thread.
+// name has to live as long as the profiler (a string literal or __func__).
+class CpuProfileZone
+{
+public:
+    explicit CpuProfileZone(const char* name)
+        : m_name(CpuProfiler::shared().isEnabled() ? name : nullptr),
+          m_begin_ns(m_name ? CpuProfiler::now_ns() : 0)
+    {}
+    ~CpuProfileZone() {
+        if (m_name) {
+            CpuProfiler::shared().record(m_name, m_begin_ns, CpuProfiler::now_ns());
+        }
+    }
+
+    // do not allow copy or move:
+    CpuProfileZone(const CpuProfileZone& other) = delete;
+    CpuProfileZone& operator=(const CpuProfileZone& other) = delete;
+
+private:
+    const char* m_name;
+    std::uint64_t m_begin_ns;
+};
+
+#ifdef OPENGL_DEMOS_CPU_PROFILER
+#define CPU_PROFILER_CONCAT_IMPL(a, b) a##b
+#define CPU_PROFILER_CONCAT(a, b) CPU_PROFILER_CONCAT_IMPL(a, b)
+// zone from here to the end of the enclosing C++ scope
+#define CPU_PROFILE_SCOPE(name) const CpuProfileZone CPU_PROFILER_CONCAT(cpuProfileZone_, __LINE__)(name)
+#define CPU_PROFILE_FUNCTION() CPU_PROFILE_SCOPE(__func__)
+#else
+#define CPU_PROFILE_SCOPE(name) static_cast<void>(0)
+#define CPU_PROFILE_FUNCTION() static_cast<void>(0)
+#endif
+
+#endif // CPUPROFILER_H
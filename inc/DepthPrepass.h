@@ -0,0 +1,72 @@
+#ifndef DEPTHPREPASS_H
+#define DEPTHPREPASS_H
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "cpu_mesh_structs.h"
+
+#include "GLRenderer.h"
+#include "GLShaderProgram.h"
+#include "GLVertexArray.h"
+#include "GLVertexBuffer.h"
+#include "GLIndexBuffer.h"
+#include "GLTimerQuery.h"
+
+// mesh with its positions in a separate vertex buffer (see splitPositionStream(..))
+// so the depth pre-pass only has to fetch positions:
+struct GLSplitMesh {
+    GLVertexBuffer positionVB;
+    GLVertexBuffer attribVB;
+    GLVertexArray va;           // all attributes (positionVB + attribVB) for the shading pass
+    GLVertexArray positionVA;   // only positionVB for the depth pre-pass
+    GLIndexBuffer ib;
+};
+
+// Render path toggle shared by the demos that shade with the textured phong shader:
+//  - disabled: the scene is drawn once with the shading program (depth test GL_LESS)
+//  - enabled: the scene is first drawn with a position-only program that just fills
+//      the depth buffer. Then the shading pass is drawn with glDepthFunc(GL_EQUAL) and
+//      depth writes disabled, so every pixel is shaded at most once.
+// The GPU time of the whole scene is measured separately for both paths, so they can be
+// compared in the gui.
+class DepthPrepass
+{
+public:
+    DepthPrepass();
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+
+    // uploads cpuMesh split into a position stream and a stream of the remaining attributes.
+    // the attribute locations are taken from shadingSP and from the depth-only program respectively.
+    GLSplitMesh makeMesh(CPUMesh<GLuint>& cpuMesh, const GLShaderProgram& shadingSP);
+
+    // call around everything that belongs to the scene (for the GPU time measurement):
+    void beginScene();
+    void endScene();
+
+    // only does something if enabled: fills the depth buffer using the position-only
+    // vertex arrays (color writes are disabled during this pass).
+    void renderDepth(GLRenderer& renderer, std::vector<GLSplitMesh>& meshes, const glm::mat4& ndc_from_oc);
+
+    // set up/reset the depth state for the shading pass (only does something if enabled):
+    void beginShadingPass(GLRenderer& renderer);
+    void endShadingPass(GLRenderer& renderer);
+
+    void OnImGuiRender();
+
+private:
+    std::unique_ptr<GLShaderProgram> m_depthSP;
+    bool m_enabled;
+    bool m_activePath; // path that was used by the scene between beginScene() and endScene()
+
+    // index 0: without pre-pass, index 1: with pre-pass
+    std::array<GLTimerQuery, 2> m_sceneTimers;
+    std::array<float, 2> m_avgSceneTime_ms;
+};
+
+#endif // DEPTHPREPASS_H
@@ -0,0 +1,160 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "GLBufferObject.h"
+#include "GLFence.h"
+#include "FrameStream.h"
+
+class GLFramebufferObject;
+
+// Screenshots and frame sequences as PNG files, or videos (FrameStream), without stalling the GL thread.
+// capture(..) reads the framebuffer into one pixel pack buffer of a ring and sets a fence. poll() maps the
+// buffers whose fence is signaled (some frames later) and encodes them on the ThreadPool, reading the
+// mapped memory directly. A buffer is unmapped and reused once its file is written (or its video frame
+// converted). If every buffer of the ring or the queue of the video is full, the frame is dropped (and
+// counted) instead of waiting, unless setDropFrames(false).
+class FrameCapture
+{
+public:
+    // files are named directory/frame_NNNNNN.png and directory/video_NNNNNN.y4m (existing files are not overwritten)
+    explicit FrameCapture(std::filesystem::path directory = "captures", std::size_t ringSize = 6);
+    // do not allow copy or move (tasks on the ThreadPool read the mapped buffers):
+    FrameCapture(const FrameCapture& other) = delete;
+    FrameCapture& operator=(const FrameCapture& other) = delete;
+    // waits for the pending captures (needs the OpenGL context)
+    ~FrameCapture();
+
+    // the next isCaptureRequested() is true
+    void requestScreenshot() {
+        m_screenshotRequested = true;
+    }
+    // captures every frame while recording
+    void setRecording(bool recording) {
+        m_recording = recording;
+    }
+    bool isRecording() const {
+        return m_recording;
+    }
+    bool isCaptureRequested() const {
+        return m_screenshotRequested || m_recording || m_streamRequested || m_stream;
+    }
+    // whether the alpha channel is written (RGBA instead of RGB PNG files)
+    void setKeepAlpha(bool keepAlpha) {
+        m_keepAlpha = keepAlpha;
+    }
+    // false: capture(..) waits until a buffer is free instead of dropping the frame (complete recordings)
+    void setDropFrames(bool dropFrames) {
+        m_dropFrames = dropFrames;
+    }
+    // of the PNG files and the videos of requestStream()
+    void setDirectory(const std::filesystem::path& directory);
+
+    // every captured frame is also converted and written into path (Y4M for .y4m, raw YUV 4:2:0 otherwise)
+    // until stopStream(). Captures of another size are dropped.
+    bool startStream(const std::filesystem::path& path, int width, int height, int framesPerSecond);
+    // startStream(..) into directory/video_NNNNNN.y4m with the size of the next capture(..)
+    void requestStream(int framesPerSecond = 60) {
+        m_streamRequested = true;
+        m_streamFramesPerSecond = framesPerSecond;
+    }
+    // waits for the frames in flight, closes the file and returns the number of frames in it
+    std::uint64_t stopStream();
+    bool isStreaming() const {
+        return m_stream != nullptr;
+    }
+    // nullptr if not streaming
+    const FrameStream* getStream() const {
+        return m_stream.get();
+    }
+
+    // starts the readback of the width x height region at the origin of the default framebuffer (back buffer),
+    // or of the attachment of fbo. Returns false if the frame was dropped.
+    // Leaves the default framebuffer bound to GL_READ_FRAMEBUFFER.
+    bool capture(GLsizei width, GLsizei height, GLFramebufferObject* fbo = nullptr,
+                 GLenum attachment = GL_COLOR_ATTACHMENT0);
+    // starts the encoding of finished readbacks and recycles the buffers of written files, call it once per frame
+    void poll();
+    // blocks until all captured frames are written
+    void finish();
+
+    std::uint64_t getCapturedCount() const {
+        return m_capturedCount;
+    }
+    std::uint64_t getDroppedCount() const {
+        return m_droppedCount;
+    }
+    std::uint64_t getWrittenCount() const {
+        return m_writtenCount;
+    }
+    std::uint64_t getFailedCount() const {
+        return m_failedCount;
+    }
+    // GL thread time of the last capture(..) + poll() and its average over all frames with any capture work
+    double getLastGLThread_ms() const {
+        return m_lastGLThread_ms;
+    }
+    double getAverageGLThread_ms() const;
+    double getMaxGLThread_ms() const {
+        return m_maxGLThread_ms;
+    }
+    // ends the time measurement of the frame (capture(..) and poll() add to it), call it once per frame
+    void endFrame();
+
+    // screenshot button, recording checkbox and statistics
+    void OnImGuiRender();
+
+private:
+    struct Slot {
+        std::optional<GLBufferObject> pbo;
+        std::optional<GLFence> fence;              // set while the readback is pending
+        std::optional<std::future<bool>> encoding; // set while the buffer is mapped and encoded
+        GLsizei width = 0;
+        GLsizei height = 0;
+        std::filesystem::path path;                // of the PNG file, empty if none is written
+        std::optional<std::uint64_t> streamPosition;
+    };
+
+    // poll() without the time measurement
+    void pollSlots();
+    // maps and unmaps the buffers (blocking) until the next capture fits into the ring and the stream
+    void waitForCapacity();
+    std::filesystem::path nextPath(const char* prefix, const char* extension);
+
+    std::filesystem::path m_directory;
+    std::vector<Slot> m_slots;
+    std::size_t m_nextSlot = 0;
+    std::size_t m_nextFileIndex = 0;
+    bool m_directoryCreated = false;
+    bool m_screenshotRequested = false;
+    bool m_recording = false;
+    bool m_keepAlpha = false;
+    bool m_dropFrames = true;
+
+    std::unique_ptr<FrameStream> m_stream;
+    bool m_streamRequested = false;
+    int m_streamFramesPerSecond = 60;
+    bool m_streamSizeWarned = false;
+
+    std::uint64_t m_capturedCount = 0;
+    std::uint64_t m_droppedCount = 0;
+    std::uint64_t m_writtenCount = 0;
+    std::uint64_t m_failedCount = 0;
+
+    double m_frameGLThread_ms = 0.; // of the current frame
+    double m_lastGLThread_ms = 0.;
+    double m_sumGLThread_ms = 0.;
+    double m_maxGLThread_ms = 0.;
+    std::uint64_t m_measuredFrames = 0;
+};
+
+#endif // FRAMECAPTURE_H
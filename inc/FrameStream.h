@@ -0,0 +1,103 @@
+#ifndef FRAMESTREAM_H
+#define FRAMESTREAM_H
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * video file of rendered frames in planar YUV 4:2:0 (see yuv420_from_RGBA8(..)):
+ *  - Y4M: YUV4MPEG2 header and one FRAME header per frame, plays in ffmpeg, mpv, vlc, ...
+ *  - RAW: only the planes, e.g. ffmpeg -f rawvideo -pix_fmt yuv420p -s WIDTHxHEIGHT -r FPS -i FILE
+ * Frames get their position with reserveFrame() and are converted by writeFrame(..) on any thread
+ * (FrameCapture uses the ThreadPool), the writer thread writes them in the order of their positions.
+ * At most maxQueuedFrames frames are reserved but not written yet, the caller drops frames
+ * (or waits) while canReserve() is false.
+ */
+class FrameStream
+{
+public:
+    enum class Format {
+        Y4M,
+        RAW
+    };
+
+    FrameStream(const std::filesystem::path& path, Format format, int width, int height, int framesPerSecond,
+                std::size_t maxQueuedFrames = 8);
+    // the writer thread refers to this object, so neither copy nor move it:
+    FrameStream(const FrameStream& other) = delete;
+    FrameStream& operator=(const FrameStream& other) = delete;
+    FrameStream(FrameStream&& other) = delete;
+    FrameStream& operator=(FrameStream&& other) = delete;
+    // close()
+    ~FrameStream();
+    // writes the frames that are converted already and stops the writer thread,
+    // reserved frames that never arrive are missing
+    void close();
+
+    // Y4M for .y4m files, RAW otherwise
+    static Format formatOf(const std::filesystem::path& path);
+
+    bool isValid() const {
+        return m_valid;
+    }
+    const std::filesystem::path& getPath() const {
+        return m_path;
+    }
+    int getWidth() const {
+        return m_width;
+    }
+    int getHeight() const {
+        return m_height;
+    }
+
+    bool canReserve() const;
+    // blocks until canReserve() or every reserved frame is handed to writeFrame(..) or skipFrame(..) already
+    void waitUntilReservable();
+    // the position of the next frame in the video
+    std::uint64_t reserveFrame();
+    // converts rgba (getWidth() x getHeight(), bottom row first) and queues it. Thread safe.
+    void writeFrame(std::uint64_t position, const GLubyte* rgba);
+    // the reserved frame will never arrive (e.g. its readback failed), the following frames move up
+    void skipFrame(std::uint64_t position);
+
+    std::uint64_t getWrittenCount() const;
+    std::uint64_t getSkippedCount() const;
+    std::uint64_t getQueuedCount() const;
+
+private:
+    void writerMain();
+    // called with m_mutex locked
+    void queue(std::uint64_t position, std::vector<GLubyte> frame);
+
+    std::filesystem::path m_path;
+    Format m_format;
+    int m_width;
+    int m_height;
+    std::size_t m_maxQueuedFrames;
+    std::size_t m_frameSize; // bytes of the three planes
+    std::ofstream m_file;    // only used by the writer thread after construction
+    bool m_valid;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_frameReady;
+    std::condition_variable m_frameWritten;
+    std::map<std::uint64_t, std::vector<GLubyte>> m_converted; // by position, empty for skipped frames
+    std::uint64_t m_reservedCount = 0;
+    std::uint64_t m_handedCount = 0;  // frames given to writeFrame(..) or skipFrame(..)
+    std::uint64_t m_finishedCount = 0; // frames written or skipped, the position of the next frame to write
+    std::uint64_t m_writtenCount = 0;
+    std::uint64_t m_skippedCount = 0;
+    bool m_stop = false;
+    std::thread m_writer; // last member: started after everything else is initialized
+};
+
+#endif // FRAMESTREAM_H
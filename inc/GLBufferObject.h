@@ -3,7 +3,11 @@
 
 #include <GL/glew.h>
 
+#include <cstdint>
+#include <string>
+
 #include "debug_utils.h"
+#include "GpuMemoryRegistry.h"
 
 class GLBufferObject {
 public:
@@ -39,15 +43,31 @@ public:
 
     bool isBound() const;
 
+    // buffer has to be bound. returns nullptr on failure.
+    void* mapRange(GLintptr offset, size_type length, GLbitfield access);
+    // buffer has to be bound. returns false if the data store got corrupted
+    // while it was mapped (the contents are undefined then).
+    bool unmap();
+
+    // name of the buffer in the GpuMemoryRegistry and in debug tools (glObjectLabel(..) if supported)
+    void setDebugLabel(const std::string& label);
+
     GLuint getRendererID() const {
         return m_rendererId;
     }
 
+    size_type getSize() const {
+        return m_size;
+    }
+
 private:
     static GLenum getBindingEnum(GLenum target);
+    static GpuMemoryCategory getMemoryCategory(GLenum target);
 
     GLenum m_target;
     GLuint m_rendererId;
+    size_type m_size;
+    std::uint64_t m_memoryId = 0; // in the GpuMemoryRegistry
 };
 
 
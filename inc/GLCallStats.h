@@ -0,0 +1,331 @@
+#ifndef GLCALLSTATS_H
+#define GLCALLSTATS_H
+
+#include <GL/glew.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <ostream>
+#include <tuple>
+#include <vector>
+
+enum class GLCallCategory : int {
+    DRAW = 0,       // draws, clears and blits
+    DISPATCH,       // compute dispatches
+    BIND,           // buffers, vertex arrays, programs, textures, framebuffers
+    STATE,          // fixed function state, vertex formats, texture parameters
+    UNIFORM,
+    BUFFER_UPLOAD,  // buffer data and mappings
+    TEXTURE_UPLOAD, // texture data, storage and mipmap generation
+    QUERY,          // glGet*(..), glIs*(..), ... (wait for the GL to answer)
+    SYNC,           // fences, query objects, glFinish(), glReadPixels(..), barriers
+    OBJECT,         // creation and deletion of GL objects, shader compilation
+    OTHER,
+    COUNT
+};
+
+// X(name, category, synchronous query) for the GL 1.1 entry points, which the OpenGL library exports
+// itself. Their calls are counted in the files that include this header (macros below).
+#define GL_CALL_STATS_EXPORTED_FUNCTIONS(X) \
+    X(BindTexture, BIND, false) \
+    X(BlendFunc, STATE, false) \
+    X(Clear, DRAW, false) \
+    X(ClearColor, STATE, false) \
+    X(ClearDepth, STATE, false) \
+    X(ColorMask, STATE, false) \
+    X(CullFace, STATE, false) \
+    X(DeleteTextures, OBJECT, false) \
+    X(DepthFunc, STATE, false) \
+    X(DepthMask, STATE, false) \
+    X(Disable, STATE, false) \
+    X(DrawArrays, DRAW, false) \
+    X(DrawElements, DRAW, false) \
+    X(Enable, STATE, false) \
+    X(Finish, SYNC, false) \
+    X(FrontFace, STATE, false) \
+    X(GenTextures, OBJECT, false) \
+    X(GetFloatv, QUERY, true) \
+    X(GetIntegerv, QUERY, true) \
+    X(GetString, QUERY, true) \
+    X(IsEnabled, QUERY, true) \
+    X(PixelStorei, STATE, false) \
+    X(ReadBuffer, STATE, false) \
+    X(ReadPixels, SYNC, false) \
+    X(TexImage2D, TEXTURE_UPLOAD, false) \
+    X(TexParameterf, STATE, false) \
+    X(TexParameteri, STATE, false) \
+    X(TexSubImage2D, TEXTURE_UPLOAD, false) \
+    X(Viewport, STATE, false)
+
+// X(name, category, synchronous query) for the entry points GLEW loads (function pointers __glew<name>),
+// their calls are counted everywhere once GLCallStats::install() replaced the pointers.
+#define GL_CALL_STATS_LOADED_FUNCTIONS(X) \
+    X(ActiveTexture, BIND, false) \
+    X(AttachShader, OBJECT, false) \
+    X(BeginQuery, SYNC, false) \
+    X(BindBuffer, BIND, false) \
+    X(BindBufferBase, BIND, false) \
+    X(BindFramebuffer, BIND, false) \
+    X(BindImageTexture, BIND, false) \
+    X(BindVertexArray, BIND, false) \
+    X(BindVertexBuffer, BIND, false) \
+    X(BlendEquation, STATE, false) \
+    X(BlendEquationSeparate, STATE, false) \
+    X(BlendFuncSeparate, STATE, false) \
+    X(BlitFramebuffer, DRAW, false) \
+    X(BufferData, BUFFER_UPLOAD, false) \
+    X(BufferSubData, BUFFER_UPLOAD, false) \
+    X(CheckFramebufferStatus, QUERY, true) \
+    X(ClearDepthf, STATE, false) \
+    X(ClientWaitSync, SYNC, false) \
+    X(CompileShader, OBJECT, false) \
+    X(CompressedTexSubImage2D, TEXTURE_UPLOAD, false) \
+    X(CopyBufferSubData, BUFFER_UPLOAD, false) \
+    X(CreateProgram, OBJECT, false) \
+    X(CreateShader, OBJECT, false) \
+    X(DebugMessageCallback, OTHER, false) \
+    X(DeleteBuffers, OBJECT, false) \
+    X(DeleteFramebuffers, OBJECT, false) \
+    X(DeleteProgram, OBJECT, false) \
+    X(DeleteQueries, OBJECT, false) \
+    X(DeleteShader, OBJECT, false) \
+    X(DeleteSync, OBJECT, false) \
+    X(DeleteVertexArrays, OBJECT, false) \
+    X(DispatchCompute, DISPATCH, false) \
+    X(DispatchComputeIndirect, DISPATCH, false) \
+    X(DrawArraysInstanced, DRAW, false) \
+    X(DrawBuffers, STATE, false) \
+    X(DrawElementsIndirect, DRAW, false) \
+    X(DrawElementsInstanced, DRAW, false) \
+    X(EnableVertexAttribArray, STATE, false) \
+    X(EndQuery, SYNC, false) \
+    X(FenceSync, SYNC, false) \
+    X(FramebufferTexture2D, OBJECT, false) \
+    X(GenBuffers, OBJECT, false) \
+    X(GenFramebuffers, OBJECT, false) \
+    X(GenQueries, OBJECT, false) \
+    X(GenVertexArrays, OBJECT, false) \
+    X(GenerateMipmap, TEXTURE_UPLOAD, false) \
+    X(GetAttribLocation, QUERY, true) \
+    X(GetIntegeri_v, QUERY, true) \
+    X(GetProgramInfoLog, QUERY, false) \
+    X(GetProgramiv, QUERY, true) \
+    X(GetQueryObjectiv, SYNC, false) \
+    X(GetQueryObjectui64v, SYNC, false) \
+    X(GetShaderInfoLog, QUERY, false) \
+    X(GetShaderiv, QUERY, true) \
+    X(GetUniformLocation, QUERY, true) \
+    X(LinkProgram, OBJECT, false) \
+    X(MapBufferRange, BUFFER_UPLOAD, false) \
+    X(MemoryBarrier, SYNC, false) \
+    X(MultiDrawElementsIndirect, DRAW, false) \
+    X(MultiDrawElementsIndirectCount, DRAW, false) \
+    X(MultiDrawElementsIndirectCountARB, DRAW, false) \
+    X(NamedBufferData, BUFFER_UPLOAD, false) \
+    X(ObjectLabel, OTHER, false) \
+    X(PrimitiveRestartIndex, STATE, false) \
+    X(QueryCounter, SYNC, false) \
+    X(ShaderSource, OBJECT, false) \
+    X(TexImage2DMultisample, TEXTURE_UPLOAD, false) \
+    X(TexStorage2D, TEXTURE_UPLOAD, false) \
+    X(TexStorage2DMultisample, TEXTURE_UPLOAD, false) \
+    X(TexStorage3D, TEXTURE_UPLOAD, false) \
+    X(TexSubImage3D, TEXTURE_UPLOAD, false) \
+    X(Uniform1f, UNIFORM, false) \
+    X(Uniform1fv, UNIFORM, false) \
+    X(Uniform1i, UNIFORM, false) \
+    X(Uniform1iv, UNIFORM, false) \
+    X(Uniform2f, UNIFORM, false) \
+    X(Uniform2i, UNIFORM, false) \
+    X(Uniform3f, UNIFORM, false) \
+    X(Uniform3fv, UNIFORM, false) \
+    X(Uniform4f, UNIFORM, false) \
+    X(Uniform4fv, UNIFORM, false) \
+    X(UniformMatrix3fv, UNIFORM, false) \
+    X(UniformMatrix4fv, UNIFORM, false) \
+    X(UnmapBuffer, BUFFER_UPLOAD, false) \
+    X(UseProgram, BIND, false) \
+    X(ValidateProgram, OBJECT, false) \
+    X(VertexArrayVertexBuffer, BIND, false) \
+    X(VertexAttribBinding, STATE, false) \
+    X(VertexAttribDivisor, STATE, false) \
+    X(VertexAttribFormat, STATE, false) \
+    X(VertexAttribIFormat, STATE, false) \
+    X(VertexAttribIPointer, STATE, false) \
+    X(VertexAttribLFormat, STATE, false) \
+    X(VertexAttribLPointer, STATE, false) \
+    X(VertexAttribPointer, STATE, false) \
+    X(VertexBindingDivisor, STATE, false)
+
+// the counted entry points, e.g. GLFunction::DrawElements for glDrawElements(..)
+enum class GLFunction : int {
+#define GL_CALL_STATS_ENUMERATOR(name, category, synchronous) name,
+    GL_CALL_STATS_EXPORTED_FUNCTIONS(GL_CALL_STATS_ENUMERATOR)
+    GL_CALL_STATS_LOADED_FUNCTIONS(GL_CALL_STATS_ENUMERATOR)
+#undef GL_CALL_STATS_ENUMERATOR
+    COUNT
+};
+
+struct GLCallFrameStats {
+    std::array<std::uint64_t, static_cast<std::size_t>(GLCallCategory::COUNT)> calls = {};
+    std::uint64_t synchronousQueries = 0; // calls of QUERY functions that wait for the GL (part of calls)
+
+    std::uint64_t getTotal() const;
+    GLCallFrameStats& operator+=(const GLCallFrameStats& other);
+};
+
+// a source line that issued synchronous queries inside a frame (debug builds only)
+struct GLSynchronousQuerySite {
+    GLFunction function;
+    const char* file;       // nullptr for calls through the GLEW function pointers (the site is unknown)
+    int line;
+    std::uint64_t calls;    // in all frames so far
+    std::uint64_t frames;   // number of frames with at least one call
+};
+
+// counts the GL calls of each frame by GLCallCategory. Calls through the function pointers GLEW loads are
+// intercepted by replacing the pointers with counting wrappers (install()), calls of the GL 1.1 entry points
+// by the macros of this header (in files that include it). Calls outside of beginFrame()/endFrame() are not
+// counted. In debug builds synchronous queries (glGetIntegerv(..), ...) inside a frame, e.g. the isBound()
+// checks of the GL wrappers, are flagged with their source line and reported once on std::cerr.
+// Counting is compiled in if OPENGL_DEMOS_GL_CALL_STATS is defined (cmake option). It is not synchronized,
+// GL calls are only made on the thread of the context.
+class GLCallStats
+{
+public:
+    static constexpr std::size_t categoryCount = static_cast<std::size_t>(GLCallCategory::COUNT);
+    static constexpr std::size_t functionCount = static_cast<std::size_t>(GLFunction::COUNT);
+    // frames of getAverage()
+    static constexpr std::size_t averageWindow = 64;
+
+    static GLCallStats& shared();
+
+    static const char* getCategoryName(GLCallCategory category);
+    static const char* getFunctionName(GLFunction function);
+    static GLCallCategory getCategory(GLFunction function);
+    static constexpr bool isSynchronousQuery(GLFunction function) {
+        return synchronousQueries[static_cast<std::size_t>(function)];
+    }
+
+    // false if counting is compiled out (without OPENGL_DEMOS_GL_CALL_STATS all counts stay 0)
+    static bool isEnabled();
+
+    // replaces the GLEW function pointers with counting wrappers, call it after glewInit()
+    // (does nothing without OPENGL_DEMOS_GL_CALL_STATS)
+    void install();
+    // restores the GLEW function pointers
+    void uninstall();
+    // number of replaced GLEW function pointers (entry points the context does not have are skipped)
+    std::size_t getInstalledCount() const {
+        return m_installedCount;
+    }
+
+    void beginFrame();
+    void endFrame();
+
+    // called by the wrappers and macros (inline and without lookup of shared(), they are on every GL call)
+    static void count(GLFunction function, [[maybe_unused]] const char* file = nullptr, [[maybe_unused]] int line = 0) {
+        ++s_calls[static_cast<std::size_t>(function)];
+#ifndef NDEBUG
+        if (isSynchronousQuery(function) && s_inFrame) {
+            recordSynchronousQuery(function, file, line);
+        }
+#endif
+    }
+
+    const GLCallFrameStats& getLastFrame() const {
+        return m_lastFrame;
+    }
+    // calls of each function in the last frame
+    const std::array<std::uint64_t, functionCount>& getLastFrameCalls() const {
+        return m_lastFrameCalls;
+    }
+    // mean over the last averageWindow frames
+    std::array<double, categoryCount> getAverage() const;
+
+    // sum over all frames since resetTotals(), e.g. to get the calls per frame of a benchmark
+    const GLCallFrameStats& getTotals() const {
+        return m_totals;
+    }
+    std::uint64_t getTotalFrameCount() const {
+        return m_totalFrames;
+    }
+    void resetTotals();
+
+    std::vector<GLSynchronousQuerySite> getSynchronousQuerySites() const;
+
+    // per category: calls per frame of a sum over frameCount frames (e.g. getTotals()),
+    // null if counting is compiled out (so it cannot be mistaken for frames without GL calls)
+    static void writeJson(std::ostream& os, const GLCallFrameStats& sum, std::uint64_t frameCount);
+    // window with the calls of the last frame and the flagged synchronous queries
+    void OnImGuiRender();
+
+private:
+    static constexpr std::array<bool, functionCount> synchronousQueries = {
+#define GL_CALL_STATS_SYNCHRONOUS(name, category, synchronous) synchronous,
+        GL_CALL_STATS_EXPORTED_FUNCTIONS(GL_CALL_STATS_SYNCHRONOUS)
+        GL_CALL_STATS_LOADED_FUNCTIONS(GL_CALL_STATS_SYNCHRONOUS)
+#undef GL_CALL_STATS_SYNCHRONOUS
+    };
+
+    GLCallStats() = default;
+    static void recordSynchronousQuery(GLFunction function, const char* file, int line);
+
+    static inline std::array<std::uint64_t, functionCount> s_calls = {};
+    static inline bool s_inFrame = false;
+
+    std::size_t m_installedCount = 0;
+    std::uint64_t m_frameNumber = 0;
+    GLCallFrameStats m_lastFrame;
+    std::array<std::uint64_t, functionCount> m_lastFrameCalls = {};
+    std::deque<GLCallFrameStats> m_recentFrames; // (the last averageWindow)
+    GLCallFrameStats m_totals;
+    std::uint64_t m_totalFrames = 0;
+
+    struct SiteStats {
+        std::uint64_t calls = 0;
+        std::uint64_t frames = 0;
+        std::uint64_t lastFrame = ~std::uint64_t(0);
+    };
+    std::map<std::tuple<GLFunction, const char*, int>, SiteStats> m_synchronousQuerySites;
+};
+
+// counting versions of the GL 1.1 entry points (a macro does not expand itself again, so the inner call
+// is the exported function). GLEW dispatches the other entry points through macros the same way.
+#ifdef OPENGL_DEMOS_GL_CALL_STATS
+#define GL_CALL_STATS_COUNT(name) GLCallStats::count(GLFunction::name, __FILE__, __LINE__)
+#define glBindTexture(...) (GL_CALL_STATS_COUNT(BindTexture), glBindTexture(__VA_ARGS__))
+#define glBlendFunc(...) (GL_CALL_STATS_COUNT(BlendFunc), glBlendFunc(__VA_ARGS__))
+#define glClear(...) (GL_CALL_STATS_COUNT(Clear), glClear(__VA_ARGS__))
+#define glClearColor(...) (GL_CALL_STATS_COUNT(ClearColor), glClearColor(__VA_ARGS__))
+#define glClearDepth(...) (GL_CALL_STATS_COUNT(ClearDepth), glClearDepth(__VA_ARGS__))
+#define glColorMask(...) (GL_CALL_STATS_COUNT(ColorMask), glColorMask(__VA_ARGS__))
+#define glCullFace(...) (GL_CALL_STATS_COUNT(CullFace), glCullFace(__VA_ARGS__))
+#define glDeleteTextures(...) (GL_CALL_STATS_COUNT(DeleteTextures), glDeleteTextures(__VA_ARGS__))
+#define glDepthFunc(...) (GL_CALL_STATS_COUNT(DepthFunc), glDepthFunc(__VA_ARGS__))
+#define glDepthMask(...) (GL_CALL_STATS_COUNT(DepthMask), glDepthMask(__VA_ARGS__))
+#define glDisable(...) (GL_CALL_STATS_COUNT(Disable), glDisable(__VA_ARGS__))
+#define glDrawArrays(...) (GL_CALL_STATS_COUNT(DrawArrays), glDrawArrays(__VA_ARGS__))
+#define glDrawElements(...) (GL_CALL_STATS_COUNT(DrawElements), glDrawElements(__VA_ARGS__))
+#define glEnable(...) (GL_CALL_STATS_COUNT(Enable), glEnable(__VA_ARGS__))
+#define glFinish(...) (GL_CALL_STATS_COUNT(Finish), glFinish(__VA_ARGS__))
+#define glFrontFace(...) (GL_CALL_STATS_COUNT(FrontFace), glFrontFace(__VA_ARGS__))
+#define glGenTextures(...) (GL_CALL_STATS_COUNT(GenTextures), glGenTextures(__VA_ARGS__))
+#define glGetFloatv(...) (GL_CALL_STATS_COUNT(GetFloatv), glGetFloatv(__VA_ARGS__))
+#define glGetIntegerv(...) (GL_CALL_STATS_COUNT(GetIntegerv), glGetIntegerv(__VA_ARGS__))
+#define glGetString(...) (GL_CALL_STATS_COUNT(GetString), glGetString(__VA_ARGS__))
+#define glIsEnabled(...) (GL_CALL_STATS_COUNT(IsEnabled), glIsEnabled(__VA_ARGS__))
+#define glPixelStorei(...) (GL_CALL_STATS_COUNT(PixelStorei), glPixelStorei(__VA_ARGS__))
+#define glReadBuffer(...) (GL_CALL_STATS_COUNT(ReadBuffer), glReadBuffer(__VA_ARGS__))
+#define glReadPixels(...) (GL_CALL_STATS_COUNT(ReadPixels), glReadPixels(__VA_ARGS__))
+#define glTexImage2D(...) (GL_CALL_STATS_COUNT(TexImage2D), glTexImage2D(__VA_ARGS__))
+#define glTexParameterf(...) (GL_CALL_STATS_COUNT(TexParameterf), glTexParameterf(__VA_ARGS__))
+#define glTexParameteri(...) (GL_CALL_STATS_COUNT(TexParameteri), glTexParameteri(__VA_ARGS__))
+#define glTexSubImage2D(...) (GL_CALL_STATS_COUNT(TexSubImage2D), glTexSubImage2D(__VA_ARGS__))
+#define glViewport(...) (GL_CALL_STATS_COUNT(Viewport), glViewport(__VA_ARGS__))
+#endif
+
+#endif // GLCALLSTATS_H
@@ -0,0 +1,36 @@
+#ifndef GLFENCE_H
+#define GLFENCE_H
+
+#include <GL/glew.h>
+
+// sync object that is signaled once the GPU finished all commands issued before its construction.
+class GLFence
+{
+public:
+    GLFence();
+    // do not allow copy:
+    GLFence(const GLFence& other) = delete;
+    GLFence& operator=(const GLFence& other) = delete;
+    // do allow move:
+    GLFence(GLFence&& other) noexcept;
+    GLFence& operator=(GLFence&& other);
+    //  warning: moved from object must be destroyed or
+    //           assigned to before being used again
+
+    ~GLFence();
+
+    // never blocks. The first call flushes the command stream so that the
+    // fence is guaranteed to be signaled eventually.
+    bool isSignaled();
+
+    // blocks for at most timeout_ns nanoseconds, returns whether the fence is signaled.
+    bool wait(GLuint64 timeout_ns);
+
+private:
+    bool clientWait(GLuint64 timeout_ns);
+
+    GLsync m_sync;
+    bool m_flushed = false;
+};
+
+#endif // GLFENCE_H
@@ -4,6 +4,9 @@
 #include <GL/glew.h>
 #include <gsl/gsl> // for gsl::span<>
 
+#include <cstdint>
+#include <string>
+
 #include "GLTexture.h"
 
 class GLFramebufferObject
@@ -31,6 +34,20 @@ public:
     void attachTexture(GLenum attachment, const GLTexture& texture, GLint mipLevel = 0);
     void unattachTexture(GLenum attachment);
 
+    // copies the width x height region at the origin of the read buffer of this fbo into the
+    // draw buffers of dst (resolves multisampled attachments). Leaves dst bound to GL_DRAW_FRAMEBUFFER.
+    void blitTo(GLFramebufferObject& dst, GLint width, GLint height, GLbitfield mask = GL_COLOR_BUFFER_BIT);
+    // same into the back buffer of the default framebuffer. Leaves it bound to GL_DRAW_FRAMEBUFFER.
+    void blitToDefault(GLint width, GLint height, GLbitfield mask = GL_COLOR_BUFFER_BIT);
+
+    // reads the width x height region at (x, y) of the read buffer (GL_COLOR_ATTACHMENT0 unless changed)
+    // into pixels. Waits for all rendering into the fbo to finish unless a buffer is bound to
+    // GL_PIXEL_PACK_BUFFER (then pixels is an offset into that buffer).
+    void readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* pixels);
+
+    // name of the fbo in the GpuMemoryRegistry and in debug tools (glObjectLabel(..) if supported)
+    void setDebugLabel(const std::string& label);
+
     GLenum checkFramebufferStatus() const;
 
     static GLuint getMaxDrawBuffers();
@@ -43,6 +60,7 @@ private:
     // false if this fbo or the default framebuffer is bound:
     bool isOtherFBObound(GLenum target = GL_DRAW_FRAMEBUFFER) const;
     GLuint m_rendererId;
+    std::uint64_t m_memoryId = 0; // in the GpuMemoryRegistry
 };
 
 #endif // GLFRAMEBUFFEROBJECT_H
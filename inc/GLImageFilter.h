@@ -0,0 +1,66 @@
+#ifndef GLIMAGEFILTER_H
+#define GLIMAGEFILTER_H
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "GLRenderer.h"
+#include "GLShaderProgram.h"
+#include "GLTexture.h"
+#include "RenderTargetPool.h"
+#include "cpu_image_filter.h"
+
+// convolution of float textures with compute shaders (requires OpenGL 4.3).
+// Same kernel semantics and edge handling as applyConvolution(..) (cpu_image_filter.h):
+//  - general kernels run in one pass (ConvolutionTiled.shader): each work group loads its
+//      16 x 16 pixels with the apron of the kernel into shared memory once
+//  - separable kernels run as a horizontal and a vertical 1D pass (ConvolutionSeparable.shader),
+//      i.e. 2 * (2r + 1) instead of (2r + 1)^2 taps per pixel. The intermediate result lives in
+//      a texture of the RenderTargetPool (signed, with the precision of the input).
+// The shaders are compiled once per output format (the image format of imageStore(..) has to match).
+class GLImageFilter
+{
+public:
+    GLImageFilter();
+
+    // do not allow copy or move (owns the shader programs):
+    GLImageFilter(const GLImageFilter& other) = delete;
+    GLImageFilter& operator=(const GLImageFilter& other) = delete;
+
+    // filters the width x height region at the origin of input into the same region of output
+    // (they can be larger, e.g. from the RenderTargetPool, but must not be the same).
+    // output needs a format that getImageFormat(..) knows, e.g. from RenderTargetPool::chooseFormat(..).
+    // input is sampled through texture unit texUnit, output is bound to image unit 0.
+    // Ends with a barrier, so output can be sampled right away.
+    void apply(GLRenderer& renderer, const ConvolutionKernel& kernel, GLTexture& input, GLTexture& output,
+               GLsizei width, GLsizei height, RenderTargetPool& pool, int texUnit);
+
+    // sets u_radius (ivec2), u_weights[] and u_absolute of a shader that applies the whole
+    // 2D kernel (e.g. ConvolutionTiled.shader or Filter.shader). The program has to be bound.
+    static void setKernelUniforms(GLShaderProgram& sp, const ConvolutionKernel& kernel);
+
+    // GLSL image format qualifier of internalformat (e.g. "r11f_g11f_b10f"), nullptr if not supported
+    static const char* getImageFormat(GLenum internalformat);
+
+private:
+    struct Programs {
+        std::unique_ptr<GLShaderProgram> tiled;
+        std::unique_ptr<GLShaderProgram> separable;
+    };
+
+    // compiles the programs for outputs of the format on first use:
+    Programs& getPrograms(GLenum outputFormat);
+
+    void dispatchTiled(GLRenderer& renderer, const ConvolutionKernel& kernel, GLTexture& input, GLTexture& output,
+                       GLsizei width, GLsizei height, int texUnit);
+    // one 1D pass of a separable kernel along direction ((1, 0) or (0, -1)):
+    void dispatchLine(GLRenderer& renderer, const float* weights, int radius, int dirX, int dirY, bool absolute,
+                      GLTexture& input, GLTexture& output, GLsizei width, GLsizei height, int texUnit);
+
+    std::unordered_map<GLenum, Programs> m_programs; // by output format
+};
+
+#endif // GLIMAGEFILTER_H
@@ -68,8 +68,9 @@ public:
         return *m_primitiveRestartIndex;
     }
 
-private:
     static GLuint getIndexSize(GLenum type);
+
+private:
     GLenum m_indexType;
     count_type m_count;
     GLenum m_primitiveType = GL_TRIANGLES;
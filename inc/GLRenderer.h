@@ -5,6 +5,7 @@
 #include "GLVertexBuffer.h"
 #include "GLIndexBuffer.h"
 #include "GLShaderProgram.h"
+#include "GpuProfiler.h"
 
 class GLRenderer
 {
@@ -43,6 +44,10 @@ public:
 
     void setDepthFunc(GLenum func = GL_LESS);
 
+    void setDepthMask(bool writeDepth = true);
+
+    void setColorMask(bool red = true, bool green = true, bool blue = true, bool alpha = true);
+
     void enableBlending();
 
     void disableBlending();
@@ -62,6 +67,39 @@ public:
     bool isEnabled_framebuffer_sRGB() const;
 
     void draw(GLVertexArray& va, GLIndexBuffer& ib, GLShaderProgram& shaderP) const;
+
+    // draws ib with the vertex array and shader program that are currently bound
+    // (ib has to be bound, too). For callers that keep track of the bound state, e.g. RenderQueue.
+    void drawBound(const GLIndexBuffer& ib) const;
+
+    // same for count indices starting at index first of ib:
+    void drawBound(const GLIndexBuffer& ib, GLIndexBuffer::count_type first, GLIndexBuffer::count_type count) const;
+
+    // draws the drawCount DrawElementsIndirectCommands at the start of the buffer bound to
+    // GL_DRAW_INDIRECT_BUFFER with the bound vertex array, program and ib (requires OpenGL 4.3)
+    void multiDrawIndirectBound(const GLIndexBuffer& ib, GLsizei drawCount) const;
+
+    // same, but the number of commands is the GLuint at the start of the buffer bound to GL_PARAMETER_BUFFER
+    // (at most maxDrawCount), see supportsIndirectCount()
+    void multiDrawIndirectCountBound(const GLIndexBuffer& ib, GLsizei maxDrawCount) const;
+
+    // OpenGL 4.6 or ARB_indirect_parameters
+    static bool supportsIndirectCount();
+
+    // runs the compute shader of the bound shader program (requires OpenGL 4.3)
+    void dispatchCompute(GLuint groupsX, GLuint groupsY = 1, GLuint groupsZ = 1) const;
+
+    // makes writes of shaders (e.g. imageStore(..)) visible to the accesses in barriers,
+    // e.g. GL_TEXTURE_FETCH_BARRIER_BIT before sampling an image written by a compute shader
+    void memoryBarrier(GLbitfield barriers) const;
+
+    // GPU timings of the frames rendered with this renderer (main() begins and ends the frames)
+    GpuProfiler& getProfiler() {
+        return m_profiler;
+    }
+
+private:
+    GpuProfiler m_profiler;
 };
 
 #endif // GLRENDERER_H
@@ -82,10 +82,19 @@ public:
 
     void setUniform1i(const std::string& name, int v);
 
+    void setUniform2i(GLint location, int v0, int v1);
+
+    void setUniform2i(const std::string& name, int v0, int v1);
+
     void setUniform1f(GLint location, float value);
 
     void setUniform1f(const std::string& name, float value);
 
+    // count elements of a float array
+    void setUniform1fv(GLint location, GLsizei count, const GLfloat* values);
+
+    void setUniform1fv(const std::string& name, GLsizei count, const GLfloat* values);
+
     void setUniform3f(GLint location, float v0, float v1, float v2);
 
     void setUniform3f(const std::string& name, float v0, float v1, float v2);
@@ -108,8 +117,11 @@ public:
 
     bool isBound() const;
 
-private:
+    // splits a .shader file into its "#shader <type>" sections
+    // (e.g. to modify the sources before passing them to the constructor)
     static std::vector<ShaderSource> parseShader(const std::filesystem::path& filepath);
+
+private:
     static const std::unordered_map<std::string, GLenum> shaderTypes;
 
     void printShaderProgramInfoLog() const;
@@ -3,8 +3,13 @@
 
 #include <GL/glew.h>
 
+#include <cstdint>
 #include <vector>
 #include <filesystem>
+#include <string>
+
+#include "cpu_image_structs.h"
+#include "GpuMemoryRegistry.h"
 
 
 struct Tex2DSamplingParams {
@@ -34,8 +39,20 @@ class GLTexture
 public:
     GLTexture() = delete;
     GLTexture(int width, int height, GLenum internalformat, const Tex2DSamplingParams &sampParams);
+    // multisampled texture (GL_TEXTURE_2D_MULTISAMPLE) without mip levels, only useful as
+    // framebuffer attachment (resolve it with GLFramebufferObject::blitTo(..) or read it with texelFetch(..))
+    GLTexture(int width, int height, GLenum internalformat, GLsizei samples);
     GLTexture(std::filesystem::path filepath, int channels = 3, bool sRGB = false,
               const Tex2DSamplingParams& sampParams = texture_sampling_presets::filterPretty);
+    // generates the mip chain on the CPU if the sampling parameters require it
+    GLTexture(const CPUImage& image, bool sRGB = false,
+              const Tex2DSamplingParams& sampParams = texture_sampling_presets::filterPretty);
+    // uploads all mip levels the sampling parameters require from the mip chain
+    GLTexture(const CPUTexture& texture,
+              const Tex2DSamplingParams& sampParams = texture_sampling_presets::filterPretty);
+    // uploads all mip levels the sampling parameters require from the block compressed texture
+    GLTexture(const CPUCompressedTexture& texture,
+              const Tex2DSamplingParams& sampParams = texture_sampling_presets::filterPretty);
     // do not allow copying:
     GLTexture(const GLTexture& other) = delete;
     GLTexture& operator=(const GLTexture& other) = delete;
@@ -51,19 +68,81 @@ public:
     void bind(int texUnit = 0);
     void unbind();
 
+    // uploads a whole mip level with the pixel layout of a CPUImage with the given
+    // number of channels. If a buffer is bound to GL_PIXEL_UNPACK_BUFFER, pixels
+    // is an offset into that buffer and the call returns without waiting for the copy.
+    // leaves the texture bound to the active texture unit.
+    void setImage(GLint level, int channels, const GLvoid* pixels);
+    // same as setImage(..) for the width x height region at (x, y) of the mip level.
+    void setSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                     int channels, const GLvoid* pixels);
+    // same for 4 channel float pixels (e.g. of a CPUImageRGBA32F).
+    void setSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, const GLfloat* rgba);
+    // uploads one level of a texture with block compressed internal format. If a buffer is
+    // bound to GL_PIXEL_UNPACK_BUFFER, blocks is an offset into that buffer.
+    // leaves the texture bound to the active texture unit.
+    void setCompressedImage(GLint level, GLsizei byteSize, const GLvoid* blocks);
+
+    // binds a mip level to image unit unit for imageLoad(..)/imageStore(..) in shaders with the
+    // internal format of the texture as image format (requires OpenGL 4.2).
+    // access is GL_READ_ONLY, GL_WRITE_ONLY or GL_READ_WRITE.
+    void bindImage(GLuint unit, GLenum access, GLint level = 0);
+
+    // name of the texture in the GpuMemoryRegistry and in debug tools (glObjectLabel(..) if supported)
+    void setDebugLabel(const std::string& label);
+    // textures are registered as GpuMemoryCategory::TEXTURE
+    void setMemoryCategory(GpuMemoryCategory category);
+
     GLuint getRendererId() const {
         return m_rendererId;
     }
+    // GL_TEXTURE_2D or GL_TEXTURE_2D_MULTISAMPLE
+    GLenum getTarget() const {
+        return m_target;
+    }
+    // 1 for textures that are not multisampled
+    GLsizei getSampleCount() const {
+        return m_samples;
+    }
+    GLsizei getWidth() const {
+        return m_width;
+    }
+    GLsizei getHeight() const {
+        return m_height;
+    }
+    GLsizei getMipLevelCount() const {
+        return m_mipLevels;
+    }
+    GLenum getInternalFormat() const {
+        return m_internalformat;
+    }
+
+    // R8, RG8, RGBA8 or SRGB8_ALPHA8. 3 channel formats are not supported because
+    // drivers usually have to convert them on upload.
+    static GLenum getInternalFormat(int channels, bool sRGB);
+    // number of channels an image with the given number of used channels
+    // should be decoded to, such that it can be uploaded without conversion.
+    static int getUploadChannelCount(int channels) {
+        return (channels == 3) ? 4 : channels;
+    }
+    // S3TC formats (EXT_texture_compression_s3tc, EXT_texture_sRGB)
+    static GLenum getCompressedInternalFormat(BlockFormat format, bool sRGB);
+    // number of levels of a full mip chain down to 1x1
+    static GLsizei computeMipLevelCount(GLsizei width, GLsizei height);
+    // largest GL_UNPACK_ALIGNMENT that tightly packed rows of the given size satisfy
+    static GLint computeUnpackAlignment(std::size_t rowSize);
 private:
     void initAndKeepBound(int width, int height, GLenum internalformat, const Tex2DSamplingParams &sampParams);
     bool isBoundToActiveUnit() const;
-    static GLsizei computeMipLevelCount(GLsizei width, GLsizei height);
-    static std::vector<GLubyte> makeCheckerPattern(GLsizei& width, GLsizei& height);
 
     GLuint m_rendererId;
+    GLenum m_target = GL_TEXTURE_2D;
+    GLsizei m_samples = 1;
     GLsizei m_width;
     GLsizei m_height;
     GLsizei m_mipLevels;
+    GLenum m_internalformat;
+    std::uint64_t m_memoryId = 0; // in the GpuMemoryRegistry
 };
 
 #endif // TEXTURE_H
@@ -0,0 +1,73 @@
+#ifndef GLTEXTUREARRAY_H
+#define GLTEXTUREARRAY_H
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+#include "GLTexture.h" // for Tex2DSamplingParams
+#include "cpu_texture_packing.h"
+
+// GL_TEXTURE_2D_ARRAY: layers of equal size and format that are bound to a single
+// texture unit, so draws with different textures (layers) do not need rebinding.
+class GLTextureArray
+{
+public:
+    GLTextureArray() = delete;
+    GLTextureArray(int width, int height, int layers, GLenum internalformat,
+                   const Tex2DSamplingParams& sampParams = texture_sampling_presets::filterPretty);
+    // uploads the layers of the pack. If the sampling parameters require mipmaps,
+    // the mip chain of every layer is generated on the CPU.
+    GLTextureArray(const CPUTexturePack& pack,
+                   const Tex2DSamplingParams& sampParams = texture_sampling_presets::filterPretty);
+    // do not allow copying:
+    GLTextureArray(const GLTextureArray& other) = delete;
+    GLTextureArray& operator=(const GLTextureArray& other) = delete;
+    // do allow moving:
+    GLTextureArray(GLTextureArray&& other) noexcept;
+    GLTextureArray& operator=(GLTextureArray&& other);
+    //  warning: moved from object must be destroyed or
+    //           assigned to before being used again
+
+    ~GLTextureArray();
+
+    void bind(int texUnit = 0);
+    void unbind();
+
+    // uploads a whole mip level of one layer with the pixel layout of a CPUImage with the
+    // given number of channels. leaves the texture bound to the active texture unit.
+    void setLayerImage(GLint level, GLint layer, int channels, const GLvoid* pixels);
+
+    // name of the texture in the GpuMemoryRegistry and in debug tools (glObjectLabel(..) if supported)
+    void setDebugLabel(const std::string& label);
+
+    GLuint getRendererId() const {
+        return m_rendererId;
+    }
+    GLsizei getWidth() const {
+        return m_width;
+    }
+    GLsizei getHeight() const {
+        return m_height;
+    }
+    GLsizei getLayerCount() const {
+        return m_layers;
+    }
+    GLsizei getMipLevelCount() const {
+        return m_mipLevels;
+    }
+
+private:
+    void initAndKeepBound(int width, int height, int layers, GLenum internalformat, const Tex2DSamplingParams &sampParams);
+    bool isBoundToActiveUnit() const;
+
+    GLuint m_rendererId;
+    GLsizei m_width;
+    GLsizei m_height;
+    GLsizei m_layers;
+    GLsizei m_mipLevels;
+    std::uint64_t m_memoryId = 0; // in the GpuMemoryRegistry
+};
+
+#endif // GLTEXTUREARRAY_H
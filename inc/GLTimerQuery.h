@@ -0,0 +1,50 @@
+#ifndef GLTIMERQUERY_H
+#define GLTIMERQUERY_H
+
+#include <GL/glew.h>
+
+#include <array>
+#include <optional>
+
+// measures the GPU time spent between begin() and end() with GL_TIME_ELAPSED queries.
+// The results are read back a few frames later (when they are available) so that
+// measuring never stalls the pipeline. If all queries of the ring are still in flight
+// begin()/end() silently skip the measurement of the current frame.
+// note: GL_TIME_ELAPSED queries can not be nested.
+class GLTimerQuery
+{
+public:
+    GLTimerQuery();
+    // do not allow copy:
+    GLTimerQuery(const GLTimerQuery& other) = delete;
+    GLTimerQuery& operator=(const GLTimerQuery& other) = delete;
+    // do allow move:
+    GLTimerQuery(GLTimerQuery&& other) noexcept;
+    GLTimerQuery& operator=(GLTimerQuery&& other);
+    //  warning: moved from object must be destroyed or
+    //           assigned to before being used again
+
+    ~GLTimerQuery();
+
+    void begin();
+    void end();
+
+    // collects all results that became available since the last call
+    // and returns the newest one in milliseconds (empty if there never was one):
+    std::optional<double> poll();
+
+    std::optional<double> getLastResult_ms() const {
+        return m_lastResult_ms;
+    }
+
+private:
+    static constexpr int ringSize = 4;
+
+    std::array<GLuint, ringSize> m_queries;
+    int m_next = 0;      // index of the query used by the next begin()
+    int m_inFlight = 0;  // number of queries that ended but were not read back yet
+    bool m_active = false;
+    std::optional<double> m_lastResult_ms = {};
+};
+
+#endif // GLTIMERQUERY_H
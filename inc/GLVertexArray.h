@@ -28,7 +28,15 @@ public:
 
     ~GLVertexArray();
 
-    void addBuffer(const GLVertexBuffer& vb, const VertexBufferLayout& layout);
+    // bindingIndex selects the vertex buffer binding point the buffer is attached to.
+    // a VAO can read from several buffers at once (one per binding index), e.g. for
+    // meshes that were split into several streams with splitVertexArray(..).
+    // A VAO for a depth-only pass can be created by only adding the position stream.
+    void addBuffer(const GLVertexBuffer& vb, const VertexBufferLayout& layout, GLuint bindingIndex = 0);
+
+    // divisor 0: the attributes of the binding advance per vertex,
+    // divisor n > 0: they advance once per n instances (starting at the baseInstance of the draw)
+    void setBindingDivisor(GLuint bindingIndex, GLuint divisor);
 
     void bind() {
         glBindVertexArray(m_rendererID);
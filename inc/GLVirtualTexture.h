@@ -0,0 +1,84 @@
+#ifndef GLVIRTUALTEXTURE_H
+#define GLVIRTUALTEXTURE_H
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "GLShaderProgram.h"
+#include "GLTexture.h"
+#include "VirtualTexturePageFile.h"
+#include "VirtualTextureResidency.h"
+
+/**
+ * texture that is streamed page by page from a VTPageFile, so only the pages the
+ * feedback pass reports have to be resident:
+ *  - physical cache: texture of slotsX x slotsY padded pages (sized by the memory budget)
+ *  - page table: one texel per page and one mip level per level of the virtual texture,
+ *      see VTResidency::PageTableEntry
+ *  - loader thread: reads the requested pages from disk
+ * The shaders in VirtualTexture.shader translate virtual to physical coordinates.
+ */
+class GLVirtualTexture
+{
+public:
+    GLVirtualTexture(VTPageFile pageFile, std::size_t memoryBudgetBytes);
+    // the loader thread refers to this object, so neither copy nor move it:
+    GLVirtualTexture(const GLVirtualTexture& other) = delete;
+    GLVirtualTexture& operator=(const GLVirtualTexture& other) = delete;
+    GLVirtualTexture(GLVirtualTexture&& other) = delete;
+    GLVirtualTexture& operator=(GLVirtualTexture&& other) = delete;
+
+    ~GLVirtualTexture();
+
+    // call once per frame with the pages reported by the feedback pass. Hands missing pages
+    // to the loader thread, copies at most maxUploads loaded pages into the physical cache
+    // and uploads the page table if it changed.
+    void update(const std::vector<VTPageId>& feedback, std::size_t maxUploads = 8);
+
+    // binds both textures and sets the u_vt_* uniforms used by VirtualTexture.shader
+    void bind(GLShaderProgram& shaderP, int physicalTexUnit, int pageTableTexUnit);
+
+    const VTLayout& getLayout() const {
+        return m_residency.getLayout();
+    }
+    const VTResidency& getResidency() const {
+        return m_residency;
+    }
+    std::size_t getUploadCount() const {
+        return m_uploadCount;
+    }
+    // bytes of the physical cache and the page table on the GPU
+    std::size_t getGPUMemorySize() const;
+
+    // number of pages the loader reads ahead at most
+    static constexpr std::size_t maxInFlight = 32;
+
+private:
+    struct LoadedPage {
+        VTPageId page;
+        std::vector<GLubyte> data; // empty if reading failed
+    };
+
+    void loaderMain();
+
+    VTPageFile m_pageFile; // only used by the loader thread after construction
+    VTResidency m_residency;
+    GLTexture m_physicalTex;
+    GLTexture m_pageTableTex;
+    std::size_t m_uploadCount = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_requestAvailable;
+    std::deque<VTPageId> m_requests;
+    std::vector<LoadedPage> m_loaded;
+    bool m_stop = false;
+    std::thread m_loader; // last member: started after everything else is initialized
+};
+
+#endif // GLVIRTUALTEXTURE_H
@@ -0,0 +1,137 @@
+#ifndef GPUCULLING_H
+#define GPUCULLING_H
+
+#include <GL/glew.h>
+#include <gsl/gsl> // for gsl::span<>
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+#include "glm/glm.hpp"
+
+#include "GLBufferObject.h"
+#include "GLFence.h"
+#include "GLIndexBuffer.h"
+#include "GLRenderer.h"
+#include "GLShaderProgram.h"
+#include "GLTexture.h"
+#include "GLVertexArray.h"
+#include "GLVertexBuffer.h"
+#include "VertexBufferLayout.h"
+
+// layout of the commands of glMultiDrawElementsIndirect(..)
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// one object for GpuCulling (std430 layout of the Objects buffer in the shaders).
+// The index range is drawn from the index buffer of GpuCulling::draw(..).
+struct GpuCullingObject {
+    glm::vec4 boundingSphere_oc; // center (xyz) and radius (w) in object coordinates
+    GLuint indexCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint materialIndex;        // only read by the draw shader
+};
+
+struct GpuCullingStats {
+    std::size_t objects = 0;
+    std::size_t visible = 0;     // of a frame some frames ago (read back without waiting)
+    bool occlusion = false;      // whether that frame was tested against a Hi-Z pyramid
+};
+
+// Visibility of many objects decided on the GPU, so the GL thread issues the same few calls no matter
+// how many objects there are:
+//  - the world transforms of all objects are written into a mapped shader storage buffer (on any thread)
+//  - cull(..) runs GpuCulling.shader with one invocation per object: its bounding sphere is tested against
+//      the frustum and against a Hi-Z pyramid (maximum depth per texel of each mip level) of the previous
+//      frame. The visible objects are appended as DrawElementsIndirectCommands, their count goes to a
+//      buffer that glMultiDrawElementsIndirectCount(..) reads (GL 4.6 or ARB_indirect_parameters).
+//      Without indirect count, every object keeps its command and hidden objects get 0 instances.
+//  - draw(..) is a single indirect multi-draw. Every command has the index of its object as baseInstance,
+//      the draw shader reads it from the instanced attribute at objectIndexLocation
+//      ("layout(location = 15) in uint objectIndex;") and the object data from the buffers at
+//      transformsBinding and objectsBinding.
+//  - buildHiZ(..) reduces the depth buffer the visible objects were drawn into for the next cull(..).
+// Objects that were hidden behind objects which moved away show up one frame late.
+class GpuCulling
+{
+public:
+    // shader storage buffer bindings:
+    static constexpr GLuint transformsBinding = 0;  // mat4 wc_from_oc[]
+    static constexpr GLuint objectsBinding = 1;     // GpuCullingObject[]
+    static constexpr GLuint commandsBinding = 2;    // DrawElementsIndirectCommand[]
+    static constexpr GLuint drawCountBinding = 3;   // uint
+    // the object index of the draw shaders:
+    static constexpr GLuint objectIndexLocation = 15;
+    static constexpr GLuint objectIndexBindingIndex = 15;
+
+    GpuCulling();
+    // do not allow copy or move (the vertex arrays of draw(..) refer to the object index buffer):
+    GpuCulling(const GpuCulling& other) = delete;
+    GpuCulling& operator=(const GpuCulling& other) = delete;
+
+    // replaces the objects, the buffers only grow
+    void setObjects(gsl::span<const GpuCullingObject> objects);
+    std::size_t getObjectCount() const {
+        return m_objectCount;
+    }
+
+    // the world transforms of this frame, write all getObjectCount() of them (also on other threads)
+    // before unmapTransforms(). The previous contents are discarded.
+    glm::mat4* mapTransforms();
+    void unmapTransforms();
+
+    // writes the commands of the objects that are visible with ndc_from_wc
+    void cull(GLRenderer& renderer, const glm::mat4& ndc_from_wc);
+    // draws the commands of the last cull(..) with the bound program, the vertex array va and ib.
+    // Attaches the object index buffer to va. Leaves va bound.
+    void draw(GLRenderer& renderer, GLVertexArray& va, GLIndexBuffer& ib);
+    // max depth pyramid of depth, which was rendered with ndc_from_wc, for the occlusion test of the
+    // next cull(..). depth is bound to texture unit texUnit.
+    void buildHiZ(GLRenderer& renderer, GLTexture& depth, const glm::mat4& ndc_from_wc, int texUnit);
+    // the next cull(..) only tests the frustum, e.g. after the depth buffer was not drawn by draw(..)
+    void invalidateHiZ() {
+        m_hiZValid = false;
+    }
+
+    GpuCullingStats getStats();
+
+private:
+    struct Readback {
+        GLBufferObject buffer;  // the visible count
+        std::optional<GLFence> fence;
+        bool occlusion = false;
+    };
+
+    void pollReadbacks();
+
+    std::unique_ptr<GLShaderProgram> m_cullSP;
+    std::unique_ptr<GLShaderProgram> m_hiZSP;
+    bool m_compact;
+
+    std::size_t m_objectCount = 0;
+    std::size_t m_capacity = 0;
+    std::optional<GLBufferObject> m_transforms;
+    std::optional<GLBufferObject> m_objects;
+    std::optional<GLBufferObject> m_commands;
+    std::optional<GLVertexBuffer> m_objectIndices; // i at index i, instanced attribute
+    GLBufferObject m_drawCount;
+    VertexBufferLayout m_objectIndexLayout;
+
+    std::optional<GLTexture> m_hiZ; // GL_R32F with the size of the depth buffer, full mip chain
+    glm::mat4 m_hiZ_ndc_from_wc;
+    bool m_hiZValid = false;
+
+    std::array<std::optional<Readback>, 3> m_readbacks;
+    std::size_t m_nextReadback = 0;
+    GpuCullingStats m_stats;
+};
+
+#endif // GPUCULLING_H
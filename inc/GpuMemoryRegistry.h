@@ -0,0 +1,139 @@
+#ifndef GPUMEMORYREGISTRY_H
+#define GPUMEMORYREGISTRY_H
+
+#include <GL/glew.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class GpuMemoryCategory : int {
+    VERTEX_BUFFER = 0,
+    INDEX_BUFFER,
+    OTHER_BUFFER,  // pixel buffers, uniform buffers, ...
+    TEXTURE,
+    RENDER_TARGET, // textures handed out by the RenderTargetPool
+    FRAMEBUFFER,   // only counted (the attachments are textures)
+    COUNT
+};
+
+// file and line of the code that called a function with a defaulted SourceLocation parameter
+struct SourceLocation {
+    const char* file = "";
+    int line = 0;
+
+    // (__builtin_FILE()/__builtin_LINE() in default arguments are evaluated at the call site,
+    //  supported by gcc, clang and msvc)
+    static SourceLocation current(const char* file = __builtin_FILE(), int line = __builtin_LINE()) {
+        return SourceLocation{file, line};
+    }
+};
+
+struct GpuAllocationInfo {
+    std::uint64_t id = 0;
+    GpuMemoryCategory category = GpuMemoryCategory::OTHER_BUFFER;
+    std::size_t bytes = 0;
+    std::string label; // debug label of the object (empty if none was set)
+    std::string scope; // labels of the GpuMemoryScopes it was created in, e.g. "Framebuffer/RenderTargetPool"
+    SourceLocation site; // of the innermost GpuMemoryScope
+};
+
+struct GpuMemoryCategoryStats {
+    std::size_t liveBytes = 0;
+    std::size_t liveCount = 0;
+    std::size_t highWaterBytes = 0;
+    std::size_t allocationsTotal = 0;
+};
+
+// process wide record of the GPU memory the GL wrapper classes allocate (GLBufferObject, GLTexture,
+// GLTextureArray, GLFramebufferObject). The sizes are estimates (drivers add padding and metadata).
+// The creation site of an allocation is the innermost GpuMemoryScope that is alive on the creating thread
+// (the wrappers are mostly created through std::make_unique(..) or containers, where a defaulted
+// SourceLocation parameter of their constructors would only point into the standard library).
+// All methods are thread safe.
+class GpuMemoryRegistry
+{
+public:
+    static constexpr std::size_t categoryCount = static_cast<std::size_t>(GpuMemoryCategory::COUNT);
+
+    static GpuMemoryRegistry& shared();
+
+    // returns the id to update/unregister the allocation with (never 0, so 0 can mean "none")
+    std::uint64_t registerAllocation(GpuMemoryCategory category, std::size_t bytes);
+    // the calls below ignore id 0 (e.g. of moved from wrappers):
+    void updateAllocation(std::uint64_t id, std::size_t bytes);
+    // meant to be called right after the allocation was registered
+    // (the high-water mark of the old category keeps counting its bytes)
+    void setCategory(std::uint64_t id, GpuMemoryCategory category);
+    void setLabel(std::uint64_t id, std::string label);
+    void unregisterAllocation(std::uint64_t id);
+
+    GpuMemoryCategoryStats getStats(GpuMemoryCategory category) const;
+    std::size_t getLiveBytes() const;
+    std::size_t getHighWaterBytes() const;
+    // lowers the high-water marks (total and per category) to the bytes that are live now,
+    // e.g. to measure the peak of one demo
+    void resetHighWaterMarks();
+    // id the next allocation will get, to find the allocations made after a point in time:
+    std::uint64_t getNextId() const;
+    // live allocations with an id >= firstId, sorted by id
+    std::vector<GpuAllocationInfo> getAllocations(std::uint64_t firstId = 0) const;
+
+    // machine readable dump: totals, stats per category and every live allocation
+    void writeJson(std::ostream& os) const;
+    // table of the stats per category, the largest allocations and a button to dump into gpu_memory.json
+    void OnImGuiRender();
+
+    static const char* getCategoryName(GpuMemoryCategory category);
+    // mip levels of width x height x layers (x samples), block compressed formats by their block size
+    static std::size_t estimateTextureBytes(GLenum internalformat, GLsizei width, GLsizei height, GLsizei layers,
+                                            GLsizei mipLevels, GLsizei samples = 1);
+
+private:
+    friend class GpuMemoryScope;
+
+    GpuMemoryRegistry() = default;
+
+    mutable std::mutex m_mutex;
+    std::uint64_t m_nextId = 1;
+    std::unordered_map<std::uint64_t, GpuAllocationInfo> m_allocations;
+    std::array<GpuMemoryCategoryStats, categoryCount> m_categoryStats;
+    std::size_t m_liveBytes = 0;
+    std::size_t m_highWaterBytes = 0;
+};
+
+// attributes the GPU allocations made on this thread while it is alive to label and the code that
+// created it, e.g. { GpuMemoryScope scope("meshes"); ... load meshes ... }.
+// Scopes nest: the labels are joined with '/'.
+class GpuMemoryScope
+{
+public:
+    explicit GpuMemoryScope(std::string label, SourceLocation site = SourceLocation::current());
+    ~GpuMemoryScope();
+
+    // do not allow copy or move (scopes form a stack):
+    GpuMemoryScope(const GpuMemoryScope& other) = delete;
+    GpuMemoryScope& operator=(const GpuMemoryScope& other) = delete;
+
+    // innermost scope of the calling thread, nullptr if there is none
+    static const GpuMemoryScope* current();
+
+    const std::string& getPath() const {
+        return m_path;
+    }
+    SourceLocation getSite() const {
+        return m_site;
+    }
+
+private:
+    std::string m_path;
+    SourceLocation m_site;
+    const GpuMemoryScope* m_parent;
+};
+
+#endif // GPUMEMORYREGISTRY_H
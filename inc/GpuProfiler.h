@@ -0,0 +1,178 @@
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include <GL/glew.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// timing of the GPU work of one scope in the GpuProfiler
+struct GpuScopeStats {
+    std::string path;   // names of the enclosing scopes and the scope joined with '/', e.g. "OnRender/scene"
+    std::string name;
+    std::size_t depth;  // number of enclosing scopes
+    double last_ms;     // of the newest frame that was read back and contained the scope
+    double average_ms;  // over the last GpuProfiler::averageWindow frames that contained the scope
+    double max_ms;      // ... over the same frames
+};
+
+// measures the GPU time of nested, named scopes (beginScope(..)/endScope() or GpuProfileScope)
+// with GL_TIMESTAMP queries (unlike GL_TIME_ELAPSED queries, see GLTimerQuery, they can be nested).
+// Queries come from a pool that grows to the number a frame needs. The results of a frame are read
+// back at the beginning of a later frame once all of them are available, so profiling never stalls the
+// pipeline. If framesInFlight frames are still waiting for their results, the current frame is not
+// measured. A scope that is entered several times in a frame counts with the sum of its times.
+// Needs an OpenGL context from the first beginScope(..) until the profiler is destroyed.
+class GpuProfiler
+{
+public:
+    static constexpr std::size_t framesInFlight = 4;
+    static constexpr std::size_t averageWindow = 64;
+    // frames kept for writeCsv(..)/writeChromeTrace(..)/getFrameTimes_ms(..) by default
+    static constexpr std::size_t defaultTraceFrameCount = 120;
+
+    GpuProfiler() = default;
+    // do not allow copy or move (scopes are recorded between calls):
+    GpuProfiler(const GpuProfiler& other) = delete;
+    GpuProfiler& operator=(const GpuProfiler& other) = delete;
+
+    ~GpuProfiler();
+
+    // reads back the results of earlier frames that became available and starts recording a frame
+    void beginFrame();
+    // all scopes of the frame have to be ended
+    void endFrame();
+
+    // scopes outside of beginFrame()/endFrame() or while disabled are not measured
+    void beginScope(std::string_view name);
+    void endScope();
+
+    void setEnabled(bool enabled) {
+        m_enabled = enabled;
+    }
+    bool isEnabled() const {
+        return m_enabled;
+    }
+
+    // every scope that was read back so far, children right after their parent
+    std::vector<GpuScopeStats> getScopeStats() const;
+    // frames that were not measured because all frames in flight were waiting for results
+    std::size_t getSkippedFrameCount() const {
+        return m_skippedFrames;
+    }
+    // waits for the GPU (glFinish()) and reads back all frames in flight, call it outside of a frame
+    void flush();
+
+    // number of the newest frames that were read back to keep (drops older ones if lowered)
+    void setTraceFrameCount(std::size_t count);
+    std::size_t getTraceFrameCount() const {
+        return m_traceFrameCount;
+    }
+    // forgets the kept frames (the stats of getScopeStats() stay)
+    void clearTrace() {
+        m_resolvedFrames.clear();
+    }
+    // time of the scope with that path in each kept frame that contained it, oldest first
+    std::vector<double> getFrameTimes_ms(std::string_view path) const;
+
+    // one line per scope and frame of the kept frames (see setTraceFrameCount(..)):
+    // frame,path,depth,begin_us,duration_us (begin relative to the first scope of the frame)
+    bool writeCsv(const std::filesystem::path& path) const;
+    // same frames in the Chrome trace event format (chrome://tracing, https://ui.perfetto.dev)
+    bool writeChromeTrace(const std::filesystem::path& path) const;
+
+    // window with the timings of the scopes as a tree and buttons for the exports
+    void OnImGuiRender();
+
+private:
+    static constexpr std::size_t invalidIndex = ~static_cast<std::size_t>(0);
+
+    struct Scope {
+        std::string path;
+        std::string name;
+        std::size_t depth;
+        std::size_t parent;
+        std::vector<std::size_t> children;
+        std::array<double, averageWindow> samples_ms = {};
+        std::size_t sampleCount = 0; // (until the window is full)
+        std::size_t nextSample = 0;
+        double last_ms = 0.;
+    };
+    // an executed scope of a frame:
+    struct Event {
+        std::size_t scope;
+        GLuint beginQuery = 0;
+        GLuint endQuery = 0;
+    };
+    struct Frame {
+        std::uint64_t number = 0;
+        std::vector<Event> events;
+    };
+    struct ResolvedEvent {
+        std::size_t scope;
+        GLuint64 begin_ns;
+        GLuint64 end_ns;
+    };
+    struct ResolvedFrame {
+        std::uint64_t number;
+        std::vector<ResolvedEvent> events;
+    };
+
+    std::size_t getScope(std::string_view name);
+    GLuint acquireQuery();
+    // reads back the frames in flight whose results are all available (oldest first)
+    void collect();
+    void resolve(const Frame& frame);
+    void appendScopeStats(std::size_t scope, std::vector<GpuScopeStats>& stats) const;
+    static GpuScopeStats makeStats(const Scope& scope);
+    void renderScopeRow(std::size_t scope) const;
+
+    bool m_enabled = true;
+    bool m_recording = false;
+    std::uint64_t m_frameNumber = 0;
+    std::size_t m_skippedFrames = 0;
+    std::size_t m_traceFrameCount = defaultTraceFrameCount;
+
+    std::vector<Scope> m_scopes;
+    std::vector<std::size_t> m_rootScopes;
+
+    Frame m_currentFrame;
+    // of the scopes that are open: index of their event, invalidIndex if they are not measured
+    std::vector<std::size_t> m_openEvents;
+    std::size_t m_currentScope = invalidIndex;
+
+    std::deque<Frame> m_framesInFlight;
+    std::vector<GLuint> m_freeQueries;
+    std::vector<GLuint> m_allQueries;
+    std::deque<ResolvedFrame> m_resolvedFrames;
+};
+
+// measures the GPU time of the enclosing C++ scope, e.g.
+//  { GpuProfileScope profile(getRenderer().getProfiler(), "shadow map"); ...draw... }
+class GpuProfileScope
+{
+public:
+    GpuProfileScope(GpuProfiler& profiler, std::string_view name)
+        : m_profiler(profiler)
+    {
+        m_profiler.beginScope(name);
+    }
+    ~GpuProfileScope() {
+        m_profiler.endScope();
+    }
+
+    // do not allow copy or move:
+    GpuProfileScope(const GpuProfileScope& other) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope& other) = delete;
+
+private:
+    GpuProfiler& m_profiler;
+};
+
+#endif // GPUPROFILER_H
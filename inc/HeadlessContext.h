@@ -0,0 +1,40 @@
+#ifndef HEADLESSCONTEXT_H
+#define HEADLESSCONTEXT_H
+
+#include <string>
+
+// OpenGL core profile context without a window, made current on the creating thread.
+// Uses EGL (e.g. Mesa llvmpipe on machines without display or GPU): the default framebuffer
+// is a width x height pbuffer, or missing if only a surfaceless context could be created
+// (then drawing to framebuffer 0 does nothing).
+// Only available if the build found EGL (OPENGL_DEMOS_HAS_EGL), isValid() is false otherwise.
+class HeadlessContext
+{
+public:
+    HeadlessContext(int width, int height, int majorVersion = 4, int minorVersion = 3, bool debug = false);
+    // do not allow copy or move:
+    HeadlessContext(const HeadlessContext& other) = delete;
+    HeadlessContext& operator=(const HeadlessContext& other) = delete;
+
+    ~HeadlessContext();
+
+    bool isValid() const {
+        return m_context != nullptr;
+    }
+    bool hasDefaultFramebuffer() const {
+        return m_surface != nullptr;
+    }
+    // why the context could not be created (empty if it could)
+    const std::string& getError() const {
+        return m_error;
+    }
+
+private:
+    // EGLDisplay, EGLContext and EGLSurface (the EGL headers stay out of this header):
+    void* m_display = nullptr;
+    void* m_context = nullptr;
+    void* m_surface = nullptr;
+    std::string m_error;
+};
+
+#endif // HEADLESSCONTEXT_H
@@ -0,0 +1,205 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility> // for std::forward(..), std::move(..)
+#include <vector>
+
+#include "GLRenderer.h"
+#include "GLTexture.h"
+#include "GLFramebufferObject.h"
+#include "RenderTargetPool.h"
+
+// handle of a transient texture of a RenderGraph
+struct RGTexture {
+    static constexpr std::size_t invalidIndex = ~static_cast<std::size_t>(0);
+    std::size_t index = invalidIndex;
+
+    bool isValid() const {
+        return index != invalidIndex;
+    }
+};
+
+class RenderGraph;
+
+// declares the resources of one pass, only used inside the setup function passed to RenderGraph::addPass(..)
+class RenderGraphBuilder
+{
+public:
+    // transient texture that lives from its first to its last use in the compiled graph
+    RGTexture createTexture(std::string name, const RenderTargetDesc& desc);
+
+    // the pass reads texture (sampling, blit source, ...). It has to be written by an earlier pass.
+    void read(RGTexture texture);
+    // color attachment of the framebuffer of the pass (GL_COLOR_ATTACHMENT0 + number of earlier calls)
+    void writeColor(RGTexture texture);
+    void writeDepth(RGTexture texture);
+    // written without a framebuffer, e.g. by imageStore(..) in a compute shader or an upload
+    void writeStorage(RGTexture texture);
+    // never cull the pass even if nothing reads what it writes (e.g. it draws to the screen)
+    void setSideEffects();
+
+private:
+    friend class RenderGraph;
+    RenderGraphBuilder(RenderGraph& graph, std::size_t pass);
+
+    RenderGraph& m_graph;
+    std::size_t m_pass;
+};
+
+// what the execute function of a pass gets to work with
+class RenderGraphContext
+{
+public:
+    GLRenderer& getRenderer() {
+        return m_renderer;
+    }
+    RenderTargetPool& getPool() {
+        return m_pool;
+    }
+    GLTexture& getTexture(RGTexture texture);
+    // bound to GL_FRAMEBUFFER while the pass executes,
+    // nullptr if the pass has no attachments (then the default framebuffer is bound)
+    GLFramebufferObject* getFramebuffer() {
+        return m_framebuffer;
+    }
+
+private:
+    friend class RenderGraph;
+    RenderGraphContext(RenderGraph& graph, GLRenderer& renderer, RenderTargetPool& pool, GLFramebufferObject* framebuffer);
+
+    RenderGraph& m_graph;
+    GLRenderer& m_renderer;
+    RenderTargetPool& m_pool;
+    GLFramebufferObject* m_framebuffer;
+};
+
+struct RenderGraphStats {
+    std::size_t passes = 0;
+    std::size_t culledPasses = 0;
+    std::size_t textures = 0;         // transient textures used by the passes that are not culled
+    std::size_t physicalTextures = 0; // textures acquired from the pool after aliasing
+    // estimate of the render target traffic of one frame: every read and every write of a texture
+    // touches each of its pixels (samples) once, e.g. a filter reading a 1080p GL_RGBA32F buffer
+    // counts 32 MiB. Overdraw, depth test reads and caches are ignored.
+    std::size_t bytesRead = 0;
+    std::size_t bytesWritten = 0;
+};
+
+// frame graph of passes that declare which textures they read and write:
+//  1. addPass(..) for every pass (in an order in which every texture is written before it is read)
+//  2. compile() culls passes whose outputs are never read (unless they have side effects), and
+//       assigns transient textures whose lifetimes do not overlap to the same physical texture.
+//       compile() does not call OpenGL, so the graph can be built and compiled without a context
+//       (execute(..) is in RenderGraphExecute.cxx, cpu_benchmarks checks compile() on its own).
+//  3. execute(..) acquires the physical textures from the pool and a framebuffer with the declared
+//       attachments for every pass, runs the passes and releases each texture after its last use.
+// The graph is meant to be rebuilt every frame (clear(), addPass(..), ...), which is cheap.
+class RenderGraph
+{
+public:
+    using ExecuteFunction = std::function<void(RenderGraphContext&)>;
+
+    static constexpr std::size_t invalidIndex = RGTexture::invalidIndex;
+
+    RenderGraph() = default;
+
+    // do not allow copy or move (builders and contexts point to the graph):
+    RenderGraph(const RenderGraph& other) = delete;
+    RenderGraph& operator=(const RenderGraph& other) = delete;
+
+    void clear();
+
+    // setup(RenderGraphBuilder&, Data&) is called right away and stores the handles the pass needs
+    // (e.g. of the textures it creates) in a default constructed Data, execute(const Data&, RenderGraphContext&)
+    // gets that Data when the pass runs. Returns the Data (valid until clear()), so later passes can read
+    // the outputs. Handles reach execute only through Data, never as captures made before setup ran.
+    template<typename Data, typename Setup, typename Execute>
+    const Data& addPass(std::string name, Setup&& setup, Execute&& execute)
+    {
+        auto data = std::make_shared<Data>();
+        RenderGraphBuilder builder = beginPass(std::move(name),
+                [data, execute = std::forward<Execute>(execute)](RenderGraphContext& context) {
+            execute(static_cast<const Data&>(*data), context);
+        });
+        setup(builder, *data);
+        return *data;
+    }
+
+    // returns false (and prints a warning) if a texture is read before any pass wrote it
+    bool compile();
+
+    // the graph has to be compiled. Textures are created on the active texture unit
+    // (see RenderTargetPool). Leaves the default framebuffer bound.
+    // Every pass is a scope named after the pass in the GpuProfiler of the renderer.
+    void execute(GLRenderer& renderer, RenderTargetPool& pool);
+
+    // results of compile():
+    const std::vector<std::size_t>& getExecutionOrder() const {
+        return m_executionOrder;
+    }
+    bool isCulled(std::size_t pass) const;
+    // index of the physical texture texture is assigned to, invalidIndex if no remaining pass uses it
+    std::size_t getPhysicalTexture(RGTexture texture) const;
+    std::size_t getPhysicalTextureCount() const {
+        return m_physicalDescs.size();
+    }
+    RenderGraphStats getStats() const;
+
+    std::size_t getPassCount() const {
+        return m_passes.size();
+    }
+    const std::string& getPassName(std::size_t pass) const;
+    // bytes pass reads and writes (see RenderGraphStats)
+    std::size_t getPassBytesRead(std::size_t pass) const;
+    std::size_t getPassBytesWritten(std::size_t pass) const;
+    const std::string& getTextureName(RGTexture texture) const;
+
+private:
+    friend class RenderGraphBuilder;
+    friend class RenderGraphContext;
+
+    // appends a pass and returns the builder for its setup
+    RenderGraphBuilder beginPass(std::string name, ExecuteFunction execute);
+
+    struct TextureEntry {
+        std::string name;
+        RenderTargetDesc desc;
+        // positions in the execution order (set by compile()):
+        std::size_t firstUse = invalidIndex;
+        std::size_t lastUse = invalidIndex;
+        std::size_t physical = invalidIndex;
+    };
+    struct PassEntry {
+        std::string name;
+        ExecuteFunction execute;
+        std::vector<std::size_t> reads;
+        std::vector<std::size_t> colorWrites;
+        std::size_t depthWrite = invalidIndex;
+        std::vector<std::size_t> storageWrites;
+        bool sideEffects = false;
+        bool culled = false;
+    };
+
+    static std::vector<std::size_t> getWrittenTextures(const PassEntry& pass);
+    // all textures the pass reads or writes:
+    static std::vector<std::size_t> getUsedTextures(const PassEntry& pass);
+    // physical textures can be shared by textures that map to the same pool entry:
+    static bool isCompatible(const RenderTargetDesc& a, const RenderTargetDesc& b);
+    std::size_t getByteSize(std::size_t texture) const;
+
+    std::vector<TextureEntry> m_textures;
+    std::vector<PassEntry> m_passes;
+    bool m_compiled = false;
+    std::vector<std::size_t> m_executionOrder;
+    std::vector<RenderTargetDesc> m_physicalDescs;
+    std::vector<std::size_t> m_physicalLastUse; // position in the execution order
+    std::vector<GLTexture*> m_physicalTextures; // only while executing
+};
+
+#endif // RENDERGRAPH_H
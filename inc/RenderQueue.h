@@ -0,0 +1,128 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <GL/glew.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "GLRenderer.h"
+#include "GLShaderProgram.h"
+#include "GLVertexArray.h"
+#include "GLIndexBuffer.h"
+
+// everything a draw needs besides its geometry and transformation.
+// apply is called with program bound whenever the material changes between two
+// consecutive draws (bind textures and set the uniforms shared by all draws of the material).
+struct RenderMaterial {
+    GLShaderProgram* program = nullptr;
+    std::function<void(GLShaderProgram&)> apply;
+};
+
+// number of state changes needed to draw a sequence of items:
+struct RenderStateChanges {
+    std::size_t programs = 0;
+    std::size_t materials = 0;
+    std::size_t vertexArrays = 0;
+
+    std::size_t total() const {
+        return programs + materials + vertexArrays;
+    }
+};
+
+struct RenderQueueStats {
+    std::size_t items = 0;
+    RenderStateChanges unsorted; // if the items were drawn in the order they were added
+    RenderStateChanges sorted;   // what is actually emitted by submit(..)
+    float sort_ms = 0.f;
+};
+
+// collects the draws of a frame, sorts them by a 64 bit key and submits them
+// with only the state changes that differ between consecutive draws.
+// bits of the key (most significant first):
+//      pass (4) | program (10) | material (14) | vertex array (12) | depth (24)
+// i.e. draws are grouped by pass, then by the most expensive state and drawn
+// front to back inside of each group (back to front for passes set with setBackToFront(..)).
+// The queue sets the uniform "u_ndc_from_oc" of every draw.
+// The ids in the key are assigned in order of first use each frame, so any number
+// of objects can exist as long as a single frame does not exceed the bits above.
+// Usage per frame: clear(), add(..) all draws, then submit(..) each pass in order.
+class RenderQueue
+{
+public:
+    static constexpr unsigned int passCount = 16;
+
+    RenderQueue();
+
+    // do not allow copy (the sorted order is only valid for this object):
+    RenderQueue(const RenderQueue& other) = delete;
+    RenderQueue& operator=(const RenderQueue& other) = delete;
+
+    void clear();
+
+    // depth: distance of the object from the camera (along the view direction)
+    // all referenced objects must stay alive until the last submit(..) of the frame.
+    void add(unsigned int pass, const RenderMaterial& material, GLVertexArray& va, GLIndexBuffer& ib,
+             const glm::mat4& ndc_from_oc, float depth);
+
+    void setBackToFront(unsigned int pass, bool backToFront) {
+        m_backToFront[pass] = backToFront;
+    }
+
+    // sorts the items on the first call after add(..) and draws all items of the pass:
+    void submit(GLRenderer& renderer, unsigned int pass);
+
+    // stats of the current frame (valid after the first submit(..)):
+    const RenderQueueStats& getStats() const {
+        return m_stats;
+    }
+
+    // parts that do not need a GL context:
+
+    // quantizes depth >= 0 monotonically into 24 bits (by the bits of the float):
+    static std::uint32_t quantizeDepth(float depth);
+
+    static std::uint64_t makeSortKey(unsigned int pass, std::uint32_t programId, std::uint32_t materialId,
+                                     std::uint32_t vertexArrayId, std::uint32_t depth24);
+
+    struct KeyIndex {
+        std::uint64_t key;
+        std::uint32_t index;
+    };
+
+    // stable LSD radix sort by key (8 bit digits). Digits that are equal for all keys are skipped,
+    // so for typical keys only a few of the 8 passes are run. tmp is used as scratch memory.
+    static void radixSort(std::vector<KeyIndex>& keys, std::vector<KeyIndex>& tmp);
+
+private:
+    struct Item {
+        const RenderMaterial* material;
+        GLVertexArray* va;
+        GLIndexBuffer* ib;
+        glm::mat4 ndc_from_oc;
+    };
+
+    void sort();
+    std::uint32_t getId(std::unordered_map<const void*, std::uint32_t>& ids, const void* object,
+                        std::uint32_t maxId);
+
+    std::vector<Item> m_items;
+    std::vector<KeyIndex> m_keys;
+    std::vector<KeyIndex> m_keysTmp;
+    bool m_sorted;
+
+    std::unordered_map<const void*, std::uint32_t> m_programIds;
+    std::unordered_map<const void*, std::uint32_t> m_materialIds;
+    std::unordered_map<const void*, std::uint32_t> m_vertexArrayIds;
+
+    std::array<bool, passCount> m_backToFront;
+    RenderQueueStats m_stats;
+};
+
+#endif // RENDERQUEUE_H
@@ -0,0 +1,115 @@
+#ifndef RENDERTARGETPOOL_H
+#define RENDERTARGETPOOL_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "GLTexture.h"
+#include "GLFramebufferObject.h"
+#include "gl_format_utils.h"
+
+struct RenderTargetDesc {
+    GLsizei width;
+    GLsizei height;
+    GLenum internalformat;
+    GLsizei samples = 1; // > 1 -> GL_TEXTURE_2D_MULTISAMPLE
+};
+
+// what the content of a color render target needs, see RenderTargetPool::chooseFormat(..)
+struct RenderTargetRequirements {
+    int channels = 4;       // channels that are read later, 4 -> alpha is needed
+    bool hdr = false;       // values above 1
+    bool negative = false;  // values below 0 (e.g. gradients before taking the absolute value)
+    int precisionBits = 8;  // relative precision: mantissa bits of float formats, bits of normalized formats
+};
+
+struct RenderTargetPoolStats {
+    std::size_t textureCount = 0;
+    std::size_t framebufferCount = 0;
+    std::size_t byteSize = 0;          // estimate of the GPU memory of all pooled textures
+    std::size_t allocationsTotal = 0;  // textures created since the pool was created
+    std::size_t evictionsTotal = 0;
+};
+
+// hands out textures and framebuffer objects for intermediate results that only live for one frame
+// (e.g. the offscreen color and depth buffers of a post processing chain).
+// Textures are keyed by size class, internal format and sample count. The size is rounded up to
+// a multiple of sizeClassStep, so the texture can be larger than requested: render with a viewport of
+// the requested size and do not sample outside of it (clamp to the requested size - 1).
+// Rounding up means resizing the window only allocates when a size class is crossed.
+// Lifetime:
+//  - everything acquired is in use until the next beginFrame() (or until release(..))
+//  - a released texture can be handed out again in the same frame, e.g. to a later pass
+//  - beginFrame() destroys textures that were not used for evictAfterFrames frames, together
+//      with the framebuffers that reference them
+// Textures are created on the active texture unit and unbound from it again
+// (the caller should activate an unused unit before acquiring).
+class RenderTargetPool
+{
+public:
+    static constexpr GLsizei sizeClassStep = 256;
+
+    explicit RenderTargetPool(unsigned int evictAfterFrames = 60);
+
+    // do not allow copy or move (handed out references point into the pool):
+    RenderTargetPool(const RenderTargetPool& other) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool& other) = delete;
+
+    void beginFrame();
+
+    GLTexture& acquireTexture(const RenderTargetDesc& desc);
+    // returns the texture to the pool before the end of the frame:
+    void release(const GLTexture& texture);
+
+    // framebuffer with the given attachments (depth may be nullptr) and one draw buffer per color texture.
+    // Framebuffers are cached per combination of attachments and rebound each call.
+    // leaves the framebuffer bound to GL_FRAMEBUFFER.
+    GLFramebufferObject& acquireFramebuffer(const std::vector<const GLTexture*>& colors, const GLTexture* depth);
+
+    RenderTargetPoolStats getStats() const;
+
+    // (inline, so RenderGraph::compile() and its queries link without the GL code of the pool)
+    static GLsizei roundUpToSizeClass(GLsizei size) {
+        return (size + sizeClassStep - 1) / sizeClassStep * sizeClassStep;
+    }
+    // (of uncompressed formats, see getGLFormatSize(..))
+    static std::size_t estimateBytesPerPixel(GLenum internalformat) {
+        return getGLFormatSize(internalformat).bitsPerPixel / 8;
+    }
+
+    // smallest color renderable format that meets the requirements, e.g. GL_R11F_G11F_B10F for
+    // an HDR color without alpha (4 bytes per pixel instead of 16 with GL_RGBA32F).
+    // All formats it chooses can also be written with imageStore(..).
+    static GLenum chooseFormat(const RenderTargetRequirements& requirements);
+    // precision of a format in the sense of RenderTargetRequirements::precisionBits (0 if unknown)
+    static int getPrecisionBits(GLenum internalformat);
+    // e.g. "GL_RGBA16F" (for display)
+    static const char* getFormatName(GLenum internalformat);
+
+private:
+    struct TextureEntry {
+        std::unique_ptr<GLTexture> texture; // pointer -> stable address while the vector grows
+        RenderTargetDesc desc;              // with size class as size
+        bool inUse;
+        std::uint64_t lastUsedFrame;
+    };
+    struct FramebufferEntry {
+        std::unique_ptr<GLFramebufferObject> fbo;
+        std::vector<GLuint> colorIds; // renderer ids of the attachments
+        GLuint depthId;
+        std::uint64_t lastUsedFrame;
+    };
+
+    unsigned int m_evictAfterFrames;
+    std::uint64_t m_frame;
+    std::vector<TextureEntry> m_textures;
+    std::vector<FramebufferEntry> m_framebuffers;
+    std::size_t m_allocationsTotal;
+    std::size_t m_evictionsTotal;
+};
+
+#endif // RENDERTARGETPOOL_H
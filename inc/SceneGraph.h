@@ -0,0 +1,101 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include "ThreadPool.h"
+
+/**
+ * hierarchy of transforms (no OpenGL). Every node has a transform relative to its parent
+ * (translation, rotation, scale) and a world transform wc_from_oc = parent's wc_from_oc * local.
+ *
+ * The node data is stored as structure of arrays sorted by depth, so update() can process
+ * one depth level after the other (every parent is finished before its children) and split
+ * each level over the threads of a pool. Only nodes whose local transform changed and
+ * their descendants are recomputed.
+ * Nodes cannot be removed.
+ */
+class SceneGraph
+{
+public:
+    using NodeId = std::uint32_t;
+    static constexpr NodeId noParent = std::numeric_limits<NodeId>::max();
+
+    SceneGraph() = default;
+
+    // the parent has to exist already. Creating nodes is cheap, the storage is
+    // re-sorted once in the next update().
+    NodeId createNode(NodeId parent = noParent,
+                      const glm::vec3& translation = glm::vec3(0.f),
+                      const glm::quat& rotation = glm::quat(1.f, 0.f, 0.f, 0.f),
+                      const glm::vec3& scale = glm::vec3(1.f));
+
+    void setTranslation(NodeId node, const glm::vec3& translation);
+    void setRotation(NodeId node, const glm::quat& rotation);
+    void setScale(NodeId node, const glm::vec3& scale);
+
+    const glm::vec3& getTranslation(NodeId node) const {
+        return m_translations[m_slotOfNode[node]];
+    }
+    const glm::quat& getRotation(NodeId node) const {
+        return m_rotations[m_slotOfNode[node]];
+    }
+    const glm::vec3& getScale(NodeId node) const {
+        return m_scales[m_slotOfNode[node]];
+    }
+    NodeId getParent(NodeId node) const;
+    // wc_from_oc as of the last update()
+    const glm::mat4& getWorldTransform(NodeId node) const {
+        return m_worldTransforms[m_slotOfNode[node]];
+    }
+
+    // recomputes the world transforms of all dirty nodes and their descendants
+    void update(ThreadPool& pool = ThreadPool::shared());
+
+    std::size_t getNodeCount() const {
+        return m_nodeOfSlot.size();
+    }
+    std::size_t getDepthCount() const {
+        return m_levelBegin.empty() ? 0 : m_levelBegin.size() - 1;
+    }
+    // number of world transforms the last update() recomputed
+    std::size_t getLastUpdateCount() const {
+        return m_lastUpdateCount;
+    }
+
+private:
+    static constexpr std::uint32_t noSlot = std::numeric_limits<std::uint32_t>::max();
+
+    void markDirty(NodeId node) {
+        m_dirty[m_slotOfNode[node]] = 1;
+    }
+    // counting sort of all slots by depth
+    void sortByDepth();
+    // returns the number of recomputed nodes in [slotBegin, slotEnd)
+    std::size_t updateSlots(std::size_t slotBegin, std::size_t slotEnd);
+
+    std::vector<std::uint32_t> m_slotOfNode;
+
+    // per slot:
+    std::vector<NodeId> m_nodeOfSlot;
+    std::vector<std::uint32_t> m_parentSlots; // noSlot for roots
+    std::vector<std::uint32_t> m_depths;
+    std::vector<glm::vec3> m_translations;
+    std::vector<glm::quat> m_rotations;
+    std::vector<glm::vec3> m_scales;
+    std::vector<glm::mat4> m_worldTransforms;
+    std::vector<std::uint8_t> m_dirty; // uint8_t instead of bool: written concurrently per element
+
+    // slots of depth d: [m_levelBegin[d], m_levelBegin[d + 1])
+    std::vector<std::size_t> m_levelBegin;
+    bool m_sorted = true;
+    std::size_t m_lastUpdateCount = 0;
+};
+
+#endif // SCENEGRAPH_H
@@ -0,0 +1,109 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <memory> // for std::unique_ptr<..>
+#include <optional>
+#include <variant>
+#include <vector>
+
+#include "cpu_image_mipmap.h"
+#include "cpu_image_structs.h"
+#include "GLBufferObject.h"
+#include "GLFence.h"
+#include "GLTexture.h"
+#include "ThreadPool.h"
+
+/**
+ * loads textures from image files without blocking the GL thread for long:
+ *  - the files are decoded on the worker threads of a ThreadPool (3 channel images
+ *    are expanded to RGBA there, so the driver does not need to convert anything).
+ *    Mip chains are generated on the CPU there as well and kept in a cache file
+ *    next to the image (see texture_cache.h), block compressed textures likewise.
+ *  - the pixels are uploaded through pixel unpack buffers, so glTexSubImage2D(..)
+ *    returns immediately and the copy into the texture happens asynchronously on the GPU.
+ *  - any number of textures may be in flight at once, each one identified by its ticket.
+ * All member functions have to be called from the thread owning the GL context.
+ */
+class TextureLoader
+{
+public:
+    using Ticket = std::size_t;
+
+    explicit TextureLoader(ThreadPool& pool = ThreadPool::shared());
+
+    // do not allow copy (decoded images are referenced by ticket only):
+    TextureLoader(const TextureLoader& other) = delete;
+    TextureLoader& operator=(const TextureLoader& other) = delete;
+
+    // filter used for the mip chains of subsequent requests
+    void setMipFilter(MipFilter filter) {
+        m_mipFilter = filter;
+    }
+
+    // starts decoding the file on a worker thread and returns immediately.
+    Ticket request(std::filesystem::path filepath, int channels = 3, bool sRGB = false,
+                   const Tex2DSamplingParams& sampParams = texture_sampling_presets::filterPretty);
+
+    // same for the block compressed mip chain of the file (see loadCompressedTexture(..))
+    Ticket requestCompressed(std::filesystem::path filepath, BlockFormat format, bool sRGB = false,
+                             const Tex2DSamplingParams& sampParams = texture_sampling_presets::filterPretty);
+
+    // should be called once per frame: uploads at most maxUploads of the textures
+    // that finished decoding and recycles pixel unpack buffers the GPU is done with.
+    void update(std::size_t maxUploads = 2);
+
+    // true if the texture was uploaded or loading it failed
+    bool isDone(Ticket ticket) const;
+
+    // returns the texture if it is done and forgets about the ticket afterwards.
+    // returns nullptr if the texture is still in flight or loading failed.
+    std::unique_ptr<GLTexture> take(Ticket ticket);
+
+    // blocks until the texture is done, then behaves like take(..)
+    std::unique_ptr<GLTexture> wait(Ticket ticket);
+
+    // number of requests which are not done yet
+    std::size_t getInFlightCount() const;
+
+private:
+    using Decoded = std::variant<CPUTexture, CPUCompressedTexture>;
+
+    struct Request {
+        bool sRGB;
+        Tex2DSamplingParams sampParams;
+        std::future<std::optional<Decoded>> decoded;
+        bool done = false;
+        std::unique_ptr<GLTexture> texture = nullptr;
+    };
+
+    struct BusyPBO {
+        GLBufferObject pbo;
+        GLFence fence;
+    };
+
+    void upload(Request& req, const CPUTexture& texture);
+    void upload(Request& req, const CPUCompressedTexture& texture);
+    // returns a pixel unpack buffer (bound) of at least the given size and maps its first size bytes.
+    // dst is nullptr if mapping failed.
+    GLBufferObject acquireMappedPBO(GLBufferObject::size_type size, void*& dst);
+    void releasePBO(GLBufferObject pbo);
+    void recyclePBOs();
+
+    // keep at most this many idle pixel unpack buffers around for reuse:
+    static constexpr std::size_t maxFreePBOs = 4;
+
+    ThreadPool& m_pool;
+    MipFilter m_mipFilter = MipFilter::Box;
+    std::map<Ticket, Request> m_requests;
+    Ticket m_nextTicket = 0;
+    std::vector<BusyPBO> m_busyPBOs;
+    std::vector<GLBufferObject> m_freePBOs;
+};
+
+#endif // TEXTURELOADER_H
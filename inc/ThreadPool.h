@@ -0,0 +1,70 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory> // for std::make_shared<..>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// fixed number of worker threads that process a shared queue of tasks.
+class ThreadPool
+{
+public:
+    // threadCount = 0 -> one thread less than the number of hardware threads
+    //                      (the calling thread is supposed to keep one core busy)
+    explicit ThreadPool(unsigned int threadCount = 0);
+
+    // do not allow copy or move (worker threads reference this object):
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+    ThreadPool(ThreadPool&& other) = delete;
+    ThreadPool& operator=(ThreadPool&& other) = delete;
+
+    // finishes all tasks that are already queued and joins the worker threads:
+    ~ThreadPool();
+
+    // pool shared by all subsystems that do not need their own workers:
+    static ThreadPool& shared();
+
+    unsigned int getThreadCount() const {
+        return static_cast<unsigned int>(m_workers.size());
+    }
+
+    template<typename F>
+    std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& f) {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        // std::function requires a copyable callable -> wrap packaged_task in a shared_ptr:
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+        std::future<Result> result = task->get_future();
+        enqueue([task](){ (*task)(); });
+        return result;
+    }
+
+    /**
+     * calls body(chunkBegin, chunkEnd) for consecutive chunks of [0, count) with at most
+     * grainSize elements each, distributed over the worker threads and the calling thread.
+     * returns when all chunks are finished.
+     * It is safe to call parallelFor(..) from inside a task of the same pool: the calling
+     * thread never waits for a chunk that nobody started working on yet.
+     */
+    void parallelFor(std::size_t count, std::size_t grainSize,
+                     const std::function<void(std::size_t, std::size_t)>& body);
+
+private:
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop;
+};
+
+#endif // THREADPOOL_H
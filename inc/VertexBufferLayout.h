@@ -6,6 +6,7 @@
 #include <vector>
 #include <string>
 #include <optional>
+#include <iostream>
 
 #include "debug_utils.h"
 #include "GLShaderProgram.h" // to query attribute locations
@@ -114,6 +115,10 @@ public:
         }
     }
 
+    // appends a copy of attr (including its location and name).
+    // only the offset is recomputed to fit at the end of this layout:
+    void append(const VertexAttributeLayout& attr);
+
     VertexBufferLayout& operator+=(const VertexBufferLayout& other);
 
     void setDefaultLocations();
@@ -122,11 +127,31 @@ public:
         return m_attributes;
     }
 
+    // index into getAttributes() of the attribute with the given name (if any):
+    std::optional<count_type> findAttribute(const std::string& name) const;
+
+    static GLuint getAttributeSize(const VertexAttributeLayout& attr) {
+        return getAttributeSize(attr.dimCount, attr.componentType);
+    }
+
     stride_type getStride() const {
         return m_stride;
     }
 
-    void setLocations(const GLShaderProgram& program);
+    // (defined here, so that code without OpenGL like the CPU benchmarks can link the rest of the layout)
+    void setLocations(const GLShaderProgram& program) {
+        for (auto& attr: m_attributes) {
+            if (!attr.name.empty()) {
+                auto loc = program.getAttribLocation(attr.name);
+                if (loc == -1) {
+                    std::cout << "warning: did not find attribute location " << attr.name << '\n';
+                    attr.location = std::nullopt;
+                } else {
+                    attr.location = loc;
+                }
+            }
+        }
+    }
 
     static TypeCategory getTypeCategory(GLenum componentType);
 
@@ -0,0 +1,71 @@
+#ifndef VIRTUALTEXTUREFEEDBACK_H
+#define VIRTUALTEXTUREFEEDBACK_H
+
+#include <GL/glew.h>
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "GLBufferObject.h"
+#include "GLFence.h"
+#include "GLFramebufferObject.h"
+#include "GLRenderer.h"
+#include "GLShaderProgram.h"
+#include "GLTexture.h"
+#include "VirtualTextureLayout.h"
+
+// Low resolution render pass that reports which pages of a virtual texture are visible.
+// The scene is drawn with VirtualTextureFeedback.shader into a small framebuffer whose texels
+// store (page x, page y, level, 255). The framebuffer is read back asynchronously through
+// a ring of pixel pack buffers, so the pages arrive one or two frames later without a stall.
+class VirtualTextureFeedback
+{
+public:
+    // the feedback framebuffer is 1 / downscale of the window size in each dimension
+    explicit VirtualTextureFeedback(int downscale = 8);
+
+    void OnWindowSizeChanged(int width, int height);
+
+    // binds the feedback framebuffer, sets the viewport, clears it and sets the u_vt_* uniforms
+    // of feedbackSP. Draw the scene with feedbackSP afterwards.
+    void begin(GLRenderer& renderer, GLShaderProgram& feedbackSP, const VTLayout& layout);
+    // starts the readback and restores the default framebuffer and the viewport.
+    void end(GLRenderer& renderer);
+
+    // unique pages of the latest readback that finished, sorted by level (coarse first).
+    // Pages of older readbacks are returned again until a newer one finishes.
+    const std::vector<VTPageId>& poll(const VTLayout& layout);
+
+    int getWidth() const {
+        return m_width;
+    }
+    int getHeight() const {
+        return m_height;
+    }
+
+private:
+    struct Readback {
+        std::optional<GLBufferObject> pbo;
+        std::optional<GLFence> fence; // set while the readback is pending
+        int width = 0;
+        int height = 0;
+    };
+
+    int m_downscale;
+    int m_windowWidth = 0;
+    int m_windowHeight = 0;
+    int m_width = 0;
+    int m_height = 0;
+
+    GLFramebufferObject m_fbo;
+    std::unique_ptr<GLTexture> m_colorTex;
+    std::unique_ptr<GLTexture> m_depthTex;
+
+    std::array<Readback, 2> m_readbacks;
+    std::size_t m_nextReadback = 0;
+    std::vector<VTPageId> m_pages;
+};
+
+#endif // VIRTUALTEXTUREFEEDBACK_H
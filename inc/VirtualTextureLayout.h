@@ -0,0 +1,77 @@
+#ifndef VIRTUALTEXTURELAYOUT_H
+#define VIRTUALTEXTURELAYOUT_H
+
+#include <algorithm> // for std::max(..)
+#include <cstddef>
+#include <cstdint>
+
+// page (x, y) of mip level `level` of a virtual texture
+struct VTPageId {
+    std::uint32_t level = 0;
+    std::uint32_t x = 0;
+    std::uint32_t y = 0;
+
+    // unique key: 8 bit level, 12 bit x, 12 bit y
+    std::uint32_t pack() const {
+        return (level << 24) | (x << 12) | y;
+    }
+    static VTPageId unpack(std::uint32_t key) {
+        return {key >> 24, (key >> 12) & 0xfff, key & 0xfff};
+    }
+    VTPageId getParent() const {
+        return {level + 1, x / 2, y / 2};
+    }
+    bool operator==(const VTPageId& other) const {
+        return level == other.level && x == other.x && y == other.y;
+    }
+};
+
+// geometry of a virtual texture that is split into square pages.
+// The size of level 0 is a power of two times the page size, the last level consists of a single page.
+struct VTLayout {
+    int size = 0;     // width and height of level 0 in texels
+    int pageSize = 0; // texels per page side without border
+    int border = 0;   // texels around each page copied from its neighbours (for bilinear filtering)
+
+    bool isValid() const {
+        return pageSize > 0 && size >= pageSize && size % pageSize == 0
+                && ((size / pageSize) & (size / pageSize - 1)) == 0 && border >= 0;
+    }
+    int getLevelCount() const {
+        int count = 1;
+        for (int pages = size / pageSize; pages > 1; pages /= 2) {
+            ++count;
+        }
+        return count;
+    }
+    // pages per side of the given level
+    int getPageCount(int level) const {
+        return std::max((size / pageSize) >> level, 1);
+    }
+    int getPaddedPageSize() const {
+        return pageSize + 2 * border;
+    }
+    std::size_t getTotalPageCount() const {
+        std::size_t total = 0;
+        for (int level = 0; level < getLevelCount(); ++level) {
+            total += static_cast<std::size_t>(getPageCount(level)) * static_cast<std::size_t>(getPageCount(level));
+        }
+        return total;
+    }
+    // position of the page in a list of all pages, sorted by level, then row, then column
+    std::size_t getPageIndex(const VTPageId& page) const {
+        std::size_t index = 0;
+        for (std::uint32_t level = 0; level < page.level; ++level) {
+            const auto n = static_cast<std::size_t>(getPageCount(static_cast<int>(level)));
+            index += n * n;
+        }
+        return index + page.y * static_cast<std::size_t>(getPageCount(static_cast<int>(page.level))) + page.x;
+    }
+    bool contains(const VTPageId& page) const {
+        return page.level < static_cast<std::uint32_t>(getLevelCount())
+                && page.x < static_cast<std::uint32_t>(getPageCount(static_cast<int>(page.level)))
+                && page.y < static_cast<std::uint32_t>(getPageCount(static_cast<int>(page.level)));
+    }
+};
+
+#endif // VIRTUALTEXTURELAYOUT_H
@@ -0,0 +1,51 @@
+#ifndef VIRTUALTEXTUREPAGEFILE_H
+#define VIRTUALTEXTUREPAGEFILE_H
+
+#include <GL/glew.h>
+
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+#include "cpu_image_mipmap.h"  // for MipFilter
+#include "cpu_image_structs.h" // for CPUImage
+#include "VirtualTextureLayout.h"
+
+/**
+ * tiled page file of a virtual texture: a small header followed by the RGBA8 pages
+ * (including their borders) of all mip levels in the order of VTLayout::getPageIndex(..),
+ * so every page can be read with a single seek.
+ */
+class VTPageFile
+{
+public:
+    // generates the mip chain of the RGBA image (square, power of two multiple of pageSize)
+    // and writes all of its pages.
+    static bool write(const std::filesystem::path& filepath, const CPUImage& image, bool sRGB,
+                      int pageSize = 128, int border = 4, MipFilter filter = MipFilter::Box);
+
+    static std::optional<VTPageFile> open(const std::filesystem::path& filepath);
+
+    const VTLayout& getLayout() const {
+        return m_layout;
+    }
+    bool isSRGB() const {
+        return m_sRGB;
+    }
+    std::size_t getPageByteSize() const {
+        const auto padded = static_cast<std::size_t>(m_layout.getPaddedPageSize());
+        return padded * padded * 4;
+    }
+
+    // reads getPageByteSize() bytes (rows bottom to top). Not thread safe.
+    bool readPage(const VTPageId& page, GLubyte* dst);
+
+private:
+    VTPageFile(std::ifstream file, const VTLayout& layout, bool sRGB);
+
+    std::ifstream m_file;
+    VTLayout m_layout;
+    bool m_sRGB;
+};
+
+#endif // VIRTUALTEXTUREPAGEFILE_H
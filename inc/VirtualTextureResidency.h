@@ -0,0 +1,127 @@
+#ifndef VIRTUALTEXTURERESIDENCY_H
+#define VIRTUALTEXTURERESIDENCY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "VirtualTextureLayout.h"
+
+/**
+ * decides which pages of a virtual texture live in which slot of the physical page cache
+ * and maintains the page table. Does not use OpenGL, so it can be tested on the CPU.
+ *
+ * Usage per frame:
+ *  1.) beginFrame() and requestPage(..) for every page the feedback pass reported
+ *  2.) takeLoadRequests(..) and hand the pages to the loader
+ *  3.) onPageLoaded(..) for every page the loader finished, copy the data into the returned slot
+ *  4.) if the page table changed, upload getPageTable()
+ *
+ * The single page of the last level is pinned: it is requested first and never evicted,
+ * so every page table entry has a fallback once it is loaded.
+ */
+class VTResidency
+{
+public:
+    struct Slot {
+        std::uint32_t x;
+        std::uint32_t y;
+    };
+    struct LoadResult {
+        Slot slot;
+        std::optional<VTPageId> evicted;
+    };
+    // red, green: slot of the finest resident page covering this entry, blue: its level,
+    // alpha: 255 if there is any resident page, 0 otherwise
+    using PageTableEntry = std::array<std::uint8_t, 4>;
+
+    VTResidency(const VTLayout& layout, std::uint32_t slotsX, std::uint32_t slotsY);
+
+    void beginFrame();
+    // the page is needed this frame. Resident pages (and their parents, the fallbacks) count
+    // as recently used, missing ones are queued for loading.
+    void requestPage(const VTPageId& page);
+
+    // at most maxCount queued pages, coarse levels first. They count as in flight until onPageLoaded(..).
+    std::vector<VTPageId> takeLoadRequests(std::size_t maxCount);
+
+    // assigns a slot to a page that finished loading, evicting the least recently used page if the
+    // cache is full. returns nothing (and drops the page) if all pages were used in the current frame.
+    std::optional<LoadResult> onPageLoaded(const VTPageId& page);
+    // the loader could not read the page, it will be requested again by the feedback.
+    void onPageLoadFailed(const VTPageId& page);
+
+    bool isResident(const VTPageId& page) const;
+    std::optional<Slot> getSlot(const VTPageId& page) const;
+
+    // one vector per level with getPageCount(level)^2 entries, recomputed if the residency changed
+    const std::vector<std::vector<PageTableEntry>>& getPageTable();
+    // true if the page table changed since the last call of getPageTable()
+    bool isPageTableDirty() const {
+        return m_pageTableDirty;
+    }
+
+    const VTLayout& getLayout() const {
+        return m_layout;
+    }
+    std::uint32_t getSlotsX() const {
+        return m_slotsX;
+    }
+    std::uint32_t getSlotsY() const {
+        return m_slotsY;
+    }
+    std::size_t getCapacity() const {
+        return static_cast<std::size_t>(m_slotsX) * m_slotsY;
+    }
+    std::size_t getResidentCount() const {
+        return m_resident.size();
+    }
+    std::size_t getQueuedCount() const {
+        return m_queued.size();
+    }
+    std::size_t getInFlightCount() const {
+        return m_inFlight.size();
+    }
+    std::uint64_t getLoadCount() const {
+        return m_loadCount;
+    }
+    std::uint64_t getEvictionCount() const {
+        return m_evictionCount;
+    }
+
+private:
+    struct ResidentPage {
+        Slot slot;
+        std::uint64_t lastUsedFrame;
+        std::list<std::uint32_t>::iterator lruPosition; // m_lru.end() for the pinned page
+    };
+
+    void touch(std::uint32_t key);
+    std::optional<Slot> allocateSlot(std::optional<VTPageId>& evicted);
+    void rebuildPageTable();
+
+    VTLayout m_layout;
+    std::uint32_t m_slotsX;
+    std::uint32_t m_slotsY;
+    std::uint64_t m_frame = 0;
+    VTPageId m_pinnedPage;
+
+    std::unordered_map<std::uint32_t, ResidentPage> m_resident;
+    std::list<std::uint32_t> m_lru; // most recently used first
+    std::vector<Slot> m_freeSlots;
+    std::unordered_set<std::uint32_t> m_queued;
+    std::unordered_set<std::uint32_t> m_inFlight;
+
+    std::vector<std::vector<PageTableEntry>> m_pageTable;
+    bool m_pageTableDirty = true;
+
+    std::uint64_t m_loadCount = 0;
+    std::uint64_t m_evictionCount = 0;
+};
+
+#endif // VIRTUALTEXTURERESIDENCY_H
@@ -1,6 +1,10 @@
 #ifndef COLORSPACE_UTILS_H
 #define COLORSPACE_UTILS_H
 
+#include <cstdint>
+
+#include <gsl/gsl> // for gsl::span<>
+
 #include "glm/glm.hpp"
 
 glm::vec3 sRGB_from_linRGB(const glm::vec3& rgb);
@@ -8,4 +12,28 @@ glm::vec3 sRGB_from_linRGB(const glm::vec3& rgb);
 glm::vec3 linRGB_from_sRGB(const glm::vec3& sRGB);
 
 
+// batch conversions of single channels (src and dst must have the same size).
+// The alpha channel is linear, so interleaved data needs its alpha values converted separately.
+
+// 8 bit sRGB -> linear through a lookup table, identical to the scalar function
+void linRGB_from_sRGB8(gsl::span<const std::uint8_t> src, gsl::span<float> dst);
+// linear -> 8 bit sRGB rounded to the nearest value: the result k satisfies
+// decode((k - .5) / 255) <= linear < decode((k + .5) / 255) (exact inversion of the lookup table).
+// src is clamped to [0, 1].
+void sRGB8_from_linRGB(gsl::span<const float> src, gsl::span<std::uint8_t> dst);
+
+// polynomial approximations of the scalar functions for non-negative values.
+// The absolute error on [0, 1] is below srgbApproximationMaxError.
+void linRGB_from_sRGB(gsl::span<const float> src, gsl::span<float> dst);
+void sRGB_from_linRGB(gsl::span<const float> src, gsl::span<float> dst);
+constexpr float srgbApproximationMaxError = 1e-6f;
+
+// 8 bit RGBA with the bottom row first (like CPUImage and glReadPixels(..)) -> planar YUV 4:2:0 with the
+// top row first (like video frames), BT.601 limited range (Y in [16, 235]) in 8 bit fixed point.
+// Every chroma sample is computed from the average color of a 2x2 block (JPEG siting), the last
+// column and row are repeated for odd sizes.
+// y has width * height bytes, u and v have ((width + 1) / 2) * ((height + 1) / 2) bytes each.
+void yuv420_from_RGBA8(gsl::span<const std::uint8_t> rgba, int width, int height,
+                       gsl::span<std::uint8_t> y, gsl::span<std::uint8_t> u, gsl::span<std::uint8_t> v);
+
 #endif // COLORSPACE_UTILS_H
@@ -0,0 +1,27 @@
+#ifndef CPU_IMAGE_COMPRESSION_H
+#define CPU_IMAGE_COMPRESSION_H
+
+#include <cstddef>
+#include <vector>
+
+#include "cpu_image_structs.h"
+#include "ThreadPool.h"
+
+std::size_t getBlockByteSize(BlockFormat format);
+
+// size of a whole image in the given format, partial blocks at the border count as full blocks
+std::size_t getCompressedByteSize(int width, int height, BlockFormat format);
+
+// encodes an RGBA image (4 channels). BC1 ignores the alpha channel.
+// rows of blocks are distributed over the threads of the pool.
+CPUCompressedImage compressImage(const CPUImage& image, BlockFormat format,
+                                 ThreadPool& pool = ThreadPool::shared());
+
+// compresses every level of a mip chain (levels[0] = full resolution)
+CPUCompressedTexture compressTexture(const std::vector<CPUImage>& levels, BlockFormat format, bool sRGB,
+                                     ThreadPool& pool = ThreadPool::shared());
+
+// decodes to an RGBA image (alpha is opaque for BC1), e.g. to measure the encoder quality
+CPUImage decompressImage(const CPUCompressedImage& image, BlockFormat format);
+
+#endif // CPU_IMAGE_COMPRESSION_H
@@ -0,0 +1,18 @@
+#ifndef CPU_IMAGE_EXPORT_H
+#define CPU_IMAGE_EXPORT_H
+
+#include <filesystem>
+#include <vector>
+#include "cpu_image_structs.h" // for CPUImage
+
+// encodes an image as PNG (8 bit gray, gray + alpha, RGB or RGBA by the number of channels).
+// Rows are filtered with the PNG filter of the smallest sum of absolute differences and compressed
+// with fixed Huffman codes and a short LZ77 search: fast rather than small. The bottom row of the
+// image is written last (it is the last row of the PNG), unless flipVertically is false.
+// Has no global state, so it can be called from several threads concurrently.
+std::vector<GLubyte> encodePNG(const CPUImage& image, bool flipVertically = true);
+
+// encodePNG(..) into a file, returns false (and prints a warning) if it cannot be written
+bool writePNGFile(const std::filesystem::path& filepath, const CPUImage& image, bool flipVertically = true);
+
+#endif // CPU_IMAGE_EXPORT_H
@@ -0,0 +1,62 @@
+#ifndef CPU_IMAGE_FILTER_H
+#define CPU_IMAGE_FILTER_H
+
+#include <string>
+#include <vector>
+
+#include "cpu_image_structs.h"
+#include "ThreadPool.h"
+
+// largest radius any convolution backend supports (kernels of up to 15 x 15 taps)
+constexpr int maxConvolutionRadius = 7;
+
+/**
+ * convolution kernel of (2 * radiusX + 1) x (2 * radiusY + 1) taps with the weights written
+ * row by row as they appear in code: the first row is the top row (+y in texture coordinates).
+ * i.e. out(x, y) = sum over j, i of weights[j * width + i] * in(x + i - radiusX, y + radiusY - j)
+ * Pixels outside of the image are clamped to the edge.
+ * Separable kernels additionally store their 1D factors (weights[j * width + i] == column[j] * row[i])
+ * and are applied as a horizontal pass followed by a vertical pass.
+ * All backends filter the RGB channels and output alpha = 1.
+ */
+struct ConvolutionKernel {
+    std::string name;
+    int radiusX = 0;
+    int radiusY = 0;
+    std::vector<float> weights;
+    std::vector<float> row;    // empty if not separable
+    std::vector<float> column; // first entry is the top
+    bool absolute = false;     // output the absolute value (e.g. for edge detection)
+
+    int getWidth() const {
+        return 2 * radiusX + 1;
+    }
+    int getHeight() const {
+        return 2 * radiusY + 1;
+    }
+    bool isSeparable() const {
+        return !row.empty();
+    }
+};
+
+ConvolutionKernel makeKernel(std::string name, int radiusX, int radiusY, std::vector<float> weights,
+                             bool absolute = false);
+ConvolutionKernel makeSeparableKernel(std::string name, std::vector<float> row, std::vector<float> column,
+                                      bool absolute = false);
+
+// horizontal gradient, the filter Filter.shader used to hard code (separable into [1 2 1] x [1 0 -1])
+ConvolutionKernel makeSobelKernel();
+// normalized gaussian blur (separable)
+ConvolutionKernel makeGaussianKernel(int radius, float sigma);
+// 3 x 3 laplacian (not separable)
+ConvolutionKernel makeLaplacianKernel();
+
+/**
+ * CPU reference of the GPU convolution (GLImageFilter): same kernel semantics, same edge handling.
+ * out is resized to the size of in. Separable kernels run as two 1D passes.
+ * Rows are distributed over the threads of the pool, each pixel is processed as one SSE register.
+ */
+void applyConvolution(const ConvolutionKernel& kernel, const CPUImageRGBA32F& in, CPUImageRGBA32F& out,
+                      ThreadPool& pool = ThreadPool::shared());
+
+#endif // CPU_IMAGE_FILTER_H
@@ -0,0 +1,14 @@
+#ifndef CPU_IMAGE_IMPORT_H
+#define CPU_IMAGE_IMPORT_H
+
+#include <filesystem>
+#include <optional>
+#include "cpu_image_structs.h" // for CPUImage
+
+// decodes an image file into an image with exactly the requested number of channels.
+// Does not touch any global state of stb_image, so it can be called from several
+// threads concurrently.
+std::optional<CPUImage> loadImageFile(const std::filesystem::path& filepath, int channels,
+                                      bool flipVertically = true);
+
+#endif // CPU_IMAGE_IMPORT_H
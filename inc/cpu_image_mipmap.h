@@ -0,0 +1,24 @@
+#ifndef CPU_IMAGE_MIPMAP_H
+#define CPU_IMAGE_MIPMAP_H
+
+#include <vector>
+
+#include "cpu_image_structs.h"
+#include "ThreadPool.h"
+
+enum class MipFilter {
+    Box,   // averages the texels covered by the footprint of the smaller texel
+    Kaiser // windowed sinc (Kaiser window, 8 taps for 2:1), sharper, may ring slightly
+};
+
+/**
+ * generates the full mip chain down to 1x1 on the CPU, levels[0] is the image itself.
+ * If sRGB is set, the color channels (not the alpha channel) are decoded to linear before
+ * filtering and encoded again afterwards with exact rounding.
+ * Every level is filtered from the unquantized linear version of the previous one.
+ * Rows are distributed over the threads of the pool.
+ */
+std::vector<CPUImage> generateMipChain(const CPUImage& image, bool sRGB, MipFilter filter = MipFilter::Box,
+                                       ThreadPool& pool = ThreadPool::shared());
+
+#endif // CPU_IMAGE_MIPMAP_H
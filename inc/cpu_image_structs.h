@@ -0,0 +1,63 @@
+#ifndef CPU_IMAGE_STRUCTS_H
+#define CPU_IMAGE_STRUCTS_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+// 8 bit per channel image with tightly packed rows.
+// The first row is the bottom row of the image (OpenGL convention).
+struct CPUImage {
+    int width = 0;
+    int height = 0;
+    int channels = 0; // 1 to 4
+    std::vector<GLubyte> data;
+
+    std::size_t getRowSize() const {
+        return static_cast<std::size_t>(width) * static_cast<std::size_t>(channels);
+    }
+};
+
+// 32 bit float RGBA image with tightly packed rows (first row is the bottom row),
+// the layout of GL_RGBA32F render targets read back with GL_RGBA, GL_FLOAT.
+struct CPUImageRGBA32F {
+    int width = 0;
+    int height = 0;
+    std::vector<float> data; // 4 floats per pixel
+
+    float* row(int y) {
+        return data.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(width) * 4;
+    }
+    const float* row(int y) const {
+        return data.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(width) * 4;
+    }
+};
+
+// mip chain of an uncompressed texture
+struct CPUTexture {
+    bool sRGB = false;
+    std::vector<CPUImage> levels; // levels[0] is the full resolution image
+};
+
+// S3TC block formats. Every block encodes 4x4 texels.
+enum class BlockFormat {
+    BC1, // RGB, 8 bytes per block
+    BC3  // RGBA, 16 bytes per block (BC1 color block after an 8 byte alpha block)
+};
+
+// one mip level of a block compressed image, blocks are stored row by row
+// (starting with the bottom row, like CPUImage).
+struct CPUCompressedImage {
+    int width = 0;
+    int height = 0;
+    std::vector<GLubyte> blocks;
+};
+
+struct CPUCompressedTexture {
+    BlockFormat format = BlockFormat::BC1;
+    bool sRGB = false;
+    std::vector<CPUCompressedImage> levels; // levels[0] is the full resolution image
+};
+
+#endif // CPU_IMAGE_STRUCTS_H
@@ -0,0 +1,10 @@
+#ifndef CPU_IMAGE_UTILS_H
+#define CPU_IMAGE_UTILS_H
+
+#include "cpu_image_structs.h" // for CPUImage
+
+// peak signal to noise ratio in dB over the first channelCount channels of both images.
+// returns infinity for identical images.
+double computePSNR(const CPUImage& reference, const CPUImage& test, int channelCount);
+
+#endif // CPU_IMAGE_UTILS_H
@@ -41,6 +41,19 @@ struct CPUMultiIndexMesh {
     std::array<CPUVertexArray, N> vas;
 };
 
+// same as CPUMesh but the vertex data is split into several streams
+// (e.g. positions in one stream and all other attributes in a second stream).
+// all streams have the same vertex count and are referenced by the same index buffer.
+// Each stream is supposed to be uploaded into its own GLVertexBuffer and bound to
+// its own binding index of a GLVertexArray. This way passes that only need some of
+// the attributes (e.g. a depth-only pass that only needs positions) do not have to
+// fetch the whole interleaved vertex.
+template <typename Index>
+struct CPUMultiStreamMesh {
+    CPUIndexBuffer<Index> ib;
+    std::vector<CPUVertexArray> streams;
+};
+
 
 template <typename Index>
 std::ostream& operator<<(std::ostream& os, const CPUIndexBuffer<Index>& ib) {
@@ -61,5 +74,14 @@ std::ostream& operator<<(std::ostream& os, const CPUMesh<Index>& cpuMesh) {
     return os << cpuMesh.ib << cpuMesh.va;
 }
 
+template <typename Index>
+std::ostream& operator<<(std::ostream& os, const CPUMultiStreamMesh<Index>& cpuMesh) {
+    os << cpuMesh.ib;
+    for (std::size_t i = 0; i < cpuMesh.streams.size(); ++i) {
+        os << "stream " << i << ":\n" << cpuMesh.streams[i];
+    }
+    return os;
+}
+
 
 #endif // CPU_MESH_STRUCTS_H
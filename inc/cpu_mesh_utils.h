@@ -2,11 +2,13 @@
 #define CPU_MESH_UTILS_H
 
 #include "cpu_mesh_structs.h"
+#include "CpuProfiler.h"
 
 #include <limits>
 #include <map>
 #include <algorithm> // for std::equal(), std::copy()
 #include <iterator> // for std::back_inserter()
+#include <string>
 #include "gsl/gsl" // or "gsl/gsl" ?
 
 
@@ -63,6 +65,7 @@ CPUMesh<Index> addIndexBuffer(const CPUVertexArray& va,
 template <typename Index, int N>
 CPUMesh<Index> unifyIndexBuffer(const CPUMultiIndexMesh<Index, N>& miMesh,
                                 Index restartIndex = std::numeric_limits<Index>::max()) {
+    CPU_PROFILE_FUNCTION();
     // 1. remove duplicates from multidimensional index buffer and add a single
     //      dimensional index buffer that references the multidimensional index buffer:
     using Index_IN = std::size_t;
@@ -176,5 +179,46 @@ CPUIndexBuffer<Index> applyTriangleFan(const CPUIndexBuffer<Index>& ib) {
     return res;
 }
 
+/**
+ * copies count elements of elemSize bytes each from src to dst, where consecutive
+ * elements are srcStride bytes apart in src and dstStride bytes apart in dst.
+ * this is the kernel used to convert between interleaved (array of structures) and
+ * non-interleaved (structure of arrays) vertex data.
+ * with SSE2 8 and 16 byte elements are copied as one register each, and 12 byte elements
+ * (e.g. vec3 positions) four at a time if dst is packed (dstStride == 12). Other sizes (also
+ * 4 bytes, which is a single move anyway) are copied with std::memcpy(..).
+ * src and dst must not overlap.
+ */
+void copyStrided(GLbyte* dst, std::size_t dstStride,
+                 const GLbyte* src, std::size_t srcStride,
+                 std::size_t elemSize, std::size_t count);
+
+/**
+ * AoS -> SoA transcoding:
+ * splits the interleaved vertex array va into attribsPerStream.size() streams.
+ * attribsPerStream[i] contains the indices (into va.layout.getAttributes()) of the
+ * attributes that should be copied into stream i. Within each stream the attributes
+ * are interleaved again in the order given by attribsPerStream[i].
+ * attribute locations and names are kept, so each stream can be added to a
+ * GLVertexArray with its own binding index.
+ */
+std::vector<CPUVertexArray> splitVertexArray(const CPUVertexArray& va,
+                                             const std::vector<std::vector<VertexBufferLayout::count_type>>& attribsPerStream);
+
+/**
+ * splits va into two streams:
+ *  stream 0 contains only the attribute called positionName
+ *  stream 1 contains all the other attributes (in their original order)
+ * if va has no attribute called positionName va is returned as the only stream.
+ */
+std::vector<CPUVertexArray> splitPositionStream(const CPUVertexArray& va,
+                                                const std::string& positionName = "position_oc");
+
+template <typename Index>
+CPUMultiStreamMesh<Index> splitPositionStream(const CPUMesh<Index>& mesh,
+                                              const std::string& positionName = "position_oc") {
+    return CPUMultiStreamMesh<Index>{mesh.ib, splitPositionStream(mesh.va, positionName)};
+}
+
 
 #endif // CPU_MESH_UTILS_H
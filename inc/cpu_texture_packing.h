@@ -0,0 +1,41 @@
+#ifndef CPU_TEXTURE_PACKING_H
+#define CPU_TEXTURE_PACKING_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "cpu_image_structs.h"
+
+// images of one format that share a texture array. All layers have the same size.
+struct CPUTexturePack {
+    bool sRGB = false;
+    int channels = 0;
+    std::vector<CPUImage> layers;
+};
+
+// where an input image of packTextures(..) ended up
+struct TexturePackEntry {
+    std::size_t pack = 0;
+    int layer = 0;
+    // texture coordinates in [0, 1] of the input image map to uv * (x, y) + (z, w) in the layer
+    std::array<float, 4> uvScaleOffset = {1.f, 1.f, 0.f, 0.f};
+};
+
+struct TexturePacking {
+    std::vector<CPUTexturePack> packs; // one per channel count
+    std::vector<TexturePackEntry> entries; // in the order of the input images
+};
+
+/**
+ * groups images with the same number of channels into one pack each. The layers of a pack
+ * have the size of its largest image:
+ *  - images of exactly that size get a layer of their own
+ *  - smaller images are packed into atlas layers (shelf packing, largest first). They are
+ *      surrounded by `padding` texels repeating their edges, which keeps bilinear filtering
+ *      and the first log2(padding) mip levels free of their neighbours.
+ * Repeating texture coordinates have to be wrapped (fract(..)) before the uv transform is applied.
+ */
+TexturePacking packTextures(const std::vector<CPUImage>& images, bool sRGB, int padding = 8);
+
+#endif // CPU_TEXTURE_PACKING_H
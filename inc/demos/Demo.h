@@ -1,6 +1,7 @@
 #ifndef DEMO_H
 #define DEMO_H
 
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <functional>
@@ -50,9 +51,23 @@ public:
                                    ));
     }
 
-    void SelectDemo(std::string_view name);
+    // returns false (and stays in the main menu) if there is no demo with that name
+    bool SelectDemo(std::string_view name);
+    // back to the main menu, warns about GPU allocations of the demo that outlive it
+    void CloseDemo();
+    // in the order they were registered
+    std::vector<std::string> getDemoNames() const;
+    // empty in the main menu
+    const std::string& getCurrentDemoName() const {
+        return m_currentDemoName;
+    }
 private:
+    // GPU memory the demo allocates is attributed to its name (see GpuMemoryScope):
+    void startDemo(const std::string& name, const std::function<std::unique_ptr<Demo>(GLRenderer&)>& factory);
+
     std::unique_ptr<Demo> m_currentDemo;
+    std::string m_currentDemoName;
+    std::uint64_t m_demoFirstMemoryId = 0;
     std::vector<std::pair<std::string, std::function<std::unique_ptr<Demo>(GLRenderer&)>>> m_demos;
 
     int m_width;
@@ -0,0 +1,140 @@
+#ifndef DEMOBENCHMARK_H
+#define DEMOBENCHMARK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "FrameCapture.h"
+#include "GLCallStats.h"
+
+namespace demo {
+
+class DemoSuite;
+
+struct BenchmarkOptions {
+    std::vector<std::string> demos; // registered names, all registered demos if empty
+    std::size_t frames = 300;
+    std::size_t warmupFrames = 30;  // run before the measured frames (first uploads, shader caches ...)
+    float deltaSeconds = 1.f / 60.f;
+    int width = 960;
+    int height = 640;
+    std::filesystem::path output = "benchmark.json";
+    // letters and digits pressed (and released) one after the other after each demo is loaded,
+    // e.g. to select a render path (see the key bindings of the demos)
+    std::string keys;
+    // input recording (see InputRecorder) that drives the suite instead of running the demos for a fixed
+    // number of frames, its first warmupFrames are not measured
+    std::filesystem::path replay;
+    // directory for PNG files of all measured frames (FrameCapture, one subdirectory per demo), no capture if empty
+    std::filesystem::path capture;
+    // video of all measured frames of all demos (Y4M for .y4m, raw YUV 4:2:0 otherwise), no video if empty.
+    // No frame is dropped while streaming, the capture waits for the conversion instead.
+    std::filesystem::path stream;
+    // compare both paths of the GPU convolution (GLImageFilter) with applyConvolution(..) after the demos
+    bool checkConvolution = false;
+};
+
+// distribution of frame times, percentiles by nearest rank
+struct FrameTimeStats {
+    std::size_t count = 0;
+    double mean_ms = 0.;
+    double p50_ms = 0.;
+    double p90_ms = 0.;
+    double p99_ms = 0.;
+    double max_ms = 0.;
+
+    static FrameTimeStats compute(std::vector<double> times_ms);
+};
+
+struct DemoBenchmarkResult {
+    std::string name;
+    double load_ms;             // construction of the demo until the GPU finished its uploads
+    FrameTimeStats cpu;         // OnUpdate(..) + OnRender() on the CPU
+    FrameTimeStats gpu;         // OnRender() on the GPU (GpuProfiler), frames the profiler skipped are missing
+    std::size_t gpuMemoryPeak;  // bytes, high-water mark of the GpuMemoryRegistry while the demo ran
+    std::size_t peakResident;   // bytes, of the whole process so far (never decreases, 0 if unknown)
+    GLCallFrameStats glCalls;   // sum over the measured frames (null in the JSON without OPENGL_DEMOS_GL_CALL_STATS)
+    FrameTimeStats capture;     // GL thread time of the FrameCapture per frame (empty without --capture/--stream)
+    std::size_t capturedFrames; // frames the FrameCapture read back
+    std::size_t droppedFrames;  // frames the FrameCapture skipped because all its buffers were in use
+};
+
+// GLImageFilter against the CPU reference for one kernel and one path of the filter
+struct ConvolutionCheckResult {
+    std::string kernel;
+    const char* path;           // "tiled" or "separable"
+    double maxError;            // largest absolute difference of a channel
+    bool passed;
+};
+
+// runs demos of a DemoSuite one after the other for a fixed number of frames with a fixed
+// deltaSeconds, without a window and without user input, e.g.
+//  OpenGLDemos --benchmark --frames 600 --output scene.json "Scene Graph"
+// (--keys presses keys after loading each demo, e.g. --keys 3NN selects the GPU culling of the
+// "Scene Graph" and adds 20000 stress nodes) or replays a recorded session (key events, selected demos and delta times) frame by frame, e.g.
+//  OpenGLDemos --benchmark --replay gothic_bed.rec
+// (the recorded window sizes are ignored, --size decides the size).
+// With --capture every measured frame is also written as PNG file, to measure the cost of a sustained capture.
+// --stream records the measured frames of all demos as one video, e.g. for visual diffs between two builds.
+// Both read the default framebuffer and are refused if the HeadlessContext is surfaceless.
+// --check-convolution compares the compute shader convolution with the CPU reference on the same context.
+// The renderer of the suite needs a current OpenGL context (see HeadlessContext) and its GpuProfiler
+// must not be inside a frame. No ImGui frame is rendered.
+class DemoBenchmark
+{
+public:
+    DemoBenchmark(DemoSuite& suite, BenchmarkOptions options);
+
+    // true if the command line asks for the benchmark mode (--benchmark)
+    static bool isRequested(int argc, char** argv);
+    // --benchmark [--frames N] [--warmup N] [--delta SECONDS] [--size WIDTHxHEIGHT] [--output FILE]
+    //             [--keys KEYS] [--replay FILE] [--capture DIRECTORY] [--stream FILE] [--check-convolution]
+    //             [DEMO ...]
+    // prints the problem and returns nothing for invalid arguments
+    static std::optional<BenchmarkOptions> parseArguments(int argc, char** argv);
+
+    // returns false if a demo is not registered (the others still run), the replay failed
+    // or a convolution check failed
+    bool run();
+    const std::vector<DemoBenchmarkResult>& getResults() const {
+        return m_results;
+    }
+    const std::vector<ConvolutionCheckResult>& getConvolutionChecks() const {
+        return m_convolutionChecks;
+    }
+
+    // options, OpenGL implementation, results, convolution checks and the synchronous GL queries of the
+    // frames (debug builds)
+    void writeJson(std::ostream& os) const;
+    // writes the JSON to stdout and to the output file of the options
+    bool writeResults() const;
+
+private:
+    // the demos or the replay, returns like run()
+    bool runAll();
+    std::optional<DemoBenchmarkResult> runDemo(const std::string& name);
+    std::optional<DemoBenchmarkResult> runReplay();
+    // runs warmupFrames + frames frames, nextFrame() is called before each of them and returns its deltaSeconds
+    void measureFrames(std::size_t frames, const std::function<float()>& nextFrame, DemoBenchmarkResult& result);
+    // filters a test image with every kernel of the Framebuffer demo on the GPU (the tiled path, and the
+    // separable path for separable kernels) and on the CPU, returns false if a result differs
+    bool checkConvolution();
+
+    DemoSuite& m_suite;
+    BenchmarkOptions m_options;
+    std::vector<DemoBenchmarkResult> m_results;
+    std::vector<ConvolutionCheckResult> m_convolutionChecks;
+    std::unique_ptr<FrameCapture> m_capture; // while run() runs with --capture or --stream
+    std::uint64_t m_streamedFrames = 0;
+};
+
+}
+
+#endif // DEMOBENCHMARK_H
@@ -3,6 +3,7 @@
 
 #include "Demo.h"
 
+#include <array>
 #include <vector>
 #include <tuple>
 #include <memory>
@@ -20,7 +21,15 @@
 
 #include "ControllerSun.h"
 
+#include "DepthPrepass.h"
+
 #include "GLFramebufferObject.h"
+#include "RenderTargetPool.h"
+#include "RenderGraph.h"
+
+#include "GLImageFilter.h"
+#include "GLTimerQuery.h"
+#include "cpu_image_filter.h"
 
 
 namespace demo {
@@ -42,6 +51,23 @@ private:
     static const GLuint texUnitColorBuffer;
     static const GLuint texUnitUnused;
 
+    // where the post processing filter runs:
+    enum class FilterBackend : int {
+        FRAGMENT_SHADER = 0, // while drawing to the screen (Filter.shader)
+        COMPUTE_SHADER = 1,  // GLImageFilter
+        CPU = 2,             // read back, applyConvolution(..), upload
+        COUNT = 3
+    };
+    static constexpr std::size_t backendCount = static_cast<std::size_t>(FilterBackend::COUNT);
+
+    // declares the passes of this frame: scene (+ resolve), filter, present
+    void buildRenderGraph();
+    // draws the scene into the bound framebuffer
+    void renderScene();
+    // formats of the color buffers by what is stored in them (the same for every backend):
+    static RenderTargetRequirements getSceneColorRequirements(const ConvolutionKernel& kernel);
+    static RenderTargetRequirements getFilteredColorRequirements(const ConvolutionKernel& kernel);
+
     // 1. members for rendering into fbo
     // ---------------------------------
     Camera m_camera;
@@ -64,19 +90,39 @@ private:
     // glm::vec3 m_k_a; just set k_a := k_d (:= texture color)
     float m_shininess;
 
-    std::vector<std::tuple<GLVertexBuffer, GLVertexArray, GLIndexBuffer>> m_glMeshes;
+    DepthPrepass m_depthPrepass;
+    std::vector<GLSplitMesh> m_glMeshes;
     std::unique_ptr<GLTexture> m_texBaseColor;
 
     // 2. members for fbo
     // ------------------
-    std::unique_ptr<GLTexture> m_texColorBuffer;
-    std::unique_ptr<GLTexture> m_texDepthBuffer;
-    std::unique_ptr<GLFramebufferObject> m_fbo;
+    // color and depth buffers (and the fbos) are taken from the pool each frame by the render graph
+    // -> resizing the window only allocates when a size class is crossed:
+    RenderTargetPool m_renderTargets;
+    RenderGraph m_renderGraph;
+    int m_width;
+    int m_height;
+    int m_samples; // > 1 -> render into multisampled buffers and resolve into the color buffer
+    bool m_negotiateFormats; // false -> GL_RGBA32F for all color buffers (for comparison)
+    GLenum m_sceneColorFormat;
+    GLenum m_filteredColorFormat;
 
     // 3. members for rendering from fbo to screen
     // -------------------------------------------
     std::unique_ptr<GLShaderProgram> m_filterSP;
 
+    // post processing filter:
+    std::vector<ConvolutionKernel> m_kernels;
+    ConvolutionKernel m_identityKernel; // for drawing to the screen after the other backends
+    int m_kernelIndex;
+    int m_backend; // FilterBackend
+    std::unique_ptr<GLImageFilter> m_imageFilter;
+    CPUImageRGBA32F m_cpuInput;  // (kept to reuse the memory)
+    CPUImageRGBA32F m_cpuOutput;
+    // per kernel and backend:
+    std::vector<std::array<GLTimerQuery, backendCount>> m_filterTimers;
+    std::vector<double> m_cpuFilterTime_ms; // wall clock of the CPU backend (incl. readback and upload)
+
     std::unique_ptr<GLIndexBuffer> m_rectIBO;
     std::unique_ptr<GLVertexBuffer> m_rectVBO;
     std::unique_ptr<GLVertexArray> m_rectVAO;
@@ -27,7 +27,9 @@
 #include "GLIndexBuffer.h"
 #include "GLVertexArray.h"
 
-#include "GLTexture.h"
+#include "GLTextureArray.h"
+
+#include "RenderQueue.h"
 
 
 namespace demo {
@@ -45,6 +47,9 @@ public:
     void OnImGuiRender() override;
 
 private:
+    // per draw data instead of binding another texture:
+    void setTextureUniforms(const TexturePackEntry& texture);
+
     static const GLuint texUnit;
 
     struct GLMesh {
@@ -61,7 +66,8 @@ private:
     std::unique_ptr<GLIndexBuffer> m_houseIBO;
 
     std::unique_ptr<GLShaderProgram> m_texturedSP;
-    std::unique_ptr<GLTexture> m_alphaTexture;
+    std::unique_ptr<GLTextureArray> m_textures; // layers of all textures
+    TexturePackEntry m_alphaTexture;
     std::unique_ptr<GLVertexBuffer> m_rectVBO;
     std::unique_ptr<GLVertexArray> m_rectVAO;
     std::unique_ptr<GLIndexBuffer> m_rectIBO;
@@ -71,10 +77,17 @@ private:
     std::unique_ptr<GLIndexBuffer> m_starIBO;
 
     std::vector<GLMesh> m_suzanneMeshes;
-    std::unique_ptr<GLTexture> m_gridTexture;
+    TexturePackEntry m_gridTexture;
     float m_starColor[4];
     float m_starRot_deg;
     float m_starRot_degPerSec;
+
+    // all draws go through the queue (pass 0: opaque, pass 1: blended):
+    RenderMaterial m_houseMaterial;
+    RenderMaterial m_starMaterial;
+    RenderMaterial m_gridMaterial;
+    RenderMaterial m_alphaMaterial;
+    RenderQueue m_renderQueue;
 };
 
 }
@@ -20,6 +20,8 @@
 
 #include "ControllerSun.h"
 
+#include "DepthPrepass.h"
+
 namespace demo {
 
 class DemoPhongReflectionModelTextured : public Demo
@@ -53,7 +55,8 @@ private:
     // glm::vec3 m_k_a; just set k_a := k_d (:= texture color)
     float m_shininess;
 
-    std::vector<std::tuple<GLVertexBuffer, GLVertexArray, GLIndexBuffer>> m_glMeshes;
+    DepthPrepass m_depthPrepass;
+    std::vector<GLSplitMesh> m_glMeshes;
     std::unique_ptr<GLTexture> m_texBaseColor;
 };
 
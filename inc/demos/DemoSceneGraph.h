@@ -0,0 +1,118 @@
+#ifndef DEMOSCENEGRAPH_H
+#define DEMOSCENEGRAPH_H
+
+#include "Demo.h"
+
+#include <array>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Camera.h"
+#include "ControllerCamera.h"
+
+#include "GLVertexArray.h"
+#include "GLVertexBuffer.h"
+#include "GLIndexBuffer.h"
+#include "GLTexture.h"
+#include "GLFramebufferObject.h"
+
+#include "GLShaderProgram.h"
+
+#include "SceneGraph.h"
+#include "RenderQueue.h"
+#include "CommandList.h"
+#include "GpuCulling.h"
+
+namespace demo {
+
+// suns orbiting the origin, planets orbiting the suns and moons orbiting the planets.
+// Optionally a large number of additional nodes, 1% of which change every frame,
+// to compare the cost of the transform update with the size of the scene.
+// The draws are either sorted with a RenderQueue on the GL thread, recorded into CommandLists
+// on the worker threads of the ThreadPool and only replayed on the GL thread, or culled and
+// issued on the GPU (GpuCulling) with a constant number of GL calls.
+// Keys (also for recordings and --benchmark --keys): 1, 2, 3 select the render queue, the command lists
+// or the GPU culling, N adds (and draws) 10000 stress nodes, M toggles drawing the stress nodes and
+// H toggles the Hi-Z occlusion test of the GPU culling.
+class DemoSceneGraph : public Demo
+{
+public:
+    DemoSceneGraph(GLRenderer& renderer);
+    ~DemoSceneGraph();
+
+    void OnWindowSizeChanged(int width, int height) override;
+    bool OnKeyPressed(int key, int scancode, int action, int mods) override;
+    void OnUpdate(float deltaSeconds) override;
+    void OnRender() override;
+    void OnImGuiRender() override;
+
+private:
+    enum class RenderPath : int {
+        RENDER_QUEUE = 0,
+        COMMAND_LISTS = 1, // recorded on the worker threads
+        GPU_CULLING = 2    // into m_sceneFBO, its depth buffer is the occluder of the next frame
+    };
+
+    struct Orbit {
+        SceneGraph::NodeId pivot;       // rotates around its parent
+        SceneGraph::NodeId body;        // drawn, child of pivot
+        float angle_rad;
+        float speed_radPerSec;
+        std::size_t materialIndex;
+    };
+
+    void addOrbits(SceneGraph::NodeId parent, int count, float radius, float scale, float speed_radPerSec,
+                   int depth);
+    void resizeStressNodes(int count);
+    // body and material of draw i (orbits first, then the stress nodes):
+    SceneGraph::NodeId getDrawNode(std::size_t i) const;
+    std::size_t getDrawMaterialIndex(std::size_t i) const;
+    void renderQueued(const glm::mat4& cc_from_wc, const glm::mat4& ndc_from_wc, std::size_t drawCount);
+    void renderCommandLists(const glm::mat4& ndc_from_wc, std::size_t drawCount);
+    void renderGpuCulled(const glm::mat4& ndc_from_wc, std::size_t drawCount);
+
+    Camera m_camera;
+    ControllerCamera m_cameraController;
+
+    std::unique_ptr<GLShaderProgram> m_shaderP;
+    std::unique_ptr<GLVertexBuffer> m_starVBO;
+    std::unique_ptr<GLVertexArray> m_starVAO;
+    std::unique_ptr<GLIndexBuffer> m_starIBO;
+
+    // one material per depth (suns, planets, moons), their draws are interleaved in m_orbits:
+    std::array<glm::vec4, 3> m_colors;
+    std::array<RenderMaterial, 3> m_materials;
+    RenderQueue m_renderQueue;
+    int m_renderPath; // RenderPath
+    std::vector<CommandList> m_commandLists; // one per chunk of draws
+    std::size_t m_usedCommandLists;
+    float m_avgRenderTime_ms;
+
+    // GPU culling (the stars with the object index attribute of m_objectsSP):
+    std::unique_ptr<GLShaderProgram> m_objectsSP;
+    std::unique_ptr<GLVertexArray> m_culledStarVAO;
+    GpuCulling m_gpuCulling;
+    bool m_occlusionCulling; // test against the depth buffer of the last frame, otherwise only the frustum
+    GLFramebufferObject m_sceneFBO;
+    std::unique_ptr<GLTexture> m_sceneColor;
+    std::unique_ptr<GLTexture> m_sceneDepth;
+    int m_width;
+    int m_height;
+
+    SceneGraph m_scene;
+    std::vector<Orbit> m_orbits;
+
+    // stress test:
+    int m_stressNodeTarget;
+    std::vector<SceneGraph::NodeId> m_stressNodes;
+    bool m_drawStressNodes;
+    std::mt19937 m_rng;
+    float m_time_s;
+
+    float m_avgUpdateTime_ms;
+};
+
+}
+
+#endif // DEMOSCENEGRAPH_H
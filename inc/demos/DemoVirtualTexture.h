@@ -0,0 +1,60 @@
+#ifndef DEMOVIRTUALTEXTURE_H
+#define DEMOVIRTUALTEXTURE_H
+
+#include "Demo.h"
+
+#include <memory>
+
+#include "Camera.h"
+#include "ControllerCamera.h"
+
+#include "GLVertexArray.h"
+#include "GLVertexBuffer.h"
+#include "GLIndexBuffer.h"
+
+#include "GLShaderProgram.h"
+
+#include "GLVirtualTexture.h"
+#include "VirtualTextureFeedback.h"
+
+namespace demo {
+
+// a large ground plane with a 4096x4096 texture that is streamed from a page file
+// into a physical page cache that holds only a fraction of it.
+class DemoVirtualTexture : public Demo
+{
+public:
+    DemoVirtualTexture(GLRenderer& renderer);
+    ~DemoVirtualTexture();
+
+    void OnWindowSizeChanged(int width, int height) override;
+    bool OnKeyPressed(int key, int scancode, int action, int mods) override;
+    void OnUpdate(float deltaSeconds) override;
+    void OnRender() override;
+    void OnImGuiRender() override;
+
+private:
+    static const GLuint texUnitPhysical;
+    static const GLuint texUnitPageTable;
+
+    Camera m_camera;
+    ControllerCamera m_cameraController;
+
+    std::unique_ptr<GLShaderProgram> m_vtSP;
+    std::unique_ptr<GLShaderProgram> m_feedbackSP;
+    std::unique_ptr<GLVertexBuffer> m_groundVBO;
+    std::unique_ptr<GLIndexBuffer> m_groundIBO;
+    std::unique_ptr<GLVertexArray> m_groundVAO;         // attribute locations of m_vtSP
+    std::unique_ptr<GLVertexArray> m_groundFeedbackVAO; // attribute locations of m_feedbackSP
+
+    std::unique_ptr<GLVirtualTexture> m_virtualTex;
+    VirtualTextureFeedback m_feedback;
+    std::size_t m_feedbackPageCount;
+
+    int m_maxUploadsPerFrame;
+    bool m_showLevels;
+};
+
+}
+
+#endif // DEMOVIRTUALTEXTURE_H
@@ -0,0 +1,110 @@
+#ifndef INPUTRECORDING_H
+#define INPUTRECORDING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <utility> // for std::pair
+#include <vector>
+
+namespace demo {
+
+class DemoSuite;
+
+// what reaches the DemoSuite between two frames
+struct InputEvent {
+    enum class Type : std::uint8_t {
+        KEY = 1,         // OnKeyPressed(key, scancode, action, mods)
+        WINDOW_SIZE = 2, // OnWindowSizeChanged(width, height)
+        DEMO = 3         // SelectDemo(demoName), CloseDemo() if the name is empty
+    };
+    Type type;
+    int key = 0;
+    int scancode = 0;
+    int action = 0;
+    int mods = 0;
+    int width = 0;
+    int height = 0;
+    std::string demoName;
+};
+
+struct InputFrame {
+    std::vector<InputEvent> events; // in the order they arrived, before OnUpdate(..) of the frame
+    float deltaSeconds = 0.f;
+};
+
+// writes the key events, window sizes, selected demos and delta times of a session to a compact binary
+// file (little endian, 5 bytes per frame without events), e.g.
+//  OpenGLDemos --record gothic_bed.rec "Load WavefrontOBJ-file"
+// Record the events the DemoSuite actually gets (not the ones Dear ImGui captures) and call
+// recordFrame(..) once per frame right before OnUpdate(..).
+class InputRecorder
+{
+public:
+    explicit InputRecorder(const std::filesystem::path& path);
+    // do not allow copy or move:
+    InputRecorder(const InputRecorder& other) = delete;
+    InputRecorder& operator=(const InputRecorder& other) = delete;
+
+    bool isValid() const {
+        return static_cast<bool>(m_file);
+    }
+    std::size_t getFrameCount() const {
+        return m_frameCount;
+    }
+
+    void recordKey(int key, int scancode, int action, int mods);
+    void recordWindowSize(int width, int height);
+    // only records changes, call it after everything that could select or close a demo (e.g. OnImGuiRender())
+    void recordDemo(const std::string& name);
+    // ends the events of the frame
+    void recordFrame(float deltaSeconds);
+
+private:
+    std::ofstream m_file;
+    std::optional<std::string> m_demoName;
+    std::size_t m_frameCount = 0;
+};
+
+// feeds a recording of InputRecorder back into a DemoSuite frame by frame. The recorded delta times are
+// the fixed timestep, so every replay updates the demos with exactly the same input.
+class InputReplay
+{
+public:
+    // reads the whole file, isValid() is false if it is missing or not a recording
+    explicit InputReplay(const std::filesystem::path& path);
+
+    bool isValid() const {
+        return m_valid;
+    }
+    const std::vector<InputFrame>& getFrames() const {
+        return m_frames;
+    }
+    std::size_t getCurrentFrame() const {
+        return m_currentFrame;
+    }
+    bool isFinished() const {
+        return m_currentFrame >= m_frames.size();
+    }
+    void restart() {
+        m_currentFrame = 0;
+    }
+    // of the first WINDOW_SIZE event
+    std::optional<std::pair<int, int>> getInitialWindowSize() const;
+
+    // applies the events of the next frame to the suite and returns its deltaSeconds
+    // (window sizes are skipped if !applyWindowSize, e.g. if a real window decides the size)
+    float replayFrame(DemoSuite& suite, bool applyWindowSize = true);
+
+private:
+    std::vector<InputFrame> m_frames;
+    std::size_t m_currentFrame = 0;
+    bool m_valid = false;
+};
+
+}
+
+#endif // INPUTRECORDING_H
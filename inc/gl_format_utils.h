@@ -0,0 +1,19 @@
+#ifndef GL_FORMAT_UTILS_H
+#define GL_FORMAT_UTILS_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+// bits per pixel, or bytes per 4x4 block of block compressed formats (blockBytes != 0)
+struct GLFormatSize {
+    std::size_t bitsPerPixel;
+    std::size_t blockBytes;
+};
+
+// size of a texel of a texture internal format (the single table of format sizes, used by
+// GpuMemoryRegistry, RenderTargetPool and RenderGraph). Does not call OpenGL.
+// Unknown formats count as 32 bits per pixel.
+GLFormatSize getGLFormatSize(GLenum internalformat);
+
+#endif // GL_FORMAT_UTILS_H
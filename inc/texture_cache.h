@@ -0,0 +1,34 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <filesystem>
+#include <optional>
+
+#include "cpu_image_mipmap.h"  // for MipFilter
+#include "cpu_image_structs.h" // for CPUTexture, CPUCompressedTexture
+
+// KTX2 container (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html) with one
+// layer, one face, no supercompression and all mip levels of an R8, RG8, RGBA8 or a BC1/BC3 texture.
+// The rows are stored bottom to top (KTXorientation "ru").
+bool writeKTX2File(const std::filesystem::path& filepath, const CPUTexture& texture);
+bool writeKTX2File(const std::filesystem::path& filepath, const CPUCompressedTexture& texture);
+// only read files written by writeKTX2File(..) (the data format descriptor is not interpreted)
+std::optional<CPUTexture> readKTX2File(const std::filesystem::path& filepath);
+std::optional<CPUCompressedTexture> readCompressedKTX2File(const std::filesystem::path& filepath);
+
+// where loadTexture(..) / loadCompressedTexture(..) keep the mip chain of an image file:
+std::filesystem::path getTextureCachePath(const std::filesystem::path& imagePath, int channels,
+                                          bool sRGB, MipFilter filter);
+std::filesystem::path getTextureCachePath(const std::filesystem::path& imagePath, BlockFormat format,
+                                          bool sRGB, MipFilter filter);
+
+// load the full mip chain of the image file from its cache file. If the cache file is missing
+// or older than the image file, the mip chain is generated (and compressed, which may take a while)
+// and the cache file is (re)written.
+std::optional<CPUTexture> loadTexture(const std::filesystem::path& imagePath, int channels,
+                                      bool sRGB, MipFilter filter = MipFilter::Box);
+std::optional<CPUCompressedTexture> loadCompressedTexture(const std::filesystem::path& imagePath,
+                                                          BlockFormat format, bool sRGB,
+                                                          MipFilter filter = MipFilter::Box);
+
+#endif // TEXTURE_CACHE_H
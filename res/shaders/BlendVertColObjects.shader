@@ -0,0 +1,46 @@
+// blend vertex colors with the material color of the object, for the indirect draws of GpuCulling
+// (the baseInstance of each draw is the index of its object)
+#shader vertex
+#version 430 core
+in vec4 position_oc;
+in vec4 color;
+layout(location = 15) in uint objectIndex; // GpuCulling::objectIndexLocation
+out vec4 v_color;
+
+struct Object {
+    vec4 boundingSphere_oc;
+    uint indexCount;
+    uint firstIndex;
+    int baseVertex;
+    uint materialIndex;
+};
+
+layout(std430, binding = 0) readonly buffer Transforms {
+    mat4 wc_from_oc[];
+};
+layout(std430, binding = 1) readonly buffer Objects {
+    Object objects[];
+};
+
+const int maxMaterials = 8;
+uniform vec4 u_colors[maxMaterials];
+
+uniform mat4 u_ndc_from_wc;
+
+void main()
+{
+   vec4 materialColor = u_colors[objects[objectIndex].materialIndex];
+   v_color = vec4(color.rgb * color.a + (1.f - color.a) * materialColor.rgb, 1.f);
+   gl_Position = u_ndc_from_wc * wc_from_oc[objectIndex] * position_oc;
+}
+
+#shader fragment
+#version 430 core
+in vec4 v_color;
+layout(location = 0) out vec4 out_color;
+
+
+void main()
+{
+   out_color = v_color;
+}
@@ -0,0 +1,52 @@
+#shader compute
+#version 430 core
+// one 1D pass of a separable convolution of the u_size region of u_input.
+// tap i reads the pixel at offset (i - u_radius) * u_direction, i.e. u_direction is (1, 0) for the
+// horizontal pass and (0, -1) for the vertical pass (the first weight of a column is the top).
+// Every work group filters a segment of 128 pixels of one row/column that it first loads
+// together with an apron of u_radius pixels into shared memory.
+layout(local_size_x = 128, local_size_y = 1) in;
+const int groupSize = 128;
+const int maxRadius = 7;
+
+uniform sampler2D u_input;
+// image format of u_output (GLImageFilter defines it for other output formats):
+#ifndef OUTPUT_FORMAT
+#define OUTPUT_FORMAT rgba32f
+#endif
+layout(OUTPUT_FORMAT, binding = 0) uniform writeonly image2D u_output;
+uniform ivec2 u_size;
+
+uniform ivec2 u_direction;
+uniform int u_radius;
+uniform float u_weights[2 * maxRadius + 1];
+uniform bool u_absolute;
+
+shared vec4 line[groupSize + 2 * maxRadius];
+
+void main()
+{
+    ivec2 along = abs(u_direction);
+    ivec2 across = ivec2(1) - along;
+    int segmentBegin = int(gl_WorkGroupID.x) * groupSize;
+    int lineIndex = int(gl_WorkGroupID.y);
+    ivec2 maxCoord = u_size - ivec2(1);
+    // line[k] is the pixel at segmentBegin + k - u_radius:
+    for (int k = int(gl_LocalInvocationID.x); k < groupSize + 2 * u_radius; k += groupSize) {
+        ivec2 p = (segmentBegin + k - u_radius) * along + lineIndex * across;
+        line[k] = texelFetch(u_input, clamp(p, ivec2(0), maxCoord), 0);
+    }
+    barrier();
+
+    int localIndex = int(gl_LocalInvocationID.x);
+    ivec2 pixel = (segmentBegin + localIndex) * along + lineIndex * across;
+    if (any(greaterThanEqual(pixel, u_size))) {
+        return;
+    }
+    int stepSign = u_direction.x + u_direction.y; // 1 or -1
+    vec3 res = vec3(0.f);
+    for (int i = 0; i <= 2 * u_radius; ++i) {
+        res += u_weights[i] * line[localIndex + u_radius + stepSign * (i - u_radius)].rgb;
+    }
+    imageStore(u_output, pixel, vec4(u_absolute ? abs(res) : res, 1.f));
+}
@@ -0,0 +1,50 @@
+#shader compute
+#version 430 core
+// 2D convolution (see ConvolutionKernel in cpu_image_filter.h) of the u_size region of u_input.
+// Every work group first loads its 16 x 16 pixels plus an apron of u_radius pixels into shared
+// memory, so each texel is fetched about once instead of once per tap.
+layout(local_size_x = 16, local_size_y = 16) in;
+const int groupSize = 16;
+const int maxRadius = 7;
+const int maxTileSize = groupSize + 2 * maxRadius;
+
+uniform sampler2D u_input;
+// image format of u_output (GLImageFilter defines it for other output formats):
+#ifndef OUTPUT_FORMAT
+#define OUTPUT_FORMAT rgba32f
+#endif
+layout(OUTPUT_FORMAT, binding = 0) uniform writeonly image2D u_output;
+uniform ivec2 u_size;
+
+uniform ivec2 u_radius;
+uniform float u_weights[(2 * maxRadius + 1) * (2 * maxRadius + 1)];
+uniform bool u_absolute;
+
+shared vec4 tile[maxTileSize * maxTileSize];
+
+void main()
+{
+    ivec2 tileSize = ivec2(groupSize) + 2 * u_radius;
+    ivec2 tileOrigin = ivec2(gl_WorkGroupID.xy) * groupSize - u_radius;
+    ivec2 maxCoord = u_size - ivec2(1);
+    for (int i = int(gl_LocalInvocationIndex); i < tileSize.x * tileSize.y; i += groupSize * groupSize) {
+        ivec2 t = ivec2(i % tileSize.x, i / tileSize.x);
+        tile[i] = texelFetch(u_input, clamp(tileOrigin + t, ivec2(0), maxCoord), 0);
+    }
+    barrier();
+
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(pixel, u_size))) {
+        return;
+    }
+    ivec2 center = ivec2(gl_LocalInvocationID.xy) + u_radius; // in the tile
+    int kernelWidth = 2 * u_radius.x + 1;
+    vec3 res = vec3(0.f);
+    for (int row = 0; row <= 2 * u_radius.y; ++row) {
+        for (int col = 0; col < kernelWidth; ++col) {
+            ivec2 t = center + ivec2(col - u_radius.x, u_radius.y - row);
+            res += u_weights[kernelWidth * row + col] * tile[t.y * tileSize.x + t.x].rgb;
+        }
+    }
+    imageStore(u_output, pixel, vec4(u_absolute ? abs(res) : res, 1.f));
+}
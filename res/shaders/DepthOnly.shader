@@ -0,0 +1,24 @@
+#shader vertex
+#version 330 core
+// only positions are needed to fill the depth buffer.
+// (used for the depth pre-pass, the vertex array only contains the position stream)
+in vec4 position_oc;
+uniform mat4 u_ndc_from_oc;
+
+// the shading pass after the depth pre-pass uses glDepthFunc(GL_EQUAL).
+// -> gl_Position must be computed exactly the same way in both passes
+//      (TexturedPhongRefl.shader declares it as invariant as well)
+invariant gl_Position;
+
+void main()
+{
+    gl_Position = u_ndc_from_oc * position_oc;
+}
+
+#shader fragment
+#version 330 core
+// no color output, only the depth of the fragment is written.
+
+void main()
+{
+}
@@ -11,27 +11,31 @@ void main()
 #version 330 core
 // in vec4 gl_FragCoord;
 uniform sampler2D tex;
-const float[3 * 3] filter = float[]( 1.f, 0.f, -1.f,
-                                     2.f, 0.f, -2.f,
-                                     1.f, 0.f, -1.f);
+// the texture can be larger than the rendered region (see RenderTargetPool):
+uniform ivec2 u_maxCoord;
+
+// convolution kernel (see ConvolutionKernel in cpu_image_filter.h), the first row is the top row:
+const int maxRadius = 7;
+uniform ivec2 u_radius;
+uniform float u_weights[(2 * maxRadius + 1) * (2 * maxRadius + 1)];
+uniform bool u_absolute;
 
 layout(location = 0) out vec4 out_color;
 
 void main()
 {
-    ivec2 maxCoord = textureSize(tex, 0) - ivec2(1);
+    ivec2 maxCoord = min(u_maxCoord, textureSize(tex, 0) - ivec2(1));
+    int kernelWidth = 2 * u_radius.x + 1;
     vec3 res = vec3(0.f);
-    for (int offX = -1; offX <= 1; ++offX) {
-        for (int offY = -1; offY <= 1; ++offY) {
-            ivec2 unnormTexCoord = clamp(ivec2(gl_FragCoord.xy) + ivec2(offX, offY), ivec2(0), maxCoord);
+    for (int row = 0; row <= 2 * u_radius.y; ++row) {
+        for (int col = 0; col < kernelWidth; ++col) {
+            ivec2 offset = ivec2(col - u_radius.x, u_radius.y - row);
+            ivec2 unnormTexCoord = clamp(ivec2(gl_FragCoord.xy) + offset, ivec2(0), maxCoord);
             vec3 in_color = texelFetch(tex, unnormTexCoord, 0).rgb;
-            int col = offX + 1;
-            int row = 1 - offY;
-            res += filter[3*row + col] * in_color;
+            res += u_weights[kernelWidth * row + col] * in_color;
        }
     }
-    // out_color = vec4(res, 1.f);
-    out_color = vec4(abs(res), 1.f);
+    out_color = vec4(u_absolute ? abs(res) : res, 1.f);
 }
 
 
@@ -0,0 +1,131 @@
+#shader compute
+#version 430 core
+// visibility of one object per invocation (see GpuCulling.h): the bounding sphere is tested against the
+// frustum of u_ndc_from_wc and against the Hi-Z pyramid of the previous frame. The commands of the visible
+// objects are appended to commands[] (u_compact) or every object keeps its command with 0 or 1 instances.
+layout(local_size_x = 64) in;
+
+struct Object {
+    vec4 boundingSphere_oc;
+    uint indexCount;
+    uint firstIndex;
+    int baseVertex;
+    uint materialIndex;
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Transforms {
+    mat4 wc_from_oc[];
+};
+layout(std430, binding = 1) readonly buffer Objects {
+    Object objects[];
+};
+layout(std430, binding = 2) writeonly buffer Commands {
+    DrawCommand commands[];
+};
+layout(std430, binding = 3) buffer DrawCount {
+    uint drawCount;
+};
+
+uniform int u_objectCount;
+uniform mat4 u_ndc_from_wc;
+uniform bool u_compact;
+
+uniform bool u_useHiZ;
+uniform sampler2D u_hiZ;          // maximum depth pyramid of the previous frame (HiZBuild.shader)
+uniform mat4 u_hiZ_ndc_from_wc;   // the camera the depth buffer was rendered with
+
+shared uint s_visibleCount;
+shared uint s_firstCommand;
+
+bool isInFrustum(vec3 center_wc, float radius_wc)
+{
+    // the planes of the frustum are sums of the rows of u_ndc_from_wc (Gribb & Hartmann):
+    mat4 m = transpose(u_ndc_from_wc);
+    vec4 planes[6] = vec4[6](m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2]);
+    for (int i = 0; i < 6; ++i) {
+        if (dot(planes[i], vec4(center_wc, 1.)) < -radius_wc * length(planes[i].xyz)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isOccluded(vec3 center_wc, float radius_wc)
+{
+    // rectangle and nearest depth of the box around the sphere in the depth buffer:
+    vec2 minUV = vec2(1.);
+    vec2 maxUV = vec2(0.);
+    float minDepth = 1.;
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = center_wc + radius_wc * vec3((i & 1) != 0 ? 1. : -1., (i & 2) != 0 ? 1. : -1., (i & 4) != 0 ? 1. : -1.);
+        vec4 corner_cc = u_hiZ_ndc_from_wc * vec4(corner, 1.);
+        if (corner_cc.w <= 0.) {
+            return false; // reaches behind the camera
+        }
+        vec3 corner_win = corner_cc.xyz / corner_cc.w * .5 + .5;
+        minUV = min(minUV, corner_win.xy);
+        maxUV = max(maxUV, corner_win.xy);
+        minDepth = min(minDepth, corner_win.z);
+    }
+    minUV = clamp(minUV, 0., 1.);
+    maxUV = clamp(maxUV, 0., 1.);
+
+    // the level on which the rectangle covers at most 2 x 2 texels:
+    ivec2 size = textureSize(u_hiZ, 0);
+    vec2 extent = (maxUV - minUV) * vec2(size);
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.)))), 0, textureQueryLevels(u_hiZ) - 1);
+    ivec2 maxCoord = textureSize(u_hiZ, level) - 1;
+    // (texels of a level cover the last row/column of the previous level for odd sizes, see HiZBuild.shader)
+    ivec2 lo = min(ivec2(minUV * vec2(size)) >> level, maxCoord);
+    ivec2 hi = min(ivec2(maxUV * vec2(size)) >> level, maxCoord);
+    float maxDepth = max(max(texelFetch(u_hiZ, lo, level).r, texelFetch(u_hiZ, ivec2(hi.x, lo.y), level).r),
+                         max(texelFetch(u_hiZ, ivec2(lo.x, hi.y), level).r, texelFetch(u_hiZ, hi, level).r));
+    return minDepth > maxDepth;
+}
+
+void main()
+{
+    if (gl_LocalInvocationIndex == 0) {
+        s_visibleCount = 0;
+    }
+    memoryBarrierShared();
+    barrier();
+
+    uint i = gl_GlobalInvocationID.x;
+    bool visible = false;
+    DrawCommand command;
+    if (int(i) < u_objectCount) {
+        Object object = objects[i];
+        mat4 m = wc_from_oc[i];
+        vec3 center_wc = (m * vec4(object.boundingSphere_oc.xyz, 1.)).xyz;
+        float radius_wc = object.boundingSphere_oc.w * max(max(length(m[0].xyz), length(m[1].xyz)), length(m[2].xyz));
+        visible = isInFrustum(center_wc, radius_wc) && !(u_useHiZ && isOccluded(center_wc, radius_wc));
+        command = DrawCommand(object.indexCount, visible ? 1u : 0u, object.firstIndex, object.baseVertex, i);
+    }
+
+    // one atomic operation on the global count per work group:
+    uint localIndex = visible ? atomicAdd(s_visibleCount, 1u) : 0u;
+    memoryBarrierShared();
+    barrier();
+    if (gl_LocalInvocationIndex == 0) {
+        s_firstCommand = atomicAdd(drawCount, s_visibleCount);
+    }
+    memoryBarrierShared();
+    barrier();
+
+    if (u_compact) {
+        if (visible) {
+            commands[s_firstCommand + localIndex] = command;
+        }
+    } else if (int(i) < u_objectCount) {
+        commands[i] = command;
+    }
+}
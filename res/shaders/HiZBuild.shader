@@ -0,0 +1,35 @@
+#shader compute
+#version 430 core
+// one level of the Hi-Z pyramid of GpuCulling: level 0 is a copy of the depth buffer, every texel of the
+// following levels is the maximum of the 2 x 2 texels of the previous level below it. For odd sizes the
+// texels at the end of a row/column also cover the last column/row of the previous level (3 texels),
+// so every level stays conservative.
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform bool u_fromDepth;
+uniform sampler2D u_depth;                                     // u_fromDepth
+layout(r32f, binding = 0) uniform readonly image2D u_source;   // the previous level otherwise
+layout(r32f, binding = 1) uniform writeonly image2D u_destination;
+uniform ivec2 u_sourceSize;
+uniform ivec2 u_destinationSize;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(coord, u_destinationSize))) {
+        return;
+    }
+    float depth = 0.;
+    if (u_fromDepth) {
+        depth = texelFetch(u_depth, coord, 0).r;
+    } else {
+        ivec2 first = 2 * coord;
+        ivec2 last = min(first + 1 + ivec2(equal(coord, u_destinationSize - 1)) * (u_sourceSize & 1), u_sourceSize - 1);
+        for (int y = first.y; y <= last.y; ++y) {
+            for (int x = first.x; x <= last.x; ++x) {
+                depth = max(depth, imageLoad(u_source, ivec2(x, y)).r);
+            }
+        }
+    }
+    imageStore(u_destination, coord, vec4(depth));
+}
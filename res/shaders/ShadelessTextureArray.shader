@@ -0,0 +1,33 @@
+#shader vertex
+#version 330 core
+in vec4 position_oc;
+in vec2 texCoord;
+out vec2 texCoord_v;
+
+uniform mat4 u_ndc_from_oc;
+
+void main()
+{
+    gl_Position = u_ndc_from_oc * position_oc;
+    texCoord_v = texCoord;
+}
+
+#shader fragment
+#version 330 core
+in vec2 texCoord_v;
+layout(location = 0) out vec4 color;
+
+uniform sampler2DArray tex;
+
+// per draw: where the texture of the material was packed (see TexturePackEntry)
+uniform float u_layer;
+uniform vec4 u_uv_scale_offset;
+
+void main()
+{
+    // wrap before remapping into the layer (the texture may be a part of an atlas),
+    // the gradients of the unwrapped coordinates avoid seams where fract(..) jumps:
+    vec2 uv = fract(texCoord_v) * u_uv_scale_offset.xy + u_uv_scale_offset.zw;
+    color = textureGrad(tex, vec3(uv, u_layer),
+                        dFdx(texCoord_v) * u_uv_scale_offset.xy, dFdy(texCoord_v) * u_uv_scale_offset.xy);
+}
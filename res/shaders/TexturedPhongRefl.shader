@@ -16,6 +16,10 @@ out vec3 normal_cc;
 out vec3 posToCamera_cc;
 out vec2 texCoord_v;
 
+// must match the depth pre-pass (DepthOnly.shader) exactly,
+// otherwise its glDepthFunc(GL_EQUAL) test may reject fragments:
+invariant gl_Position;
+
 void main()
 {
     normal_cc = (u_cc_from_oc * vec4(normal_oc, 0.f)).xyz; // assuming the model and view transforms preserve angles (e.g. no shear)
@@ -0,0 +1,58 @@
+#shader vertex
+#version 330 core
+in vec4 position_oc;
+in vec2 texCoord;
+out vec2 texCoord_v;
+
+uniform mat4 u_ndc_from_oc;
+
+void main()
+{
+    gl_Position = u_ndc_from_oc * position_oc;
+    texCoord_v = texCoord;
+}
+
+#shader fragment
+#version 330 core
+in vec2 texCoord_v;
+layout(location = 0) out vec4 color;
+
+// see GLVirtualTexture::bind(..)
+uniform sampler2D u_vt_physical;   // cache of padded pages
+uniform sampler2D u_vt_page_table; // (slot x, slot y, level, resident) per page, one mip level per level
+uniform float u_vt_size;           // texels per side of level 0
+uniform float u_vt_page_size;      // texels per side of a page without border
+uniform float u_vt_border;
+uniform float u_vt_max_level;
+uniform vec3 u_vt_physical_size;   // width, height, padded page size
+
+uniform bool u_show_levels;
+
+void main()
+{
+    // level of detail from the texel footprint of the (unwrapped) coordinates.
+    // rounded down to the next level: a page table lookup returns a single page
+    float lod = 0.5 * log2(max(dot(dFdx(texCoord_v * u_vt_size), dFdx(texCoord_v * u_vt_size)),
+                               dot(dFdy(texCoord_v * u_vt_size), dFdy(texCoord_v * u_vt_size))));
+    float level = clamp(floor(lod), 0.0, u_vt_max_level);
+
+    vec2 uv = fract(texCoord_v); // repeat
+    float pages = max(u_vt_size / u_vt_page_size / exp2(level), 1.0);
+    vec4 entry = texelFetch(u_vt_page_table, ivec2(uv * pages), int(level));
+    if (entry.a == 0.0) {
+        // not even the coarsest page arrived yet:
+        color = vec4(0.5, 0.5, 0.5, 1.0);
+        return;
+    }
+    // the entry may point to a coarser page (fallback while the requested one streams in):
+    vec3 slotAndLevel = round(entry.rgb * 255.0);
+    float residentPages = max(u_vt_size / u_vt_page_size / exp2(slotAndLevel.z), 1.0);
+    vec2 inPage = fract(uv * residentPages) * u_vt_page_size;
+    vec2 physical = (slotAndLevel.xy * u_vt_physical_size.z + u_vt_border + inPage) / u_vt_physical_size.xy;
+    color = textureLod(u_vt_physical, physical, 0.0);
+
+    if (u_show_levels) {
+        const vec3 tints[4] = vec3[](vec3(1.0, 0.3, 0.3), vec3(0.3, 1.0, 0.3), vec3(0.3, 0.3, 1.0), vec3(1.0, 1.0, 0.3));
+        color.rgb *= tints[int(slotAndLevel.z) % 4];
+    }
+}
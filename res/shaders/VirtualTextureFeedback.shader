@@ -0,0 +1,37 @@
+#shader vertex
+#version 330 core
+in vec4 position_oc;
+in vec2 texCoord;
+out vec2 texCoord_v;
+
+uniform mat4 u_ndc_from_oc;
+
+void main()
+{
+    gl_Position = u_ndc_from_oc * position_oc;
+    texCoord_v = texCoord;
+}
+
+#shader fragment
+#version 330 core
+in vec2 texCoord_v;
+layout(location = 0) out vec4 feedback;
+
+// see VirtualTextureFeedback::begin(..)
+uniform float u_vt_size;
+uniform float u_vt_page_size;
+uniform float u_vt_max_level;
+uniform float u_vt_lod_bias; // compensates for the lower resolution of the feedback framebuffer
+
+void main()
+{
+    // same level selection as in VirtualTexture.shader:
+    float lod = 0.5 * log2(max(dot(dFdx(texCoord_v * u_vt_size), dFdx(texCoord_v * u_vt_size)),
+                               dot(dFdy(texCoord_v * u_vt_size), dFdy(texCoord_v * u_vt_size))));
+    float level = clamp(floor(lod + u_vt_lod_bias), 0.0, u_vt_max_level);
+
+    float pages = max(u_vt_size / u_vt_page_size / exp2(level), 1.0);
+    vec2 page = floor(fract(texCoord_v) * pages);
+    // stored in a RGBA8 framebuffer, see VirtualTextureFeedback::poll(..)
+    feedback = vec4(page, level, 255.0) / 255.0;
+}
@@ -0,0 +1,192 @@
+#include "CommandList.h"
+
+#include <cstring> // for std::memcpy(..)
+#include <type_traits>
+
+#include "debug_utils.h"
+
+namespace {
+
+// payloads of the commands (stored right after their type byte, unaligned -> always memcpy):
+struct BindProgramCmd {
+    GLShaderProgram* sp;
+};
+
+struct BindVertexArrayCmd {
+    GLVertexArray* va;
+    GLIndexBuffer* ib;
+};
+
+struct BindTextureCmd {
+    GLTexture* texture;
+    int texUnit;
+};
+
+template<typename T>
+struct UniformCmd {
+    GLint location;
+    T value;
+};
+
+struct DrawCmd {
+    GLIndexBuffer* ib;
+    GLIndexBuffer::count_type first;
+    GLIndexBuffer::count_type count;
+};
+
+template<typename Payload>
+Payload read(const std::byte*& p)
+{
+    Payload payload;
+    std::memcpy(&payload, p, sizeof(Payload));
+    p += sizeof(Payload);
+    return payload;
+}
+
+}
+
+template<typename Payload>
+void CommandList::push(CommandType type, const Payload &payload)
+{
+    static_assert(std::is_trivially_copyable_v<Payload>);
+    const std::size_t offset = m_bytes.size();
+    m_bytes.resize(offset + 1 + sizeof(Payload));
+    m_bytes[offset] = static_cast<std::byte>(type);
+    std::memcpy(m_bytes.data() + offset + 1, &payload, sizeof(Payload));
+    ++m_commandCount;
+}
+
+void CommandList::reset()
+{
+    m_bytes.clear();
+    m_commandCount = 0;
+    m_lastIB = nullptr;
+}
+
+void CommandList::bindProgram(GLShaderProgram &sp)
+{
+    push(CommandType::BIND_PROGRAM, BindProgramCmd{&sp});
+}
+
+void CommandList::bindVertexArray(GLVertexArray &va, GLIndexBuffer &ib)
+{
+    push(CommandType::BIND_VERTEX_ARRAY, BindVertexArrayCmd{&va, &ib});
+    m_lastIB = &ib;
+}
+
+void CommandList::bindTexture(GLTexture &texture, int texUnit)
+{
+    push(CommandType::BIND_TEXTURE, BindTextureCmd{&texture, texUnit});
+}
+
+void CommandList::setUniform1i(GLint location, int v)
+{
+    push(CommandType::UNIFORM_1I, UniformCmd<int>{location, v});
+}
+
+void CommandList::setUniform1f(GLint location, float v)
+{
+    push(CommandType::UNIFORM_1F, UniformCmd<float>{location, v});
+}
+
+void CommandList::setUniform4f(GLint location, const glm::vec4 &v)
+{
+    push(CommandType::UNIFORM_4F, UniformCmd<glm::vec4>{location, v});
+}
+
+void CommandList::setUniformMat4f(GLint location, const glm::mat4 &m)
+{
+    push(CommandType::UNIFORM_MAT4F, UniformCmd<glm::mat4>{location, m});
+}
+
+void CommandList::draw(GLIndexBuffer::count_type first, GLIndexBuffer::count_type count)
+{
+    ASSERT(m_lastIB); // bindVertexArray(..) has to be recorded first
+    ASSERT(0 <= first && first + count <= m_lastIB->getCount());
+    push(CommandType::DRAW, DrawCmd{m_lastIB, first, count});
+}
+
+void CommandList::draw()
+{
+    ASSERT(m_lastIB); // bindVertexArray(..) has to be recorded first
+    draw(0, m_lastIB->getCount());
+}
+
+void CommandList::replay(GLRenderer &renderer, gsl::span<const CommandList> lists)
+{
+    GLShaderProgram* sp = nullptr;
+    GLVertexArray* va = nullptr;
+    GLIndexBuffer* ib = nullptr;
+    for (const CommandList& list : lists) {
+        const std::byte* p = list.m_bytes.data();
+        const std::byte* end = p + list.m_bytes.size();
+        while (p < end) {
+            CommandType type = static_cast<CommandType>(*p++);
+            switch (type) {
+            case CommandType::BIND_PROGRAM: {
+                auto cmd = read<BindProgramCmd>(p);
+                if (cmd.sp != sp) {
+                    sp = cmd.sp;
+                    sp->bind();
+                }
+                break;
+            }
+            case CommandType::BIND_VERTEX_ARRAY: {
+                auto cmd = read<BindVertexArrayCmd>(p);
+                if (cmd.va != va) {
+                    va = cmd.va;
+                    va->bind();
+                    ib = nullptr; // the element array binding is part of the vertex array state
+                }
+                if (cmd.ib != ib) {
+                    ib = cmd.ib;
+                    ib->bind();
+                }
+                break;
+            }
+            case CommandType::BIND_TEXTURE: {
+                auto cmd = read<BindTextureCmd>(p);
+                cmd.texture->bind(cmd.texUnit);
+                break;
+            }
+            case CommandType::UNIFORM_1I: {
+                auto cmd = read<UniformCmd<int>>(p);
+                ASSERT(sp); // bindProgram(..) has to be recorded first
+                sp->setUniform1i(cmd.location, cmd.value);
+                break;
+            }
+            case CommandType::UNIFORM_1F: {
+                auto cmd = read<UniformCmd<float>>(p);
+                ASSERT(sp); // bindProgram(..) has to be recorded first
+                sp->setUniform1f(cmd.location, cmd.value);
+                break;
+            }
+            case CommandType::UNIFORM_4F: {
+                auto cmd = read<UniformCmd<glm::vec4>>(p);
+                ASSERT(sp); // bindProgram(..) has to be recorded first
+                sp->setUniform4f(cmd.location, cmd.value.x, cmd.value.y, cmd.value.z, cmd.value.w);
+                break;
+            }
+            case CommandType::UNIFORM_MAT4F: {
+                auto cmd = read<UniformCmd<glm::mat4>>(p);
+                ASSERT(sp); // bindProgram(..) has to be recorded first
+                sp->setUniformMat4f(cmd.location, cmd.value);
+                break;
+            }
+            case CommandType::DRAW: {
+                auto cmd = read<DrawCmd>(p);
+                ASSERT(cmd.ib == ib);
+                renderer.drawBound(*cmd.ib, cmd.first, cmd.count);
+                break;
+            }
+            }
+        }
+    }
+    // leave the same state behind as GLRenderer::draw(..):
+    if (sp) {
+        sp->unbind();
+    }
+    if (va) {
+        va->unbind();
+    }
+}
@@ -0,0 +1,171 @@
+#include "CpuProfiler.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <utility> // for std::move(..)
+
+#include "imgui.h"
+
+namespace {
+
+const auto programStart = std::chrono::steady_clock::now();
+
+void writeJsonString(std::ostream& os, const char* s)
+{
+    os << '"';
+    for (; *s != '\0'; ++s) {
+        if (*s == '"' || *s == '\\') {
+            os << '\\';
+        }
+        os << *s;
+    }
+    os << '"';
+}
+
+}
+
+CpuProfiler &CpuProfiler::shared()
+{
+    static CpuProfiler profiler;
+    return profiler;
+}
+
+std::uint64_t CpuProfiler::now_ns()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now() - programStart).count());
+}
+
+void CpuProfiler::setThreadName(std::string name)
+{
+    CpuProfiler& profiler = shared();
+    ThreadRing& ring = profiler.getThreadRing();
+    std::lock_guard lock(profiler.m_mutex);
+    ring.name = std::move(name);
+}
+
+void CpuProfiler::record(const char *name, std::uint64_t begin_ns, std::uint64_t end_ns)
+{
+    ThreadRing& ring = getThreadRing();
+    const std::size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) == ringCapacity) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring.events[head % ringCapacity] = CpuZoneEvent{name, begin_ns, end_ns};
+    // publish the event to collect():
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void CpuProfiler::collect()
+{
+    std::lock_guard lock(m_mutex);
+    collectLocked();
+}
+
+std::size_t CpuProfiler::getHistorySize() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_history.size();
+}
+
+std::size_t CpuProfiler::getDroppedCount() const
+{
+    std::lock_guard lock(m_mutex);
+    std::size_t dropped = 0;
+    for (const auto& ring : m_rings) {
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+bool CpuProfiler::writeChromeTrace(const std::filesystem::path &path)
+{
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "WARNING: could not open " << path << " for writing\n";
+        return false;
+    }
+    std::lock_guard lock(m_mutex);
+    collectLocked();
+    // complete events ("ph": "X"), nested by their time intervals per thread:
+    file << "{\"traceEvents\": [\n";
+    for (const auto& ring : m_rings) {
+        const std::string name = ring->name.empty() ? "thread " + std::to_string(ring->index) : ring->name;
+        file << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << ring->index
+             << ", \"args\": {\"name\": ";
+        writeJsonString(file, name.c_str());
+        file << "}},\n";
+    }
+    for (const HistoryEntry& entry : m_history) {
+        file << "  {\"name\": ";
+        writeJsonString(file, entry.event.name);
+        file << ", \"cat\": \"cpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << entry.thread
+             << ", \"ts\": " << static_cast<double>(entry.event.begin_ns) * 1e-3
+             << ", \"dur\": " << static_cast<double>(entry.event.end_ns - entry.event.begin_ns) * 1e-3 << "},\n";
+    }
+    // (no trailing comma after the last event)
+    file << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"OpenGLDemos\"}}\n"
+            "], \"displayTimeUnit\": \"ms\"}\n";
+    return static_cast<bool>(file);
+}
+
+void CpuProfiler::OnImGuiRender()
+{
+    if (!ImGui::Begin("CPU profiler")) {
+        ImGui::End();
+        return;
+    }
+#ifndef OPENGL_DEMOS_CPU_PROFILER
+    ImGui::Text("zones are compiled out (cmake option OPENGL_DEMOS_CPU_PROFILER)");
+#endif
+    bool enabled = isEnabled();
+    if (ImGui::Checkbox("record zones", &enabled)) {
+        setEnabled(enabled);
+    }
+    std::size_t discarded = 0;
+    {
+        std::lock_guard lock(m_mutex);
+        discarded = m_discarded;
+    }
+    ImGui::Text("%zu zones, %zu discarded (oldest), %zu dropped (full rings)",
+                getHistorySize(), discarded, getDroppedCount());
+    if (ImGui::Button("write cpu_trace.json")) {
+        if (writeChromeTrace("cpu_trace.json")) {
+            std::cout << "wrote cpu_trace.json\n";
+        }
+    }
+    ImGui::End();
+}
+
+CpuProfiler::ThreadRing &CpuProfiler::getThreadRing()
+{
+    // the profiler owns the ring, so zones recorded just before a thread ends are not lost:
+    thread_local ThreadRing* ring = nullptr;
+    if (!ring) {
+        auto newRing = std::make_shared<ThreadRing>();
+        std::lock_guard lock(m_mutex);
+        newRing->index = m_rings.size();
+        m_rings.push_back(newRing);
+        ring = newRing.get();
+    }
+    return *ring;
+}
+
+void CpuProfiler::collectLocked()
+{
+    for (const auto& ring : m_rings) {
+        const std::size_t tail = ring->tail.load(std::memory_order_relaxed);
+        const std::size_t head = ring->head.load(std::memory_order_acquire);
+        for (std::size_t i = tail; i != head; ++i) {
+            m_history.push_back(HistoryEntry{ring->events[i % ringCapacity], ring->index});
+        }
+        // hand the slots back to the thread:
+        ring->tail.store(head, std::memory_order_release);
+    }
+    while (m_history.size() > historyCapacity) {
+        m_history.pop_front();
+        ++m_discarded;
+    }
+}
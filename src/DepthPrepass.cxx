@@ -0,0 +1,113 @@
+#include "DepthPrepass.h"
+
+#include <filesystem>
+
+#include "imgui.h"
+
+#include "cpu_mesh_utils.h"
+#include "GLCallStats.h"
+
+DepthPrepass::DepthPrepass()
+    : m_enabled(false),
+      m_activePath(false),
+      m_avgSceneTime_ms{-1.f, -1.f}
+{
+    namespace fs = std::filesystem;
+    m_depthSP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/DepthOnly.shader",
+                                                           fs::path::format::generic_format));
+}
+
+GLSplitMesh DepthPrepass::makeMesh(CPUMesh<GLuint> &cpuMesh, const GLShaderProgram &shadingSP)
+{
+    CPUMultiStreamMesh<GLuint> splitMesh = splitPositionStream(cpuMesh);
+    ASSERT(splitMesh.streams.size() == 2);
+    CPUVertexArray& positions = splitMesh.streams[0];
+    CPUVertexArray& attribs = splitMesh.streams[1];
+
+    GLVertexBuffer positionVB(positions.data.size(), positions.data.data());
+    GLVertexBuffer attribVB(attribs.data.size(), attribs.data.data());
+
+    // vao for the shading pass:
+    GLVertexArray va;
+    positions.layout.setLocations(shadingSP);
+    attribs.layout.setLocations(shadingSP);
+    va.addBuffer(positionVB, positions.layout, 0);
+    va.addBuffer(attribVB, attribs.layout, 1);
+    GLIndexBuffer ib(GL_UNSIGNED_INT, static_cast<GLIndexBuffer::count_type>(splitMesh.ib.indices.size()),
+                     splitMesh.ib.indices.data());
+
+    // vao for the depth pre-pass (the location of position_oc may differ between the programs):
+    GLVertexArray positionVA;
+    positions.layout.setLocations(*m_depthSP);
+    positionVA.addBuffer(positionVB, positions.layout, 0);
+
+    return GLSplitMesh{std::move(positionVB), std::move(attribVB),
+                       std::move(va), std::move(positionVA), std::move(ib)};
+}
+
+void DepthPrepass::beginScene()
+{
+    m_activePath = m_enabled;
+    m_sceneTimers[m_activePath ? 1 : 0].begin();
+}
+
+void DepthPrepass::endScene()
+{
+    m_sceneTimers[m_activePath ? 1 : 0].end();
+    // update rolling average of both paths:
+    for (std::size_t path = 0; path < 2; ++path) {
+        if (auto time_ms = m_sceneTimers[path].poll()) {
+            float t = static_cast<float>(*time_ms);
+            m_avgSceneTime_ms[path] = (m_avgSceneTime_ms[path] < 0.f) ? t
+                                            : .95f * m_avgSceneTime_ms[path] + .05f * t;
+        }
+    }
+}
+
+void DepthPrepass::renderDepth(GLRenderer &renderer, std::vector<GLSplitMesh> &meshes, const glm::mat4 &ndc_from_oc)
+{
+    if (!m_enabled) {
+        return;
+    }
+    renderer.setColorMask(false, false, false, false);
+    m_depthSP->bind(); // binding needed to set the uniforms
+    m_depthSP->setUniformMat4f("u_ndc_from_oc", ndc_from_oc);
+    for (auto& mesh : meshes) {
+        renderer.draw(mesh.positionVA, mesh.ib, *m_depthSP);
+    }
+    renderer.setColorMask();
+}
+
+void DepthPrepass::beginShadingPass(GLRenderer &renderer)
+{
+    if (!m_enabled) {
+        return;
+    }
+    // the depth buffer already contains the nearest surface
+    // -> only shade the fragments of exactly this surface:
+    renderer.setDepthFunc(GL_EQUAL);
+    renderer.setDepthMask(false);
+}
+
+void DepthPrepass::endShadingPass(GLRenderer &renderer)
+{
+    if (!m_enabled) {
+        return;
+    }
+    renderer.setDepthMask(true); // also needed so that glClear(GL_DEPTH_BUFFER_BIT) works next frame
+    renderer.setDepthFunc();
+}
+
+void DepthPrepass::OnImGuiRender()
+{
+    ImGui::Checkbox("depth pre-pass", &m_enabled);
+    for (std::size_t path = 0; path < 2; ++path) {
+        const char* name = (path == 0) ? "without pre-pass" : "with pre-pass";
+        if (m_avgSceneTime_ms[path] < 0.f) {
+            ImGui::Text("GPU time %s: (not measured yet)", name);
+        } else {
+            ImGui::Text("GPU time %s: %.3f ms", name, static_cast<double>(m_avgSceneTime_ms[path]));
+        }
+    }
+    ImGui::Separator();
+}
@@ -0,0 +1,342 @@
+#include "FrameCapture.h"
+
+#include <algorithm> // for std::max(..)
+#include <chrono>
+#include <cstdio>    // for std::snprintf(..)
+#include <iostream>
+#include <system_error>
+
+#include "imgui.h"
+
+#include "cpu_image_export.h"
+#include "debug_utils.h"
+#include "CpuProfiler.h"
+#include "GLCallStats.h"
+#include "GLFramebufferObject.h"
+#include "ThreadPool.h"
+
+namespace {
+
+// adds the time since its construction to total_ms when destroyed
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(double& total_ms)
+        : m_total_ms(total_ms),
+          m_begin(std::chrono::steady_clock::now())
+    {}
+    ~ScopedTimer() {
+        m_total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_begin).count();
+    }
+
+private:
+    double& m_total_ms;
+    std::chrono::steady_clock::time_point m_begin;
+};
+
+bool encodeAndWrite(const GLubyte* rgba, GLsizei width, GLsizei height, bool keepAlpha,
+                    const std::filesystem::path& path)
+{
+    CPU_PROFILE_FUNCTION();
+    CPUImage image;
+    image.width = width;
+    image.height = height;
+    image.channels = keepAlpha ? 4 : 3;
+    const std::size_t pixelCount = static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+    if (keepAlpha) {
+        image.data.assign(rgba, rgba + pixelCount * 4);
+    } else {
+        image.data.resize(pixelCount * 3);
+        for (std::size_t i = 0; i < pixelCount; ++i) {
+            image.data[3 * i + 0] = rgba[4 * i + 0];
+            image.data[3 * i + 1] = rgba[4 * i + 1];
+            image.data[3 * i + 2] = rgba[4 * i + 2];
+        }
+    }
+    // (the rows of the readback start at the bottom like the rows of CPUImage)
+    return writePNGFile(path, image);
+}
+
+}
+
+FrameCapture::FrameCapture(std::filesystem::path directory, std::size_t ringSize)
+    : m_directory(std::move(directory)),
+      m_slots(ringSize)
+{
+    ASSERT(ringSize >= 1);
+}
+
+FrameCapture::~FrameCapture()
+{
+    finish();
+}
+
+void FrameCapture::setDirectory(const std::filesystem::path &directory)
+{
+    m_directory = directory;
+    m_directoryCreated = false;
+    m_nextFileIndex = 0;
+}
+
+bool FrameCapture::startStream(const std::filesystem::path &path, int width, int height, int framesPerSecond)
+{
+    stopStream();
+    m_stream = std::make_unique<FrameStream>(path, FrameStream::formatOf(path), width, height, framesPerSecond);
+    if (!m_stream->isValid()) {
+        m_stream.reset();
+        return false;
+    }
+    m_streamSizeWarned = false;
+    return true;
+}
+
+std::uint64_t FrameCapture::stopStream()
+{
+    m_streamRequested = false;
+    if (!m_stream) {
+        return 0;
+    }
+    // (no task may refer to the stream anymore)
+    finish();
+    m_stream->close();
+    const std::uint64_t frameCount = m_stream->getWrittenCount();
+    m_stream.reset();
+    return frameCount;
+}
+
+bool FrameCapture::capture(GLsizei width, GLsizei height, GLFramebufferObject *fbo, GLenum attachment)
+{
+    CPU_PROFILE_FUNCTION();
+    ScopedTimer timer(m_frameGLThread_ms);
+    const bool writePNG = m_screenshotRequested || m_recording;
+    m_screenshotRequested = false;
+
+    if (!m_directoryCreated && (writePNG || m_streamRequested)) {
+        std::error_code error;
+        std::filesystem::create_directories(m_directory, error);
+        if (error) {
+            std::cerr << "WARNING: could not create " << m_directory << ": " << error.message() << '\n';
+            ++m_failedCount;
+            return false;
+        }
+        m_directoryCreated = true;
+    }
+    if (m_streamRequested) {
+        m_streamRequested = false;
+        startStream(nextPath("video_", ".y4m"), width, height, m_streamFramesPerSecond);
+    }
+    if (m_stream && (width != m_stream->getWidth() || height != m_stream->getHeight())) {
+        if (!m_streamSizeWarned) {
+            std::cerr << "WARNING: frames of " << width << "x" << height << " do not fit into the "
+                      << m_stream->getWidth() << "x" << m_stream->getHeight() << " video " << m_stream->getPath()
+                      << ", they are dropped\n";
+            m_streamSizeWarned = true;
+        }
+        ++m_droppedCount;
+        return false;
+    }
+
+    Slot& slot = m_slots[m_nextSlot];
+    if (slot.fence || slot.encoding || (m_stream && !m_stream->canReserve())) {
+        if (m_dropFrames) {
+            // the oldest capture is not even written yet -> drop this frame instead of stalling
+            ++m_droppedCount;
+            return false;
+        }
+        waitForCapacity();
+    }
+
+    const auto size = static_cast<GLBufferObject::size_type>(width) * height * 4;
+    if (!slot.pbo || slot.pbo->getSize() != size) {
+        slot.pbo.emplace(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.pbo->setDebugLabel("FrameCapture");
+    }
+    if (fbo) {
+        fbo->bind(GL_READ_FRAMEBUFFER);
+        glReadBuffer(attachment);
+    } else {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glReadBuffer(GL_BACK);
+    }
+    slot.pbo->bind();
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // offset 0 into the pbo
+    slot.pbo->unbind();
+    if (fbo) {
+        fbo->unbind(GL_READ_FRAMEBUFFER);
+    }
+    slot.fence.emplace();
+    slot.width = width;
+    slot.height = height;
+    slot.path = writePNG ? nextPath("frame_", ".png") : std::filesystem::path();
+    slot.streamPosition.reset();
+    if (m_stream) {
+        slot.streamPosition = m_stream->reserveFrame();
+    }
+    m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+    ++m_capturedCount;
+    return true;
+}
+
+void FrameCapture::poll()
+{
+    CPU_PROFILE_FUNCTION();
+    ScopedTimer timer(m_frameGLThread_ms);
+    pollSlots();
+}
+
+void FrameCapture::pollSlots()
+{
+    for (Slot& slot : m_slots) {
+        if (slot.encoding) {
+            if (slot.encoding->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                continue;
+            }
+            const bool written = slot.encoding->get();
+            if (!slot.path.empty()) {
+                ++(written ? m_writtenCount : m_failedCount);
+            }
+            slot.encoding.reset();
+            slot.pbo->bind();
+            slot.pbo->unmap();
+            slot.pbo->unbind();
+        }
+        if (!slot.fence || !slot.fence->isSignaled()) {
+            continue;
+        }
+        slot.fence.reset();
+
+        slot.pbo->bind();
+        const auto size = static_cast<GLBufferObject::size_type>(slot.width) * slot.height * 4;
+        const auto* pixels = static_cast<const GLubyte*>(slot.pbo->mapRange(0, size, GL_MAP_READ_BIT));
+        slot.pbo->unbind();
+        if (!pixels) {
+            std::cerr << "WARNING: could not map a frame capture\n";
+            ++m_failedCount;
+            if (slot.streamPosition) {
+                m_stream->skipFrame(*slot.streamPosition);
+            }
+            continue;
+        }
+        // (the mapping stays valid until unmap(), the GL does not touch the buffer meanwhile)
+        FrameStream* stream = slot.streamPosition ? m_stream.get() : nullptr;
+        slot.encoding = ThreadPool::shared().submit(
+            [pixels, width = slot.width, height = slot.height, keepAlpha = m_keepAlpha, path = slot.path,
+             stream, position = slot.streamPosition.value_or(0)]() {
+                if (stream) {
+                    stream->writeFrame(position, pixels);
+                }
+                return path.empty() || encodeAndWrite(pixels, width, height, keepAlpha, path);
+            });
+    }
+}
+
+void FrameCapture::waitForCapacity()
+{
+    CPU_PROFILE_FUNCTION();
+    const Slot& next = m_slots[m_nextSlot];
+    while (next.fence || next.encoding || (m_stream && !m_stream->canReserve())) {
+        // the oldest capture in flight (the next slot of the ring is the oldest one):
+        Slot* oldest = nullptr;
+        for (std::size_t i = 0; i < m_slots.size() && !oldest; ++i) {
+            Slot& slot = m_slots[(m_nextSlot + i) % m_slots.size()];
+            if (slot.fence || slot.encoding) {
+                oldest = &slot;
+            }
+        }
+        if (!oldest) {
+            // all frames of the stream are handed over, only the writer thread is behind
+            m_stream->waitUntilReservable();
+        } else if (oldest->fence) {
+            oldest->fence->wait(GLuint64(1'000'000'000)); // 1 s
+        } else {
+            oldest->encoding->wait();
+        }
+        pollSlots();
+    }
+}
+
+void FrameCapture::finish()
+{
+    for (Slot& slot : m_slots) {
+        if (slot.fence) {
+            slot.fence->wait(GLuint64(10'000'000'000)); // 10 s
+        }
+    }
+    pollSlots(); // starts the encoding of all readbacks
+    for (Slot& slot : m_slots) {
+        if (slot.encoding) {
+            slot.encoding->wait();
+        }
+    }
+    pollSlots(); // unmaps all buffers
+}
+
+double FrameCapture::getAverageGLThread_ms() const
+{
+    return m_measuredFrames > 0 ? m_sumGLThread_ms / static_cast<double>(m_measuredFrames) : 0.;
+}
+
+void FrameCapture::endFrame()
+{
+    m_lastGLThread_ms = m_frameGLThread_ms;
+    m_frameGLThread_ms = 0.;
+    bool busy = false;
+    for (const Slot& slot : m_slots) {
+        busy = busy || slot.fence || slot.encoding;
+    }
+    if (busy || isCaptureRequested()) {
+        // (frames without any captures in flight would only dilute the average)
+        m_sumGLThread_ms += m_lastGLThread_ms;
+        m_maxGLThread_ms = std::max(m_maxGLThread_ms, m_lastGLThread_ms);
+        ++m_measuredFrames;
+    }
+}
+
+void FrameCapture::OnImGuiRender()
+{
+    if (!ImGui::Begin("Frame capture")) {
+        ImGui::End();
+        return;
+    }
+    if (ImGui::Button("Screenshot")) {
+        requestScreenshot();
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("record every frame", &m_recording);
+    ImGui::Checkbox("keep alpha", &m_keepAlpha);
+    ImGui::Text("into %s", m_directory.string().c_str());
+    ImGui::Text("%llu captured, %llu dropped, %llu written, %llu failed",
+                static_cast<unsigned long long>(m_capturedCount), static_cast<unsigned long long>(m_droppedCount),
+                static_cast<unsigned long long>(m_writtenCount), static_cast<unsigned long long>(m_failedCount));
+    ImGui::Text("GL thread: %.3f ms last frame, %.3f ms average, %.3f ms max", m_lastGLThread_ms,
+                getAverageGLThread_ms(), m_maxGLThread_ms);
+
+    bool streaming = m_stream || m_streamRequested;
+    if (ImGui::Checkbox("stream video (Y4M)", &streaming)) {
+        if (streaming) {
+            requestStream();
+        } else {
+            stopStream();
+        }
+    }
+    if (m_stream) {
+        ImGui::Text("%s: %llu frames written, %llu queued", m_stream->getPath().string().c_str(),
+                    static_cast<unsigned long long>(m_stream->getWrittenCount()),
+                    static_cast<unsigned long long>(m_stream->getQueuedCount()));
+    }
+    ImGui::End();
+}
+
+std::filesystem::path FrameCapture::nextPath(const char *prefix, const char *extension)
+{
+    for (;;) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "%s%06zu%s", prefix, m_nextFileIndex++, extension);
+        std::filesystem::path path = m_directory / name;
+        // (files of previous sessions stay)
+        if (!std::filesystem::exists(path)) {
+            return path;
+        }
+    }
+}
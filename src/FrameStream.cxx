@@ -0,0 +1,163 @@
+#include "FrameStream.h"
+
+#include <iostream>
+#include <string>
+#include <utility> // for std::move(..)
+
+#include "colorspace_utils.h"
+#include "debug_utils.h"
+#include "CpuProfiler.h"
+
+FrameStream::FrameStream(const std::filesystem::path &path, Format format, int width, int height,
+                         int framesPerSecond, std::size_t maxQueuedFrames)
+    : m_path(path),
+      m_format(format),
+      m_width(width),
+      m_height(height),
+      m_maxQueuedFrames(maxQueuedFrames),
+      m_frameSize(static_cast<std::size_t>(width) * static_cast<std::size_t>(height)
+                  + 2 * static_cast<std::size_t>((width + 1) / 2) * static_cast<std::size_t>((height + 1) / 2)),
+      m_file(path, std::ios::binary),
+      m_valid(static_cast<bool>(m_file)),
+      m_writer(&FrameStream::writerMain, this)
+{
+    ASSERT(width > 0 && height > 0 && framesPerSecond > 0 && maxQueuedFrames >= 1);
+    if (!m_valid) {
+        std::cerr << "WARNING: could not open " << path << " for writing\n";
+    } else if (format == Format::Y4M) {
+        // (the writer thread does not touch the file before the first frame is queued)
+        // C420jpeg: chroma sited between the 2x2 luma samples it was averaged from
+        m_file << "YUV4MPEG2 W" << width << " H" << height << " F" << framesPerSecond
+               << ":1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n";
+    }
+}
+
+FrameStream::~FrameStream()
+{
+    close();
+}
+
+void FrameStream::close()
+{
+    if (!m_writer.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_frameReady.notify_one();
+    m_writer.join();
+    m_file.close();
+    if (m_handedCount < m_reservedCount) {
+        std::cerr << "WARNING: " << m_reservedCount - m_handedCount << " reserved frames never arrived in " << m_path
+                  << '\n';
+    }
+}
+
+FrameStream::Format FrameStream::formatOf(const std::filesystem::path &path)
+{
+    return path.extension() == ".y4m" ? Format::Y4M : Format::RAW;
+}
+
+bool FrameStream::canReserve() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_reservedCount - m_finishedCount < m_maxQueuedFrames;
+}
+
+void FrameStream::waitUntilReservable()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // (frames that were not handed over yet cannot be written, waiting for them would never end)
+    m_frameWritten.wait(lock, [this]() {
+        return m_reservedCount - m_finishedCount < m_maxQueuedFrames || m_handedCount < m_reservedCount;
+    });
+}
+
+std::uint64_t FrameStream::reserveFrame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ASSERT(m_reservedCount - m_finishedCount < m_maxQueuedFrames);
+    return m_reservedCount++;
+}
+
+void FrameStream::writeFrame(std::uint64_t position, const GLubyte *rgba)
+{
+    CPU_PROFILE_FUNCTION();
+    const std::size_t lumaSize = static_cast<std::size_t>(m_width) * static_cast<std::size_t>(m_height);
+    const std::size_t chromaSize = (m_frameSize - lumaSize) / 2;
+    std::vector<GLubyte> frame(m_frameSize);
+    yuv420_from_RGBA8(gsl::span<const GLubyte>(rgba, lumaSize * 4), m_width, m_height,
+                      gsl::span<GLubyte>(frame.data(), lumaSize),
+                      gsl::span<GLubyte>(frame.data() + lumaSize, chromaSize),
+                      gsl::span<GLubyte>(frame.data() + lumaSize + chromaSize, chromaSize));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    queue(position, std::move(frame));
+}
+
+void FrameStream::skipFrame(std::uint64_t position)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    queue(position, {});
+}
+
+std::uint64_t FrameStream::getWrittenCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_writtenCount;
+}
+
+std::uint64_t FrameStream::getSkippedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_skippedCount;
+}
+
+std::uint64_t FrameStream::getQueuedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_reservedCount - m_finishedCount;
+}
+
+void FrameStream::queue(std::uint64_t position, std::vector<GLubyte> frame)
+{
+    ASSERT(position >= m_finishedCount && position < m_reservedCount);
+    m_converted.emplace(position, std::move(frame));
+    ++m_handedCount;
+    m_frameReady.notify_one();
+}
+
+void FrameStream::writerMain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool writeFailed = false;
+    while (true) {
+        // frames are written strictly in order of their positions:
+        m_frameReady.wait(lock, [this]() { return m_stop || m_converted.count(m_finishedCount) > 0; });
+        auto it = m_converted.find(m_finishedCount);
+        if (it == m_converted.end()) {
+            return; // m_stop
+        }
+        const std::vector<GLubyte> frame = std::move(it->second);
+        m_converted.erase(it);
+
+        // write to disk without holding the lock:
+        lock.unlock();
+        if (!frame.empty() && m_valid) {
+            CPU_PROFILE_SCOPE("FrameStream::write");
+            if (m_format == Format::Y4M) {
+                m_file << "FRAME\n";
+            }
+            m_file.write(reinterpret_cast<const char*>(frame.data()), static_cast<std::streamsize>(frame.size()));
+            if (!m_file && !writeFailed) {
+                std::cerr << "WARNING: could not write to " << m_path << '\n';
+                writeFailed = true;
+            }
+        }
+        lock.lock();
+        ++(frame.empty() ? m_skippedCount : m_writtenCount);
+        ++m_finishedCount;
+        m_frameWritten.notify_all();
+    }
+}
@@ -2,11 +2,16 @@
 
 #include <utility> // std::move(..), std::exchange(..)
 
+#include "GpuMemoryRegistry.h"
+#include "GLCallStats.h"
+
 GLBufferObject::GLBufferObject(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage, bool keepBound) {
 	this->m_target = target;
+    this->m_size = size;
     glGenBuffers(1, &(this->m_rendererId));
     glBindBuffer(target, this->m_rendererId);
     glBufferData(target, size, data, usage);
+    m_memoryId = GpuMemoryRegistry::shared().registerAllocation(getMemoryCategory(target), static_cast<std::size_t>(size));
     if (!keepBound) {
         glBindBuffer(target, 0);
     }
@@ -14,7 +19,9 @@ GLBufferObject::GLBufferObject(GLenum target, GLsizeiptr size, const GLvoid* dat
 
 GLBufferObject::GLBufferObject(GLBufferObject&& other) noexcept
     : m_target(std::move(other.m_target)),
-      m_rendererId(std::exchange(other.m_rendererId, 0))
+      m_rendererId(std::exchange(other.m_rendererId, 0)),
+      m_size(std::exchange(other.m_size, 0)),
+      m_memoryId(std::exchange(other.m_memoryId, 0))
 {}
 
 GLBufferObject& GLBufferObject::operator=(GLBufferObject&& other) {
@@ -24,8 +31,11 @@ GLBufferObject& GLBufferObject::operator=(GLBufferObject&& other) {
     if (m_rendererId) {
         glDeleteBuffers(1, &m_rendererId);
 	}
+    GpuMemoryRegistry::shared().unregisterAllocation(m_memoryId);
     m_target = std::move(other.m_target);
     m_rendererId = std::exchange(other.m_rendererId, 0);
+    m_size = std::exchange(other.m_size, 0);
+    m_memoryId = std::exchange(other.m_memoryId, 0);
 	return *this;
 }
 
@@ -34,6 +44,7 @@ GLBufferObject::~GLBufferObject() {
     if (m_rendererId) {
         glDeleteBuffers(1, &m_rendererId);
     }
+    GpuMemoryRegistry::shared().unregisterAllocation(m_memoryId);
 }
 
 bool GLBufferObject::isBound() const
@@ -43,6 +54,39 @@ bool GLBufferObject::isBound() const
     return (static_cast<GLenum>(currBuff) == m_rendererId);
 }
 
+void *GLBufferObject::mapRange(GLintptr offset, size_type length, GLbitfield access)
+{
+    ASSERT(isBound());
+    ASSERT(0 <= offset && offset + length <= m_size);
+    return glMapBufferRange(m_target, offset, length, access);
+}
+
+bool GLBufferObject::unmap()
+{
+    ASSERT(isBound());
+    return glUnmapBuffer(m_target) == GL_TRUE;
+}
+
+void GLBufferObject::setDebugLabel(const std::string &label)
+{
+    GpuMemoryRegistry::shared().setLabel(m_memoryId, label);
+    if (GLEW_VERSION_4_3 || GLEW_KHR_debug) {
+        glObjectLabel(GL_BUFFER, m_rendererId, -1, label.c_str());
+    }
+}
+
+GpuMemoryCategory GLBufferObject::getMemoryCategory(GLenum target)
+{
+    switch (target) {
+    case GL_ARRAY_BUFFER:
+        return GpuMemoryCategory::VERTEX_BUFFER;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        return GpuMemoryCategory::INDEX_BUFFER;
+    default:
+        return GpuMemoryCategory::OTHER_BUFFER;
+    }
+}
+
 GLenum GLBufferObject::getBindingEnum(GLenum target) {
     switch (target) {
       case GL_ARRAY_BUFFER:
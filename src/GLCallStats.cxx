@@ -0,0 +1,296 @@
+#include "GLCallStats.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric> // for std::iota(..)
+#include <type_traits>
+
+#include "imgui.h"
+
+namespace {
+
+constexpr std::array<const char*, GLCallStats::categoryCount> categoryNames = {
+    "draw", "dispatch", "bind", "state", "uniform", "buffer upload", "texture upload", "query", "sync", "object",
+    "other"
+};
+
+constexpr std::array<const char*, GLCallStats::functionCount> functionNames = {
+#define GL_CALL_STATS_NAME(name, category, synchronous) "gl" #name,
+    GL_CALL_STATS_EXPORTED_FUNCTIONS(GL_CALL_STATS_NAME)
+    GL_CALL_STATS_LOADED_FUNCTIONS(GL_CALL_STATS_NAME)
+#undef GL_CALL_STATS_NAME
+};
+
+constexpr std::array<GLCallCategory, GLCallStats::functionCount> functionCategories = {
+#define GL_CALL_STATS_CATEGORY(name, category, synchronous) GLCallCategory::category,
+    GL_CALL_STATS_EXPORTED_FUNCTIONS(GL_CALL_STATS_CATEGORY)
+    GL_CALL_STATS_LOADED_FUNCTIONS(GL_CALL_STATS_CATEGORY)
+#undef GL_CALL_STATS_CATEGORY
+};
+
+#ifdef OPENGL_DEMOS_GL_CALL_STATS
+// the function GLEW loaded for the pointer variable (while the wrapper is installed)
+template <auto* pointer>
+std::remove_pointer_t<decltype(pointer)> original = nullptr;
+
+template <typename Function>
+struct Wrapper;
+
+template <typename R, typename... Args>
+struct Wrapper<R (GLAPIENTRY*)(Args...)> {
+    template <auto* pointer, GLFunction function>
+    static R GLAPIENTRY call(Args... args) {
+        GLCallStats::count(function);
+        return original<pointer>(args...);
+    }
+};
+
+template <auto* pointer, GLFunction function>
+bool installWrapper()
+{
+    using Function = std::remove_pointer_t<decltype(pointer)>;
+    if (!*pointer || original<pointer>) {
+        // (the context does not have the entry point or it is wrapped already)
+        return false;
+    }
+    original<pointer> = *pointer;
+    *pointer = &Wrapper<Function>::template call<pointer, function>;
+    return true;
+}
+
+template <auto* pointer>
+void uninstallWrapper()
+{
+    if (original<pointer>) {
+        *pointer = original<pointer>;
+        original<pointer> = nullptr;
+    }
+}
+#endif
+
+}
+
+std::uint64_t GLCallFrameStats::getTotal() const
+{
+    return std::accumulate(calls.begin(), calls.end(), std::uint64_t(0));
+}
+
+GLCallFrameStats &GLCallFrameStats::operator+=(const GLCallFrameStats &other)
+{
+    for (std::size_t i = 0; i < calls.size(); ++i) {
+        calls[i] += other.calls[i];
+    }
+    synchronousQueries += other.synchronousQueries;
+    return *this;
+}
+
+GLCallStats &GLCallStats::shared()
+{
+    static GLCallStats stats;
+    return stats;
+}
+
+const char *GLCallStats::getCategoryName(GLCallCategory category)
+{
+    return categoryNames[static_cast<std::size_t>(category)];
+}
+
+const char *GLCallStats::getFunctionName(GLFunction function)
+{
+    return functionNames[static_cast<std::size_t>(function)];
+}
+
+GLCallCategory GLCallStats::getCategory(GLFunction function)
+{
+    return functionCategories[static_cast<std::size_t>(function)];
+}
+
+bool GLCallStats::isEnabled()
+{
+#ifdef OPENGL_DEMOS_GL_CALL_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void GLCallStats::install()
+{
+#ifdef OPENGL_DEMOS_GL_CALL_STATS
+#define GL_CALL_STATS_INSTALL(name, category, synchronous) \
+    m_installedCount += installWrapper<&__glew##name, GLFunction::name>() ? 1 : 0;
+    GL_CALL_STATS_LOADED_FUNCTIONS(GL_CALL_STATS_INSTALL)
+#undef GL_CALL_STATS_INSTALL
+#endif
+}
+
+void GLCallStats::uninstall()
+{
+#ifdef OPENGL_DEMOS_GL_CALL_STATS
+#define GL_CALL_STATS_UNINSTALL(name, category, synchronous) uninstallWrapper<&__glew##name>();
+    GL_CALL_STATS_LOADED_FUNCTIONS(GL_CALL_STATS_UNINSTALL)
+#undef GL_CALL_STATS_UNINSTALL
+#endif
+    m_installedCount = 0;
+}
+
+void GLCallStats::beginFrame()
+{
+    // calls between the frames (e.g. while a demo loads) do not count:
+    s_calls.fill(0);
+    s_inFrame = true;
+}
+
+void GLCallStats::endFrame()
+{
+    s_inFrame = false;
+    GLCallFrameStats frame;
+    for (std::size_t i = 0; i < functionCount; ++i) {
+        const GLFunction function = static_cast<GLFunction>(i);
+        frame.calls[static_cast<std::size_t>(getCategory(function))] += s_calls[i];
+        if (isSynchronousQuery(function)) {
+            frame.synchronousQueries += s_calls[i];
+        }
+    }
+    m_lastFrameCalls = s_calls;
+    m_lastFrame = frame;
+    m_recentFrames.push_back(frame);
+    if (m_recentFrames.size() > averageWindow) {
+        m_recentFrames.pop_front();
+    }
+    m_totals += frame;
+    ++m_totalFrames;
+    ++m_frameNumber;
+}
+
+std::array<double, GLCallStats::categoryCount> GLCallStats::getAverage() const
+{
+    std::array<double, categoryCount> average = {};
+    for (const GLCallFrameStats& frame : m_recentFrames) {
+        for (std::size_t i = 0; i < categoryCount; ++i) {
+            average[i] += static_cast<double>(frame.calls[i]);
+        }
+    }
+    if (!m_recentFrames.empty()) {
+        for (double& calls : average) {
+            calls /= static_cast<double>(m_recentFrames.size());
+        }
+    }
+    return average;
+}
+
+void GLCallStats::resetTotals()
+{
+    m_totals = GLCallFrameStats();
+    m_totalFrames = 0;
+}
+
+std::vector<GLSynchronousQuerySite> GLCallStats::getSynchronousQuerySites() const
+{
+    std::vector<GLSynchronousQuerySite> sites;
+    sites.reserve(m_synchronousQuerySites.size());
+    for (const auto& [key, stats] : m_synchronousQuerySites) {
+        const auto& [function, file, line] = key;
+        sites.push_back(GLSynchronousQuerySite{function, file, line, stats.calls, stats.frames});
+    }
+    // most calls first:
+    std::sort(sites.begin(), sites.end(), [](const GLSynchronousQuerySite& a, const GLSynchronousQuerySite& b) {
+        return a.calls > b.calls;
+    });
+    return sites;
+}
+
+void GLCallStats::writeJson(std::ostream &os, const GLCallFrameStats &sum, std::uint64_t frameCount)
+{
+    if (!isEnabled()) {
+        os << "null";
+        return;
+    }
+    const double frames = static_cast<double>(std::max(frameCount, std::uint64_t(1)));
+    os << '{';
+    for (std::size_t i = 0; i < categoryCount; ++i) {
+        os << '"' << categoryNames[i] << "\": " << static_cast<double>(sum.calls[i]) / frames << ", ";
+    }
+    os << "\"synchronous queries\": " << static_cast<double>(sum.synchronousQueries) / frames
+       << ", \"total\": " << static_cast<double>(sum.getTotal()) / frames << '}';
+}
+
+void GLCallStats::OnImGuiRender()
+{
+    if (!ImGui::Begin("GL calls")) {
+        ImGui::End();
+        return;
+    }
+    if (!isEnabled()) {
+        // (no table of zeros that looks like a measurement)
+        ImGui::Text("counting is compiled out (cmake option OPENGL_DEMOS_GL_CALL_STATS)");
+        ImGui::End();
+        return;
+    }
+    ImGui::Text("%zu GLEW entry points wrapped, last frame: %llu calls, %llu synchronous queries",
+                m_installedCount, static_cast<unsigned long long>(m_lastFrame.getTotal()),
+                static_cast<unsigned long long>(m_lastFrame.synchronousQueries));
+    const std::array<double, categoryCount> average = getAverage();
+    ImGui::Columns(3, "gl call categories");
+    ImGui::Text("category");
+    ImGui::NextColumn();
+    ImGui::Text("last frame");
+    ImGui::NextColumn();
+    ImGui::Text("average (%zu frames)", m_recentFrames.size());
+    ImGui::NextColumn();
+    for (std::size_t i = 0; i < categoryCount; ++i) {
+        ImGui::Text("%s", categoryNames[i]);
+        ImGui::NextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(m_lastFrame.calls[i]));
+        ImGui::NextColumn();
+        ImGui::Text("%.1f", average[i]);
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    if (ImGui::TreeNode("functions (last frame)")) {
+        std::vector<std::size_t> order(functionCount);
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return m_lastFrameCalls[a] > m_lastFrameCalls[b];
+        });
+        for (std::size_t i : order) {
+            if (m_lastFrameCalls[i] == 0) {
+                break;
+            }
+            ImGui::BulletText("%llu %s (%s)", static_cast<unsigned long long>(m_lastFrameCalls[i]), functionNames[i],
+                              getCategoryName(functionCategories[i]));
+        }
+        ImGui::TreePop();
+    }
+#ifndef NDEBUG
+    if (ImGui::TreeNode("synchronous queries in frames")) {
+        for (const GLSynchronousQuerySite& site : getSynchronousQuerySites()) {
+            ImGui::BulletText("%s at %s:%d, %llu calls in %llu frames", getFunctionName(site.function),
+                              site.file ? site.file : "(GLEW)", site.line,
+                              static_cast<unsigned long long>(site.calls), static_cast<unsigned long long>(site.frames));
+        }
+        ImGui::TreePop();
+    }
+#endif
+    ImGui::End();
+}
+
+void GLCallStats::recordSynchronousQuery(GLFunction function, const char *file, int line)
+{
+    GLCallStats& stats = shared();
+    auto [it, inserted] = stats.m_synchronousQuerySites.try_emplace(std::tuple(function, file, line));
+    if (inserted) {
+        std::cerr << "WARNING: synchronous " << getFunctionName(function) << " in a frame";
+        if (file) {
+            std::cerr << " at " << file << ":" << line;
+        }
+        std::cerr << " (waits until the GL answers)\n";
+    }
+    SiteStats& site = it->second;
+    ++site.calls;
+    if (site.lastFrame != stats.m_frameNumber) {
+        site.lastFrame = stats.m_frameNumber;
+        ++site.frames;
+    }
+}
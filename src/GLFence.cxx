@@ -0,0 +1,52 @@
+#include "GLFence.h"
+
+#include <utility> // std::exchange(..)
+
+#include "debug_utils.h"
+
+GLFence::GLFence()
+    : m_sync(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0))
+{
+    ASSERT(m_sync);
+}
+
+GLFence::GLFence(GLFence &&other) noexcept
+    : m_sync(std::exchange(other.m_sync, nullptr)),
+      m_flushed(other.m_flushed)
+{}
+
+GLFence &GLFence::operator=(GLFence &&other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    glDeleteSync(m_sync); // docs.gl: "The value zero is silently ignored"
+    m_sync = std::exchange(other.m_sync, nullptr);
+    m_flushed = other.m_flushed;
+    return *this;
+}
+
+GLFence::~GLFence()
+{
+    glDeleteSync(m_sync);
+}
+
+bool GLFence::isSignaled()
+{
+    return clientWait(0);
+}
+
+bool GLFence::wait(GLuint64 timeout_ns)
+{
+    return clientWait(timeout_ns);
+}
+
+bool GLFence::clientWait(GLuint64 timeout_ns)
+{
+    ASSERT(m_sync);
+    GLbitfield flags = m_flushed ? 0 : GL_SYNC_FLUSH_COMMANDS_BIT;
+    m_flushed = true;
+    GLenum result = glClientWaitSync(m_sync, flags, timeout_ns);
+    ASSERT(result != GL_WAIT_FAILED);
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
@@ -1,15 +1,20 @@
 #include "GLFramebufferObject.h"
 
 #include "debug_utils.h"
+#include "GpuMemoryRegistry.h"
+#include "GLCallStats.h"
 
 GLFramebufferObject::GLFramebufferObject()
 {
     glGenFramebuffers(1, &m_rendererId);
+    // (the memory of the attachments belongs to the textures)
+    m_memoryId = GpuMemoryRegistry::shared().registerAllocation(GpuMemoryCategory::FRAMEBUFFER, 0);
 }
 
 
 GLFramebufferObject::GLFramebufferObject(GLFramebufferObject&& other) noexcept
-    : m_rendererId(std::exchange(other.m_rendererId, 0))
+    : m_rendererId(std::exchange(other.m_rendererId, 0)),
+      m_memoryId(std::exchange(other.m_memoryId, 0))
 {}
 
 GLFramebufferObject &GLFramebufferObject::operator=(GLFramebufferObject&& other)
@@ -19,8 +24,10 @@ GLFramebufferObject &GLFramebufferObject::operator=(GLFramebufferObject&& other)
     }
 
     glDeleteFramebuffers(1, &m_rendererId);
+    GpuMemoryRegistry::shared().unregisterAllocation(m_memoryId);
 
     m_rendererId = std::exchange(other.m_rendererId, 0);
+    m_memoryId = std::exchange(other.m_memoryId, 0);
 
     return *this;
 }
@@ -32,6 +39,15 @@ GLFramebufferObject::~GLFramebufferObject()
     // "The name zero is reserved by the GL and is silently ignored,
     //  should it occur in framebuffers, as are other unused names."
     // docs.gl
+    GpuMemoryRegistry::shared().unregisterAllocation(m_memoryId);
+}
+
+void GLFramebufferObject::setDebugLabel(const std::string &label)
+{
+    GpuMemoryRegistry::shared().setLabel(m_memoryId, label);
+    if (GLEW_VERSION_4_3 || GLEW_KHR_debug) {
+        glObjectLabel(GL_FRAMEBUFFER, m_rendererId, -1, label.c_str());
+    }
 }
 
 void GLFramebufferObject::bind(GLenum target)
@@ -62,7 +78,7 @@ void GLFramebufferObject::attachTexture(GLenum attachment, const GLTexture &text
 {
     ASSERT(isBound(GL_DRAW_FRAMEBUFFER));
     glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, attachment,
-                           GL_TEXTURE_2D, texture.getRendererId(), mipLevel);
+                           texture.getTarget(), texture.getRendererId(), mipLevel);
 }
 
 void GLFramebufferObject::unattachTexture(GLenum attachment)
@@ -75,6 +91,36 @@ void GLFramebufferObject::unattachTexture(GLenum attachment)
 
 }
 
+void GLFramebufferObject::blitTo(GLFramebufferObject &dst, GLint width, GLint height, GLbitfield mask)
+{
+    // resolves multisampled attachments if this fbo is multisampled and dst is not:
+    bind(GL_READ_FRAMEBUFFER);
+    dst.bind(GL_DRAW_FRAMEBUFFER);
+    glBlitFramebuffer(0, 0, width, height,
+                      0, 0, width, height,
+                      mask, GL_NEAREST);
+    unbind(GL_READ_FRAMEBUFFER);
+}
+
+void GLFramebufferObject::blitToDefault(GLint width, GLint height, GLbitfield mask)
+{
+    bind(GL_READ_FRAMEBUFFER);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height,
+                      0, 0, width, height,
+                      mask, GL_NEAREST);
+    unbind(GL_READ_FRAMEBUFFER);
+}
+
+void GLFramebufferObject::readPixels(GLint x, GLint y, GLsizei width, GLsizei height,
+                                     GLenum format, GLenum type, GLvoid *pixels)
+{
+    bind(GL_READ_FRAMEBUFFER);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(x, y, width, height, format, type, pixels);
+    unbind(GL_READ_FRAMEBUFFER);
+}
+
 GLenum GLFramebufferObject::checkFramebufferStatus() const
 {
     ASSERT(isBound(GL_DRAW_FRAMEBUFFER));
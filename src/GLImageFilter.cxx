@@ -0,0 +1,143 @@
+#include "GLImageFilter.h"
+
+#include <algorithm> // for std::max(..)
+#include <filesystem>
+#include <utility>   // for std::move(..)
+
+#include "debug_utils.h"
+
+namespace {
+
+// local sizes of the compute shaders:
+constexpr GLuint tileSize = 16;  // ConvolutionTiled.shader
+constexpr GLuint lineSize = 128; // ConvolutionSeparable.shader
+
+GLuint groupCount(GLsizei size, GLuint groupSize)
+{
+    return (static_cast<GLuint>(size) + groupSize - 1) / groupSize;
+}
+
+// shader of the file with "#define OUTPUT_FORMAT <imageFormat>" after the #version line
+std::unique_ptr<GLShaderProgram> makeProgram(const char* path, const char* imageFormat)
+{
+    namespace fs = std::filesystem;
+    std::vector<ShaderSource> sources = GLShaderProgram::parseShader(fs::path(path, fs::path::format::generic_format));
+    for (ShaderSource& source : sources) {
+        const std::size_t versionEnd = source.sourceCode.find('\n') + 1;
+        source.sourceCode.insert(versionEnd, std::string("#define OUTPUT_FORMAT ") + imageFormat + "\n");
+    }
+    return std::make_unique<GLShaderProgram>(std::move(sources));
+}
+
+}
+
+GLImageFilter::GLImageFilter()
+{
+    // the programs for GL_RGBA32F are compiled right away, the others on first use:
+    getPrograms(GL_RGBA32F);
+}
+
+void GLImageFilter::apply(GLRenderer &renderer, const ConvolutionKernel &kernel, GLTexture &input, GLTexture &output,
+                          GLsizei width, GLsizei height, RenderTargetPool &pool, int texUnit)
+{
+    ASSERT(&input != &output);
+    ASSERT(getImageFormat(output.getInternalFormat()));
+    ASSERT(width <= input.getWidth() && height <= input.getHeight());
+    ASSERT(width <= output.getWidth() && height <= output.getHeight());
+    ASSERT(kernel.radiusX <= maxConvolutionRadius && kernel.radiusY <= maxConvolutionRadius);
+
+    if (!kernel.isSeparable()) {
+        dispatchTiled(renderer, kernel, input, output, width, height, texUnit);
+    } else {
+        // (the pool creates textures on the active unit, texUnit is rebound anyway)
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(texUnit));
+        // the horizontal pass of e.g. the sobel filter has negative results:
+        RenderTargetRequirements tmpRequirements;
+        tmpRequirements.channels = 3;
+        tmpRequirements.hdr = true;
+        tmpRequirements.negative = true;
+        tmpRequirements.precisionBits = std::max(RenderTargetPool::getPrecisionBits(input.getInternalFormat()), 10);
+        GLTexture& tmp = pool.acquireTexture({width, height, RenderTargetPool::chooseFormat(tmpRequirements)});
+        dispatchLine(renderer, kernel.row.data(), kernel.radiusX, 1, 0, false, input, tmp, width, height, texUnit);
+        // the vertical pass samples what the horizontal pass wrote:
+        renderer.memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        dispatchLine(renderer, kernel.column.data(), kernel.radiusY, 0, -1, kernel.absolute, tmp, output, width, height, texUnit);
+        pool.release(tmp);
+    }
+    renderer.memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void GLImageFilter::setKernelUniforms(GLShaderProgram &sp, const ConvolutionKernel &kernel)
+{
+    sp.setUniform2i("u_radius", kernel.radiusX, kernel.radiusY);
+    sp.setUniform1fv("u_weights", static_cast<GLsizei>(kernel.weights.size()), kernel.weights.data());
+    sp.setUniform1i("u_absolute", kernel.absolute ? 1 : 0);
+}
+
+void GLImageFilter::dispatchTiled(GLRenderer &renderer, const ConvolutionKernel &kernel, GLTexture &input, GLTexture &output,
+                                  GLsizei width, GLsizei height, int texUnit)
+{
+    GLShaderProgram& sp = *getPrograms(output.getInternalFormat()).tiled;
+    input.bind(texUnit);
+    output.bindImage(0, GL_WRITE_ONLY);
+    sp.bind();
+    sp.setUniform1i("u_input", texUnit);
+    sp.setUniform2i("u_size", width, height);
+    setKernelUniforms(sp, kernel);
+    renderer.dispatchCompute(groupCount(width, tileSize), groupCount(height, tileSize));
+    sp.unbind();
+}
+
+void GLImageFilter::dispatchLine(GLRenderer &renderer, const float *weights, int radius, int dirX, int dirY, bool absolute,
+                                 GLTexture &input, GLTexture &output, GLsizei width, GLsizei height, int texUnit)
+{
+    GLShaderProgram& sp = *getPrograms(output.getInternalFormat()).separable;
+    input.bind(texUnit);
+    output.bindImage(0, GL_WRITE_ONLY);
+    sp.bind();
+    sp.setUniform1i("u_input", texUnit);
+    sp.setUniform2i("u_size", width, height);
+    sp.setUniform2i("u_direction", dirX, dirY);
+    sp.setUniform1i("u_radius", radius);
+    sp.setUniform1fv("u_weights", 2 * radius + 1, weights);
+    sp.setUniform1i("u_absolute", absolute ? 1 : 0);
+    // one work group per segment of lineSize pixels of each row/column:
+    if (dirX != 0) {
+        renderer.dispatchCompute(groupCount(width, lineSize), static_cast<GLuint>(height));
+    } else {
+        renderer.dispatchCompute(groupCount(height, lineSize), static_cast<GLuint>(width));
+    }
+    sp.unbind();
+}
+
+const char *GLImageFilter::getImageFormat(GLenum internalformat)
+{
+    switch (internalformat) {
+    case GL_RGBA32F:        return "rgba32f";
+    case GL_RGBA16F:        return "rgba16f";
+    case GL_RG32F:          return "rg32f";
+    case GL_RG16F:          return "rg16f";
+    case GL_R11F_G11F_B10F: return "r11f_g11f_b10f";
+    case GL_R32F:           return "r32f";
+    case GL_R16F:           return "r16f";
+    case GL_RGB10_A2:       return "rgb10_a2";
+    case GL_RGBA8:          return "rgba8";
+    case GL_RG8:            return "rg8";
+    case GL_R8:             return "r8";
+    default:                return nullptr; // e.g. GL_SRGB8_ALPHA8 cannot be written with imageStore(..)
+    }
+}
+
+GLImageFilter::Programs &GLImageFilter::getPrograms(GLenum outputFormat)
+{
+    auto search = m_programs.find(outputFormat);
+    if (search != m_programs.end()) {
+        return search->second;
+    }
+    const char* imageFormat = getImageFormat(outputFormat);
+    ASSERT(imageFormat);
+    Programs programs;
+    programs.tiled = makeProgram("res/shaders/ConvolutionTiled.shader", imageFormat);
+    programs.separable = makeProgram("res/shaders/ConvolutionSeparable.shader", imageFormat);
+    return m_programs.emplace(outputFormat, std::move(programs)).first->second;
+}
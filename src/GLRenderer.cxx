@@ -1,5 +1,9 @@
 #include "GLRenderer.h"
 
+#include <cstdint> // for std::uintptr_t
+
+#include "GLCallStats.h"
+
 void GLRenderer::setViewport(GLint x, GLint y, GLsizei width, GLsizei height)
 {
     glViewport(x, y, width, height);
@@ -65,6 +69,17 @@ void GLRenderer::setDepthFunc(GLenum func)
     glDepthFunc(func);
 }
 
+void GLRenderer::setDepthMask(bool writeDepth)
+{
+    glDepthMask(writeDepth ? GL_TRUE : GL_FALSE);
+}
+
+void GLRenderer::setColorMask(bool red, bool green, bool blue, bool alpha)
+{
+    glColorMask(red ? GL_TRUE : GL_FALSE, green ? GL_TRUE : GL_FALSE,
+                blue ? GL_TRUE : GL_FALSE, alpha ? GL_TRUE : GL_FALSE);
+}
+
 void GLRenderer::enableBlending()
 {
     glEnable(GL_BLEND);
@@ -116,15 +131,61 @@ void GLRenderer::draw(GLVertexArray &va, GLIndexBuffer &ib, GLShaderProgram &sha
     va.bind();
     ib.bind();
     shaderP.bind();
+    drawBound(ib);
+    shaderP.unbind();
+    va.unbind(); // automatically unbinds ib
+}
+
+void GLRenderer::drawBound(const GLIndexBuffer &ib) const
+{
+    drawBound(ib, 0, ib.getCount());
+}
+
+void GLRenderer::drawBound(const GLIndexBuffer &ib, GLIndexBuffer::count_type first, GLIndexBuffer::count_type count) const
+{
+    ASSERT(0 <= first && first + count <= ib.getCount());
     if (ib.hasPrimitiveRestart()) {
         glPrimitiveRestartIndex(ib.getPrimitiveRestartIndex());
         glEnable(GL_PRIMITIVE_RESTART);
     }
-    glDrawElements(ib.getPrimitiveType(), ib.getCount(),
-                   ib.getIndexType(), nullptr);
+    // the offset into the bound element array buffer is passed as pointer:
+    const std::uintptr_t offset = static_cast<std::uintptr_t>(first) * GLIndexBuffer::getIndexSize(ib.getIndexType());
+    glDrawElements(ib.getPrimitiveType(), count,
+                   ib.getIndexType(), reinterpret_cast<const void*>(offset));
     if (ib.hasPrimitiveRestart()) {
         glDisable(GL_PRIMITIVE_RESTART);
     }
-    shaderP.unbind();
-    va.unbind(); // automatically unbinds ib
+}
+
+void GLRenderer::multiDrawIndirectBound(const GLIndexBuffer &ib, GLsizei drawCount) const
+{
+    ASSERT(!ib.hasPrimitiveRestart());
+    glMultiDrawElementsIndirect(ib.getPrimitiveType(), ib.getIndexType(), nullptr, drawCount, 0); // tightly packed
+}
+
+void GLRenderer::multiDrawIndirectCountBound(const GLIndexBuffer &ib, GLsizei maxDrawCount) const
+{
+    ASSERT(!ib.hasPrimitiveRestart());
+    ASSERT(supportsIndirectCount());
+    // (both are the same function, only the extension might be loaded)
+    if (GLEW_VERSION_4_6) {
+        glMultiDrawElementsIndirectCount(ib.getPrimitiveType(), ib.getIndexType(), nullptr, 0, maxDrawCount, 0);
+    } else {
+        glMultiDrawElementsIndirectCountARB(ib.getPrimitiveType(), ib.getIndexType(), nullptr, 0, maxDrawCount, 0);
+    }
+}
+
+bool GLRenderer::supportsIndirectCount()
+{
+    return GLEW_VERSION_4_6 || GLEW_ARB_indirect_parameters;
+}
+
+void GLRenderer::dispatchCompute(GLuint groupsX, GLuint groupsY, GLuint groupsZ) const
+{
+    glDispatchCompute(groupsX, groupsY, groupsZ);
+}
+
+void GLRenderer::memoryBarrier(GLbitfield barriers) const
+{
+    glMemoryBarrier(barriers);
 }
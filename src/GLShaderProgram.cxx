@@ -1,6 +1,7 @@
 #include "GLShaderProgram.h"
 
 #include "debug_utils.h"
+#include "CpuProfiler.h"
 
 #include <iostream>
 
@@ -12,6 +13,8 @@
 
 #include <utility> // std::move(..), std::exchange(..)
 
+#include "GLCallStats.h"
+
 using namespace std::literals::string_literals;
 
 
@@ -33,6 +36,7 @@ GLShaderProgram::GLShaderProgram()
 
 GLShaderProgram::GLShaderProgram(const std::filesystem::path& filepath, SPReadiness readiness)
 {
+    CPU_PROFILE_SCOPE("GLShaderProgram(filepath)");
     m_rendererID = glCreateProgram();
 
     std::vector<ShaderSource> sources = parseShader(filepath);
@@ -45,6 +49,7 @@ GLShaderProgram::GLShaderProgram(const std::filesystem::path& filepath, SPReadin
 
 GLShaderProgram::GLShaderProgram(std::vector<ShaderSource> sources, SPReadiness readiness)
 {
+    CPU_PROFILE_SCOPE("GLShaderProgram(sources)");
     m_rendererID = glCreateProgram();
 
     for (auto& src : sources) {
@@ -109,6 +114,7 @@ void GLShaderProgram::addShaderFromSource(const ShaderSource &source) {
 }
 
 bool GLShaderProgram::compileShaders() {
+    CPU_PROFILE_FUNCTION();
     bool success = true;
     for (auto& s : m_shaders) {
         success = (success && s.compile());
@@ -117,6 +123,7 @@ bool GLShaderProgram::compileShaders() {
 }
 
 bool GLShaderProgram::link() {
+    CPU_PROFILE_FUNCTION();
     glLinkProgram(m_rendererID);
     bool success = (getParam(GL_LINK_STATUS) == GL_TRUE);
     if (success) {
@@ -224,6 +231,17 @@ void GLShaderProgram::setUniform1i(const std::string &name, int v)
     setUniform1i(getUniformLocation(name), v);
 }
 
+void GLShaderProgram::setUniform2i(GLint location, int v0, int v1)
+{
+    ASSERT(isBound());
+    glUniform2i(location, v0, v1);
+}
+
+void GLShaderProgram::setUniform2i(const std::string &name, int v0, int v1)
+{
+    setUniform2i(getUniformLocation(name), v0, v1);
+}
+
 void GLShaderProgram::setUniform1f(GLint location, float value)
 {
     ASSERT(isBound());
@@ -235,6 +253,17 @@ void GLShaderProgram::setUniform1f(const std::string &name, float value)
     setUniform1f(getUniformLocation(name), value);
 }
 
+void GLShaderProgram::setUniform1fv(GLint location, GLsizei count, const GLfloat *values)
+{
+    ASSERT(isBound());
+    glUniform1fv(location, count, values);
+}
+
+void GLShaderProgram::setUniform1fv(const std::string &name, GLsizei count, const GLfloat *values)
+{
+    setUniform1fv(getUniformLocation(name), count, values);
+}
+
 void GLShaderProgram::setUniform3f(GLint location, float v0, float v1, float v2)
 {
     ASSERT(isBound());
@@ -5,10 +5,15 @@
 #include <optional>
 
 #include "debug_utils.h"
-#include "stb_image.h"
+#include "cpu_image_import.h"
+#include "cpu_image_mipmap.h"
+#include "GpuMemoryRegistry.h"
+#include "CpuProfiler.h"
 
 #include <utility> // std::move(..), std::exchange(..)
 
+#include "GLCallStats.h"
+
 namespace texture_sampling_presets {
 const Tex2DSamplingParams noFilter {
     GL_NEAREST, GL_NEAREST, false,
@@ -34,28 +39,52 @@ GLTexture::GLTexture(int width, int height, GLenum internalformat, const Tex2DSa
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-GLTexture::GLTexture(std::filesystem::path filepath, int channels, bool sRGB, const Tex2DSamplingParams &sampParams)
+GLTexture::GLTexture(int width, int height, GLenum internalformat, GLsizei samples)
+    : m_target(GL_TEXTURE_2D_MULTISAMPLE),
+      m_samples(samples),
+      m_width(width),
+      m_height(height),
+      m_mipLevels(1),
+      m_internalformat(internalformat)
 {
-    // load data from file:
-    // m_width = m_height = 512;
-    // std::vector<GLubyte> pix_data = makeCheckerPattern(m_width, m_height);
-    stbi_set_flip_vertically_on_load(1);
-    int width, height, channels_in_file;
-    ASSERT(1 <= channels && channels <= 4);
-    unsigned char* pix_data = stbi_load(filepath.string().c_str(), &width, &height, &channels_in_file, channels);
-    ASSERT(pix_data);
-    DEBUG_DO(std::cout << "available channels in file " << filepath << ": " << channels_in_file << '\n');
-    ASSERT(channels_in_file >= channels);
+    ASSERT(0 <= width && 0 <= height);
+    ASSERT(1 <= samples);
 
-    // select internalformat based on #channels and based on whether we want to use sRGB:
-    constexpr std::array<std::array<std::optional<GLenum>, 4>, 2> internalformats
-               = {std::array<std::optional<GLenum>, 4>{GL_R8,        GL_RG8,       GL_RGB8,  GL_RGBA8},
-                  std::array<std::optional<GLenum>, 4>{std::nullopt, std::nullopt, GL_SRGB8, GL_SRGB8_ALPHA8}};
-        // GL_RGB8 and GL_SRGB8 are guaranteed to be supported (=socalled required format) for textures but
-        //  not guaranteed to be supported for framebuffers.
-        // the others are guaranteed to be supported (required formats) for both textures and framebuffers.
-    std::optional<GLenum> myInternalformat = internalformats[static_cast<int>(sRGB)][channels - 1];
-    ASSERT(myInternalformat);
+    glGenTextures(1, &m_rendererId);
+    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, m_rendererId);
+    // fixed sample locations, so color and depth attachments with the same sample count
+    // are framebuffer complete together.
+    // (glTexStorage2DMultisample(..) would require OpenGL 4.3)
+    glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, internalformat, width, height, GL_TRUE);
+    // multisampled textures have no sampling parameters
+    m_memoryId = GpuMemoryRegistry::shared().registerAllocation(
+                GpuMemoryCategory::TEXTURE,
+                GpuMemoryRegistry::estimateTextureBytes(internalformat, width, height, 1, 1, samples));
+
+    // unbind texture again:
+    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+}
+
+GLTexture::GLTexture(std::filesystem::path filepath, int channels, bool sRGB, const Tex2DSamplingParams &sampParams)
+    // load data from file. 3 channel images are expanded to 4 channels so that the
+    // upload does not require a conversion by the driver:
+    : GLTexture(loadImageFile(filepath, getUploadChannelCount(channels)).value_or(CPUImage{}), sRGB, sampParams)
+{}
+
+GLTexture::GLTexture(const CPUImage &image, bool sRGB, const Tex2DSamplingParams &sampParams)
+    // generate content of other mipmap levels on the CPU (instead of glGenerateMipmap(..)
+    //  whose filter quality and sRGB handling depend on the driver):
+    : GLTexture(CPUTexture{sRGB, sampParams.requiresMipmap() ? generateMipChain(image, sRGB)
+                                                             : std::vector<CPUImage>{image}},
+                sampParams)
+{}
+
+GLTexture::GLTexture(const CPUTexture &texture, const Tex2DSamplingParams &sampParams)
+{
+    CPU_PROFILE_SCOPE("GLTexture(CPUTexture)");
+    ASSERT(!texture.levels.empty());
+    const CPUImage& level0 = texture.levels[0];
+    ASSERT(!level0.data.empty()); // did loading the image fail?
 
     // call helper function to avoid code duplication with other constructor:
     //  1.) compute sensible number of mipmap levels and initialize
@@ -66,26 +95,32 @@ GLTexture::GLTexture(std::filesystem::path filepath, int channels, bool sRGB, co
     //  4.) set up the texture objects sampling parameters as defined by sampParams
     //  5.) keep the texture object bound so we can upload data to the allocated storage
     //          without having to rebind the texture first
-    initAndKeepBound(width, height, *myInternalformat, sampParams);
+    initAndKeepBound(level0.width, level0.height, getInternalFormat(level0.channels, texture.sRGB), sampParams);
+    ASSERT(texture.levels.size() >= static_cast<std::size_t>(m_mipLevels));
 
     // upload actual data to the allocated storage:
-    constexpr std::array<GLenum, 4> formats = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexSubImage2D(GL_TEXTURE_2D,
-                    0, // lod-level
-                    0, 0, // x, y-offset
-                    m_width, m_height,
-                    formats[channels - 1], GL_UNSIGNED_BYTE,
-                    pix_data);
-
-    // deallocate cpu side copy of data:
-    if (pix_data) {
-        stbi_image_free(pix_data);
+    for (GLsizei level = 0; level < m_mipLevels; ++level) {
+        const CPUImage& image = texture.levels[static_cast<std::size_t>(level)];
+        setImage(level, image.channels, image.data.data());
     }
 
-    // generate content of other mipmap levels:
-    if (m_mipLevels > 1) {
-        glGenerateMipmap(GL_TEXTURE_2D);
+    // unbind texture again:
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+GLTexture::GLTexture(const CPUCompressedTexture &texture, const Tex2DSamplingParams &sampParams)
+{
+    CPU_PROFILE_SCOPE("GLTexture(CPUCompressedTexture)");
+    ASSERT(!texture.levels.empty());
+    ASSERT(GLEW_EXT_texture_compression_s3tc);
+    ASSERT(!texture.sRGB || GLEW_EXT_texture_sRGB);
+    const CPUCompressedImage& level0 = texture.levels[0];
+    initAndKeepBound(level0.width, level0.height, getCompressedInternalFormat(texture.format, texture.sRGB), sampParams);
+    ASSERT(texture.levels.size() >= static_cast<std::size_t>(m_mipLevels));
+
+    for (GLsizei level = 0; level < m_mipLevels; ++level) {
+        const auto& blocks = texture.levels[static_cast<std::size_t>(level)].blocks;
+        setCompressedImage(level, static_cast<GLsizei>(blocks.size()), blocks.data());
     }
 
     // unbind texture again:
@@ -94,9 +129,13 @@ GLTexture::GLTexture(std::filesystem::path filepath, int channels, bool sRGB, co
 
 GLTexture::GLTexture(GLTexture &&other) noexcept
     : m_rendererId(std::exchange(other.m_rendererId, 0)),
+      m_target(std::move(other.m_target)),
+      m_samples(std::move(other.m_samples)),
       m_width(std::move(other.m_width)),
       m_height(std::move(other.m_height)),
-      m_mipLevels(std::move(other.m_mipLevels))
+      m_mipLevels(std::move(other.m_mipLevels)),
+      m_internalformat(std::move(other.m_internalformat)),
+      m_memoryId(std::exchange(other.m_memoryId, 0))
 {}
 
 GLTexture& GLTexture::operator=(GLTexture &&other)
@@ -106,11 +145,16 @@ GLTexture& GLTexture::operator=(GLTexture &&other)
     }
 
     glDeleteTextures(1, &m_rendererId); // docs.gl: "glDeleteTextures(..) silently ignores 0's [...]"
+    GpuMemoryRegistry::shared().unregisterAllocation(m_memoryId);
 
     m_rendererId = std::exchange(other.m_rendererId, 0);
+    m_target = std::move(other.m_target);
+    m_samples = std::move(other.m_samples);
     m_width = std::move(other.m_width);
     m_height = std::move(other.m_height);
     m_mipLevels = std::move(other.m_mipLevels);
+    m_internalformat = std::move(other.m_internalformat);
+    m_memoryId = std::exchange(other.m_memoryId, 0);
 
     return *this;
 }
@@ -118,18 +162,115 @@ GLTexture& GLTexture::operator=(GLTexture &&other)
 GLTexture::~GLTexture()
 {
     glDeleteTextures(1, &m_rendererId); // docs.gl: "glDeleteTextures(..) silently ignores 0's [...]"
+    GpuMemoryRegistry::shared().unregisterAllocation(m_memoryId);
 }
 
 void GLTexture::bind(int texUnit)
 {
     glActiveTexture(GL_TEXTURE0 + texUnit);
-    glBindTexture(GL_TEXTURE_2D, m_rendererId);
+    glBindTexture(m_target, m_rendererId);
 }
 
 void GLTexture::unbind()
 {
     ASSERT(isBoundToActiveUnit());
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(m_target, 0);
+}
+
+void GLTexture::setImage(GLint level, int channels, const GLvoid *pixels)
+{
+    ASSERT(0 <= level && level < m_mipLevels);
+    setSubImage(level, 0, 0, std::max(m_width >> level, 1), std::max(m_height >> level, 1), channels, pixels);
+}
+
+void GLTexture::setSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                            int channels, const GLvoid *pixels)
+{
+    ASSERT(m_target == GL_TEXTURE_2D); // multisampled textures can only be rendered to
+    ASSERT(0 <= level && level < m_mipLevels);
+    ASSERT(1 <= channels && channels <= 4);
+    ASSERT(0 <= x && 0 <= y && x + width <= std::max(m_width >> level, 1) && y + height <= std::max(m_height >> level, 1));
+    constexpr std::array<GLenum, 4> formats = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    glBindTexture(GL_TEXTURE_2D, m_rendererId);
+    // rows of a CPUImage are tightly packed:
+    const std::size_t rowSize = static_cast<std::size_t>(width) * static_cast<std::size_t>(channels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, computeUnpackAlignment(rowSize));
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    level, // lod-level
+                    x, y, // x, y-offset
+                    width, height,
+                    formats[channels - 1], GL_UNSIGNED_BYTE,
+                    pixels);
+}
+
+void GLTexture::setSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, const GLfloat *rgba)
+{
+    ASSERT(m_target == GL_TEXTURE_2D);
+    ASSERT(0 <= level && level < m_mipLevels);
+    ASSERT(0 <= x && 0 <= y && x + width <= std::max(m_width >> level, 1) && y + height <= std::max(m_height >> level, 1));
+    glBindTexture(GL_TEXTURE_2D, m_rendererId);
+    // rows of 16 byte pixels are always 8 byte aligned:
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 8);
+    glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, GL_RGBA, GL_FLOAT, rgba);
+}
+
+void GLTexture::setCompressedImage(GLint level, GLsizei byteSize, const GLvoid *blocks)
+{
+    ASSERT(m_target == GL_TEXTURE_2D);
+    ASSERT(0 <= level && level < m_mipLevels);
+    glBindTexture(GL_TEXTURE_2D, m_rendererId);
+    glCompressedTexSubImage2D(GL_TEXTURE_2D,
+                              level,
+                              0, 0, // x, y-offset
+                              std::max(m_width >> level, 1), std::max(m_height >> level, 1),
+                              m_internalformat,
+                              byteSize, blocks);
+}
+
+void GLTexture::setDebugLabel(const std::string &label)
+{
+    GpuMemoryRegistry::shared().setLabel(m_memoryId, label);
+    if (GLEW_VERSION_4_3 || GLEW_KHR_debug) {
+        glObjectLabel(GL_TEXTURE, m_rendererId, -1, label.c_str());
+    }
+}
+
+void GLTexture::setMemoryCategory(GpuMemoryCategory category)
+{
+    GpuMemoryRegistry::shared().setCategory(m_memoryId, category);
+}
+
+void GLTexture::bindImage(GLuint unit, GLenum access, GLint level)
+{
+    ASSERT(m_target == GL_TEXTURE_2D);
+    ASSERT(0 <= level && level < m_mipLevels);
+    glBindImageTexture(unit, m_rendererId,
+                       level,
+                       GL_FALSE, 0, // not layered
+                       access, m_internalformat);
+}
+
+GLenum GLTexture::getInternalFormat(int channels, bool sRGB)
+{
+    // select internalformat based on #channels and based on whether we want to use sRGB:
+    constexpr std::array<std::array<std::optional<GLenum>, 4>, 2> internalformats
+               = {std::array<std::optional<GLenum>, 4>{GL_R8,        GL_RG8,       std::nullopt, GL_RGBA8},
+                  std::array<std::optional<GLenum>, 4>{std::nullopt, std::nullopt, std::nullopt, GL_SRGB8_ALPHA8}};
+        // all of those are guaranteed to be supported (required formats) for both textures and framebuffers.
+        // (GL_RGB8 and GL_SRGB8 would be required for textures but not for framebuffers and their
+        //  upload often takes a slow conversion path inside the driver -> use getUploadChannelCount(..))
+    ASSERT(1 <= channels && channels <= 4);
+    std::optional<GLenum> myInternalformat = internalformats[static_cast<int>(sRGB)][channels - 1];
+    ASSERT(myInternalformat);
+    return myInternalformat.value_or(GL_RGBA8);
+}
+
+GLenum GLTexture::getCompressedInternalFormat(BlockFormat format, bool sRGB)
+{
+    if (format == BlockFormat::BC1) {
+        return sRGB ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+    return sRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
 }
 
 void GLTexture::initAndKeepBound(int width, int height, GLenum internalformat, const Tex2DSamplingParams& sampParams)
@@ -139,6 +280,7 @@ void GLTexture::initAndKeepBound(int width, int height, GLenum internalformat, c
     m_width = width;
     m_height = height;
     m_mipLevels = (sampParams.requiresMipmap()) ? computeMipLevelCount(m_width, m_height) : 1;
+    m_internalformat = internalformat;
 
     // create texture:
     glGenTextures(1, &m_rendererId);
@@ -156,6 +298,9 @@ void GLTexture::initAndKeepBound(int width, int height, GLenum internalformat, c
     // I believe glTexStorage2D(..) will also take care of setting GL_TEXTURE_MAX_LEVEL
     // see: https://www.khronos.org/opengl/wiki/Common_Mistakes#Creating_a_complete_texture
     //      https://www.khronos.org/opengl/wiki/Texture#Mipmap_range
+    m_memoryId = GpuMemoryRegistry::shared().registerAllocation(
+                GpuMemoryCategory::TEXTURE,
+                GpuMemoryRegistry::estimateTextureBytes(internalformat, m_width, m_height, 1, m_mipLevels));
 
     // set sampling parameters:
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampParams.mag_filter);
@@ -173,7 +318,8 @@ void GLTexture::initAndKeepBound(int width, int height, GLenum internalformat, c
 bool GLTexture::isBoundToActiveUnit() const
 {
     GLint currId = 0;
-    glGetIntegerv(GL_TEXTURE_BINDING_2D, &currId);
+    glGetIntegerv((m_target == GL_TEXTURE_2D_MULTISAMPLE) ? GL_TEXTURE_BINDING_2D_MULTISAMPLE : GL_TEXTURE_BINDING_2D,
+                  &currId);
     return m_rendererId == static_cast<GLuint>(currId);
 }
 
@@ -189,22 +335,13 @@ GLsizei GLTexture::computeMipLevelCount(GLsizei width, GLsizei height)
     return level; // return first level where (size >> level) would be zero
 }
 
-std::vector<GLubyte> GLTexture::makeCheckerPattern(GLsizei &width, GLsizei &height)
+GLint GLTexture::computeUnpackAlignment(std::size_t rowSize)
 {
-    std::array<std::vector<GLubyte>, 2> colors = {
-            std::vector<GLubyte>{  0,   0,   0},
-            std::vector<GLubyte>{255, 255, 255}
-        };
-    std::vector<GLubyte> res;
-    for (GLsizei y = 0; y < height; ++y) {
-        for (GLsizei x = 0; x < width; ++x) {
-            int col_index = !!((x ^ y) & (1 << 3)); // !! converts to bool, after that
-                                                    // implicitly convert to int again
-            std::copy(colors[col_index].begin(), colors[col_index].end(),
-                      std::back_inserter(res));
+    // largest alignment allowed by glPixelStorei(..) that the tightly packed rows satisfy:
+    for (GLint alignment : {8, 4, 2}) {
+        if (rowSize % static_cast<std::size_t>(alignment) == 0) {
+            return alignment;
         }
     }
-    ASSERT(res.size() == colors[0].size() * width * height);
-    ASSERT(colors[0].size() == colors[1].size());
-    return res;
+    return 1;
 }
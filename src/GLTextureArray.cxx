@@ -0,0 +1,152 @@
+#include "GLTextureArray.h"
+
+#include <algorithm> // for std::min(..), std::max(..)
+#include <array>
+#include <utility>   // for std::move(..), std::exchange(..)
+
+#include "debug_utils.h"
+#include "cpu_image_mipmap.h"
+#include "GpuMemoryRegistry.h"
+#include "GLCallStats.h"
+
+
+GLTextureArray::GLTextureArray(int width, int height, int layers, GLenum internalformat, const Tex2DSamplingParams &sampParams)
+{
+    initAndKeepBound(width, height, layers, internalformat, sampParams);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+GLTextureArray::GLTextureArray(const CPUTexturePack &pack, const Tex2DSamplingParams &sampParams)
+{
+    ASSERT(!pack.layers.empty());
+    const CPUImage& layer0 = pack.layers[0];
+    initAndKeepBound(layer0.width, layer0.height, static_cast<int>(pack.layers.size()),
+                     GLTexture::getInternalFormat(pack.channels, pack.sRGB), sampParams);
+
+    for (std::size_t layer = 0; layer < pack.layers.size(); ++layer) {
+        const CPUImage& image = pack.layers[layer];
+        ASSERT(image.width == m_width && image.height == m_height && image.channels == pack.channels);
+        if (m_mipLevels > 1) {
+            // filtered on the CPU like the levels of a GLTexture (sRGB correct):
+            const std::vector<CPUImage> levels = generateMipChain(image, pack.sRGB);
+            for (GLsizei level = 0; level < m_mipLevels; ++level) {
+                setLayerImage(level, static_cast<GLint>(layer), pack.channels, levels[static_cast<std::size_t>(level)].data.data());
+            }
+        } else {
+            setLayerImage(0, static_cast<GLint>(layer), pack.channels, image.data.data());
+        }
+    }
+
+    // unbind texture again:
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+GLTextureArray::GLTextureArray(GLTextureArray &&other) noexcept
+    : m_rendererId(std::exchange(other.m_rendererId, 0)),
+      m_width(std::move(other.m_width)),
+      m_height(std::move(other.m_height)),
+      m_layers(std::move(other.m_layers)),
+      m_mipLevels(std::move(other.m_mipLevels)),
+      m_memoryId(std::exchange(other.m_memoryId, 0))
+{}
+
+GLTextureArray& GLTextureArray::operator=(GLTextureArray &&other)
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    glDeleteTextures(1, &m_rendererId); // docs.gl: "glDeleteTextures(..) silently ignores 0's [...]"
+    GpuMemoryRegistry::shared().unregisterAllocation(m_memoryId);
+
+    m_rendererId = std::exchange(other.m_rendererId, 0);
+    m_width = std::move(other.m_width);
+    m_height = std::move(other.m_height);
+    m_layers = std::move(other.m_layers);
+    m_mipLevels = std::move(other.m_mipLevels);
+    m_memoryId = std::exchange(other.m_memoryId, 0);
+
+    return *this;
+}
+
+GLTextureArray::~GLTextureArray()
+{
+    glDeleteTextures(1, &m_rendererId); // docs.gl: "glDeleteTextures(..) silently ignores 0's [...]"
+    GpuMemoryRegistry::shared().unregisterAllocation(m_memoryId);
+}
+
+void GLTextureArray::bind(int texUnit)
+{
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(texUnit));
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_rendererId);
+}
+
+void GLTextureArray::unbind()
+{
+    ASSERT(isBoundToActiveUnit());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void GLTextureArray::setLayerImage(GLint level, GLint layer, int channels, const GLvoid *pixels)
+{
+    ASSERT(0 <= level && level < m_mipLevels);
+    ASSERT(0 <= layer && layer < m_layers);
+    ASSERT(1 <= channels && channels <= 4);
+    constexpr std::array<GLenum, 4> formats = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_rendererId);
+    const GLsizei width = std::max(m_width >> level, 1);
+    const GLsizei height = std::max(m_height >> level, 1);
+    // rows of a CPUImage are tightly packed:
+    const std::size_t rowSize = static_cast<std::size_t>(width) * static_cast<std::size_t>(channels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, GLTexture::computeUnpackAlignment(rowSize));
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                    level, // lod-level
+                    0, 0, layer, // x, y, z-offset
+                    width, height, 1,
+                    formats[static_cast<std::size_t>(channels - 1)], GL_UNSIGNED_BYTE,
+                    pixels);
+}
+
+void GLTextureArray::setDebugLabel(const std::string &label)
+{
+    GpuMemoryRegistry::shared().setLabel(m_memoryId, label);
+    if (GLEW_VERSION_4_3 || GLEW_KHR_debug) {
+        glObjectLabel(GL_TEXTURE, m_rendererId, -1, label.c_str());
+    }
+}
+
+void GLTextureArray::initAndKeepBound(int width, int height, int layers, GLenum internalformat, const Tex2DSamplingParams &sampParams)
+{
+    ASSERT(0 < width && 0 < height && 0 < layers);
+    m_width = width;
+    m_height = height;
+    m_layers = layers;
+    m_mipLevels = (sampParams.requiresMipmap()) ? GLTexture::computeMipLevelCount(m_width, m_height) : 1;
+
+    glGenTextures(1, &m_rendererId);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_rendererId);
+
+    // allocate immutable storage for all layers:
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, m_mipLevels, internalformat, m_width, m_height, m_layers);
+    m_memoryId = GpuMemoryRegistry::shared().registerAllocation(
+                GpuMemoryCategory::TEXTURE,
+                GpuMemoryRegistry::estimateTextureBytes(internalformat, m_width, m_height, m_layers, m_mipLevels));
+
+    // set sampling parameters:
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, sampParams.mag_filter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, sampParams.min_filter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, sampParams.wrap_s);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, sampParams.wrap_t);
+    if (sampParams.try_anisotropic_filter && GLEW_EXT_texture_filter_anisotropic) {
+        float maxMaxAnisotropy = 1.f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxMaxAnisotropy);
+        glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(maxMaxAnisotropy, 32.f));
+    }
+}
+
+bool GLTextureArray::isBoundToActiveUnit() const
+{
+    GLint boundTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &boundTexture);
+    return static_cast<GLuint>(boundTexture) == m_rendererId;
+}
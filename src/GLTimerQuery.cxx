@@ -0,0 +1,80 @@
+#include "GLTimerQuery.h"
+
+#include "debug_utils.h"
+
+#include <utility> // std::move(..), std::exchange(..)
+
+GLTimerQuery::GLTimerQuery()
+{
+    glGenQueries(ringSize, m_queries.data());
+}
+
+GLTimerQuery::GLTimerQuery(GLTimerQuery &&other) noexcept
+    : m_queries(std::exchange(other.m_queries, {})),
+      m_next(other.m_next),
+      m_inFlight(std::exchange(other.m_inFlight, 0)),
+      m_active(std::exchange(other.m_active, false)),
+      m_lastResult_ms(other.m_lastResult_ms)
+{}
+
+GLTimerQuery &GLTimerQuery::operator=(GLTimerQuery &&other)
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    glDeleteQueries(ringSize, m_queries.data()); // docs.gl: "Unused names in ids are silently ignored, as is the value zero."
+
+    m_queries = std::exchange(other.m_queries, {});
+    m_next = other.m_next;
+    m_inFlight = std::exchange(other.m_inFlight, 0);
+    m_active = std::exchange(other.m_active, false);
+    m_lastResult_ms = other.m_lastResult_ms;
+
+    return *this;
+}
+
+GLTimerQuery::~GLTimerQuery()
+{
+    glDeleteQueries(ringSize, m_queries.data());
+}
+
+void GLTimerQuery::begin()
+{
+    ASSERT(!m_active);
+    if (m_inFlight == ringSize) {
+        // all queries still wait for their results, do not measure this time
+        return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+    m_active = true;
+}
+
+void GLTimerQuery::end()
+{
+    if (!m_active) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    m_active = false;
+    m_next = (m_next + 1) % ringSize;
+    ++m_inFlight;
+}
+
+std::optional<double> GLTimerQuery::poll()
+{
+    while (m_inFlight > 0) {
+        GLuint oldest = m_queries[(m_next - m_inFlight + ringSize) % ringSize];
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(oldest, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE) {
+            // results become available in order, so newer ones are not available either
+            break;
+        }
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(oldest, GL_QUERY_RESULT, &elapsed_ns);
+        m_lastResult_ms = static_cast<double>(elapsed_ns) * 1e-6;
+        --m_inFlight;
+    }
+    return m_lastResult_ms;
+}
@@ -4,6 +4,8 @@
 
 #include <utility> // std::move(..), std::exchange(..)
 
+#include "GLCallStats.h"
+
 GLVertexArray::GLVertexArray(bool bindNow)
 {
     glGenVertexArrays(1, &m_rendererID);
@@ -43,10 +45,9 @@ GLVertexArray::~GLVertexArray() {
     }
 }
 
-void GLVertexArray::addBuffer(const GLVertexBuffer &vb, const VertexBufferLayout &layout)
+void GLVertexArray::addBuffer(const GLVertexBuffer &vb, const VertexBufferLayout &layout, GLuint bindingIndex)
 {
     bind();
-    const GLuint bindingIndex = 0;
     glBindVertexBuffer(bindingIndex, vb.getRendererID(), 0, layout.getStride());
     const std::vector<VertexAttributeLayout>& attributes = layout.getAttributes();
     for (auto& attr : attributes) {
@@ -81,6 +82,12 @@ void GLVertexArray::addBuffer(const GLVertexBuffer &vb, const VertexBufferLayout
     }
 }
 
+void GLVertexArray::setBindingDivisor(GLuint bindingIndex, GLuint divisor)
+{
+    bind();
+    glVertexBindingDivisor(bindingIndex, divisor);
+}
+
 bool GLVertexArray::isBound() const
 {
     GLint currVao;
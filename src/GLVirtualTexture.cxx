@@ -0,0 +1,164 @@
+#include "GLVirtualTexture.h"
+
+#include <algorithm> // for std::min(..), std::max(..)
+#include <cmath>     // for std::sqrt(..)
+#include <iterator>  // for std::make_move_iterator(..)
+#include <iostream>
+#include <utility>   // for std::move(..)
+
+#include "debug_utils.h"
+#include "GLCallStats.h"
+
+namespace {
+
+VTResidency makeResidency(const VTPageFile& pageFile, std::size_t memoryBudgetBytes)
+{
+    const std::size_t slotCount = std::max<std::size_t>(memoryBudgetBytes / pageFile.getPageByteSize(), 2);
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    // slot coordinates are stored in 8 bit page table channels:
+    const auto maxSlots = static_cast<std::uint32_t>(std::min(256, maxTextureSize / pageFile.getLayout().getPaddedPageSize()));
+    // as square as possible:
+    const auto slotsX = std::min(std::max(static_cast<std::uint32_t>(std::sqrt(static_cast<double>(slotCount))), 2u), maxSlots);
+    const auto slotsY = std::min(std::max(static_cast<std::uint32_t>(slotCount / slotsX), 1u), maxSlots);
+    return VTResidency(pageFile.getLayout(), slotsX, slotsY);
+}
+
+// the page borders take care of filtering across page boundaries. No mipmaps,
+// the shader selects the level through the page table:
+const Tex2DSamplingParams physicalSamplingParams {
+    GL_LINEAR, GL_LINEAR, false,
+    GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE
+};
+// the page table and the virtual texture both halve their page count from level to level,
+// so the page table has one mip level per level of the virtual texture:
+const Tex2DSamplingParams pageTableSamplingParams {
+    GL_NEAREST, GL_NEAREST_MIPMAP_NEAREST, false,
+    GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE
+};
+
+} // namespace
+
+
+GLVirtualTexture::GLVirtualTexture(VTPageFile pageFile, std::size_t memoryBudgetBytes)
+    : m_pageFile(std::move(pageFile)),
+      m_residency(makeResidency(m_pageFile, memoryBudgetBytes)),
+      m_physicalTex(static_cast<int>(m_residency.getSlotsX()) * m_pageFile.getLayout().getPaddedPageSize(),
+                    static_cast<int>(m_residency.getSlotsY()) * m_pageFile.getLayout().getPaddedPageSize(),
+                    m_pageFile.isSRGB() ? GL_SRGB8_ALPHA8 : GL_RGBA8, physicalSamplingParams),
+      m_pageTableTex(m_pageFile.getLayout().getPageCount(0), m_pageFile.getLayout().getPageCount(0),
+                     GL_RGBA8, pageTableSamplingParams),
+      m_loader(&GLVirtualTexture::loaderMain, this)
+{
+    ASSERT(m_pageTableTex.getMipLevelCount() == getLayout().getLevelCount());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+GLVirtualTexture::~GLVirtualTexture()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_requestAvailable.notify_one();
+    m_loader.join();
+}
+
+void GLVirtualTexture::update(const std::vector<VTPageId> &feedback, std::size_t maxUploads)
+{
+    m_residency.beginFrame();
+    for (const VTPageId& page : feedback) {
+        if (getLayout().contains(page)) {
+            m_residency.requestPage(page);
+        }
+    }
+
+    // exchange pages with the loader thread:
+    const std::size_t inFlight = m_residency.getInFlightCount();
+    std::vector<VTPageId> requests = m_residency.takeLoadRequests((inFlight < maxInFlight) ? maxInFlight - inFlight : 0);
+    std::vector<LoadedPage> loaded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.insert(m_requests.end(), requests.begin(), requests.end());
+        const auto count = static_cast<std::ptrdiff_t>(std::min(maxUploads, m_loaded.size()));
+        loaded.assign(std::make_move_iterator(m_loaded.begin()), std::make_move_iterator(m_loaded.begin() + count));
+        m_loaded.erase(m_loaded.begin(), m_loaded.begin() + count);
+    }
+    if (!requests.empty()) {
+        m_requestAvailable.notify_one();
+    }
+
+    // copy the pages into their slots of the physical cache:
+    const int padded = getLayout().getPaddedPageSize();
+    for (const LoadedPage& page : loaded) {
+        if (page.data.empty()) {
+            m_residency.onPageLoadFailed(page.page);
+            continue;
+        }
+        if (auto result = m_residency.onPageLoaded(page.page)) {
+            m_physicalTex.setSubImage(0, static_cast<GLint>(result->slot.x) * padded, static_cast<GLint>(result->slot.y) * padded,
+                                      padded, padded, 4, page.data.data());
+            ++m_uploadCount;
+        }
+    }
+
+    // the page table is tiny (one texel per page), upload all of it:
+    if (m_residency.isPageTableDirty()) {
+        const auto& pageTable = m_residency.getPageTable();
+        for (std::size_t level = 0; level < pageTable.size(); ++level) {
+            m_pageTableTex.setImage(static_cast<GLint>(level), 4, pageTable[level].data());
+        }
+    }
+}
+
+void GLVirtualTexture::bind(GLShaderProgram &shaderP, int physicalTexUnit, int pageTableTexUnit)
+{
+    m_physicalTex.bind(physicalTexUnit);
+    m_pageTableTex.bind(pageTableTexUnit);
+
+    const VTLayout& layout = getLayout();
+    shaderP.bind();
+    shaderP.setUniform1i("u_vt_physical", physicalTexUnit);
+    shaderP.setUniform1i("u_vt_page_table", pageTableTexUnit);
+    shaderP.setUniform1f("u_vt_size", static_cast<float>(layout.size));
+    shaderP.setUniform1f("u_vt_page_size", static_cast<float>(layout.pageSize));
+    shaderP.setUniform1f("u_vt_border", static_cast<float>(layout.border));
+    shaderP.setUniform1f("u_vt_max_level", static_cast<float>(layout.getLevelCount() - 1));
+    shaderP.setUniform3f("u_vt_physical_size", static_cast<float>(m_physicalTex.getWidth()),
+                         static_cast<float>(m_physicalTex.getHeight()), static_cast<float>(layout.getPaddedPageSize()));
+}
+
+std::size_t GLVirtualTexture::getGPUMemorySize() const
+{
+    // both textures have 4 bytes per texel:
+    std::size_t texels = static_cast<std::size_t>(m_physicalTex.getWidth()) * static_cast<std::size_t>(m_physicalTex.getHeight());
+    for (int level = 0; level < getLayout().getLevelCount(); ++level) {
+        const auto n = static_cast<std::size_t>(getLayout().getPageCount(level));
+        texels += n * n;
+    }
+    return texels * 4;
+}
+
+void GLVirtualTexture::loaderMain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_requestAvailable.wait(lock, [this]() { return m_stop || !m_requests.empty(); });
+        if (m_stop) {
+            return;
+        }
+        LoadedPage loaded{m_requests.front(), {}};
+        m_requests.pop_front();
+
+        // read from disk without holding the lock:
+        lock.unlock();
+        loaded.data.resize(m_pageFile.getPageByteSize());
+        if (!m_pageFile.readPage(loaded.page, loaded.data.data())) {
+            std::cerr << "WARNING: could not read virtual texture page\n";
+            loaded.data.clear();
+        }
+        lock.lock();
+
+        m_loaded.push_back(std::move(loaded));
+    }
+}
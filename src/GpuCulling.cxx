@@ -0,0 +1,243 @@
+#include "GpuCulling.h"
+
+#include <algorithm> // for std::max(..)
+#include <filesystem>
+#include <iostream>
+#include <numeric>   // for std::iota(..)
+#include <vector>
+
+#include "debug_utils.h"
+#include "CpuProfiler.h"
+#include "GLCallStats.h"
+
+namespace {
+
+// local sizes of the compute shaders:
+constexpr GLuint cullGroupSize = 64; // GpuCulling.shader
+constexpr GLuint hiZGroupSize = 8;   // HiZBuild.shader
+
+GLuint groupCount(std::size_t size, GLuint groupSize)
+{
+    return static_cast<GLuint>((size + groupSize - 1) / groupSize);
+}
+
+const Tex2DSamplingParams hiZSampling {
+    GL_NEAREST, GL_NEAREST_MIPMAP_NEAREST, false, // (only read with texelFetch(..), requests all levels)
+    GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE
+};
+
+}
+
+GpuCulling::GpuCulling()
+    : m_compact(GLRenderer::supportsIndirectCount()),
+      m_drawCount(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW, false)
+{
+    namespace fs = std::filesystem;
+    m_cullSP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/GpuCulling.shader",
+                                                          fs::path::format::generic_format));
+    m_hiZSP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/HiZBuild.shader",
+                                                         fs::path::format::generic_format));
+    m_drawCount.setDebugLabel("GpuCulling draw count");
+    m_objectIndexLayout.append<GLuint>(1, VariableType::INT, objectIndexLocation, "objectIndex");
+    if (!m_compact) {
+        std::cerr << "WARNING: no glMultiDrawElementsIndirectCount(..), GpuCulling draws hidden objects with 0 instances\n";
+    }
+}
+
+void GpuCulling::setObjects(gsl::span<const GpuCullingObject> objects)
+{
+    m_objectCount = objects.size();
+    if (m_objectCount > m_capacity) {
+        // grow geometrically, so adding objects one by one does not reallocate every time:
+        m_capacity = std::max(m_objectCount, 2 * m_capacity);
+        const auto capacity = static_cast<GLBufferObject::size_type>(m_capacity);
+        m_transforms.emplace(GL_SHADER_STORAGE_BUFFER, capacity * GLBufferObject::size_type(sizeof(glm::mat4)), nullptr,
+                             GL_STREAM_DRAW, false);
+        m_transforms->setDebugLabel("GpuCulling transforms");
+        m_objects.emplace(GL_SHADER_STORAGE_BUFFER, capacity * GLBufferObject::size_type(sizeof(GpuCullingObject)),
+                          nullptr, GL_STATIC_DRAW, false);
+        m_objects->setDebugLabel("GpuCulling objects");
+        m_commands.emplace(GL_DRAW_INDIRECT_BUFFER,
+                           capacity * GLBufferObject::size_type(sizeof(DrawElementsIndirectCommand)), nullptr,
+                           GL_DYNAMIC_COPY, false);
+        m_commands->setDebugLabel("GpuCulling commands");
+        std::vector<GLuint> indices(m_capacity);
+        std::iota(indices.begin(), indices.end(), 0u);
+        m_objectIndices.emplace(capacity * GLBufferObject::size_type(sizeof(GLuint)), indices.data(), false);
+        m_objectIndices->setDebugLabel("GpuCulling object indices");
+    }
+    if (!objects.empty()) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objects->getRendererID());
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                        static_cast<GLsizeiptr>(objects.size_bytes()), objects.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+}
+
+glm::mat4 *GpuCulling::mapTransforms()
+{
+    if (m_objectCount == 0) {
+        return nullptr;
+    }
+    // the GL keeps the contents of the last frame for the draws in flight (no waiting):
+    m_transforms->bind();
+    void* transforms = m_transforms->mapRange(0, static_cast<GLBufferObject::size_type>(m_objectCount * sizeof(glm::mat4)),
+                                              GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    m_transforms->unbind();
+    return static_cast<glm::mat4*>(transforms);
+}
+
+void GpuCulling::unmapTransforms()
+{
+    if (m_objectCount == 0) {
+        return;
+    }
+    m_transforms->bind();
+    if (!m_transforms->unmap()) {
+        std::cerr << "WARNING: the transforms of GpuCulling got corrupted\n";
+    }
+    m_transforms->unbind();
+}
+
+void GpuCulling::cull(GLRenderer &renderer, const glm::mat4 &ndc_from_wc)
+{
+    CPU_PROFILE_FUNCTION();
+    pollReadbacks();
+    const GLuint zero = 0;
+    m_drawCount.bind();
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+    m_drawCount.unbind();
+    if (m_objectCount == 0) {
+        return;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, transformsBinding, m_transforms->getRendererID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, objectsBinding, m_objects->getRendererID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, commandsBinding, m_commands->getRendererID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, drawCountBinding, m_drawCount.getRendererID());
+    m_cullSP->bind();
+    m_cullSP->setUniform1i("u_objectCount", static_cast<int>(m_objectCount));
+    m_cullSP->setUniformMat4f("u_ndc_from_wc", ndc_from_wc);
+    m_cullSP->setUniform1i("u_compact", m_compact ? 1 : 0);
+    const bool useHiZ = m_hiZValid && m_hiZ;
+    m_cullSP->setUniform1i("u_useHiZ", useHiZ ? 1 : 0);
+    if (useHiZ) {
+        m_hiZ->bind(0);
+        m_cullSP->setUniform1i("u_hiZ", 0);
+        m_cullSP->setUniformMat4f("u_hiZ_ndc_from_wc", m_hiZ_ndc_from_wc);
+    }
+    renderer.dispatchCompute(groupCount(m_objectCount, cullGroupSize));
+    m_cullSP->unbind();
+    // the commands and the count are read by the draw and the copy of the readback:
+    renderer.memoryBarrier(GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    // copy of the visible count, read some frames later:
+    std::optional<Readback>& readback = m_readbacks[m_nextReadback];
+    if (readback && readback->fence) {
+        return; // all readbacks in flight, the statistics skip this frame
+    }
+    if (!readback) {
+        readback.emplace(Readback{GLBufferObject(GL_COPY_WRITE_BUFFER, sizeof(GLuint), nullptr, GL_STREAM_READ, false),
+                                  std::nullopt, false});
+        readback->buffer.setDebugLabel("GpuCulling readback");
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, m_drawCount.getRendererID());
+    readback->buffer.bind();
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(GLuint));
+    readback->buffer.unbind();
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    readback->fence.emplace();
+    readback->occlusion = useHiZ;
+    m_nextReadback = (m_nextReadback + 1) % m_readbacks.size();
+}
+
+void GpuCulling::draw(GLRenderer &renderer, GLVertexArray &va, GLIndexBuffer &ib)
+{
+    CPU_PROFILE_FUNCTION();
+    if (m_objectCount == 0) {
+        return;
+    }
+    // (the buffer is replaced when the objects grow, so it is attached every time)
+    va.addBuffer(*m_objectIndices, m_objectIndexLayout, objectIndexBindingIndex);
+    va.setBindingDivisor(objectIndexBindingIndex, 1);
+    ib.bind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, transformsBinding, m_transforms->getRendererID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, objectsBinding, m_objects->getRendererID());
+    m_commands->bind();
+    if (m_compact) {
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, m_drawCount.getRendererID());
+        renderer.multiDrawIndirectCountBound(ib, static_cast<GLsizei>(m_objectCount));
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+    } else {
+        renderer.multiDrawIndirectBound(ib, static_cast<GLsizei>(m_objectCount));
+    }
+    m_commands->unbind();
+}
+
+void GpuCulling::buildHiZ(GLRenderer &renderer, GLTexture &depth, const glm::mat4 &ndc_from_wc, int texUnit)
+{
+    CPU_PROFILE_FUNCTION();
+    ASSERT(depth.getTarget() == GL_TEXTURE_2D);
+    if (!m_hiZ || m_hiZ->getWidth() != depth.getWidth() || m_hiZ->getHeight() != depth.getHeight()) {
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(texUnit));
+        m_hiZ.emplace(depth.getWidth(), depth.getHeight(), GL_R32F, hiZSampling);
+        m_hiZ->setDebugLabel("GpuCulling Hi-Z");
+    }
+
+    m_hiZSP->bind();
+    // level 0 is a copy of the depth buffer:
+    depth.bind(texUnit);
+    m_hiZSP->setUniform1i("u_depth", texUnit);
+    m_hiZSP->setUniform1i("u_fromDepth", 1);
+    m_hiZ->bindImage(1, GL_WRITE_ONLY, 0);
+    m_hiZSP->setUniform2i("u_destinationSize", depth.getWidth(), depth.getHeight());
+    renderer.dispatchCompute(groupCount(static_cast<std::size_t>(depth.getWidth()), hiZGroupSize),
+                             groupCount(static_cast<std::size_t>(depth.getHeight()), hiZGroupSize));
+    m_hiZSP->setUniform1i("u_fromDepth", 0);
+    for (GLint level = 1; level < m_hiZ->getMipLevelCount(); ++level) {
+        // every level reads what the previous dispatch wrote:
+        renderer.memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        const GLsizei sourceWidth = std::max(depth.getWidth() >> (level - 1), 1);
+        const GLsizei sourceHeight = std::max(depth.getHeight() >> (level - 1), 1);
+        const GLsizei width = std::max(depth.getWidth() >> level, 1);
+        const GLsizei height = std::max(depth.getHeight() >> level, 1);
+        m_hiZ->bindImage(0, GL_READ_ONLY, level - 1);
+        m_hiZ->bindImage(1, GL_WRITE_ONLY, level);
+        m_hiZSP->setUniform2i("u_sourceSize", sourceWidth, sourceHeight);
+        m_hiZSP->setUniform2i("u_destinationSize", width, height);
+        renderer.dispatchCompute(groupCount(static_cast<std::size_t>(width), hiZGroupSize),
+                                 groupCount(static_cast<std::size_t>(height), hiZGroupSize));
+    }
+    m_hiZSP->unbind();
+    // cull(..) samples the pyramid:
+    renderer.memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    m_hiZ_ndc_from_wc = ndc_from_wc;
+    m_hiZValid = true;
+}
+
+GpuCullingStats GpuCulling::getStats()
+{
+    pollReadbacks();
+    m_stats.objects = m_objectCount;
+    return m_stats;
+}
+
+void GpuCulling::pollReadbacks()
+{
+    // oldest first, so the statistics do not go back in time:
+    for (std::size_t i = 0; i < m_readbacks.size(); ++i) {
+        std::optional<Readback>& readback = m_readbacks[(m_nextReadback + i) % m_readbacks.size()];
+        if (!readback || !readback->fence || !readback->fence->isSignaled()) {
+            continue;
+        }
+        readback->fence.reset();
+        readback->buffer.bind();
+        const auto* visible = static_cast<const GLuint*>(readback->buffer.mapRange(0, sizeof(GLuint), GL_MAP_READ_BIT));
+        if (visible) {
+            m_stats.visible = *visible;
+            m_stats.occlusion = readback->occlusion;
+        }
+        readback->buffer.unmap();
+        readback->buffer.unbind();
+    }
+}
@@ -0,0 +1,319 @@
+#include "GpuMemoryRegistry.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "debug_utils.h"
+#include "gl_format_utils.h"
+
+#include "imgui.h"
+
+namespace {
+
+thread_local const GpuMemoryScope* currentScope = nullptr;
+
+std::size_t categoryIndex(GpuMemoryCategory category)
+{
+    ASSERT(category != GpuMemoryCategory::COUNT);
+    return static_cast<std::size_t>(category);
+}
+
+void writeJsonString(std::ostream& os, const std::string& s)
+{
+    os << '"';
+    for (char c : s) {
+        switch (c) {
+        case '"':  os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\t': os << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                os << ' ';
+            } else {
+                os << c;
+            }
+        }
+    }
+    os << '"';
+}
+
+}
+
+GpuMemoryRegistry &GpuMemoryRegistry::shared()
+{
+    static GpuMemoryRegistry registry;
+    return registry;
+}
+
+std::uint64_t GpuMemoryRegistry::registerAllocation(GpuMemoryCategory category, std::size_t bytes)
+{
+    GpuAllocationInfo info;
+    info.category = category;
+    info.bytes = bytes;
+    if (const GpuMemoryScope* scope = GpuMemoryScope::current()) {
+        info.scope = scope->getPath();
+        info.site = scope->getSite();
+    }
+
+    std::lock_guard lock(m_mutex);
+    info.id = m_nextId++;
+    GpuMemoryCategoryStats& stats = m_categoryStats[categoryIndex(category)];
+    stats.liveBytes += bytes;
+    stats.liveCount += 1;
+    stats.highWaterBytes = std::max(stats.highWaterBytes, stats.liveBytes);
+    stats.allocationsTotal += 1;
+    m_liveBytes += bytes;
+    m_highWaterBytes = std::max(m_highWaterBytes, m_liveBytes);
+    const std::uint64_t id = info.id;
+    m_allocations.emplace(id, std::move(info));
+    return id;
+}
+
+void GpuMemoryRegistry::updateAllocation(std::uint64_t id, std::size_t bytes)
+{
+    if (id == 0) {
+        return;
+    }
+    std::lock_guard lock(m_mutex);
+    auto search = m_allocations.find(id);
+    ASSERT(search != m_allocations.end());
+    GpuAllocationInfo& info = search->second;
+    GpuMemoryCategoryStats& stats = m_categoryStats[categoryIndex(info.category)];
+    stats.liveBytes = stats.liveBytes - info.bytes + bytes;
+    stats.highWaterBytes = std::max(stats.highWaterBytes, stats.liveBytes);
+    m_liveBytes = m_liveBytes - info.bytes + bytes;
+    m_highWaterBytes = std::max(m_highWaterBytes, m_liveBytes);
+    info.bytes = bytes;
+}
+
+void GpuMemoryRegistry::setCategory(std::uint64_t id, GpuMemoryCategory category)
+{
+    if (id == 0) {
+        return;
+    }
+    std::lock_guard lock(m_mutex);
+    auto search = m_allocations.find(id);
+    ASSERT(search != m_allocations.end());
+    GpuAllocationInfo& info = search->second;
+    GpuMemoryCategoryStats& from = m_categoryStats[categoryIndex(info.category)];
+    GpuMemoryCategoryStats& to = m_categoryStats[categoryIndex(category)];
+    from.liveBytes -= info.bytes;
+    from.liveCount -= 1;
+    from.allocationsTotal -= 1;
+    to.liveBytes += info.bytes;
+    to.liveCount += 1;
+    to.highWaterBytes = std::max(to.highWaterBytes, to.liveBytes);
+    to.allocationsTotal += 1;
+    info.category = category;
+}
+
+void GpuMemoryRegistry::setLabel(std::uint64_t id, std::string label)
+{
+    if (id == 0) {
+        return;
+    }
+    std::lock_guard lock(m_mutex);
+    auto search = m_allocations.find(id);
+    ASSERT(search != m_allocations.end());
+    search->second.label = std::move(label);
+}
+
+void GpuMemoryRegistry::unregisterAllocation(std::uint64_t id)
+{
+    if (id == 0) {
+        return;
+    }
+    std::lock_guard lock(m_mutex);
+    auto search = m_allocations.find(id);
+    ASSERT(search != m_allocations.end());
+    const GpuAllocationInfo& info = search->second;
+    GpuMemoryCategoryStats& stats = m_categoryStats[categoryIndex(info.category)];
+    stats.liveBytes -= info.bytes;
+    stats.liveCount -= 1;
+    m_liveBytes -= info.bytes;
+    m_allocations.erase(search);
+}
+
+GpuMemoryCategoryStats GpuMemoryRegistry::getStats(GpuMemoryCategory category) const
+{
+    std::lock_guard lock(m_mutex);
+    return m_categoryStats[categoryIndex(category)];
+}
+
+std::size_t GpuMemoryRegistry::getLiveBytes() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_liveBytes;
+}
+
+std::size_t GpuMemoryRegistry::getHighWaterBytes() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_highWaterBytes;
+}
+
+void GpuMemoryRegistry::resetHighWaterMarks()
+{
+    std::lock_guard lock(m_mutex);
+    for (GpuMemoryCategoryStats& stats : m_categoryStats) {
+        stats.highWaterBytes = stats.liveBytes;
+    }
+    m_highWaterBytes = m_liveBytes;
+}
+
+std::uint64_t GpuMemoryRegistry::getNextId() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_nextId;
+}
+
+std::vector<GpuAllocationInfo> GpuMemoryRegistry::getAllocations(std::uint64_t firstId) const
+{
+    std::vector<GpuAllocationInfo> allocations;
+    {
+        std::lock_guard lock(m_mutex);
+        for (const auto& [id, info] : m_allocations) {
+            if (id >= firstId) {
+                allocations.push_back(info);
+            }
+        }
+    }
+    std::sort(allocations.begin(), allocations.end(), [](const GpuAllocationInfo& a, const GpuAllocationInfo& b) {
+        return a.id < b.id;
+    });
+    return allocations;
+}
+
+void GpuMemoryRegistry::writeJson(std::ostream &os) const
+{
+    std::vector<GpuAllocationInfo> allocations = getAllocations();
+    std::lock_guard lock(m_mutex);
+    os << "{\n  \"liveBytes\": " << m_liveBytes << ",\n  \"highWaterBytes\": " << m_highWaterBytes
+       << ",\n  \"categories\": [\n";
+    for (std::size_t i = 0; i < categoryCount; ++i) {
+        const GpuMemoryCategoryStats& stats = m_categoryStats[i];
+        os << "    {\"name\": \"" << getCategoryName(static_cast<GpuMemoryCategory>(i))
+           << "\", \"liveBytes\": " << stats.liveBytes << ", \"liveCount\": " << stats.liveCount
+           << ", \"highWaterBytes\": " << stats.highWaterBytes << ", \"allocationsTotal\": " << stats.allocationsTotal
+           << ((i + 1 < categoryCount) ? "},\n" : "}\n");
+    }
+    os << "  ],\n  \"allocations\": [\n";
+    for (std::size_t i = 0; i < allocations.size(); ++i) {
+        const GpuAllocationInfo& info = allocations[i];
+        os << "    {\"id\": " << info.id << ", \"category\": \"" << getCategoryName(info.category)
+           << "\", \"bytes\": " << info.bytes << ", \"label\": ";
+        writeJsonString(os, info.label);
+        os << ", \"scope\": ";
+        writeJsonString(os, info.scope);
+        os << ", \"file\": ";
+        writeJsonString(os, info.site.file);
+        os << ", \"line\": " << info.site.line << ((i + 1 < allocations.size()) ? "},\n" : "}\n");
+    }
+    os << "  ]\n}\n";
+}
+
+void GpuMemoryRegistry::OnImGuiRender()
+{
+    constexpr double MiB = 1024. * 1024.;
+    if (!ImGui::CollapsingHeader("GPU memory")) {
+        return;
+    }
+    ImGui::Text("live: %.1f MiB, high-water mark: %.1f MiB", static_cast<double>(getLiveBytes()) / MiB,
+                static_cast<double>(getHighWaterBytes()) / MiB);
+    ImGui::Columns(4, "gpu memory categories");
+    ImGui::Text("category");
+    ImGui::NextColumn();
+    ImGui::Text("live objects");
+    ImGui::NextColumn();
+    ImGui::Text("live MiB");
+    ImGui::NextColumn();
+    ImGui::Text("high-water MiB");
+    ImGui::NextColumn();
+    for (std::size_t i = 0; i < categoryCount; ++i) {
+        const GpuMemoryCategory category = static_cast<GpuMemoryCategory>(i);
+        const GpuMemoryCategoryStats stats = getStats(category);
+        ImGui::Text("%s", getCategoryName(category));
+        ImGui::NextColumn();
+        ImGui::Text("%zu", stats.liveCount);
+        ImGui::NextColumn();
+        ImGui::Text("%.2f", static_cast<double>(stats.liveBytes) / MiB);
+        ImGui::NextColumn();
+        ImGui::Text("%.2f", static_cast<double>(stats.highWaterBytes) / MiB);
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    if (ImGui::TreeNode("largest allocations")) {
+        std::vector<GpuAllocationInfo> allocations = getAllocations();
+        const std::size_t shown = std::min(allocations.size(), static_cast<std::size_t>(20));
+        std::partial_sort(allocations.begin(), allocations.begin() + static_cast<std::ptrdiff_t>(shown), allocations.end(),
+                          [](const GpuAllocationInfo& a, const GpuAllocationInfo& b) {
+            return a.bytes > b.bytes;
+        });
+        for (std::size_t i = 0; i < shown; ++i) {
+            const GpuAllocationInfo& info = allocations[i];
+            ImGui::BulletText("%.2f MiB %s %s [%s] %s:%d", static_cast<double>(info.bytes) / MiB,
+                              getCategoryName(info.category), info.label.c_str(), info.scope.c_str(),
+                              info.site.file, info.site.line);
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::Button("write gpu_memory.json")) {
+        std::ofstream file("gpu_memory.json");
+        writeJson(file);
+        std::cout << "wrote gpu_memory.json\n";
+    }
+}
+
+const char *GpuMemoryRegistry::getCategoryName(GpuMemoryCategory category)
+{
+    switch (category) {
+    case GpuMemoryCategory::VERTEX_BUFFER: return "vertex buffer";
+    case GpuMemoryCategory::INDEX_BUFFER:  return "index buffer";
+    case GpuMemoryCategory::OTHER_BUFFER:  return "other buffer";
+    case GpuMemoryCategory::TEXTURE:       return "texture";
+    case GpuMemoryCategory::RENDER_TARGET: return "render target";
+    case GpuMemoryCategory::FRAMEBUFFER:   return "framebuffer";
+    case GpuMemoryCategory::COUNT:         break;
+    }
+    return "(invalid)";
+}
+
+std::size_t GpuMemoryRegistry::estimateTextureBytes(GLenum internalformat, GLsizei width, GLsizei height,
+                                                    GLsizei layers, GLsizei mipLevels, GLsizei samples)
+{
+    const GLFormatSize size = getGLFormatSize(internalformat);
+    std::size_t bytes = 0;
+    for (GLsizei level = 0; level < mipLevels; ++level) {
+        const std::size_t w = static_cast<std::size_t>(std::max(width >> level, 1));
+        const std::size_t h = static_cast<std::size_t>(std::max(height >> level, 1));
+        if (size.blockBytes != 0) {
+            bytes += ((w + 3) / 4) * ((h + 3) / 4) * size.blockBytes;
+        } else {
+            bytes += w * h * size.bitsPerPixel / 8;
+        }
+    }
+    return bytes * static_cast<std::size_t>(layers) * static_cast<std::size_t>(samples);
+}
+
+GpuMemoryScope::GpuMemoryScope(std::string label, SourceLocation site)
+    : m_site(site),
+      m_parent(currentScope)
+{
+    m_path = m_parent ? m_parent->m_path + "/" + label : std::move(label);
+    currentScope = this;
+}
+
+GpuMemoryScope::~GpuMemoryScope()
+{
+    ASSERT(currentScope == this); // scopes have to be destroyed in reverse order
+    currentScope = m_parent;
+}
+
+const GpuMemoryScope *GpuMemoryScope::current()
+{
+    return currentScope;
+}
@@ -0,0 +1,363 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <utility> // for std::move(..)
+
+#include "debug_utils.h"
+
+#include "imgui.h"
+
+GpuProfiler::~GpuProfiler()
+{
+    // docs.gl: "Unused names in ids are silently ignored, as is the value zero."
+    glDeleteQueries(static_cast<GLsizei>(m_allQueries.size()), m_allQueries.data());
+}
+
+void GpuProfiler::beginFrame()
+{
+    ASSERT(!m_recording && m_openEvents.empty());
+    collect();
+    ++m_frameNumber;
+    if (!m_enabled) {
+        return;
+    }
+    if (m_framesInFlight.size() == framesInFlight) {
+        // the GPU is too far behind, do not wait for it
+        ++m_skippedFrames;
+        return;
+    }
+    m_recording = true;
+    m_currentFrame.number = m_frameNumber;
+    m_currentFrame.events.clear();
+}
+
+void GpuProfiler::endFrame()
+{
+    ASSERT(m_openEvents.empty()); // every beginScope(..) needs an endScope()
+    if (m_recording && !m_currentFrame.events.empty()) {
+        m_framesInFlight.push_back(std::move(m_currentFrame));
+        m_currentFrame = Frame{};
+    }
+    m_recording = false;
+}
+
+void GpuProfiler::beginScope(std::string_view name)
+{
+    m_currentScope = getScope(name);
+    if (m_recording) {
+        Event event;
+        event.scope = m_currentScope;
+        event.beginQuery = acquireQuery();
+        glQueryCounter(event.beginQuery, GL_TIMESTAMP);
+        m_openEvents.push_back(m_currentFrame.events.size());
+        m_currentFrame.events.push_back(event);
+    } else {
+        m_openEvents.push_back(invalidIndex);
+    }
+}
+
+void GpuProfiler::endScope()
+{
+    ASSERT(!m_openEvents.empty() && m_currentScope != invalidIndex);
+    const std::size_t event = m_openEvents.back();
+    m_openEvents.pop_back();
+    if (event != invalidIndex) {
+        const GLuint query = acquireQuery();
+        glQueryCounter(query, GL_TIMESTAMP);
+        m_currentFrame.events[event].endQuery = query;
+    }
+    m_currentScope = m_scopes[m_currentScope].parent;
+}
+
+void GpuProfiler::flush()
+{
+    ASSERT(!m_recording);
+    if (m_framesInFlight.empty()) {
+        return;
+    }
+    glFinish();
+    collect();
+    ASSERT(m_framesInFlight.empty());
+}
+
+void GpuProfiler::setTraceFrameCount(std::size_t count)
+{
+    m_traceFrameCount = count;
+    while (m_resolvedFrames.size() > m_traceFrameCount) {
+        m_resolvedFrames.pop_front();
+    }
+}
+
+std::vector<double> GpuProfiler::getFrameTimes_ms(std::string_view path) const
+{
+    const auto scope = std::find_if(m_scopes.begin(), m_scopes.end(),
+                                    [&](const Scope& s) { return s.path == path; });
+    std::vector<double> times_ms;
+    if (scope == m_scopes.end()) {
+        return times_ms;
+    }
+    const std::size_t scopeIndex = static_cast<std::size_t>(scope - m_scopes.begin());
+    for (const ResolvedFrame& frame : m_resolvedFrames) {
+        double time_ms = -1.;
+        for (const ResolvedEvent& event : frame.events) {
+            if (event.scope == scopeIndex) {
+                time_ms = std::max(time_ms, 0.) + static_cast<double>(event.end_ns - event.begin_ns) * 1e-6;
+            }
+        }
+        if (time_ms >= 0.) {
+            times_ms.push_back(time_ms);
+        }
+    }
+    return times_ms;
+}
+
+std::vector<GpuScopeStats> GpuProfiler::getScopeStats() const
+{
+    std::vector<GpuScopeStats> stats;
+    for (std::size_t scope : m_rootScopes) {
+        appendScopeStats(scope, stats);
+    }
+    return stats;
+}
+
+bool GpuProfiler::writeCsv(const std::filesystem::path &path) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "WARNING: could not open " << path << " for writing\n";
+        return false;
+    }
+    file << "frame,path,depth,begin_us,duration_us\n";
+    for (const ResolvedFrame& frame : m_resolvedFrames) {
+        const GLuint64 frameBegin_ns = frame.events.front().begin_ns;
+        for (const ResolvedEvent& event : frame.events) {
+            const Scope& scope = m_scopes[event.scope];
+            file << frame.number << ',' << scope.path << ',' << scope.depth << ','
+                 << static_cast<double>(event.begin_ns - frameBegin_ns) * 1e-3 << ','
+                 << static_cast<double>(event.end_ns - event.begin_ns) * 1e-3 << '\n';
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+bool GpuProfiler::writeChromeTrace(const std::filesystem::path &path) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "WARNING: could not open " << path << " for writing\n";
+        return false;
+    }
+    // complete events ("ph": "X") on one thread, the viewer nests them by their time intervals:
+    file << "{\"traceEvents\": [\n"
+            "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"GPU\"}}";
+    const GLuint64 origin_ns = m_resolvedFrames.empty() ? 0 : m_resolvedFrames.front().events.front().begin_ns;
+    for (const ResolvedFrame& frame : m_resolvedFrames) {
+        for (const ResolvedEvent& event : frame.events) {
+            const Scope& scope = m_scopes[event.scope];
+            // (scope names are C++ identifiers or plain text that needs no escaping)
+            file << ",\n  {\"name\": \"" << scope.name << "\", \"cat\": \"gpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1"
+                 << ", \"ts\": " << static_cast<double>(event.begin_ns - origin_ns) * 1e-3
+                 << ", \"dur\": " << static_cast<double>(event.end_ns - event.begin_ns) * 1e-3
+                 << ", \"args\": {\"frame\": " << frame.number << ", \"path\": \"" << scope.path << "\"}}";
+        }
+    }
+    file << "\n], \"displayTimeUnit\": \"ms\"}\n";
+    return static_cast<bool>(file);
+}
+
+void GpuProfiler::OnImGuiRender()
+{
+    ImGui::SetNextWindowBgAlpha(.75f);
+    if (!ImGui::Begin("GPU profiler")) {
+        ImGui::End();
+        return;
+    }
+    ImGui::Checkbox("enabled", &m_enabled);
+    ImGui::SameLine();
+    ImGui::Text("(%zu frames skipped)", m_skippedFrames);
+
+    ImGui::Columns(4, "gpu profiler scopes");
+    ImGui::Text("scope");
+    ImGui::NextColumn();
+    ImGui::Text("last ms");
+    ImGui::NextColumn();
+    ImGui::Text("average ms");
+    ImGui::NextColumn();
+    ImGui::Text("max ms");
+    ImGui::NextColumn();
+    for (std::size_t scope : m_rootScopes) {
+        renderScopeRow(scope);
+    }
+    ImGui::Columns(1);
+
+    if (ImGui::Button("write gpu_profile.csv")) {
+        if (writeCsv("gpu_profile.csv")) {
+            std::cout << "wrote gpu_profile.csv\n";
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("write gpu_trace.json")) {
+        if (writeChromeTrace("gpu_trace.json")) {
+            std::cout << "wrote gpu_trace.json\n";
+        }
+    }
+    ImGui::End();
+}
+
+std::size_t GpuProfiler::getScope(std::string_view name)
+{
+    // children of the current scope are looked up without building the path:
+    const std::vector<std::size_t>& siblings = (m_currentScope == invalidIndex) ? m_rootScopes
+                                                                                : m_scopes[m_currentScope].children;
+    for (std::size_t sibling : siblings) {
+        if (m_scopes[sibling].name == name) {
+            return sibling;
+        }
+    }
+
+    Scope scope;
+    scope.name = std::string(name);
+    scope.parent = m_currentScope;
+    if (m_currentScope == invalidIndex) {
+        scope.path = scope.name;
+        scope.depth = 0;
+    } else {
+        scope.path = m_scopes[m_currentScope].path + "/" + scope.name;
+        scope.depth = m_scopes[m_currentScope].depth + 1;
+    }
+    const std::size_t index = m_scopes.size();
+    m_scopes.push_back(std::move(scope));
+    if (m_currentScope == invalidIndex) {
+        m_rootScopes.push_back(index);
+    } else {
+        m_scopes[m_currentScope].children.push_back(index);
+    }
+    return index;
+}
+
+GLuint GpuProfiler::acquireQuery()
+{
+    if (m_freeQueries.empty()) {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        m_allQueries.push_back(query);
+        return query;
+    }
+    const GLuint query = m_freeQueries.back();
+    m_freeQueries.pop_back();
+    return query;
+}
+
+void GpuProfiler::collect()
+{
+    while (!m_framesInFlight.empty()) {
+        const Frame& frame = m_framesInFlight.front();
+        // (checking only the last query would rely on queries completing in order)
+        const bool available = std::all_of(frame.events.begin(), frame.events.end(), [](const Event& event) {
+            GLint endAvailable = GL_FALSE;
+            glGetQueryObjectiv(event.endQuery, GL_QUERY_RESULT_AVAILABLE, &endAvailable);
+            return endAvailable == GL_TRUE;
+        });
+        if (!available) {
+            // newer frames are not done either
+            break;
+        }
+        resolve(frame);
+        for (const Event& event : frame.events) {
+            m_freeQueries.push_back(event.beginQuery);
+            m_freeQueries.push_back(event.endQuery);
+        }
+        m_framesInFlight.pop_front();
+    }
+}
+
+void GpuProfiler::resolve(const Frame &frame)
+{
+    ResolvedFrame resolved;
+    resolved.number = frame.number;
+    std::vector<double> frameTimes_ms(m_scopes.size(), -1.);
+    for (const Event& event : frame.events) {
+        ResolvedEvent result{event.scope, 0, 0};
+        // available, so this does not wait:
+        glGetQueryObjectui64v(event.beginQuery, GL_QUERY_RESULT, &result.begin_ns);
+        glGetQueryObjectui64v(event.endQuery, GL_QUERY_RESULT, &result.end_ns);
+        result.end_ns = std::max(result.end_ns, result.begin_ns);
+        double& time_ms = frameTimes_ms[event.scope];
+        time_ms = std::max(time_ms, 0.) + static_cast<double>(result.end_ns - result.begin_ns) * 1e-6;
+        resolved.events.push_back(result);
+    }
+
+    for (std::size_t s = 0; s < frameTimes_ms.size(); ++s) {
+        if (frameTimes_ms[s] < 0.) {
+            continue; // not entered in this frame
+        }
+        Scope& scope = m_scopes[s];
+        scope.last_ms = frameTimes_ms[s];
+        scope.samples_ms[scope.nextSample] = scope.last_ms;
+        scope.nextSample = (scope.nextSample + 1) % averageWindow;
+        scope.sampleCount = std::min(scope.sampleCount + 1, averageWindow);
+    }
+
+    m_resolvedFrames.push_back(std::move(resolved));
+    if (m_resolvedFrames.size() > m_traceFrameCount) {
+        m_resolvedFrames.pop_front();
+    }
+}
+
+void GpuProfiler::appendScopeStats(std::size_t scope, std::vector<GpuScopeStats> &stats) const
+{
+    const Scope& s = m_scopes[scope];
+    if (s.sampleCount == 0) {
+        return; // (children can only have results if their parent has)
+    }
+    stats.push_back(makeStats(s));
+    for (std::size_t child : s.children) {
+        appendScopeStats(child, stats);
+    }
+}
+
+GpuScopeStats GpuProfiler::makeStats(const Scope &scope)
+{
+    GpuScopeStats stats;
+    stats.path = scope.path;
+    stats.name = scope.name;
+    stats.depth = scope.depth;
+    stats.last_ms = scope.last_ms;
+    stats.average_ms = 0.;
+    stats.max_ms = 0.;
+    for (std::size_t i = 0; i < scope.sampleCount; ++i) {
+        stats.average_ms += scope.samples_ms[i];
+        stats.max_ms = std::max(stats.max_ms, scope.samples_ms[i]);
+    }
+    if (scope.sampleCount > 0) {
+        stats.average_ms /= static_cast<double>(scope.sampleCount);
+    }
+    return stats;
+}
+
+void GpuProfiler::renderScopeRow(std::size_t scope) const
+{
+    const Scope& s = m_scopes[scope];
+    if (s.sampleCount == 0) {
+        return;
+    }
+    const GpuScopeStats stats = makeStats(s);
+    const ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen
+            | (s.children.empty() ? ImGuiTreeNodeFlags_Leaf : 0);
+    const bool open = ImGui::TreeNodeEx(s.path.c_str(), flags, "%s", s.name.c_str());
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", stats.last_ms);
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", stats.average_ms);
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", stats.max_ms);
+    ImGui::NextColumn();
+    if (open) {
+        for (std::size_t child : s.children) {
+            renderScopeRow(child);
+        }
+        ImGui::TreePop();
+    }
+}
@@ -0,0 +1,155 @@
+#include "HeadlessContext.h"
+
+#ifdef OPENGL_DEMOS_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring> // for std::strstr(..)
+#include <string> // for std::to_string(..)
+
+namespace {
+
+bool hasExtension(const char* extensions, const char* name)
+{
+    // (names can be prefixes of other names, e.g. EGL_KHR_image and EGL_KHR_image_base)
+    const std::size_t length = std::strlen(name);
+    for (const char* found = extensions ? std::strstr(extensions, name) : nullptr; found;
+         found = std::strstr(found + length, name)) {
+        const bool startsWord = (found == extensions || found[-1] == ' ');
+        const bool endsWord = (found[length] == ' ' || found[length] == '\0');
+        if (startsWord && endsWord) {
+            return true;
+        }
+    }
+    return false;
+}
+
+EGLDisplay getDisplay()
+{
+    // prefer the surfaceless platform of Mesa, which needs neither X11/Wayland nor a GPU:
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                    eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY) {
+                return display;
+            }
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+}
+
+HeadlessContext::HeadlessContext(int width, int height, int majorVersion, int minorVersion, bool debug)
+{
+    EGLDisplay display = getDisplay();
+    if (display == EGL_NO_DISPLAY || eglInitialize(display, nullptr, nullptr) != EGL_TRUE) {
+        m_error = "no EGL display";
+        return;
+    }
+    m_display = display;
+    if (eglBindAPI(EGL_OPENGL_API) != EGL_TRUE) {
+        m_error = "EGL implementation does not support desktop OpenGL";
+        return;
+    }
+
+    // a pbuffer surface gives the demos a default framebuffer to render to:
+    const EGLint pbufferConfigAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    const EGLint anyConfigAttribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    const bool pbufferConfig = eglChooseConfig(display, pbufferConfigAttribs, &config, 1, &configCount) == EGL_TRUE
+            && configCount > 0;
+    if (!pbufferConfig) {
+        configCount = 0;
+        // (the surfaceless platform may not have any config with a surface type)
+        if (eglChooseConfig(display, anyConfigAttribs, &config, 1, &configCount) != EGL_TRUE || configCount == 0) {
+            config = nullptr;
+        }
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+        EGL_CONTEXT_MINOR_VERSION, minorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_CONTEXT_OPENGL_DEBUG, debug ? EGL_TRUE : EGL_FALSE,
+        EGL_NONE
+    };
+    // EGL_NO_CONFIG_KHR (nullptr) requires EGL_KHR_no_config_context:
+    const char* displayExtensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!config && !hasExtension(displayExtensions, "EGL_KHR_no_config_context")) {
+        m_error = "no EGL config for desktop OpenGL";
+        return;
+    }
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        m_error = "could not create an OpenGL " + std::to_string(majorVersion) + "." + std::to_string(minorVersion)
+                + " core profile context";
+        return;
+    }
+
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (pbufferConfig) {
+        const EGLint surfaceAttribs[] = {
+            EGL_WIDTH, width,
+            EGL_HEIGHT, height,
+            EGL_NONE
+        };
+        surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+    }
+    if (surface == EGL_NO_SURFACE && !hasExtension(displayExtensions, "EGL_KHR_surfaceless_context")) {
+        eglDestroyContext(display, context);
+        m_error = "could neither create a pbuffer nor use a surfaceless context";
+        return;
+    }
+    if (eglMakeCurrent(display, surface, surface, context) != EGL_TRUE) {
+        if (surface != EGL_NO_SURFACE) {
+            eglDestroySurface(display, surface);
+        }
+        eglDestroyContext(display, context);
+        m_error = "could not make the OpenGL context current";
+        return;
+    }
+    m_context = context;
+    m_surface = (surface != EGL_NO_SURFACE) ? surface : nullptr;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    if (!m_display) {
+        return;
+    }
+    EGLDisplay display = m_display;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_surface) {
+        eglDestroySurface(display, m_surface);
+    }
+    if (m_context) {
+        eglDestroyContext(display, m_context);
+    }
+    eglTerminate(display);
+}
+
+#else
+
+HeadlessContext::HeadlessContext(int /*width*/, int /*height*/, int /*majorVersion*/, int /*minorVersion*/,
+                                 bool /*debug*/)
+    : m_error("built without EGL (cmake did not find OpenGL::EGL)")
+{}
+
+HeadlessContext::~HeadlessContext()
+{}
+
+#endif
@@ -0,0 +1,257 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric> // for std::iota(..)
+#include <utility> // for std::move(..)
+
+#include "debug_utils.h"
+
+RenderGraphBuilder::RenderGraphBuilder(RenderGraph &graph, std::size_t pass)
+    : m_graph(graph),
+      m_pass(pass)
+{}
+
+RGTexture RenderGraphBuilder::createTexture(std::string name, const RenderTargetDesc &desc)
+{
+    ASSERT(0 < desc.width && 0 < desc.height && 1 <= desc.samples);
+    RenderGraph::TextureEntry entry;
+    entry.name = std::move(name);
+    entry.desc = desc;
+    m_graph.m_textures.push_back(std::move(entry));
+    return RGTexture{m_graph.m_textures.size() - 1};
+}
+
+void RenderGraphBuilder::read(RGTexture texture)
+{
+    ASSERT(texture.index < m_graph.m_textures.size());
+    m_graph.m_passes[m_pass].reads.push_back(texture.index);
+}
+
+void RenderGraphBuilder::writeColor(RGTexture texture)
+{
+    ASSERT(texture.index < m_graph.m_textures.size());
+    m_graph.m_passes[m_pass].colorWrites.push_back(texture.index);
+}
+
+void RenderGraphBuilder::writeDepth(RGTexture texture)
+{
+    ASSERT(texture.index < m_graph.m_textures.size());
+    ASSERT(m_graph.m_passes[m_pass].depthWrite == RenderGraph::invalidIndex); // only one depth attachment
+    m_graph.m_passes[m_pass].depthWrite = texture.index;
+}
+
+void RenderGraphBuilder::writeStorage(RGTexture texture)
+{
+    ASSERT(texture.index < m_graph.m_textures.size());
+    m_graph.m_passes[m_pass].storageWrites.push_back(texture.index);
+}
+
+void RenderGraphBuilder::setSideEffects()
+{
+    m_graph.m_passes[m_pass].sideEffects = true;
+}
+
+void RenderGraph::clear()
+{
+    m_textures.clear();
+    m_passes.clear();
+    m_compiled = false;
+    m_executionOrder.clear();
+    m_physicalDescs.clear();
+    m_physicalLastUse.clear();
+}
+
+RenderGraphBuilder RenderGraph::beginPass(std::string name, ExecuteFunction execute)
+{
+    m_compiled = false;
+    PassEntry entry;
+    entry.name = std::move(name);
+    entry.execute = std::move(execute);
+    m_passes.push_back(std::move(entry));
+    return RenderGraphBuilder(*this, m_passes.size() - 1);
+}
+
+bool RenderGraph::compile()
+{
+    m_compiled = false;
+    m_executionOrder.clear();
+    m_physicalDescs.clear();
+    m_physicalLastUse.clear();
+
+    // 1. every texture has to be written before it is read:
+    std::vector<bool> written(m_textures.size(), false);
+    for (const PassEntry& pass : m_passes) {
+        for (std::size_t texture : pass.reads) {
+            if (!written[texture]) {
+                std::cerr << "WARNING: render graph pass " << pass.name << " reads texture "
+                          << m_textures[texture].name << " before any pass writes it\n";
+                return false;
+            }
+        }
+        for (std::size_t texture : getWrittenTextures(pass)) {
+            written[texture] = true;
+        }
+    }
+
+    // 2. cull passes from the back: a pass is needed if it has side effects or writes a texture
+    //    that a later needed pass reads
+    std::vector<bool> isRead(m_textures.size(), false);
+    for (std::size_t p = m_passes.size(); p-- > 0;) {
+        PassEntry& pass = m_passes[p];
+        std::vector<std::size_t> writes = getWrittenTextures(pass);
+        pass.culled = !pass.sideEffects && std::none_of(writes.begin(), writes.end(), [&isRead](std::size_t texture) {
+            return isRead[texture];
+        });
+        if (!pass.culled) {
+            for (std::size_t texture : pass.reads) {
+                isRead[texture] = true;
+            }
+        }
+    }
+
+    // 3. the passes that are left run in the order they were added, which is a valid
+    //    order because of 1. Lifetimes are intervals in that order:
+    for (TextureEntry& texture : m_textures) {
+        texture.firstUse = invalidIndex;
+        texture.lastUse = invalidIndex;
+        texture.physical = invalidIndex;
+    }
+    for (std::size_t p = 0; p < m_passes.size(); ++p) {
+        if (m_passes[p].culled) {
+            continue;
+        }
+        const std::size_t position = m_executionOrder.size();
+        m_executionOrder.push_back(p);
+        for (std::size_t texture : getUsedTextures(m_passes[p])) {
+            TextureEntry& entry = m_textures[texture];
+            if (entry.firstUse == invalidIndex) {
+                entry.firstUse = position;
+            }
+            entry.lastUse = position;
+        }
+    }
+
+    // 4. alias: in the order of their first use, textures take the first compatible
+    //    physical texture whose last user ran before (greedy interval coloring)
+    std::vector<std::size_t> byFirstUse(m_textures.size());
+    std::iota(byFirstUse.begin(), byFirstUse.end(), static_cast<std::size_t>(0));
+    std::stable_sort(byFirstUse.begin(), byFirstUse.end(), [this](std::size_t a, std::size_t b) {
+        return m_textures[a].firstUse < m_textures[b].firstUse;
+    });
+    for (std::size_t t : byFirstUse) {
+        TextureEntry& texture = m_textures[t];
+        if (texture.firstUse == invalidIndex) {
+            continue; // only used by culled passes (sorted last)
+        }
+        for (std::size_t physical = 0; physical < m_physicalDescs.size(); ++physical) {
+            if (m_physicalLastUse[physical] < texture.firstUse && isCompatible(m_physicalDescs[physical], texture.desc)) {
+                texture.physical = physical;
+                break;
+            }
+        }
+        if (texture.physical == invalidIndex) {
+            texture.physical = m_physicalDescs.size();
+            m_physicalDescs.push_back(texture.desc);
+            m_physicalLastUse.push_back(texture.lastUse);
+        }
+        m_physicalLastUse[texture.physical] = texture.lastUse;
+    }
+
+    m_compiled = true;
+    return true;
+}
+
+bool RenderGraph::isCulled(std::size_t pass) const
+{
+    ASSERT(pass < m_passes.size());
+    return m_passes[pass].culled;
+}
+
+std::size_t RenderGraph::getPhysicalTexture(RGTexture texture) const
+{
+    ASSERT(texture.index < m_textures.size());
+    return m_textures[texture.index].physical;
+}
+
+RenderGraphStats RenderGraph::getStats() const
+{
+    RenderGraphStats stats;
+    stats.passes = m_passes.size();
+    stats.culledPasses = m_passes.size() - m_executionOrder.size();
+    stats.textures = static_cast<std::size_t>(std::count_if(m_textures.begin(), m_textures.end(),
+                                                            [](const TextureEntry& texture) {
+        return texture.physical != invalidIndex;
+    }));
+    stats.physicalTextures = m_physicalDescs.size();
+    for (std::size_t pass : m_executionOrder) {
+        stats.bytesRead += getPassBytesRead(pass);
+        stats.bytesWritten += getPassBytesWritten(pass);
+    }
+    return stats;
+}
+
+const std::string &RenderGraph::getPassName(std::size_t pass) const
+{
+    ASSERT(pass < m_passes.size());
+    return m_passes[pass].name;
+}
+
+std::size_t RenderGraph::getPassBytesRead(std::size_t pass) const
+{
+    ASSERT(pass < m_passes.size());
+    std::size_t bytes = 0;
+    for (std::size_t texture : m_passes[pass].reads) {
+        bytes += getByteSize(texture);
+    }
+    return bytes;
+}
+
+std::size_t RenderGraph::getPassBytesWritten(std::size_t pass) const
+{
+    ASSERT(pass < m_passes.size());
+    std::size_t bytes = 0;
+    for (std::size_t texture : getWrittenTextures(m_passes[pass])) {
+        bytes += getByteSize(texture);
+    }
+    return bytes;
+}
+
+const std::string &RenderGraph::getTextureName(RGTexture texture) const
+{
+    ASSERT(texture.index < m_textures.size());
+    return m_textures[texture.index].name;
+}
+
+std::vector<std::size_t> RenderGraph::getWrittenTextures(const PassEntry &pass)
+{
+    std::vector<std::size_t> written = pass.colorWrites;
+    if (pass.depthWrite != invalidIndex) {
+        written.push_back(pass.depthWrite);
+    }
+    written.insert(written.end(), pass.storageWrites.begin(), pass.storageWrites.end());
+    return written;
+}
+
+std::vector<std::size_t> RenderGraph::getUsedTextures(const PassEntry &pass)
+{
+    std::vector<std::size_t> used = pass.reads;
+    std::vector<std::size_t> written = getWrittenTextures(pass);
+    used.insert(used.end(), written.begin(), written.end());
+    return used;
+}
+
+bool RenderGraph::isCompatible(const RenderTargetDesc &a, const RenderTargetDesc &b)
+{
+    return RenderTargetPool::roundUpToSizeClass(a.width) == RenderTargetPool::roundUpToSizeClass(b.width)
+            && RenderTargetPool::roundUpToSizeClass(a.height) == RenderTargetPool::roundUpToSizeClass(b.height)
+            && a.internalformat == b.internalformat
+            && a.samples == b.samples;
+}
+
+std::size_t RenderGraph::getByteSize(std::size_t texture) const
+{
+    const RenderTargetDesc& desc = m_textures[texture].desc;
+    return static_cast<std::size_t>(desc.width) * static_cast<std::size_t>(desc.height)
+            * static_cast<std::size_t>(desc.samples) * RenderTargetPool::estimateBytesPerPixel(desc.internalformat);
+}
@@ -0,0 +1,61 @@
+#include "RenderGraph.h"
+
+#include "debug_utils.h"
+
+RenderGraphContext::RenderGraphContext(RenderGraph &graph, GLRenderer &renderer, RenderTargetPool &pool,
+                                       GLFramebufferObject *framebuffer)
+    : m_graph(graph),
+      m_renderer(renderer),
+      m_pool(pool),
+      m_framebuffer(framebuffer)
+{}
+
+GLTexture &RenderGraphContext::getTexture(RGTexture texture)
+{
+    const std::size_t physical = m_graph.getPhysicalTexture(texture);
+    ASSERT(physical != RenderGraph::invalidIndex); // texture is not used by any pass that is executed
+    ASSERT(m_graph.m_physicalTextures[physical]);  // ... or not by this pass (it was released already)
+    return *m_graph.m_physicalTextures[physical];
+}
+
+void RenderGraph::execute(GLRenderer &renderer, RenderTargetPool &pool)
+{
+    ASSERT(m_compiled);
+    m_physicalTextures.assign(m_physicalDescs.size(), nullptr);
+    for (std::size_t physical = 0; physical < m_physicalDescs.size(); ++physical) {
+        m_physicalTextures[physical] = &pool.acquireTexture(m_physicalDescs[physical]);
+    }
+
+    for (std::size_t position = 0; position < m_executionOrder.size(); ++position) {
+        PassEntry& pass = m_passes[m_executionOrder[position]];
+
+        GLFramebufferObject* framebuffer = nullptr;
+        if (!pass.colorWrites.empty() || pass.depthWrite != invalidIndex) {
+            std::vector<const GLTexture*> colors;
+            for (std::size_t texture : pass.colorWrites) {
+                colors.push_back(m_physicalTextures[m_textures[texture].physical]);
+            }
+            const GLTexture* depth = (pass.depthWrite != invalidIndex)
+                    ? m_physicalTextures[m_textures[pass.depthWrite].physical] : nullptr;
+            framebuffer = &pool.acquireFramebuffer(colors, depth); // (binds it)
+        }
+
+        RenderGraphContext context(*this, renderer, pool, framebuffer);
+        {
+            GpuProfileScope profile(renderer.getProfiler(), pass.name);
+            pass.execute(context);
+        }
+
+        if (framebuffer) {
+            framebuffer->unbind();
+        }
+        // hand back textures after their last use (a later pass may acquire them from the pool directly):
+        for (std::size_t physical = 0; physical < m_physicalDescs.size(); ++physical) {
+            if (m_physicalLastUse[physical] == position) {
+                pool.release(*m_physicalTextures[physical]);
+                m_physicalTextures[physical] = nullptr;
+            }
+        }
+    }
+    m_physicalTextures.clear();
+}
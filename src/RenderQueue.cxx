@@ -0,0 +1,231 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring> // for std::memcpy(..)
+#include <iostream>
+
+#include "debug_utils.h"
+
+namespace {
+
+constexpr unsigned int passBits = 4;
+constexpr unsigned int programBits = 10;
+constexpr unsigned int materialBits = 14;
+constexpr unsigned int vertexArrayBits = 12;
+constexpr unsigned int depthBits = 24;
+static_assert(passBits + programBits + materialBits + vertexArrayBits + depthBits == 64);
+
+constexpr unsigned int depthShift = 0;
+constexpr unsigned int vertexArrayShift = depthShift + depthBits;
+constexpr unsigned int materialShift = vertexArrayShift + vertexArrayBits;
+constexpr unsigned int programShift = materialShift + materialBits;
+constexpr unsigned int passShift = programShift + programBits;
+
+constexpr std::uint32_t maxDepth24 = (1u << depthBits) - 1u;
+
+}
+
+RenderQueue::RenderQueue()
+    : m_sorted(false)
+{
+    m_backToFront.fill(false);
+}
+
+void RenderQueue::clear()
+{
+    m_items.clear();
+    m_keys.clear();
+    m_programIds.clear();
+    m_materialIds.clear();
+    m_vertexArrayIds.clear();
+    m_sorted = false;
+    m_stats = RenderQueueStats{};
+}
+
+void RenderQueue::add(unsigned int pass, const RenderMaterial &material, GLVertexArray &va, GLIndexBuffer &ib,
+                      const glm::mat4 &ndc_from_oc, float depth)
+{
+    ASSERT(pass < passCount);
+    ASSERT(material.program);
+    ASSERT(m_items.size() < UINT32_MAX);
+
+    std::uint32_t depth24 = quantizeDepth(depth);
+    if (m_backToFront[pass]) {
+        depth24 = maxDepth24 - depth24;
+    }
+    std::uint64_t key = makeSortKey(pass,
+                                    getId(m_programIds, material.program, (1u << programBits) - 1u),
+                                    getId(m_materialIds, &material, (1u << materialBits) - 1u),
+                                    getId(m_vertexArrayIds, &va, (1u << vertexArrayBits) - 1u),
+                                    depth24);
+    m_keys.push_back(KeyIndex{key, static_cast<std::uint32_t>(m_items.size())});
+    m_items.push_back(Item{&material, &va, &ib, ndc_from_oc});
+    m_sorted = false;
+}
+
+std::uint32_t RenderQueue::getId(std::unordered_map<const void *, std::uint32_t> &ids, const void *object,
+                                 std::uint32_t maxId)
+{
+    auto [it, inserted] = ids.try_emplace(object, static_cast<std::uint32_t>(ids.size()));
+    if (inserted && it->second > maxId) {
+        // only sorting gets worse, drawing is still correct:
+        DEBUG_DO(std::cerr << "WARNING: RenderQueue: more distinct objects in one frame than bits in the sort key\n");
+    }
+    return it->second & maxId;
+}
+
+void RenderQueue::submit(GLRenderer &renderer, unsigned int pass)
+{
+    ASSERT(pass < passCount);
+    if (!m_sorted) {
+        sort();
+    }
+
+    // the items of a pass are a contiguous range of the sorted keys:
+    auto byKey = [](const KeyIndex& a, const KeyIndex& b) { return a.key < b.key; };
+    auto begin = std::lower_bound(m_keys.begin(), m_keys.end(),
+                                  KeyIndex{static_cast<std::uint64_t>(pass) << passShift, 0}, byKey);
+    auto end = (pass + 1 < passCount)
+            ? std::lower_bound(begin, m_keys.end(),
+                               KeyIndex{static_cast<std::uint64_t>(pass + 1) << passShift, 0}, byKey)
+            : m_keys.end();
+    if (begin == end) {
+        return;
+    }
+
+    const RenderMaterial* material = nullptr;
+    GLShaderProgram* program = nullptr;
+    GLVertexArray* va = nullptr;
+    GLIndexBuffer* ib = nullptr;
+    GLint ndc_from_oc_location = -1;
+    for (auto it = begin; it != end; ++it) {
+        const Item& item = m_items[it->index];
+        if (item.material->program != program) {
+            program = item.material->program;
+            program->bind();
+            ndc_from_oc_location = program->getUniformLocation("u_ndc_from_oc");
+        }
+        if (item.material != material) {
+            material = item.material;
+            if (material->apply) {
+                material->apply(*program);
+            }
+        }
+        if (item.va != va) {
+            va = item.va;
+            va->bind();
+            ib = nullptr; // the element array binding is part of the vertex array state
+        }
+        if (item.ib != ib) {
+            ib = item.ib;
+            ib->bind();
+        }
+        program->setUniformMat4f(ndc_from_oc_location, item.ndc_from_oc);
+        renderer.drawBound(*ib);
+    }
+    // leave the same state behind as GLRenderer::draw(..):
+    program->unbind();
+    va->unbind();
+}
+
+void RenderQueue::sort()
+{
+    auto time_start = std::chrono::high_resolution_clock::now();
+    radixSort(m_keys, m_keysTmp);
+    auto time_end = std::chrono::high_resolution_clock::now();
+
+    // count the state changes in both orders
+    // (submit(..) starts with nothing bound in each pass, the passes are ignored for the unsorted order):
+    auto countChanges = [this](auto indexAt, auto passAt) {
+        RenderStateChanges changes;
+        const Item* prev = nullptr;
+        unsigned int prevPass = passCount;
+        for (std::size_t i = 0; i < m_items.size(); ++i) {
+            const Item& item = m_items[indexAt(i)];
+            if (passAt(i) != prevPass) {
+                prev = nullptr;
+                prevPass = passAt(i);
+            }
+            changes.programs += (!prev || prev->material->program != item.material->program) ? 1 : 0;
+            changes.materials += (!prev || prev->material != item.material) ? 1 : 0;
+            changes.vertexArrays += (!prev || prev->va != item.va) ? 1 : 0;
+            prev = &item;
+        }
+        return changes;
+    };
+    m_stats.items = m_items.size();
+    m_stats.unsorted = countChanges([](std::size_t i) { return i; },
+                                    [](std::size_t) { return 0u; });
+    m_stats.sorted = countChanges([this](std::size_t i) { return m_keys[i].index; },
+                                  [this](std::size_t i) { return static_cast<unsigned int>(m_keys[i].key >> passShift); });
+    m_stats.sort_ms = std::chrono::duration<float, std::milli>(time_end - time_start).count();
+    m_sorted = true;
+}
+
+std::uint32_t RenderQueue::quantizeDepth(float depth)
+{
+    // for positive floats the order of the bit patterns is the order of the values
+    // -> keeping the upper 24 bits (of 31) preserves the order with ~15 bits of mantissa:
+    if (!(depth > 0.f)) { // also catches NaN
+        return 0;
+    }
+    std::uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return std::min(bits >> (31 - depthBits), maxDepth24);
+}
+
+std::uint64_t RenderQueue::makeSortKey(unsigned int pass, std::uint32_t programId, std::uint32_t materialId,
+                                       std::uint32_t vertexArrayId, std::uint32_t depth24)
+{
+    ASSERT(pass < passCount);
+    ASSERT(programId < (1u << programBits));
+    ASSERT(materialId < (1u << materialBits));
+    ASSERT(vertexArrayId < (1u << vertexArrayBits));
+    ASSERT(depth24 <= maxDepth24);
+    return (static_cast<std::uint64_t>(pass) << passShift)
+            | (static_cast<std::uint64_t>(programId) << programShift)
+            | (static_cast<std::uint64_t>(materialId) << materialShift)
+            | (static_cast<std::uint64_t>(vertexArrayId) << vertexArrayShift)
+            | (static_cast<std::uint64_t>(depth24) << depthShift);
+}
+
+void RenderQueue::radixSort(std::vector<KeyIndex> &keys, std::vector<KeyIndex> &tmp)
+{
+    const std::size_t n = keys.size();
+    if (n < 2) {
+        return;
+    }
+    tmp.resize(n);
+
+    // histograms of all 8 digits in a single pass over the keys:
+    std::array<std::array<std::uint32_t, 256>, 8> counts{};
+    for (const KeyIndex& k : keys) {
+        for (unsigned int digit = 0; digit < 8; ++digit) {
+            ++counts[digit][(k.key >> (8 * digit)) & 0xFF];
+        }
+    }
+
+    KeyIndex* src = keys.data();
+    KeyIndex* dst = tmp.data();
+    for (unsigned int digit = 0; digit < 8; ++digit) {
+        std::array<std::uint32_t, 256>& count = counts[digit];
+        // all keys have the same digit -> the pass would not change the order:
+        if (count[(src[0].key >> (8 * digit)) & 0xFF] == n) {
+            continue;
+        }
+        std::uint32_t offset = 0;
+        for (std::uint32_t& c : count) {
+            std::uint32_t c_ = c;
+            c = offset;
+            offset += c_;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            dst[count[(src[i].key >> (8 * digit)) & 0xFF]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if (src != keys.data()) {
+        keys.swap(tmp);
+    }
+}
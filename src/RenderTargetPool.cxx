@@ -0,0 +1,217 @@
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+#include <array>
+#include <string>
+
+#include "debug_utils.h"
+#include "GpuMemoryRegistry.h"
+
+namespace {
+
+struct ColorFormat {
+    GLenum internalformat;
+    const char* name;
+    int channels;
+    bool hdr;
+    bool negative;
+    int precisionBits;
+};
+
+// candidates of RenderTargetPool::chooseFormat(..), sorted by size (see getGLFormatSize(..)):
+constexpr std::array<ColorFormat, 11> colorFormats = {{
+    {GL_R8,             "GL_R8",              1, false, false,  8},
+    {GL_RG8,            "GL_RG8",             2, false, false,  8},
+    {GL_R16F,           "GL_R16F",            1, true,  true,  10},
+    {GL_RGBA8,          "GL_RGBA8",           4, false, false,  8},
+    {GL_RGB10_A2,       "GL_RGB10_A2",        3, false, false, 10}, // (2 bit alpha is not counted as a channel)
+    {GL_R11F_G11F_B10F, "GL_R11F_G11F_B10F",  3, true,  false,  5}, // blue has 5 mantissa bits, red and green 6
+    {GL_RG16F,          "GL_RG16F",           2, true,  true,  10},
+    {GL_R32F,           "GL_R32F",            1, true,  true,  23},
+    {GL_RGBA16F,        "GL_RGBA16F",         4, true,  true,  10},
+    {GL_RG32F,          "GL_RG32F",           2, true,  true,  23},
+    {GL_RGBA32F,        "GL_RGBA32F",         4, true,  true,  23},
+}};
+
+}
+
+RenderTargetPool::RenderTargetPool(unsigned int evictAfterFrames)
+    : m_evictAfterFrames(evictAfterFrames),
+      m_frame(0),
+      m_allocationsTotal(0),
+      m_evictionsTotal(0)
+{}
+
+void RenderTargetPool::beginFrame()
+{
+    ++m_frame;
+
+    // evict textures that were not used for a while and the framebuffers referencing them:
+    std::vector<GLuint> evictedIds;
+    auto isStale = [this](std::uint64_t lastUsedFrame) {
+        return lastUsedFrame + m_evictAfterFrames < m_frame;
+    };
+    auto newTexturesEnd = std::remove_if(m_textures.begin(), m_textures.end(), [&](const TextureEntry& entry) {
+        if (!isStale(entry.lastUsedFrame)) {
+            return false;
+        }
+        evictedIds.push_back(entry.texture->getRendererId());
+        return true;
+    });
+    m_evictionsTotal += static_cast<std::size_t>(m_textures.end() - newTexturesEnd);
+    m_textures.erase(newTexturesEnd, m_textures.end());
+
+    // (the name of a deleted texture may be reused by the next texture
+    //  -> also drop framebuffers that still reference it)
+    auto references = [&evictedIds](GLuint id) {
+        return std::find(evictedIds.begin(), evictedIds.end(), id) != evictedIds.end();
+    };
+    m_framebuffers.erase(std::remove_if(m_framebuffers.begin(), m_framebuffers.end(), [&](const FramebufferEntry& entry) {
+        return isStale(entry.lastUsedFrame) || references(entry.depthId)
+                || std::any_of(entry.colorIds.begin(), entry.colorIds.end(), references);
+    }), m_framebuffers.end());
+
+    // everything acquired last frame can be handed out again:
+    for (TextureEntry& entry : m_textures) {
+        entry.inUse = false;
+    }
+}
+
+GLTexture &RenderTargetPool::acquireTexture(const RenderTargetDesc &desc)
+{
+    ASSERT(0 < desc.width && 0 < desc.height && 1 <= desc.samples);
+    const RenderTargetDesc classDesc{roundUpToSizeClass(desc.width), roundUpToSizeClass(desc.height),
+                                     desc.internalformat, desc.samples};
+    for (TextureEntry& entry : m_textures) {
+        if (!entry.inUse && entry.desc.width == classDesc.width && entry.desc.height == classDesc.height
+                && entry.desc.internalformat == classDesc.internalformat && entry.desc.samples == classDesc.samples) {
+            entry.inUse = true;
+            entry.lastUsedFrame = m_frame;
+            return *entry.texture;
+        }
+    }
+
+    GpuMemoryScope memoryScope("RenderTargetPool");
+    std::unique_ptr<GLTexture> texture;
+    if (classDesc.samples > 1) {
+        texture = std::make_unique<GLTexture>(classDesc.width, classDesc.height, classDesc.internalformat,
+                                              classDesc.samples);
+    } else {
+        texture = std::make_unique<GLTexture>(classDesc.width, classDesc.height, classDesc.internalformat,
+                                              texture_sampling_presets::noFilter);
+    }
+    texture->setMemoryCategory(GpuMemoryCategory::RENDER_TARGET);
+    texture->setDebugLabel(std::to_string(classDesc.width) + "x" + std::to_string(classDesc.height) + " "
+                           + getFormatName(classDesc.internalformat)
+                           + ((classDesc.samples > 1) ? " x" + std::to_string(classDesc.samples) : std::string()));
+    ++m_allocationsTotal;
+    m_textures.push_back(TextureEntry{std::move(texture), classDesc, true, m_frame});
+    return *m_textures.back().texture;
+}
+
+void RenderTargetPool::release(const GLTexture &texture)
+{
+    for (TextureEntry& entry : m_textures) {
+        if (entry.texture.get() == &texture) {
+            ASSERT(entry.inUse);
+            entry.inUse = false;
+            return;
+        }
+    }
+    ASSERT(false); // texture is not from this pool
+}
+
+GLFramebufferObject &RenderTargetPool::acquireFramebuffer(const std::vector<const GLTexture *> &colors,
+                                                          const GLTexture *depth)
+{
+    std::vector<GLuint> colorIds;
+    colorIds.reserve(colors.size());
+    for (const GLTexture* color : colors) {
+        colorIds.push_back(color->getRendererId());
+    }
+    const GLuint depthId = depth ? depth->getRendererId() : 0;
+
+    for (FramebufferEntry& entry : m_framebuffers) {
+        if (entry.colorIds == colorIds && entry.depthId == depthId) {
+            entry.lastUsedFrame = m_frame;
+            entry.fbo->bind();
+            return *entry.fbo;
+        }
+    }
+
+    GpuMemoryScope memoryScope("RenderTargetPool");
+    auto fbo = std::make_unique<GLFramebufferObject>();
+    fbo->bind();
+    std::vector<GLenum> drawBuffers;
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+        const GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i);
+        fbo->attachTexture(attachment, *colors[i]);
+        drawBuffers.push_back(attachment);
+    }
+    if (depth) {
+        fbo->attachTexture(GL_DEPTH_ATTACHMENT, *depth);
+    }
+    if (drawBuffers.empty()) {
+        drawBuffers.push_back(GL_NONE); // depth only
+    }
+    fbo->setDrawBuffers(drawBuffers);
+    ASSERT(fbo->checkFramebufferStatus() == GL_FRAMEBUFFER_COMPLETE);
+
+    m_framebuffers.push_back(FramebufferEntry{std::move(fbo), std::move(colorIds), depthId, m_frame});
+    return *m_framebuffers.back().fbo;
+}
+
+RenderTargetPoolStats RenderTargetPool::getStats() const
+{
+    RenderTargetPoolStats stats;
+    stats.textureCount = m_textures.size();
+    stats.framebufferCount = m_framebuffers.size();
+    for (const TextureEntry& entry : m_textures) {
+        stats.byteSize += static_cast<std::size_t>(entry.desc.width) * static_cast<std::size_t>(entry.desc.height)
+                * static_cast<std::size_t>(entry.desc.samples) * estimateBytesPerPixel(entry.desc.internalformat);
+    }
+    stats.allocationsTotal = m_allocationsTotal;
+    stats.evictionsTotal = m_evictionsTotal;
+    return stats;
+}
+
+GLenum RenderTargetPool::chooseFormat(const RenderTargetRequirements &requirements)
+{
+    ASSERT(1 <= requirements.channels && requirements.channels <= 4);
+    for (const ColorFormat& format : colorFormats) {
+        if (format.channels >= requirements.channels
+                && (format.hdr || !requirements.hdr)
+                && (format.negative || !requirements.negative)
+                && format.precisionBits >= requirements.precisionBits) {
+            return format.internalformat;
+        }
+    }
+    ASSERT(false); // more precision than GL_RGBA32F
+    return GL_RGBA32F;
+}
+
+int RenderTargetPool::getPrecisionBits(GLenum internalformat)
+{
+    for (const ColorFormat& format : colorFormats) {
+        if (format.internalformat == internalformat) {
+            return format.precisionBits;
+        }
+    }
+    return 0;
+}
+
+const char *RenderTargetPool::getFormatName(GLenum internalformat)
+{
+    for (const ColorFormat& format : colorFormats) {
+        if (format.internalformat == internalformat) {
+            return format.name;
+        }
+    }
+    switch (internalformat) {
+    case GL_SRGB8_ALPHA8:        return "GL_SRGB8_ALPHA8";
+    case GL_DEPTH_COMPONENT16:   return "GL_DEPTH_COMPONENT16";
+    case GL_DEPTH_COMPONENT24:   return "GL_DEPTH_COMPONENT24";
+    case GL_DEPTH24_STENCIL8:    return "GL_DEPTH24_STENCIL8";
+    default:                     return "(other)";
+    }
+}
@@ -0,0 +1,221 @@
+#include "SceneGraph.h"
+
+#include <algorithm> // for std::max(..), std::fill(..)
+#include <atomic>
+#include <type_traits> // for std::remove_reference_t<..>
+
+#include "debug_utils.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCENEGRAPH_USE_SSE2
+#endif
+
+namespace {
+
+// rotation and scale in the upper 3x3 block, translation in the last column
+glm::mat4 composeTransform(const glm::vec3& t, const glm::quat& q, const glm::vec3& s)
+{
+    const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    return glm::mat4(
+        glm::vec4((1.f - 2.f * (yy + zz)) * s.x, 2.f * (xy + wz) * s.x, 2.f * (xz - wy) * s.x, 0.f),
+        glm::vec4(2.f * (xy - wz) * s.y, (1.f - 2.f * (xx + zz)) * s.y, 2.f * (yz + wx) * s.y, 0.f),
+        glm::vec4(2.f * (xz + wy) * s.z, 2.f * (yz - wx) * s.z, (1.f - 2.f * (xx + yy)) * s.z, 0.f),
+        glm::vec4(t, 1.f));
+}
+
+// out = a * b (column major, out must not alias a or b)
+void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#ifdef SCENEGRAPH_USE_SSE2
+    const float* pa = &a[0][0];
+    const float* pb = &b[0][0];
+    float* po = &out[0][0];
+    const __m128 a0 = _mm_loadu_ps(pa);
+    const __m128 a1 = _mm_loadu_ps(pa + 4);
+    const __m128 a2 = _mm_loadu_ps(pa + 8);
+    const __m128 a3 = _mm_loadu_ps(pa + 12);
+    for (int col = 0; col < 4; ++col) {
+        // column col of the product: a * (column col of b)
+        const float* bc = pb + 4 * col;
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+        _mm_storeu_ps(po + 4 * col, r);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+} // namespace
+
+
+SceneGraph::NodeId SceneGraph::createNode(NodeId parent, const glm::vec3 &translation, const glm::quat &rotation, const glm::vec3 &scale)
+{
+    const auto node = static_cast<NodeId>(m_slotOfNode.size());
+    const auto slot = static_cast<std::uint32_t>(m_nodeOfSlot.size());
+    std::uint32_t parentSlot = noSlot;
+    std::uint32_t depth = 0;
+    if (parent != noParent) {
+        ASSERT(parent < m_slotOfNode.size());
+        parentSlot = m_slotOfNode[parent];
+        depth = m_depths[parentSlot] + 1;
+    }
+
+    m_slotOfNode.push_back(slot);
+    m_nodeOfSlot.push_back(node);
+    m_parentSlots.push_back(parentSlot);
+    m_depths.push_back(depth);
+    m_translations.push_back(translation);
+    m_rotations.push_back(rotation);
+    m_scales.push_back(scale);
+    m_worldTransforms.emplace_back(1.f);
+    m_dirty.push_back(1);
+
+    // appending keeps the slots sorted only if the depth does not decrease:
+    if (slot > 0 && depth < m_depths[slot - 1]) {
+        m_sorted = false;
+    }
+    if (m_sorted) {
+        if (depth + 1 >= m_levelBegin.size()) {
+            m_levelBegin.resize(depth + 2, slot);
+        }
+        m_levelBegin[depth + 1] = slot + 1;
+    }
+    return node;
+}
+
+void SceneGraph::setTranslation(NodeId node, const glm::vec3 &translation)
+{
+    m_translations[m_slotOfNode[node]] = translation;
+    markDirty(node);
+}
+
+void SceneGraph::setRotation(NodeId node, const glm::quat &rotation)
+{
+    m_rotations[m_slotOfNode[node]] = rotation;
+    markDirty(node);
+}
+
+void SceneGraph::setScale(NodeId node, const glm::vec3 &scale)
+{
+    m_scales[m_slotOfNode[node]] = scale;
+    markDirty(node);
+}
+
+SceneGraph::NodeId SceneGraph::getParent(NodeId node) const
+{
+    const std::uint32_t parentSlot = m_parentSlots[m_slotOfNode[node]];
+    return (parentSlot == noSlot) ? noParent : m_nodeOfSlot[parentSlot];
+}
+
+void SceneGraph::update(ThreadPool &pool)
+{
+    if (!m_sorted) {
+        sortByDepth();
+    }
+
+    std::atomic<std::size_t> updateCount = 0;
+    for (std::size_t depth = 0; depth + 1 < m_levelBegin.size(); ++depth) {
+        const std::size_t begin = m_levelBegin[depth];
+        const std::size_t count = m_levelBegin[depth + 1] - begin;
+        // small levels are not worth waking up the workers:
+        constexpr std::size_t grainSize = 4096;
+        if (count <= grainSize) {
+            updateCount += updateSlots(begin, begin + count);
+        } else {
+            pool.parallelFor(count, grainSize, [&](std::size_t chunkBegin, std::size_t chunkEnd) {
+                updateCount += updateSlots(begin + chunkBegin, begin + chunkEnd);
+            });
+        }
+    }
+    std::fill(m_dirty.begin(), m_dirty.end(), std::uint8_t(0));
+    m_lastUpdateCount = updateCount;
+}
+
+std::size_t SceneGraph::updateSlots(std::size_t slotBegin, std::size_t slotEnd)
+{
+    // 1.) propagate the flags of the parents. They are on the previous level,
+    //      so their flags are final already. (branch free, most nodes are clean)
+    std::uint8_t anyDirty = 0;
+    for (std::size_t slot = slotBegin; slot < slotEnd; ++slot) {
+        const std::uint32_t parentSlot = m_parentSlots[slot];
+        const std::uint8_t parentDirty = (parentSlot != noSlot) ? m_dirty[parentSlot] : std::uint8_t(0);
+        m_dirty[slot] |= parentDirty;
+        anyDirty |= m_dirty[slot];
+    }
+    if (!anyDirty) {
+        return 0;
+    }
+
+    // 2.) recompute the dirty ones:
+    std::size_t count = 0;
+    for (std::size_t slot = slotBegin; slot < slotEnd; ++slot) {
+        if (!m_dirty[slot]) {
+            continue;
+        }
+        const std::uint32_t parentSlot = m_parentSlots[slot];
+        const glm::mat4 local = composeTransform(m_translations[slot], m_rotations[slot], m_scales[slot]);
+        if (parentSlot == noSlot) {
+            m_worldTransforms[slot] = local;
+        } else {
+            multiply(m_worldTransforms[parentSlot], local, m_worldTransforms[slot]);
+        }
+        ++count;
+    }
+    return count;
+}
+
+void SceneGraph::sortByDepth()
+{
+    const std::size_t n = m_nodeOfSlot.size();
+    std::uint32_t maxDepth = 0;
+    for (std::uint32_t depth : m_depths) {
+        maxDepth = std::max(maxDepth, depth);
+    }
+
+    // counting sort, stable within a level (keeps siblings close together):
+    m_levelBegin.assign(maxDepth + 2, 0);
+    for (std::uint32_t depth : m_depths) {
+        ++m_levelBegin[depth + 1];
+    }
+    for (std::size_t d = 1; d < m_levelBegin.size(); ++d) {
+        m_levelBegin[d] += m_levelBegin[d - 1];
+    }
+    std::vector<std::uint32_t> newSlotOfSlot(n);
+    {
+        std::vector<std::size_t> next(m_levelBegin.begin(), m_levelBegin.end() - 1);
+        for (std::size_t slot = 0; slot < n; ++slot) {
+            newSlotOfSlot[slot] = static_cast<std::uint32_t>(next[m_depths[slot]]++);
+        }
+    }
+
+    auto permute = [&](auto& values) {
+        std::remove_reference_t<decltype(values)> sorted(values.size());
+        for (std::size_t slot = 0; slot < n; ++slot) {
+            sorted[newSlotOfSlot[slot]] = values[slot];
+        }
+        values.swap(sorted);
+    };
+    permute(m_nodeOfSlot);
+    permute(m_parentSlots);
+    permute(m_depths);
+    permute(m_translations);
+    permute(m_rotations);
+    permute(m_scales);
+    permute(m_worldTransforms);
+    permute(m_dirty);
+    for (std::uint32_t& parentSlot : m_parentSlots) {
+        if (parentSlot != noSlot) {
+            parentSlot = newSlotOfSlot[parentSlot];
+        }
+    }
+    for (std::size_t slot = 0; slot < n; ++slot) {
+        m_slotOfNode[m_nodeOfSlot[slot]] = static_cast<std::uint32_t>(slot);
+    }
+    m_sorted = true;
+}
@@ -0,0 +1,276 @@
+#include "TextureLoader.h"
+
+#include <algorithm> // for std::min_element(..)
+#include <chrono>
+#include <cstring> // for std::memcpy(..)
+#include <iostream>
+#include <utility> // for std::move(..)
+
+#include "cpu_image_compression.h" // for getCompressedByteSize(..)
+#include "cpu_image_import.h" // for loadImageFile(..)
+#include "debug_utils.h"
+#include "CpuProfiler.h"
+#include "texture_cache.h"
+#include "GLCallStats.h"
+
+TextureLoader::TextureLoader(ThreadPool &pool)
+    : m_pool(pool)
+{}
+
+TextureLoader::Ticket TextureLoader::request(std::filesystem::path filepath, int channels, bool sRGB,
+                                             const Tex2DSamplingParams &sampParams)
+{
+    Ticket ticket = m_nextTicket++;
+    Request& req = m_requests[ticket];
+    req.sRGB = sRGB;
+    req.sampParams = sampParams;
+    // the task only references data it owns, so it may safely outlive this loader:
+    const bool mipmapped = sampParams.requiresMipmap();
+    req.decoded = m_pool.submit([filepath = std::move(filepath), channels, sRGB, mipmapped,
+                                 filter = m_mipFilter]() -> std::optional<Decoded> {
+        const int uploadChannels = GLTexture::getUploadChannelCount(channels);
+        if (mipmapped) {
+            std::optional<CPUTexture> texture = loadTexture(filepath, uploadChannels, sRGB, filter);
+            if (!texture) {
+                return std::nullopt;
+            }
+            return Decoded(std::move(*texture));
+        }
+        std::optional<CPUImage> image = loadImageFile(filepath, uploadChannels);
+        if (!image) {
+            return std::nullopt;
+        }
+        return Decoded(CPUTexture{sRGB, {std::move(*image)}});
+    });
+    return ticket;
+}
+
+TextureLoader::Ticket TextureLoader::requestCompressed(std::filesystem::path filepath, BlockFormat format, bool sRGB,
+                                                       const Tex2DSamplingParams &sampParams)
+{
+    Ticket ticket = m_nextTicket++;
+    Request& req = m_requests[ticket];
+    req.sRGB = sRGB;
+    req.sampParams = sampParams;
+    req.decoded = m_pool.submit([filepath = std::move(filepath), format, sRGB,
+                                 filter = m_mipFilter]() -> std::optional<Decoded> {
+        std::optional<CPUCompressedTexture> texture = loadCompressedTexture(filepath, format, sRGB, filter);
+        if (!texture) {
+            return std::nullopt;
+        }
+        return Decoded(std::move(*texture));
+    });
+    return ticket;
+}
+
+void TextureLoader::update(std::size_t maxUploads)
+{
+    recyclePBOs();
+
+    std::size_t uploads = 0;
+    for (auto& [ticket, req] : m_requests) {
+        if (uploads >= maxUploads) {
+            break;
+        }
+        if (req.done
+                || req.decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            continue;
+        }
+        std::optional<Decoded> decoded = req.decoded.get();
+        req.done = true;
+        if (decoded) {
+            std::visit([this, &req](const auto& data) { upload(req, data); }, *decoded);
+            ++uploads;
+        }
+    }
+}
+
+bool TextureLoader::isDone(Ticket ticket) const
+{
+    auto it = m_requests.find(ticket);
+    ASSERT(it != m_requests.end());
+    return it != m_requests.end() && it->second.done;
+}
+
+std::unique_ptr<GLTexture> TextureLoader::take(Ticket ticket)
+{
+    auto it = m_requests.find(ticket);
+    if (it == m_requests.end() || !it->second.done) {
+        return nullptr;
+    }
+    std::unique_ptr<GLTexture> texture = std::move(it->second.texture);
+    m_requests.erase(it);
+    return texture;
+}
+
+std::unique_ptr<GLTexture> TextureLoader::wait(Ticket ticket)
+{
+    auto it = m_requests.find(ticket);
+    ASSERT(it != m_requests.end());
+    if (it == m_requests.end()) {
+        return nullptr;
+    }
+    if (!it->second.done) {
+        it->second.decoded.wait();
+    }
+    // does not upload more than necessary if other textures are done decoding, too:
+    while (!it->second.done) {
+        update(1);
+    }
+    return take(ticket);
+}
+
+std::size_t TextureLoader::getInFlightCount() const
+{
+    std::size_t count = 0;
+    for (const auto& [ticket, req] : m_requests) {
+        count += !req.done;
+    }
+    return count;
+}
+
+void TextureLoader::upload(Request &req, const CPUTexture &texture)
+{
+    CPU_PROFILE_SCOPE("TextureLoader::upload");
+    ASSERT(texture.sRGB == req.sRGB);
+    const CPUImage& level0 = texture.levels.at(0);
+    req.texture = std::make_unique<GLTexture>(level0.width, level0.height,
+                                              GLTexture::getInternalFormat(level0.channels, texture.sRGB),
+                                              req.sampParams);
+    const auto levelCount = static_cast<std::size_t>(req.texture->getMipLevelCount());
+    ASSERT(texture.levels.size() >= levelCount);
+
+    // levels start at multiples of 8 bytes inside the pbo, like client memory allocations would:
+    std::vector<std::size_t> offsets(levelCount);
+    std::size_t size = 0;
+    for (std::size_t level = 0; level < levelCount; ++level) {
+        offsets[level] = size;
+        size += (texture.levels[level].data.size() + 7) / 8 * 8;
+    }
+    void* dst = nullptr;
+    GLBufferObject pbo = acquireMappedPBO(static_cast<GLBufferObject::size_type>(size), dst);
+    bool uploadFromPBO = false;
+    if (dst) {
+        for (std::size_t level = 0; level < levelCount; ++level) {
+            const auto& data = texture.levels[level].data;
+            std::memcpy(static_cast<GLubyte*>(dst) + offsets[level], data.data(), data.size());
+        }
+        uploadFromPBO = pbo.unmap();
+    }
+    if (!uploadFromPBO) {
+        std::cerr << "WARNING: mapping pixel unpack buffer failed, uploading directly from client memory\n";
+        pbo.unbind();
+    }
+
+    for (std::size_t level = 0; level < levelCount; ++level) {
+        const CPUImage& image = texture.levels[level];
+        // with a bound pixel unpack buffer the pointer is interpreted as offset:
+        const GLvoid* src = uploadFromPBO ? reinterpret_cast<const GLvoid*>(offsets[level])
+                                          : static_cast<const GLvoid*>(image.data.data());
+        req.texture->setImage(static_cast<GLint>(level), image.channels, src);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (!uploadFromPBO) {
+        pbo.bind();
+    }
+    releasePBO(std::move(pbo));
+}
+
+void TextureLoader::upload(Request &req, const CPUCompressedTexture &texture)
+{
+    CPU_PROFILE_SCOPE("TextureLoader::upload (compressed)");
+    ASSERT(texture.sRGB == req.sRGB);
+    const CPUCompressedImage& level0 = texture.levels.at(0);
+    req.texture = std::make_unique<GLTexture>(level0.width, level0.height,
+                                              GLTexture::getCompressedInternalFormat(texture.format, texture.sRGB),
+                                              req.sampParams);
+    const auto levelCount = static_cast<std::size_t>(req.texture->getMipLevelCount());
+    ASSERT(texture.levels.size() >= levelCount);
+
+    std::size_t size = 0;
+    for (std::size_t level = 0; level < levelCount; ++level) {
+        size += texture.levels[level].blocks.size();
+    }
+    void* dst = nullptr;
+    GLBufferObject pbo = acquireMappedPBO(static_cast<GLBufferObject::size_type>(size), dst);
+    bool uploadFromPBO = false;
+    if (dst) {
+        std::size_t offset = 0;
+        for (std::size_t level = 0; level < levelCount; ++level) {
+            const auto& blocks = texture.levels[level].blocks;
+            std::memcpy(static_cast<GLubyte*>(dst) + offset, blocks.data(), blocks.size());
+            offset += blocks.size();
+        }
+        uploadFromPBO = pbo.unmap();
+    }
+    if (!uploadFromPBO) {
+        std::cerr << "WARNING: mapping pixel unpack buffer failed, uploading directly from client memory\n";
+        pbo.unbind();
+    }
+
+    std::size_t offset = 0;
+    for (std::size_t level = 0; level < levelCount; ++level) {
+        const auto& blocks = texture.levels[level].blocks;
+        // with a bound pixel unpack buffer the pointer is interpreted as offset:
+        const GLvoid* src = uploadFromPBO ? reinterpret_cast<const GLvoid*>(offset)
+                                          : static_cast<const GLvoid*>(blocks.data());
+        req.texture->setCompressedImage(static_cast<GLint>(level), static_cast<GLsizei>(blocks.size()), src);
+        offset += blocks.size();
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (!uploadFromPBO) {
+        pbo.bind();
+    }
+    releasePBO(std::move(pbo));
+}
+
+GLBufferObject TextureLoader::acquireMappedPBO(GLBufferObject::size_type size, void*& dst)
+{
+    // the smallest one that is large enough:
+    auto best = m_freePBOs.end();
+    for (auto it = m_freePBOs.begin(); it != m_freePBOs.end(); ++it) {
+        if (it->getSize() >= size && (best == m_freePBOs.end() || it->getSize() < best->getSize())) {
+            best = it;
+        }
+    }
+    std::optional<GLBufferObject> pbo;
+    if (best != m_freePBOs.end()) {
+        pbo.emplace(std::move(*best));
+        m_freePBOs.erase(best);
+        pbo->bind();
+    } else {
+        pbo.emplace(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+
+    // the buffer is either new or the GPU is done reading from it (see recyclePBOs())
+    //  -> no need to synchronize
+    dst = pbo->mapRange(0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+                                 | GL_MAP_UNSYNCHRONIZED_BIT);
+    return std::move(*pbo);
+}
+
+void TextureLoader::releasePBO(GLBufferObject pbo)
+{
+    pbo.unbind(); // a bound pixel unpack buffer would break uploads from client memory elsewhere
+    // can be reused once the GPU finished the copies issued so far:
+    m_busyPBOs.push_back({std::move(pbo), GLFence()});
+}
+
+void TextureLoader::recyclePBOs()
+{
+    for (auto it = m_busyPBOs.begin(); it != m_busyPBOs.end();) {
+        if (it->fence.isSignaled()) {
+            m_freePBOs.push_back(std::move(it->pbo));
+            it = m_busyPBOs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    while (m_freePBOs.size() > maxFreePBOs) {
+        auto smallest = std::min_element(m_freePBOs.begin(), m_freePBOs.end(),
+                                         [](const GLBufferObject& a, const GLBufferObject& b) {
+                                             return a.getSize() < b.getSize();
+                                         });
+        m_freePBOs.erase(smallest);
+    }
+}
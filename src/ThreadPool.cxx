@@ -0,0 +1,131 @@
+#include "ThreadPool.h"
+
+#include <algorithm> // for std::max(..), std::min(..)
+#include <atomic>
+
+#include "debug_utils.h"
+#include "CpuProfiler.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+    : m_stop(false)
+{
+    if (threadCount == 0) {
+        unsigned int hw = std::thread::hardware_concurrency(); // may return 0 if unknown
+        threadCount = std::max(hw, 2u) - 1;
+    }
+    m_workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back([this, i](){
+#ifdef OPENGL_DEMOS_CPU_PROFILER
+            CpuProfiler::setThreadName("worker " + std::to_string(i));
+#else
+            static_cast<void>(i);
+#endif
+            workerLoop();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& w : m_workers) {
+        w.join();
+    }
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t grainSize,
+                             const std::function<void (std::size_t, std::size_t)> &body)
+{
+    grainSize = std::max<std::size_t>(grainSize, 1);
+    const std::size_t chunkCount = (count + grainSize - 1) / grainSize;
+    if (chunkCount == 0) {
+        return;
+    }
+    if (m_workers.empty()) {
+        // (chunks on the calling thread, body may rely on the grain size, e.g. for scratch buffers)
+        for (std::size_t begin = 0; begin < count; begin += grainSize) {
+            body(begin, std::min(begin + grainSize, count));
+        }
+        return;
+    }
+    if (chunkCount == 1) {
+        body(0, count);
+        return;
+    }
+
+    // shared by the calling thread and the helpers. helpers may start after
+    // parallelFor(..) returned (and then just find no work left) -> keep state alive with shared_ptr
+    struct State {
+        std::atomic<std::size_t> nextChunk{0};
+        std::size_t finishedChunks = 0;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+
+    auto work = [state, count, grainSize, chunkCount, &body]() {
+        std::size_t finished = 0;
+        for (std::size_t c = state->nextChunk++; c < chunkCount; c = state->nextChunk++) {
+            std::size_t begin = c * grainSize;
+            body(begin, std::min(begin + grainSize, count));
+            ++finished;
+        }
+        if (finished > 0) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->finishedChunks += finished;
+            if (state->finishedChunks == chunkCount) {
+                state->cv.notify_all();
+            }
+        }
+    };
+
+    const std::size_t helperCount = std::min<std::size_t>(m_workers.size(), chunkCount - 1);
+    for (std::size_t i = 0; i < helperCount; ++i) {
+        // a helper that starts late only touches state (and not body), because
+        // nextChunk is already >= chunkCount by then.
+        enqueue(work);
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&](){ return state->finishedChunks == chunkCount; });
+}
+
+void ThreadPool::enqueue(std::function<void ()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ASSERT(!m_stop);
+        m_tasks.push(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this](){ return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty()) {
+                return; // m_stop and nothing left to do
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        CPU_PROFILE_SCOPE("task");
+        task();
+    }
+}
@@ -23,6 +23,15 @@ void VertexBufferLayout::append(GLint dimCount, GLenum componentType, VariableTy
     m_stride += getAttributeSize(dimCount, componentType);
 }
 
+void VertexBufferLayout::append(const VertexAttributeLayout &attr)
+{
+    ASSERT(isValidDimension(attr.dimCount, attr.componentType, attr.castTo));
+    ASSERT(isValidCast(attr.componentType, attr.castTo));
+    m_attributes.push_back(attr);
+    m_attributes.back().offset = static_cast<offset_type>(m_stride);
+    m_stride += getAttributeSize(attr.dimCount, attr.componentType);
+}
+
 VertexBufferLayout &VertexBufferLayout::operator+=(const VertexBufferLayout &other)
 {
    for (auto& attr : other.getAttributes()) {
@@ -40,19 +49,14 @@ void VertexBufferLayout::setDefaultLocations()
     }
 }
 
-void VertexBufferLayout::setLocations(const GLShaderProgram &program)
+std::optional<VertexBufferLayout::count_type> VertexBufferLayout::findAttribute(const std::string &name) const
 {
-    for (auto& attr: m_attributes) {
-        if (!attr.name.empty()) {
-            auto loc = program.getAttribLocation(attr.name);
-            if (loc == -1) {
-                std::cout << "warning: did not find attribute location " << attr.name << '\n';
-                attr.location = std::nullopt;
-            } else {
-                attr.location = loc;
-            }
+    for (count_type i = 0; i < m_attributes.size(); ++i) {
+        if (m_attributes[i].name == name) {
+            return i;
         }
     }
+    return std::nullopt;
 }
 
 VertexBufferLayout::TypeCategory VertexBufferLayout::getTypeCategory(GLenum componentType)
@@ -0,0 +1,118 @@
+#include "VirtualTextureFeedback.h"
+
+#include <algorithm> // for std::max(..), std::sort(..)
+#include <cmath>     // for std::log2(..)
+#include <unordered_set>
+
+#include "debug_utils.h"
+#include "GLCallStats.h"
+
+VirtualTextureFeedback::VirtualTextureFeedback(int downscale)
+    : m_downscale(downscale)
+{
+    ASSERT(downscale >= 1);
+    std::array<GLenum, 1> drawBuffers = { GL_COLOR_ATTACHMENT0 };
+    m_fbo.bind();
+    m_fbo.setDrawBuffers(drawBuffers);
+    m_fbo.unbind();
+}
+
+void VirtualTextureFeedback::OnWindowSizeChanged(int width, int height)
+{
+    m_windowWidth = width;
+    m_windowHeight = height;
+    m_width = std::max(width / m_downscale, 1);
+    m_height = std::max(height / m_downscale, 1);
+
+    m_colorTex = std::make_unique<GLTexture>(m_width, m_height, GL_RGBA8, texture_sampling_presets::noFilter);
+    m_depthTex = std::make_unique<GLTexture>(m_width, m_height, GL_DEPTH_COMPONENT24, texture_sampling_presets::noFilter);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_fbo.bind();
+    m_fbo.attachTexture(GL_COLOR_ATTACHMENT0, *m_colorTex);
+    m_fbo.attachTexture(GL_DEPTH_ATTACHMENT, *m_depthTex);
+    ASSERT(m_fbo.checkFramebufferStatus() == GL_FRAMEBUFFER_COMPLETE);
+    m_fbo.unbind();
+}
+
+void VirtualTextureFeedback::begin(GLRenderer &renderer, GLShaderProgram &feedbackSP, const VTLayout &layout)
+{
+    ASSERT(m_colorTex); // otherwise OnWindowSizeChanged(..) has not been called yet.
+    // page coordinates are stored in 8 bit channels:
+    ASSERT(layout.getPageCount(0) <= 256);
+
+    m_fbo.bind();
+    renderer.setViewport(0, 0, m_width, m_height);
+    // alpha 0 marks texels without any virtual texture:
+    renderer.setClearColor(0.f, 0.f, 0.f, 0.f);
+    renderer.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    feedbackSP.bind();
+    feedbackSP.setUniform1f("u_vt_size", static_cast<float>(layout.size));
+    feedbackSP.setUniform1f("u_vt_page_size", static_cast<float>(layout.pageSize));
+    feedbackSP.setUniform1f("u_vt_max_level", static_cast<float>(layout.getLevelCount() - 1));
+    // the screen space derivatives are downscale times larger than in the full resolution pass:
+    feedbackSP.setUniform1f("u_vt_lod_bias", -std::log2(static_cast<float>(m_downscale)));
+}
+
+void VirtualTextureFeedback::end(GLRenderer &renderer)
+{
+    Readback& readback = m_readbacks[m_nextReadback];
+    // skip this frame's readback if the GPU did not even finish the older one (instead of stalling):
+    if (!readback.fence) {
+        const auto size = static_cast<GLBufferObject::size_type>(m_width) * m_height * 4;
+        if (!readback.pbo || readback.pbo->getSize() != size) {
+            readback.pbo.emplace(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        }
+        readback.pbo->bind();
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // offset 0 into the pbo
+        readback.pbo->unbind();
+        readback.fence.emplace();
+        readback.width = m_width;
+        readback.height = m_height;
+        m_nextReadback = (m_nextReadback + 1) % m_readbacks.size();
+    }
+
+    m_fbo.unbind();
+    renderer.setViewport(0, 0, m_windowWidth, m_windowHeight);
+}
+
+const std::vector<VTPageId> &VirtualTextureFeedback::poll(const VTLayout &layout)
+{
+    // oldest pending readback first:
+    for (std::size_t i = 0; i < m_readbacks.size(); ++i) {
+        Readback& readback = m_readbacks[(m_nextReadback + i) % m_readbacks.size()];
+        if (!readback.fence || !readback.fence->isSignaled()) {
+            continue;
+        }
+        readback.fence.reset();
+
+        readback.pbo->bind();
+        const auto size = static_cast<GLBufferObject::size_type>(readback.width) * readback.height * 4;
+        const auto* texels = static_cast<const GLubyte*>(readback.pbo->mapRange(0, size, GL_MAP_READ_BIT));
+        if (texels) {
+            std::unordered_set<std::uint32_t> keys;
+            for (GLBufferObject::size_type t = 0; t < size; t += 4) {
+                if (texels[t + 3] == 0) {
+                    continue;
+                }
+                const VTPageId page{texels[t + 2], texels[t], texels[t + 1]};
+                if (layout.contains(page)) {
+                    keys.insert(page.pack());
+                }
+            }
+            m_pages.clear();
+            for (std::uint32_t key : keys) {
+                m_pages.push_back(VTPageId::unpack(key));
+            }
+            std::sort(m_pages.begin(), m_pages.end(), [](const VTPageId& a, const VTPageId& b) {
+                return a.pack() > b.pack();
+            });
+            readback.pbo->unmap();
+        }
+        readback.pbo->unbind();
+    }
+    return m_pages;
+}
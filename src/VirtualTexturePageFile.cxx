@@ -0,0 +1,132 @@
+#include "VirtualTexturePageFile.h"
+
+#include <algorithm> // for std::clamp(..), std::equal(..)
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "debug_utils.h"
+
+namespace {
+
+constexpr std::array<char, 4> magic = {'V', 'T', 'P', 'F'};
+constexpr std::uint32_t version = 1;
+// magic, version, size, pageSize, border, sRGB
+constexpr std::size_t headerSize = 4 + 5 * 4;
+
+void writeU32(std::ofstream& out, std::uint32_t v)
+{
+    std::array<char, 4> bytes;
+    for (std::size_t i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+    }
+    out.write(bytes.data(), 4);
+}
+
+std::uint32_t readU32(const std::array<unsigned char, headerSize>& bytes, std::size_t offset)
+{
+    std::uint32_t v = 0;
+    for (std::size_t i = 0; i < 4; ++i) {
+        v |= static_cast<std::uint32_t>(bytes[offset + i]) << (8 * i);
+    }
+    return v;
+}
+
+} // namespace
+
+
+bool VTPageFile::write(const std::filesystem::path &filepath, const CPUImage &image, bool sRGB,
+                       int pageSize, int border, MipFilter filter)
+{
+    VTLayout layout{image.width, pageSize, border};
+    if (image.channels != 4 || image.width != image.height || !layout.isValid()) {
+        std::cerr << "WARNING: virtual textures need square RGBA images whose size is a power of two multiple of the page size\n";
+        return false;
+    }
+    const std::vector<CPUImage> levels = generateMipChain(image, sRGB, filter);
+
+    std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "WARNING: could not open " << filepath << " for writing\n";
+        return false;
+    }
+    out.write(magic.data(), magic.size());
+    writeU32(out, version);
+    writeU32(out, static_cast<std::uint32_t>(layout.size));
+    writeU32(out, static_cast<std::uint32_t>(layout.pageSize));
+    writeU32(out, static_cast<std::uint32_t>(layout.border));
+    writeU32(out, sRGB ? 1 : 0);
+
+    const int padded = layout.getPaddedPageSize();
+    std::vector<char> page(static_cast<std::size_t>(padded) * static_cast<std::size_t>(padded) * 4);
+    for (int level = 0; level < layout.getLevelCount(); ++level) {
+        const CPUImage& src = levels[static_cast<std::size_t>(level)];
+        const int pages = layout.getPageCount(level);
+        for (int py = 0; py < pages; ++py) {
+            for (int px = 0; px < pages; ++px) {
+                // the border repeats the neighbouring pages, clamped at the edges of the texture:
+                char* dst = page.data();
+                for (int y = 0; y < padded; ++y) {
+                    const int srcY = std::clamp(py * pageSize - border + y, 0, src.height - 1);
+                    for (int x = 0; x < padded; ++x) {
+                        const int srcX = std::clamp(px * pageSize - border + x, 0, src.width - 1);
+                        const GLubyte* texel = &src.data[(static_cast<std::size_t>(srcY) * static_cast<std::size_t>(src.width)
+                                                          + static_cast<std::size_t>(srcX)) * 4];
+                        for (int c = 0; c < 4; ++c) {
+                            *dst++ = static_cast<char>(texel[c]);
+                        }
+                    }
+                }
+                out.write(page.data(), static_cast<std::streamsize>(page.size()));
+            }
+        }
+    }
+    if (!out) {
+        std::cerr << "WARNING: could not write " << filepath << '\n';
+        return false;
+    }
+    return true;
+}
+
+std::optional<VTPageFile> VTPageFile::open(const std::filesystem::path &filepath)
+{
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+    std::array<unsigned char, headerSize> header;
+    file.read(reinterpret_cast<char*>(header.data()), header.size());
+    if (!file || !std::equal(magic.begin(), magic.end(), header.begin(),
+                             [](char a, unsigned char b) { return static_cast<unsigned char>(a) == b; })
+            || readU32(header, 4) != version) {
+        std::cerr << "WARNING: " << filepath << " is not a virtual texture page file\n";
+        return std::nullopt;
+    }
+    VTLayout layout{static_cast<int>(readU32(header, 8)), static_cast<int>(readU32(header, 12)),
+                    static_cast<int>(readU32(header, 16))};
+    if (!layout.isValid()) {
+        std::cerr << "WARNING: invalid layout in " << filepath << '\n';
+        return std::nullopt;
+    }
+    return VTPageFile(std::move(file), layout, readU32(header, 20) != 0);
+}
+
+bool VTPageFile::readPage(const VTPageId &page, GLubyte *dst)
+{
+    ASSERT(m_layout.contains(page));
+    const std::size_t offset = headerSize + m_layout.getPageIndex(page) * getPageByteSize();
+    m_file.seekg(static_cast<std::streamoff>(offset));
+    m_file.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(getPageByteSize()));
+    if (!m_file) {
+        m_file.clear();
+        return false;
+    }
+    return true;
+}
+
+VTPageFile::VTPageFile(std::ifstream file, const VTLayout &layout, bool sRGB)
+    : m_file(std::move(file)),
+      m_layout(layout),
+      m_sRGB(sRGB)
+{}
@@ -0,0 +1,195 @@
+#include "VirtualTextureResidency.h"
+
+#include <algorithm> // for std::sort(..)
+
+#include "debug_utils.h"
+
+VTResidency::VTResidency(const VTLayout &layout, std::uint32_t slotsX, std::uint32_t slotsY)
+    : m_layout(layout),
+      m_slotsX(slotsX),
+      m_slotsY(slotsY),
+      m_pinnedPage{static_cast<std::uint32_t>(layout.getLevelCount() - 1), 0, 0}
+{
+    ASSERT(layout.isValid());
+    // slots are stored in 8 bit page table channels:
+    ASSERT(0 < slotsX && slotsX <= 256 && 0 < slotsY && slotsY <= 256);
+    // the pinned page and at least one page for streaming:
+    ASSERT(getCapacity() >= 2);
+
+    // hand out slots in row major order:
+    for (std::uint32_t y = slotsY; y-- > 0;) {
+        for (std::uint32_t x = slotsX; x-- > 0;) {
+            m_freeSlots.push_back({x, y});
+        }
+    }
+
+    m_pageTable.resize(static_cast<std::size_t>(layout.getLevelCount()));
+    for (int level = 0; level < layout.getLevelCount(); ++level) {
+        const auto n = static_cast<std::size_t>(layout.getPageCount(level));
+        m_pageTable[static_cast<std::size_t>(level)].assign(n * n, PageTableEntry{0, 0, 0, 0});
+    }
+
+    m_queued.insert(m_pinnedPage.pack());
+}
+
+void VTResidency::beginFrame()
+{
+    ++m_frame;
+    // the feedback of this frame replaces the wishes of the previous one:
+    m_queued.clear();
+    if (!isResident(m_pinnedPage) && !m_inFlight.count(m_pinnedPage.pack())) {
+        m_queued.insert(m_pinnedPage.pack());
+    }
+}
+
+void VTResidency::requestPage(const VTPageId &page)
+{
+    ASSERT(m_layout.contains(page));
+    // the page and all of its fallbacks:
+    for (VTPageId p = page; p.level < static_cast<std::uint32_t>(m_layout.getLevelCount()); p = p.getParent()) {
+        const std::uint32_t key = p.pack();
+        if (m_resident.count(key)) {
+            touch(key);
+        } else if (!m_inFlight.count(key)) {
+            m_queued.insert(key);
+        }
+    }
+}
+
+std::vector<VTPageId> VTResidency::takeLoadRequests(std::size_t maxCount)
+{
+    std::vector<VTPageId> pages;
+    pages.reserve(m_queued.size());
+    for (std::uint32_t key : m_queued) {
+        pages.push_back(VTPageId::unpack(key));
+    }
+    // coarse levels first (they are fallbacks for finer ones), deterministic order within a level:
+    std::sort(pages.begin(), pages.end(), [](const VTPageId& a, const VTPageId& b) {
+        if (a.level != b.level) {
+            return a.level > b.level;
+        }
+        return (a.y != b.y) ? a.y < b.y : a.x < b.x;
+    });
+    if (pages.size() > maxCount) {
+        pages.resize(maxCount);
+    }
+    for (const VTPageId& page : pages) {
+        m_queued.erase(page.pack());
+        m_inFlight.insert(page.pack());
+    }
+    return pages;
+}
+
+std::optional<VTResidency::LoadResult> VTResidency::onPageLoaded(const VTPageId &page)
+{
+    const std::uint32_t key = page.pack();
+    m_inFlight.erase(key);
+    if (m_resident.count(key)) {
+        return std::nullopt;
+    }
+
+    LoadResult result;
+    std::optional<Slot> slot = allocateSlot(result.evicted);
+    if (!slot) {
+        return std::nullopt;
+    }
+    result.slot = *slot;
+
+    ResidentPage resident{*slot, m_frame, m_lru.end()};
+    if (!(page == m_pinnedPage)) {
+        m_lru.push_front(key);
+        resident.lruPosition = m_lru.begin();
+    }
+    m_resident.emplace(key, resident);
+    ++m_loadCount;
+    m_pageTableDirty = true;
+    return result;
+}
+
+void VTResidency::onPageLoadFailed(const VTPageId &page)
+{
+    m_inFlight.erase(page.pack());
+}
+
+bool VTResidency::isResident(const VTPageId &page) const
+{
+    return m_resident.count(page.pack()) > 0;
+}
+
+std::optional<VTResidency::Slot> VTResidency::getSlot(const VTPageId &page) const
+{
+    auto it = m_resident.find(page.pack());
+    if (it == m_resident.end()) {
+        return std::nullopt;
+    }
+    return it->second.slot;
+}
+
+const std::vector<std::vector<VTResidency::PageTableEntry>> &VTResidency::getPageTable()
+{
+    if (m_pageTableDirty) {
+        rebuildPageTable();
+        m_pageTableDirty = false;
+    }
+    return m_pageTable;
+}
+
+void VTResidency::touch(std::uint32_t key)
+{
+    ResidentPage& page = m_resident.at(key);
+    page.lastUsedFrame = m_frame;
+    if (page.lruPosition != m_lru.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, page.lruPosition);
+    }
+}
+
+std::optional<VTResidency::Slot> VTResidency::allocateSlot(std::optional<VTPageId> &evicted)
+{
+    if (!m_freeSlots.empty()) {
+        Slot slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        return slot;
+    }
+    if (m_lru.empty()) {
+        return std::nullopt;
+    }
+    const std::uint32_t victimKey = m_lru.back();
+    auto victim = m_resident.find(victimKey);
+    ASSERT(victim != m_resident.end());
+    // never evict what the current frame needs (that would just cause thrashing):
+    if (victim->second.lastUsedFrame >= m_frame) {
+        return std::nullopt;
+    }
+    Slot slot = victim->second.slot;
+    m_lru.pop_back();
+    m_resident.erase(victim);
+    evicted = VTPageId::unpack(victimKey);
+    ++m_evictionCount;
+    return slot;
+}
+
+void VTResidency::rebuildPageTable()
+{
+    // from coarse to fine: an entry points to its own page if it is resident
+    // and inherits the entry of its parent otherwise.
+    for (int level = m_layout.getLevelCount() - 1; level >= 0; --level) {
+        const auto n = static_cast<std::uint32_t>(m_layout.getPageCount(level));
+        auto& entries = m_pageTable[static_cast<std::size_t>(level)];
+        for (std::uint32_t y = 0; y < n; ++y) {
+            for (std::uint32_t x = 0; x < n; ++x) {
+                const VTPageId page{static_cast<std::uint32_t>(level), x, y};
+                PageTableEntry& entry = entries[y * n + x];
+                auto it = m_resident.find(page.pack());
+                if (it != m_resident.end()) {
+                    entry = {static_cast<std::uint8_t>(it->second.slot.x), static_cast<std::uint8_t>(it->second.slot.y),
+                             static_cast<std::uint8_t>(level), 255};
+                } else if (level + 1 < m_layout.getLevelCount()) {
+                    const auto parentN = static_cast<std::uint32_t>(m_layout.getPageCount(level + 1));
+                    entry = m_pageTable[static_cast<std::size_t>(level + 1)][(y / 2) * parentN + x / 2];
+                } else {
+                    entry = {0, 0, 0, 0};
+                }
+            }
+        }
+    }
+}
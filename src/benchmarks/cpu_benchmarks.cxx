@@ -0,0 +1,878 @@
+// micro-benchmarks of the CPU side of the mesh pipeline and of the math the demos run every frame.
+// Meshes are read from a synthetic OBJ file (a height field of quads) whose size and attribute
+// format are configurable, so that runs are reproducible without the assets in res/:
+//  cpu_benchmarks [--quads N] [--format v|v/vt|v//vn|v/vt/vn] [--repeat N] [--keep]
+// Build it in release mode, debug builds check every index and print statistics.
+// Some stages also check the quality of their results (e.g. the PSNR of the block compression),
+// the exit code is 1 if one of these checks fails.
+#include <algorithm>
+#include <array>
+#include <charconv> // for std::from_chars(..)
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility> // for std::pair
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Camera.h"
+#include "colorspace_utils.h"
+#include "cpu_image_compression.h"
+#include "cpu_image_utils.h"
+#include "cpu_mesh_generate.h"
+#include "cpu_mesh_import.h"
+#include "cpu_mesh_utils.h"
+#include "debug_utils.h"
+#include "RenderGraph.h"
+#include "VirtualTextureResidency.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+enum class ObjFormat {
+    V, V_VT, V_VN, V_VT_VN
+};
+
+struct Options {
+    std::size_t quads = 256;  // per side of the height field
+    ObjFormat format = ObjFormat::V_VT_VN;
+    std::size_t repeat = 5;
+    bool keep = false;        // keep the OBJ file in the temp directory
+};
+
+struct StageResult {
+    std::string name;
+    std::size_t items;        // what the stage processes, e.g. vertices or pixels
+    const char* itemName;
+    std::size_t bytes;        // input bytes (0 if the stage has no meaningful input size)
+    double best_ms;
+    double median_ms;
+};
+
+struct CheckResult {
+    std::string name;
+    bool passed;
+    std::string detail;       // measured value and limit
+};
+
+// results are accumulated here so the compiler cannot drop the benchmarked calls:
+volatile double sink = 0.;
+
+// the loader reports every object it parses, which would dominate small meshes:
+class SilenceStdout
+{
+public:
+    SilenceStdout()
+        : m_buffer(std::cout.rdbuf(nullptr))
+    {}
+    ~SilenceStdout() {
+        std::cout.rdbuf(m_buffer); // (also clears the badbit)
+    }
+    SilenceStdout(const SilenceStdout& other) = delete;
+    SilenceStdout& operator=(const SilenceStdout& other) = delete;
+private:
+    std::streambuf* m_buffer;
+};
+
+const char* getFormatName(ObjFormat format)
+{
+    switch (format) {
+    case ObjFormat::V: return "v";
+    case ObjFormat::V_VT: return "v/vt";
+    case ObjFormat::V_VN: return "v//vn";
+    case ObjFormat::V_VT_VN: return "v/vt/vn";
+    }
+    return "?";
+}
+
+bool hasTexCoords(ObjFormat format)
+{
+    return format == ObjFormat::V_VT || format == ObjFormat::V_VT_VN;
+}
+
+bool hasNormals(ObjFormat format)
+{
+    return format == ObjFormat::V_VN || format == ObjFormat::V_VT_VN;
+}
+
+// height field z = f(x, y) on [-1, 1]^2 with quads x quads quads. Positions, texture coordinates
+// and normals have one entry per grid point (like most exporters write smooth meshes), faces are
+// quads, so the loader has to split the polygons and the index buffer unification finds every
+// grid point in up to 4 faces.
+struct HeightField {
+    std::size_t quads;
+
+    std::size_t getGridPointCount() const {
+        return (quads + 1) * (quads + 1);
+    }
+    glm::vec3 getPosition(std::size_t i, std::size_t j) const {
+        const float x = -1.f + 2.f * static_cast<float>(i) / static_cast<float>(quads);
+        const float y = -1.f + 2.f * static_cast<float>(j) / static_cast<float>(quads);
+        return glm::vec3(x, y, .1f * std::sin(4.f * x) * std::cos(3.f * y));
+    }
+    glm::vec2 getTexCoord(std::size_t i, std::size_t j) const {
+        return glm::vec2(static_cast<float>(i), static_cast<float>(j)) / static_cast<float>(quads);
+    }
+    glm::vec3 getNormal(std::size_t i, std::size_t j) const {
+        const glm::vec3 p = getPosition(i, j);
+        const float dz_dx = .4f * std::cos(4.f * p.x) * std::cos(3.f * p.y);
+        const float dz_dy = -.3f * std::sin(4.f * p.x) * std::sin(3.f * p.y);
+        return glm::normalize(glm::vec3(-dz_dx, -dz_dy, 1.f));
+    }
+    // 0-based index of a grid point in the v, vt and vn lists
+    std::size_t getIndex(std::size_t i, std::size_t j) const {
+        return j * (quads + 1) + i;
+    }
+    // corners of quad (i, j) in counter-clockwise order
+    std::array<std::size_t, 4> getQuad(std::size_t i, std::size_t j) const {
+        return {getIndex(i, j), getIndex(i + 1, j), getIndex(i + 1, j + 1), getIndex(i, j + 1)};
+    }
+};
+
+// returns the size of the file in bytes (0 if it could not be written)
+std::size_t writeSyntheticOBJ(const fs::path& path, const HeightField& field, ObjFormat format)
+{
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "error: could not open " << path << " for writing\n";
+        return 0;
+    }
+    file << std::fixed << std::setprecision(6);
+    file << "# synthetic height field, " << field.quads << "x" << field.quads << " quads, "
+         << getFormatName(format) << '\n';
+    file << "o HeightField\n";
+    for (std::size_t j = 0; j <= field.quads; ++j) {
+        for (std::size_t i = 0; i <= field.quads; ++i) {
+            const glm::vec3 p = field.getPosition(i, j);
+            file << "v " << p.x << ' ' << p.y << ' ' << p.z << '\n';
+        }
+    }
+    if (hasTexCoords(format)) {
+        for (std::size_t j = 0; j <= field.quads; ++j) {
+            for (std::size_t i = 0; i <= field.quads; ++i) {
+                const glm::vec2 t = field.getTexCoord(i, j);
+                file << "vt " << t.x << ' ' << t.y << '\n';
+            }
+        }
+    }
+    if (hasNormals(format)) {
+        for (std::size_t j = 0; j <= field.quads; ++j) {
+            for (std::size_t i = 0; i <= field.quads; ++i) {
+                const glm::vec3 n = field.getNormal(i, j);
+                file << "vn " << n.x << ' ' << n.y << ' ' << n.z << '\n';
+            }
+        }
+    }
+    for (std::size_t j = 0; j < field.quads; ++j) {
+        for (std::size_t i = 0; i < field.quads; ++i) {
+            file << 'f';
+            for (std::size_t corner : field.getQuad(i, j)) {
+                // (OBJ indices start at 1)
+                const std::size_t k = corner + 1;
+                switch (format) {
+                case ObjFormat::V: file << ' ' << k; break;
+                case ObjFormat::V_VT: file << ' ' << k << '/' << k; break;
+                case ObjFormat::V_VN: file << ' ' << k << "//" << k; break;
+                case ObjFormat::V_VT_VN: file << ' ' << k << '/' << k << '/' << k; break;
+                }
+            }
+            file << '\n';
+        }
+    }
+    file.close();
+    return file ? static_cast<std::size_t>(fs::file_size(path)) : 0;
+}
+
+template <typename T>
+CPUVertexArray makeVertexArray(const std::vector<T>& values, GLint dimCount, std::string name)
+{
+    CPUVertexArray va;
+    va.layout.append(dimCount, GL_FLOAT, std::move(name));
+    const auto* bytes = reinterpret_cast<const GLbyte*>(values.data());
+    va.data.assign(bytes, bytes + values.size() * sizeof(T));
+    return va;
+}
+
+// the multi index mesh the OBJ loader builds internally, with one vertex array per attribute
+template <int N>
+CPUMultiIndexMesh<GLuint, N> makeMultiIndexMesh(const HeightField& field, ObjFormat format)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    for (std::size_t j = 0; j <= field.quads; ++j) {
+        for (std::size_t i = 0; i <= field.quads; ++i) {
+            positions.push_back(field.getPosition(i, j));
+            texCoords.push_back(field.getTexCoord(i, j));
+            normals.push_back(field.getNormal(i, j));
+        }
+    }
+    std::vector<CPUVertexArray> attributes{makeVertexArray(positions, 3, "position")};
+    if (hasTexCoords(format)) {
+        attributes.push_back(makeVertexArray(texCoords, 2, "texCoord"));
+    }
+    if (hasNormals(format)) {
+        attributes.push_back(makeVertexArray(normals, 3, "normal"));
+    }
+    ASSERT(attributes.size() == static_cast<std::size_t>(N));
+    CPUMultiIndexMesh<GLuint, N> mesh;
+    std::move(attributes.begin(), attributes.end(), mesh.vas.begin());
+    mesh.mib.primitiveType = GL_TRIANGLE_FAN;
+    std::array<GLuint, N> restart;
+    restart.fill(std::numeric_limits<GLuint>::max());
+    mesh.mib.primitiveRestartMultiIndex = restart;
+    for (std::size_t j = 0; j < field.quads; ++j) {
+        for (std::size_t i = 0; i < field.quads; ++i) {
+            for (std::size_t corner : field.getQuad(i, j)) {
+                std::array<GLuint, N> multiIndex;
+                multiIndex.fill(static_cast<GLuint>(corner));
+                mesh.mib.indices.push_back(multiIndex);
+            }
+            mesh.mib.indices.push_back(restart);
+        }
+    }
+    return mesh;
+}
+
+// vertex array without an index buffer (every corner of every triangle is stored)
+CPUVertexArray expandIndexBuffer(const CPUMesh<GLuint>& mesh)
+{
+    CPUVertexArray va;
+    va.layout = mesh.va.layout;
+    const auto stride = static_cast<std::size_t>(mesh.va.layout.getStride());
+    va.data.reserve(mesh.ib.indices.size() * stride);
+    for (GLuint index : mesh.ib.indices) {
+        const GLbyte* vertex = mesh.va.data.data() + index * stride;
+        va.data.insert(va.data.end(), vertex, vertex + stride);
+    }
+    return va;
+}
+
+StageResult runStage(std::string name, std::size_t items, const char* itemName, std::size_t bytes,
+                     std::size_t repeat, const std::function<void()>& stage)
+{
+    std::vector<double> times_ms;
+    for (std::size_t r = 0; r < repeat; ++r) {
+        const auto begin = std::chrono::steady_clock::now();
+        stage();
+        times_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+    }
+    std::sort(times_ms.begin(), times_ms.end());
+    return StageResult{std::move(name), items, itemName, bytes, times_ms.front(), times_ms[times_ms.size() / 2]};
+}
+
+void printResults(const std::vector<StageResult>& results)
+{
+    std::cout << std::left << std::setw(34) << "stage" << std::right << std::setw(12) << "items"
+              << std::setw(12) << "best ms" << std::setw(12) << "median ms"
+              << std::setw(16) << "Mitems/s" << std::setw(10) << "MiB/s" << '\n';
+    std::cout << std::fixed;
+    for (const StageResult& result : results) {
+        const double seconds = result.best_ms * 1e-3;
+        std::cout << std::left << std::setw(34) << result.name << std::right
+                  << std::setw(12) << result.items
+                  << std::setw(12) << std::setprecision(3) << result.best_ms
+                  << std::setw(12) << std::setprecision(3) << result.median_ms
+                  << std::setw(9) << std::setprecision(2) << static_cast<double>(result.items) / seconds * 1e-6
+                  << ' ' << std::left << std::setw(6) << result.itemName << std::right;
+        if (result.bytes > 0) {
+            std::cout << std::setw(10) << std::setprecision(1)
+                      << static_cast<double>(result.bytes) / seconds / (1024. * 1024.);
+        } else {
+            std::cout << std::setw(10) << '-';
+        }
+        std::cout << '\n';
+    }
+}
+
+void printChecks(const std::vector<CheckResult>& checks)
+{
+    std::cout << '\n' << std::left << std::setw(34) << "check" << "result\n";
+    for (const CheckResult& check : checks) {
+        std::cout << std::setw(34) << check.name << (check.passed ? "ok     " : "FAILED ") << check.detail << '\n';
+    }
+    std::cout << std::right;
+}
+
+CheckResult checkAtLeast(std::string name, double value, double limit, const char* unit)
+{
+    std::ostringstream detail;
+    detail << std::fixed << std::setprecision(2) << value << ' ' << unit << " (>= " << limit << ' ' << unit << ')';
+    return CheckResult{std::move(name), value >= limit, detail.str()};
+}
+
+CheckResult checkAtMost(std::string name, double value, double limit)
+{
+    std::ostringstream detail;
+    detail << std::scientific << std::setprecision(2) << value << " (<= " << limit << ')';
+    return CheckResult{std::move(name), value <= limit, detail.str()};
+}
+
+// RGBA image with smooth gradients (most of a typical texture) and, in the upper right quarter,
+// hard edges that are not aligned to the 4x4 blocks of the block compression
+CPUImage makeTestImage(int width, int height)
+{
+    CPUImage image;
+    image.width = width;
+    image.height = height;
+    image.channels = 4;
+    image.data.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const float u = static_cast<float>(x) / static_cast<float>(width - 1);
+            const float v = static_cast<float>(y) / static_cast<float>(height - 1);
+            glm::vec4 color(u, v, .5f + .5f * std::sin(20.f * u) * std::cos(14.f * v),
+                            1.f - glm::length(glm::vec2(u, v) - .5f));
+            if (2 * x >= width && 2 * y >= height && ((x + 2) / 8 + (y + 2) / 8) % 2 == 0) {
+                color = glm::vec4(glm::vec3(1.f) - glm::vec3(color), color.a);
+            }
+            GLubyte* texel = &image.data[(static_cast<std::size_t>(y) * static_cast<std::size_t>(width)
+                                          + static_cast<std::size_t>(x)) * 4];
+            for (int c = 0; c < 4; ++c) {
+                texel[c] = static_cast<GLubyte>(std::lround(255.f * glm::clamp(color[c], 0.f, 1.f)));
+            }
+        }
+    }
+    return image;
+}
+
+// handles of the textures of the render graph that buildTestGraph(..) adds
+struct TestGraphTextures {
+    RGTexture color;
+    RGTexture depth;
+    RGTexture unused;
+    RGTexture blurred;
+    RGTexture result;
+};
+
+// scene -> unused -> blur horizontal -> blur vertical -> present, at 1920x1080.
+// Nothing reads what "unused" writes, so compile() has to cull it, and the result of the vertical blur
+// can take the physical texture of the scene color, which is dead after the horizontal blur.
+TestGraphTextures buildTestGraph(RenderGraph& graph)
+{
+    struct SceneData {
+        RGTexture color;
+        RGTexture depth;
+    };
+    struct PassOutput {
+        RGTexture texture;
+    };
+    const RenderTargetDesc colorDesc{1920, 1080, GL_RGBA16F};
+    const SceneData& scene = graph.addPass<SceneData>("scene", [&](RenderGraphBuilder& builder, SceneData& data) {
+        data.color = builder.createTexture("color", colorDesc);
+        data.depth = builder.createTexture("depth", RenderTargetDesc{1920, 1080, GL_DEPTH_COMPONENT24});
+        builder.writeColor(data.color);
+        builder.writeDepth(data.depth);
+    }, [](const SceneData&, RenderGraphContext&) {});
+    const PassOutput& unused = graph.addPass<PassOutput>("unused", [&](RenderGraphBuilder& builder, PassOutput& data) {
+        data.texture = builder.createTexture("unused", colorDesc);
+        builder.read(scene.color);
+        builder.writeColor(data.texture);
+    }, [](const PassOutput&, RenderGraphContext&) {});
+    const PassOutput& blurred = graph.addPass<PassOutput>("blur horizontal", [&](RenderGraphBuilder& builder, PassOutput& data) {
+        data.texture = builder.createTexture("blurred", colorDesc);
+        builder.read(scene.color);
+        builder.writeStorage(data.texture);
+    }, [](const PassOutput&, RenderGraphContext&) {});
+    const PassOutput& result = graph.addPass<PassOutput>("blur vertical", [&](RenderGraphBuilder& builder, PassOutput& data) {
+        data.texture = builder.createTexture("result", colorDesc);
+        builder.read(blurred.texture);
+        builder.writeStorage(data.texture);
+    }, [](const PassOutput&, RenderGraphContext&) {});
+    graph.addPass<PassOutput>("present", [&](RenderGraphBuilder& builder, PassOutput&) {
+        builder.read(result.texture);
+        builder.setSideEffects();
+    }, [](const PassOutput&, RenderGraphContext&) {});
+    return TestGraphTextures{scene.color, scene.depth, unused.texture, blurred.texture, result.texture};
+}
+
+std::string toString(const VTPageId& page)
+{
+    return std::to_string(page.level) + "/" + std::to_string(page.x) + "/" + std::to_string(page.y);
+}
+
+// page table entry that points to the slot of a page of the given level
+bool pointsTo(const VTResidency::PageTableEntry& entry, VTResidency::Slot slot, std::uint32_t level)
+{
+    return entry[0] == slot.x && entry[1] == slot.y && entry[2] == level && entry[3] == 255;
+}
+
+// a 4x4 page virtual texture (3 levels) in a cache of 2x2 slots, one of them for the pinned last level,
+// through frames that fill the cache, evict, drop, fail and load pages nobody requests any more
+std::vector<CheckResult> checkVirtualTextureResidency()
+{
+    std::vector<CheckResult> checks;
+    VTResidency residency(VTLayout{512, 128, 4}, 2, 2);
+    const VTPageId pinned{2, 0, 0};
+    const VTPageId page000{0, 0, 0};
+    const VTPageId page010{0, 1, 0};
+    const VTPageId page033{0, 3, 3};
+    const VTPageId page100{1, 0, 0};
+    const VTPageId page111{1, 1, 1};
+
+    // 1. a page and its fallbacks, coarse levels first:
+    residency.beginFrame();
+    residency.requestPage(page000);
+    const std::vector<VTPageId> firstLoads = residency.takeLoadRequests(16);
+    std::string order;
+    for (const VTPageId& page : firstLoads) {
+        order += toString(page) + " ";
+        residency.onPageLoaded(page);
+    }
+    checks.push_back(CheckResult{"VTResidency load order",
+                                 firstLoads == std::vector<VTPageId>{pinned, page100, page000}, order + "(2/0/0 1/0/0 0/0/0)"});
+
+    // 2. the last free slot, the cache is full afterwards:
+    residency.beginFrame();
+    residency.requestPage(page010);
+    for (const VTPageId& page : residency.takeLoadRequests(16)) {
+        residency.onPageLoaded(page);
+    }
+
+    // 3. 0/0/0 was not used since frame 1 -> it is evicted first. After that every page was used
+    //    in this frame, so 0/3/3 is dropped instead of evicting one of them:
+    residency.beginFrame();
+    residency.requestPage(page010);
+    residency.requestPage(page033);
+    std::optional<VTResidency::LoadResult> parentLoad;
+    std::optional<VTResidency::LoadResult> droppedLoad;
+    for (const VTPageId& page : residency.takeLoadRequests(16)) {
+        (page == page111 ? parentLoad : droppedLoad) = residency.onPageLoaded(page);
+    }
+    const bool evictedLRU = parentLoad && parentLoad->evicted && *parentLoad->evicted == page000;
+    checks.push_back(CheckResult{"VTResidency LRU eviction", evictedLRU && !residency.isResident(page000),
+                                 "evicted " + ((parentLoad && parentLoad->evicted) ? toString(*parentLoad->evicted)
+                                                                                   : std::string("nothing")) + " (0/0/0)"});
+    checks.push_back(CheckResult{"VTResidency full cache", !droppedLoad && !residency.isResident(page033)
+                                                           && residency.getResidentCount() == residency.getCapacity(),
+                                 std::string("0/3/3 ") + (droppedLoad ? "took a slot" : "dropped")});
+
+    // 4. the loader fails: the page is neither resident nor in flight and the next feedback queues it again:
+    residency.beginFrame();
+    residency.requestPage(page033);
+    const std::vector<VTPageId> retry = residency.takeLoadRequests(16);
+    for (const VTPageId& page : retry) {
+        residency.onPageLoadFailed(page);
+    }
+    const bool failedCleanly = retry == std::vector<VTPageId>{page033} && residency.getInFlightCount() == 0
+            && !residency.isResident(page033);
+    residency.requestPage(page033);
+    checks.push_back(CheckResult{"VTResidency load failure", failedCleanly && residency.getQueuedCount() == 1,
+                                 std::to_string(residency.getInFlightCount()) + " in flight, "
+                                 + std::to_string(residency.getQueuedCount()) + " queued again"});
+
+    // 5. a late result for the evicted 0/0/0 that nobody requests any more still takes the least recently
+    //    used slot, loading a resident page again changes nothing:
+    residency.beginFrame();
+    const std::optional<VTResidency::LoadResult> lateLoad = residency.onPageLoaded(page000);
+    const std::uint64_t evictionsBefore = residency.getEvictionCount();
+    const bool duplicateIgnored = !residency.onPageLoaded(page000) && residency.getEvictionCount() == evictionsBefore;
+    const bool lateLoaded = lateLoad && lateLoad->evicted && *lateLoad->evicted == page010
+            && residency.isResident(page000) && !residency.isResident(page010);
+    checks.push_back(CheckResult{"VTResidency late load", lateLoaded && duplicateIgnored,
+                                 "evicted " + ((lateLoad && lateLoad->evicted) ? toString(*lateLoad->evicted)
+                                                                               : std::string("nothing")) + " (0/1/0)"});
+
+    // 6. entries of pages that are not resident point to the nearest resident parent:
+    const std::vector<std::vector<VTResidency::PageTableEntry>>& table = residency.getPageTable();
+    const bool fallbacks = pointsTo(table[0][0], *residency.getSlot(page000), 0)  // 0/0/0 itself
+            && pointsTo(table[0][1], *residency.getSlot(page100), 1)              // 0/1/0 -> 1/0/0
+            && pointsTo(table[0][3 * 4 + 3], *residency.getSlot(page111), 1)     // 0/3/3 -> 1/1/1
+            && pointsTo(table[0][3 * 4 + 0], *residency.getSlot(pinned), 2)      // 0/0/3 -> 1/0/1 -> 2/0/0
+            && pointsTo(table[1][1 * 2 + 0], *residency.getSlot(pinned), 2);     // 1/0/1 -> 2/0/0
+    checks.push_back(CheckResult{"VTResidency page table fallback", fallbacks,
+                                 std::to_string(residency.getResidentCount()) + " resident pages"});
+    return checks;
+}
+
+// Y, U and V planes of yuv420_from_RGBA8(..)
+struct Yuv420Planes {
+    std::vector<std::uint8_t> y;
+    std::vector<std::uint8_t> u;
+    std::vector<std::uint8_t> v;
+};
+
+Yuv420Planes convertYuv420(const std::vector<std::uint8_t>& rgba, int width, int height)
+{
+    const auto chromaSize = static_cast<std::size_t>((width + 1) / 2) * static_cast<std::size_t>((height + 1) / 2);
+    Yuv420Planes planes{std::vector<std::uint8_t>(static_cast<std::size_t>(width) * static_cast<std::size_t>(height)),
+                        std::vector<std::uint8_t>(chromaSize), std::vector<std::uint8_t>(chromaSize)};
+    yuv420_from_RGBA8(rgba, width, height, planes.y, planes.u, planes.v);
+    return planes;
+}
+
+// bytes in which yuv420_from_RGBA8(..) of a random width x height image differs from its scalar path.
+// Images narrower than 16 pixels take only the scalar path, so the reference converts strips of
+// 14 columns (whole 2x2 blocks, the last strip repeats the last column of odd widths like the full image).
+std::size_t countYuv420Mismatches(int width, int height, std::mt19937& random)
+{
+    const auto w = static_cast<std::size_t>(width);
+    const auto h = static_cast<std::size_t>(height);
+    std::vector<std::uint8_t> rgba(w * h * 4);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (std::uint8_t& value : rgba) {
+        value = static_cast<std::uint8_t>(byte(random));
+    }
+    const Yuv420Planes planes = convertYuv420(rgba, width, height);
+
+    constexpr std::size_t stripWidth = 14;
+    const std::size_t chromaWidth = (w + 1) / 2;
+    const std::size_t chromaHeight = (h + 1) / 2;
+    std::size_t mismatches = 0;
+    for (std::size_t x0 = 0; x0 < w; x0 += stripWidth) {
+        const std::size_t sw = std::min(stripWidth, w - x0);
+        std::vector<std::uint8_t> strip(sw * h * 4);
+        for (std::size_t row = 0; row < h; ++row) {
+            std::copy_n(rgba.begin() + static_cast<std::ptrdiff_t>((row * w + x0) * 4), sw * 4,
+                        strip.begin() + static_cast<std::ptrdiff_t>(row * sw * 4));
+        }
+        const Yuv420Planes reference = convertYuv420(strip, static_cast<int>(sw), height);
+        for (std::size_t row = 0; row < h; ++row) {
+            for (std::size_t i = 0; i < sw; ++i) {
+                mismatches += (planes.y[row * w + x0 + i] != reference.y[row * sw + i]) ? 1 : 0;
+            }
+        }
+        const std::size_t stripChromaWidth = (sw + 1) / 2;
+        for (std::size_t row = 0; row < chromaHeight; ++row) {
+            for (std::size_t i = 0; i < stripChromaWidth; ++i) {
+                const std::size_t index = row * chromaWidth + x0 / 2 + i;
+                mismatches += (planes.u[index] != reference.u[row * stripChromaWidth + i]) ? 1 : 0;
+                mismatches += (planes.v[index] != reference.v[row * stripChromaWidth + i]) ? 1 : 0;
+            }
+        }
+    }
+    return mismatches;
+}
+
+bool parseCount(std::string_view s, std::size_t& count)
+{
+    auto [ptr, error] = std::from_chars(s.data(), s.data() + s.size(), count);
+    return error == std::errc() && ptr == s.data() + s.size() && count > 0;
+}
+
+bool parseArguments(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const std::string_view value = (i + 1 < argc) ? std::string_view(argv[i + 1]) : std::string_view();
+        if (arg == "--keep") {
+            options.keep = true;
+            continue;
+        } else if (arg == "--quads") {
+            if (!parseCount(value, options.quads)) {
+                return false;
+            }
+        } else if (arg == "--repeat") {
+            if (!parseCount(value, options.repeat)) {
+                return false;
+            }
+        } else if (arg == "--format") {
+            bool found = false;
+            for (ObjFormat format : {ObjFormat::V, ObjFormat::V_VT, ObjFormat::V_VN, ObjFormat::V_VT_VN}) {
+                if (value == getFormatName(format)) {
+                    options.format = format;
+                    found = true;
+                }
+            }
+            if (!found) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+        ++i; // (skip the value)
+    }
+    return true;
+}
+
+template <int N>
+void benchmarkIndexing(const HeightField& field, ObjFormat format, std::size_t repeat,
+                       std::vector<StageResult>& results)
+{
+    const CPUMultiIndexMesh<GLuint, N> multiIndexMesh = makeMultiIndexMesh<N>(field, format);
+    const std::size_t corners = multiIndexMesh.mib.indices.size();
+    CPUMesh<GLuint> unified;
+    results.push_back(runStage("unifyIndexBuffer", corners, "idx", corners * sizeof(std::array<GLuint, N>), repeat, [&]() {
+        SilenceStdout silence;
+        unified = unifyIndexBuffer(multiIndexMesh);
+    }));
+
+    CPUIndexBuffer<GLuint> triangles;
+    results.push_back(runStage("applyTriangleFan", corners, "idx", corners * sizeof(GLuint), repeat, [&]() {
+        triangles = applyTriangleFan(unified.ib);
+    }));
+    unified.ib = triangles;
+
+    const CPUVertexArray expanded = expandIndexBuffer(unified);
+    const std::size_t stride = static_cast<std::size_t>(expanded.layout.getStride());
+    const std::size_t vertices = expanded.data.size() / stride;
+    results.push_back(runStage("addIndexBuffer", vertices, "vert", expanded.data.size(), repeat, [&]() {
+        SilenceStdout silence;
+        const CPUMesh<GLuint> indexed = addIndexBuffer<GLuint>(expanded);
+        sink = sink + static_cast<double>(indexed.va.data.size());
+    }));
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::ios_base::sync_with_stdio(false);
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        std::cerr << "usage: cpu_benchmarks [--quads N] [--format v|v/vt|v//vn|v/vt/vn] [--repeat N] [--keep]\n";
+        return -1;
+    }
+#ifndef NDEBUG
+    std::cout << "WARNING: debug build, the timings are not representative\n";
+#endif
+
+    const HeightField field{options.quads};
+    const std::size_t gridPoints = field.getGridPointCount();
+    std::cout << "height field with " << options.quads << "x" << options.quads << " quads ("
+              << gridPoints << " grid points), format " << getFormatName(options.format)
+              << ", best and median of " << options.repeat << " runs\n\n";
+
+    std::vector<StageResult> results;
+    std::vector<CheckResult> checks;
+
+    // I. mesh pipeline:
+    const fs::path objPath = fs::temp_directory_path() / ("cpu_benchmarks_" + std::to_string(options.quads) + ".obj");
+    std::size_t objBytes = 0;
+    results.push_back(runStage("write synthetic OBJ", gridPoints, "vert", 0, 1, [&]() {
+        objBytes = writeSyntheticOBJ(objPath, field, options.format);
+    }));
+    if (objBytes == 0) {
+        return -1;
+    }
+    results.back().bytes = objBytes;
+    results.push_back(runStage("loadOBJfile", gridPoints, "vert", objBytes, options.repeat, [&]() {
+        SilenceStdout silence;
+        const std::vector<CPUMesh<GLuint>> meshes = loadOBJfile(objPath);
+        sink = sink + static_cast<double>(meshes.empty() ? 0 : meshes.front().ib.indices.size());
+    }));
+    if (!options.keep) {
+        std::error_code error;
+        fs::remove(objPath, error);
+    } else {
+        std::cout << "kept " << objPath << '\n';
+    }
+    switch (options.format) {
+    case ObjFormat::V:
+        benchmarkIndexing<1>(field, options.format, options.repeat, results);
+        break;
+    case ObjFormat::V_VT:
+    case ObjFormat::V_VN:
+        benchmarkIndexing<2>(field, options.format, options.repeat, results);
+        break;
+    case ObjFormat::V_VT_VN:
+        benchmarkIndexing<3>(field, options.format, options.repeat, results);
+        break;
+    }
+
+    const int spikes = static_cast<int>(std::min(gridPoints, static_cast<std::size_t>(1) << 20));
+    results.push_back(runStage("generateStar", static_cast<std::size_t>(spikes), "spike", 0, options.repeat, [&]() {
+        const CPUMesh<GLuint> star = generateStar(spikes, .5f, 1.f, {1.f, 1.f, 1.f, 1.f}, {1.f, 0.f, 0.f, 1.f});
+        sink = sink + static_cast<double>(star.va.data.size());
+    }));
+
+    // II. colorspace conversions of one channel per value (one 1024x1024 RGB image):
+    constexpr std::size_t channelCount = 3 * 1024 * 1024;
+    std::vector<std::uint8_t> srgb8(channelCount);
+    std::vector<float> linear(channelCount);
+    std::vector<float> converted(channelCount);
+    for (std::size_t i = 0; i < channelCount; ++i) {
+        srgb8[i] = static_cast<std::uint8_t>((i * 7) % 256);
+        linear[i] = static_cast<float>(i % 4096) / 4095.f;
+    }
+    results.push_back(runStage("linRGB_from_sRGB8 (table)", channelCount, "value", channelCount, options.repeat, [&]() {
+        linRGB_from_sRGB8(srgb8, converted);
+    }));
+    results.push_back(runStage("sRGB8_from_linRGB", channelCount, "value", channelCount * sizeof(float), options.repeat, [&]() {
+        sRGB8_from_linRGB(linear, srgb8);
+    }));
+    results.push_back(runStage("linRGB_from_sRGB (batch)", channelCount, "value", channelCount * sizeof(float), options.repeat, [&]() {
+        linRGB_from_sRGB(linear, converted);
+    }));
+    results.push_back(runStage("sRGB_from_linRGB (batch)", channelCount, "value", channelCount * sizeof(float), options.repeat, [&]() {
+        sRGB_from_linRGB(linear, converted);
+    }));
+    results.push_back(runStage("sRGB_from_linRGB (glm::vec3)", channelCount / 3, "pixel", channelCount * sizeof(float), options.repeat, [&]() {
+        glm::vec3 sum(0.f);
+        for (std::size_t i = 0; i + 2 < channelCount; i += 3) {
+            sum += sRGB_from_linRGB(glm::vec3(linear[i], linear[i + 1], linear[i + 2]));
+        }
+        sink = sink + static_cast<double>(sum.x + sum.y + sum.z);
+    }));
+    results.push_back(runStage("linRGB_from_sRGB (glm::vec3)", channelCount / 3, "pixel", channelCount * sizeof(float), options.repeat, [&]() {
+        glm::vec3 sum(0.f);
+        for (std::size_t i = 0; i + 2 < channelCount; i += 3) {
+            sum += linRGB_from_sRGB(glm::vec3(linear[i], linear[i + 1], linear[i + 2]));
+        }
+        sink = sink + static_cast<double>(sum.x + sum.y + sum.z);
+    }));
+    // the batch conversions against the scalar functions (glm::pow) on 2^20 + 1 evenly spaced values of [0, 1]:
+    constexpr std::size_t sampleCount = (1 << 20) + 1;
+    std::vector<float> samples(sampleCount);
+    for (std::size_t i = 0; i < sampleCount; ++i) {
+        samples[i] = static_cast<float>(i) / static_cast<float>(sampleCount - 1);
+    }
+    std::vector<float> batch(sampleCount);
+    double maxDecodeError = 0.;
+    linRGB_from_sRGB(samples, batch);
+    for (std::size_t i = 0; i < sampleCount; ++i) {
+        const double error = std::abs(static_cast<double>(batch[i] - linRGB_from_sRGB(glm::vec3(samples[i])).x));
+        maxDecodeError = std::max(maxDecodeError, error);
+    }
+    checks.push_back(checkAtMost("linRGB_from_sRGB (batch) error", maxDecodeError, srgbApproximationMaxError));
+    double maxEncodeError = 0.;
+    sRGB_from_linRGB(samples, batch);
+    for (std::size_t i = 0; i < sampleCount; ++i) {
+        const double error = std::abs(static_cast<double>(batch[i] - sRGB_from_linRGB(glm::vec3(samples[i])).x));
+        maxEncodeError = std::max(maxEncodeError, error);
+    }
+    checks.push_back(checkAtMost("sRGB_from_linRGB (batch) error", maxEncodeError, srgbApproximationMaxError));
+    // every 8 bit value survives the round trip through the table, and every linear value is encoded
+    // as the 8 bit value whose interval [decode((k - .5) / 255), decode((k + .5) / 255)) contains it:
+    std::array<std::uint8_t, 256> allValues;
+    for (std::size_t k = 0; k < allValues.size(); ++k) {
+        allValues[k] = static_cast<std::uint8_t>(k);
+    }
+    std::array<float, 256> decoded;
+    std::array<std::uint8_t, 256> reencoded;
+    linRGB_from_sRGB8(allValues, decoded);
+    sRGB8_from_linRGB(decoded, reencoded);
+    std::size_t mismatches = static_cast<std::size_t>(std::count_if(allValues.begin(), allValues.end(), [&](std::uint8_t k) {
+        return reencoded[k] != k;
+    }));
+    std::vector<std::uint8_t> encoded(sampleCount);
+    sRGB8_from_linRGB(samples, encoded);
+    for (std::size_t i = 0; i < sampleCount; ++i) {
+        const float k = static_cast<float>(encoded[i]);
+        const float lower = linRGB_from_sRGB(glm::vec3((k - .5f) / 255.f)).x;
+        const float upper = linRGB_from_sRGB(glm::vec3((k + .5f) / 255.f)).x;
+        if ((encoded[i] > 0 && samples[i] < lower) || (encoded[i] < 255 && samples[i] >= upper)) {
+            ++mismatches;
+        }
+    }
+    checks.push_back(CheckResult{"sRGB8_from_linRGB (exact inverse)", mismatches == 0,
+                                 std::to_string(mismatches) + " mismatches"});
+
+    // (the frame conversion of FrameStream, one 1024x1024 RGBA image)
+    constexpr int frameSize = 1024;
+    constexpr std::size_t framePixels = std::size_t(frameSize) * frameSize;
+    std::vector<std::uint8_t> rgba(framePixels * 4);
+    for (std::size_t i = 0; i < rgba.size(); ++i) {
+        rgba[i] = static_cast<std::uint8_t>((i * 7) % 256);
+    }
+    std::vector<std::uint8_t> luma(framePixels);
+    std::vector<std::uint8_t> chromaBlue(framePixels / 4);
+    std::vector<std::uint8_t> chromaRed(framePixels / 4);
+    results.push_back(runStage("yuv420_from_RGBA8", framePixels, "pixel", rgba.size(), options.repeat, [&]() {
+        yuv420_from_RGBA8(rgba, frameSize, frameSize, luma, chromaBlue, chromaRed);
+        sink = sink + static_cast<double>(luma[framePixels / 2]);
+    }));
+    // the SSE2 blocks of 16 pixels against the scalar path, byte for byte, also with odd sizes and tails:
+    std::mt19937 random(2024);
+    std::size_t yuvMismatches = 0;
+    for (auto [width, height] : {std::pair{16, 2}, std::pair{17, 9}, std::pair{33, 18}, std::pair{101, 37},
+                                 std::pair{250, 3}, std::pair{1023, 35}}) {
+        yuvMismatches += countYuv420Mismatches(width, height, random);
+    }
+    checks.push_back(CheckResult{"yuv420_from_RGBA8 SSE2 vs scalar", yuvMismatches == 0,
+                                 std::to_string(yuvMismatches) + " mismatches"});
+
+    // III. block compression of one 1024x1024 RGBA image (encoding uses all threads of the pool):
+    constexpr int imageSize = 1024;
+    constexpr std::size_t imagePixels = std::size_t(imageSize) * imageSize;
+    const CPUImage image = makeTestImage(imageSize, imageSize);
+    // (about 3 dB below what the encoder reaches on this image, far above broken endpoints or indices)
+    constexpr double minPSNR = 40.;
+    for (BlockFormat format : {BlockFormat::BC1, BlockFormat::BC3}) {
+        const std::string formatName = (format == BlockFormat::BC1) ? "BC1" : "BC3";
+        CPUCompressedImage compressed;
+        results.push_back(runStage("compressImage " + formatName, imagePixels, "pixel", image.data.size(), options.repeat, [&]() {
+            compressed = compressImage(image, format);
+        }));
+        CPUImage decompressed;
+        results.push_back(runStage("decompressImage " + formatName, imagePixels, "pixel", compressed.blocks.size(), options.repeat, [&]() {
+            decompressed = decompressImage(compressed, format);
+        }));
+        // BC1 has no alpha:
+        const int psnrChannels = (format == BlockFormat::BC1) ? 3 : 4;
+        checks.push_back(checkAtLeast(formatName + " PSNR (" + (psnrChannels == 3 ? "RGB" : "RGBA") + ")",
+                                      computePSNR(image, decompressed, psnrChannels), minPSNR, "dB"));
+    }
+
+    // IV. camera matrices (the camera moves, so nothing can be hoisted out of the loop):
+    constexpr std::size_t cameraUpdates = 1 << 20;
+    Camera camera(glm::radians(45.f), 1.5f, .1f, 100.f);
+    results.push_back(runStage("Camera (view, inverse, projection)", cameraUpdates, "cam", 0, options.repeat, [&]() {
+        float trace = 0.f;
+        for (std::size_t i = 0; i < cameraUpdates; ++i) {
+            camera.rotateYaw(1e-4f);
+            camera.translate_local(glm::vec3(0.f, 0.f, 1e-5f));
+            const glm::mat4 mvp = camera.mat_ndc_from_cc() * camera.mat_cc_from_wc();
+            const glm::mat4 wc_from_cc = camera.mat_wc_from_cc();
+            trace += mvp[0][0] + mvp[1][1] + wc_from_cc[3][0];
+        }
+        sink = sink + static_cast<double>(trace);
+    }));
+
+    // V. render graph (without a GL context, the Framebuffer demo rebuilds its graph every frame):
+    constexpr std::size_t graphBuilds = 1 << 12;
+    RenderGraph graph;
+    results.push_back(runStage("RenderGraph (build, compile)", graphBuilds, "graph", 0, options.repeat, [&]() {
+        std::size_t physicalTextures = 0;
+        for (std::size_t i = 0; i < graphBuilds; ++i) {
+            graph.clear();
+            buildTestGraph(graph);
+            graph.compile();
+            physicalTextures += graph.getPhysicalTextureCount();
+        }
+        sink = sink + static_cast<double>(physicalTextures);
+    }));
+    graph.clear();
+    const TestGraphTextures textures = buildTestGraph(graph);
+    const bool compiled = graph.compile();
+    const std::vector<std::size_t> expectedOrder = {0, 2, 3, 4};
+    std::ostringstream order;
+    for (std::size_t pass : graph.getExecutionOrder()) {
+        order << pass << ' ';
+    }
+    checks.push_back(CheckResult{"RenderGraph execution order", compiled && graph.getExecutionOrder() == expectedOrder,
+                                 order.str() + "(0 2 3 4)"});
+    checks.push_back(CheckResult{"RenderGraph culling",
+                                 graph.isCulled(1) && graph.getPhysicalTexture(textures.unused) == RenderGraph::invalidIndex,
+                                 std::string("pass \"unused\" ") + (graph.isCulled(1) ? "culled" : "not culled")});
+    const std::size_t colorPhysical = graph.getPhysicalTexture(textures.color);
+    const bool aliased = graph.getPhysicalTextureCount() == 3
+            && graph.getPhysicalTexture(textures.result) == colorPhysical
+            && graph.getPhysicalTexture(textures.blurred) != colorPhysical
+            && graph.getPhysicalTexture(textures.depth) != colorPhysical;
+    checks.push_back(CheckResult{"RenderGraph aliasing", aliased,
+                                 std::to_string(graph.getPhysicalTextureCount()) + " physical textures (3), "
+                                 + (graph.getPhysicalTexture(textures.result) == colorPhysical ? "result reuses color"
+                                                                                               : "result does not reuse color")});
+
+    // VI. virtual texture residency (the CPU side of the Virtual Texture demo):
+    for (CheckResult& check : checkVirtualTextureResidency()) {
+        checks.push_back(std::move(check));
+    }
+
+    printResults(results);
+    printChecks(checks);
+    return std::all_of(checks.begin(), checks.end(), [](const CheckResult& check) { return check.passed; }) ? 0 : 1;
+}
@@ -1,5 +1,20 @@
 #include "colorspace_utils.h"
 
+#include <algorithm> // for std::upper_bound(..), std::clamp(..), std::copy(..), std::transform(..)
+#include <array>
+#include <limits>
+
+#include "debug_utils.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLORSPACE_UTILS_USE_SSE2
+#endif
+#if defined(__AVX2__) && defined(COLORSPACE_UTILS_USE_SSE2)
+#include <immintrin.h>
+#define COLORSPACE_UTILS_USE_AVX2
+#endif
+
 // sources:
 // https://en.wikipedia.org/wiki/SRGB#Specification_of_the_transformation
 // http://www.pbr-book.org/3ed-2018/Texture/Image_Texture.html#TextureMemoryManagement
@@ -33,3 +48,389 @@ glm::vec3 linRGB_from_sRGB(const glm::vec3 &sRGB)
                      inverseGammaCorrect(sRGB.g),
                      inverseGammaCorrect(sRGB.b));
 }
+
+
+namespace {
+
+struct SrgbTables {
+    std::array<float, 256> decode;
+    // bounds[k] <= linear < bounds[k + 1] <=> linear is encoded as k.
+    // bounds[k] = decode((k - .5) / 255) for 1 <= k <= 255, bounds[0] = -inf, bounds[256] = +inf
+    std::array<float, 257> bounds;
+};
+
+const SrgbTables& getSrgbTables()
+{
+    static const SrgbTables tables = []() {
+        SrgbTables t;
+        for (std::size_t i = 0; i < t.decode.size(); ++i) {
+            t.decode[i] = inverseGammaCorrect(static_cast<float>(i) / 255.f);
+        }
+        t.bounds.front() = -std::numeric_limits<float>::infinity();
+        for (std::size_t k = 1; k < 256; ++k) {
+            t.bounds[k] = inverseGammaCorrect((static_cast<float>(k) - .5f) / 255.f);
+        }
+        t.bounds.back() = std::numeric_limits<float>::infinity();
+        return t;
+    }();
+    return tables;
+}
+
+// exact encoding of clamped linear given a candidate that is off by at most one
+inline std::uint8_t correctCandidate(float linear, int candidate, const SrgbTables& tables)
+{
+    const auto k = static_cast<std::size_t>(candidate);
+    candidate += (linear >= tables.bounds[k + 1]) ? 1 : 0;
+    candidate -= (linear < tables.bounds[k]) ? 1 : 0;
+    return static_cast<std::uint8_t>(candidate);
+}
+
+// pow(x, y) = exp2(y * log2(x)) for x > 0, by polynomials:
+//  - log2(m) for the mantissa m in [sqrt(.5), sqrt(2)) via the series of atanh(t), t = (m - 1) / (m + 1)
+//  - exp2(f) for the fraction f in [-.5, .5] via its Taylor series (relative error < 2e-7)
+constexpr float ln2 = 0.6931471805599453f;
+constexpr float log2Coeff1 = 2.f / ln2;
+constexpr float log2Coeff3 = 2.f / (3.f * ln2);
+constexpr float log2Coeff5 = 2.f / (5.f * ln2);
+constexpr float log2Coeff7 = 2.f / (7.f * ln2);
+constexpr float exp2Coeff1 = ln2;
+constexpr float exp2Coeff2 = ln2 * ln2 / 2.f;
+constexpr float exp2Coeff3 = ln2 * ln2 * ln2 / 6.f;
+constexpr float exp2Coeff4 = ln2 * ln2 * ln2 * ln2 / 24.f;
+constexpr float exp2Coeff5 = ln2 * ln2 * ln2 * ln2 * ln2 / 120.f;
+constexpr float exp2Coeff6 = ln2 * ln2 * ln2 * ln2 * ln2 * ln2 / 720.f;
+
+#ifdef COLORSPACE_UTILS_USE_SSE2
+// the kernels are written once for both register widths, these traits select the instructions:
+struct Sse2 {
+    using F = __m128;
+    using I = __m128i;
+    static constexpr std::size_t width = 4;
+    static F load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, F a) { _mm_storeu_ps(p, a); }
+    static void storeInt(std::int32_t* p, I a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a); }
+    static F set(float v) { return _mm_set1_ps(v); }
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm_div_ps(a, b); }
+    static F max(F a, F b) { return _mm_max_ps(a, b); } // b if a is NaN
+    static F min(F a, F b) { return _mm_min_ps(a, b); }
+    static F lessEqual(F a, F b) { return _mm_cmple_ps(a, b); }
+    static F select(F mask, F a, F b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    static I bits(F a) { return _mm_castps_si128(a); }
+    static F floats(I a) { return _mm_castsi128_ps(a); }
+    static I setInt(int v) { return _mm_set1_epi32(v); }
+    static I addInt(I a, I b) { return _mm_add_epi32(a, b); }
+    static I subInt(I a, I b) { return _mm_sub_epi32(a, b); }
+    static I exponentOf(I a) { return _mm_srai_epi32(a, 23); }
+    static I toExponent(I a) { return _mm_slli_epi32(a, 23); }
+    static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+    static I roundToInt(F a) { return _mm_cvtps_epi32(a); } // to nearest (default rounding mode)
+};
+#endif
+#ifdef COLORSPACE_UTILS_USE_AVX2
+struct Avx2 {
+    using F = __m256;
+    using I = __m256i;
+    static constexpr std::size_t width = 8;
+    static F load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, F a) { _mm256_storeu_ps(p, a); }
+    static void storeInt(std::int32_t* p, I a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a); }
+    static F set(float v) { return _mm256_set1_ps(v); }
+    static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm256_div_ps(a, b); }
+    static F max(F a, F b) { return _mm256_max_ps(a, b); }
+    static F min(F a, F b) { return _mm256_min_ps(a, b); }
+    static F lessEqual(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static F select(F mask, F a, F b) { return _mm256_blendv_ps(b, a, mask); }
+    static I bits(F a) { return _mm256_castps_si256(a); }
+    static F floats(I a) { return _mm256_castsi256_ps(a); }
+    static I setInt(int v) { return _mm256_set1_epi32(v); }
+    static I addInt(I a, I b) { return _mm256_add_epi32(a, b); }
+    static I subInt(I a, I b) { return _mm256_sub_epi32(a, b); }
+    static I exponentOf(I a) { return _mm256_srai_epi32(a, 23); }
+    static I toExponent(I a) { return _mm256_slli_epi32(a, 23); }
+    static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+    static I roundToInt(F a) { return _mm256_cvtps_epi32(a); }
+};
+#endif
+
+#ifdef COLORSPACE_UTILS_USE_SSE2
+// x > 0 and normal
+template<typename V>
+typename V::F log2Approx(typename V::F x)
+{
+    using I = typename V::I;
+    // x = m * 2^e with m in [sqrt(.5), sqrt(2)):
+    const I offset = V::subInt(V::bits(x), V::setInt(0x3f3504f3)); // bits of sqrt(.5)
+    const I e = V::exponentOf(offset);
+    const auto m = V::floats(V::subInt(V::bits(x), V::toExponent(e)));
+    const auto one = V::set(1.f);
+    const auto t = V::div(V::sub(m, one), V::add(m, one));
+    const auto t2 = V::mul(t, t);
+    auto p = V::add(V::set(log2Coeff5), V::mul(t2, V::set(log2Coeff7)));
+    p = V::add(V::set(log2Coeff3), V::mul(t2, p));
+    p = V::add(V::set(log2Coeff1), V::mul(t2, p));
+    return V::add(V::toFloat(e), V::mul(t, p));
+}
+
+template<typename V>
+typename V::F exp2Approx(typename V::F y)
+{
+    y = V::min(V::max(y, V::set(-126.f)), V::set(126.f));
+    // y = n + f with f in [-.5, .5]:
+    const auto n = V::roundToInt(y);
+    const auto f = V::sub(y, V::toFloat(n));
+    auto p = V::add(V::set(exp2Coeff5), V::mul(f, V::set(exp2Coeff6)));
+    p = V::add(V::set(exp2Coeff4), V::mul(f, p));
+    p = V::add(V::set(exp2Coeff3), V::mul(f, p));
+    p = V::add(V::set(exp2Coeff2), V::mul(f, p));
+    p = V::add(V::set(exp2Coeff1), V::mul(f, p));
+    p = V::add(V::set(1.f), V::mul(f, p));
+    return V::floats(V::addInt(V::bits(p), V::toExponent(n)));
+}
+
+template<typename V>
+typename V::F encodeApprox(typename V::F linear)
+{
+    const auto threshold = V::set(0.0031308f);
+    // the power is evaluated for all lanes, keep its input in the valid range:
+    const auto power = exp2Approx<V>(V::mul(V::set(1.f / 2.4f), log2Approx<V>(V::max(linear, threshold))));
+    return V::select(V::lessEqual(linear, threshold), V::mul(V::set(12.92f), linear),
+                     V::sub(V::mul(V::set(1.055f), power), V::set(0.055f)));
+}
+
+template<typename V>
+typename V::F decodeApprox(typename V::F sRGB)
+{
+    const auto threshold = V::set(0.04045f);
+    const auto base = V::mul(V::add(V::max(sRGB, threshold), V::set(0.055f)), V::set(1.f / 1.055f));
+    const auto power = exp2Approx<V>(V::mul(V::set(2.4f), log2Approx<V>(base)));
+    return V::select(V::lessEqual(sRGB, threshold), V::mul(V::set(1.f / 12.92f), sRGB), power);
+}
+
+// applies kernel to count floats, the remainder is processed through a zero padded register:
+template<typename V, typename Kernel>
+void transformFloats(const float* src, float* dst, std::size_t count, Kernel kernel)
+{
+    std::size_t i = 0;
+    for (; i + V::width <= count; i += V::width) {
+        V::store(dst + i, kernel(V::load(src + i)));
+    }
+    if (i < count) {
+        std::array<float, V::width> tail = {};
+        std::copy(src + i, src + count, tail.begin());
+        V::store(tail.data(), kernel(V::load(tail.data())));
+        std::copy(tail.begin(), tail.begin() + static_cast<std::ptrdiff_t>(count - i), dst + i);
+    }
+}
+
+// candidates for sRGB8_from_linRGB(..): clamped and approximately encoded, off by at most one
+template<typename V>
+void encodeCandidates(const float* src, std::int32_t* candidates)
+{
+    const auto linear = V::min(V::max(V::load(src), V::set(0.f)), V::set(1.f));
+    const auto scaled = V::mul(encodeApprox<V>(linear), V::set(255.f));
+    V::storeInt(candidates, V::roundToInt(V::min(V::max(scaled, V::set(0.f)), V::set(255.f))));
+}
+#endif
+
+} // namespace
+
+
+void linRGB_from_sRGB8(gsl::span<const std::uint8_t> src, gsl::span<float> dst)
+{
+    ASSERT(src.size() == dst.size());
+    const SrgbTables& tables = getSrgbTables();
+    for (std::size_t i = 0; i < src.size(); ++i) {
+        dst[i] = tables.decode[src[i]];
+    }
+}
+
+void sRGB8_from_linRGB(gsl::span<const float> src, gsl::span<std::uint8_t> dst)
+{
+    ASSERT(src.size() == dst.size());
+    const SrgbTables& tables = getSrgbTables();
+    const std::size_t count = src.size();
+    std::size_t i = 0;
+#if defined(COLORSPACE_UTILS_USE_AVX2)
+    using V = Avx2;
+#elif defined(COLORSPACE_UTILS_USE_SSE2)
+    using V = Sse2;
+#endif
+#ifdef COLORSPACE_UTILS_USE_SSE2
+    std::array<std::int32_t, V::width> candidates;
+    for (; i + V::width <= count; i += V::width) {
+        encodeCandidates<V>(src.data() + i, candidates.data());
+        for (std::size_t j = 0; j < V::width; ++j) {
+            dst[i + j] = correctCandidate(std::clamp(src[i + j], 0.f, 1.f), candidates[j], tables);
+        }
+    }
+#endif
+    // remainder (or everything without SSE2): binary search in the table
+    for (; i < count; ++i) {
+        const float linear = std::clamp(src[i], 0.f, 1.f);
+        const auto it = std::upper_bound(tables.bounds.begin() + 1, tables.bounds.end() - 1, linear);
+        dst[i] = static_cast<std::uint8_t>(it - (tables.bounds.begin() + 1));
+    }
+}
+
+void linRGB_from_sRGB(gsl::span<const float> src, gsl::span<float> dst)
+{
+    ASSERT(src.size() == dst.size());
+#if defined(COLORSPACE_UTILS_USE_AVX2)
+    transformFloats<Avx2>(src.data(), dst.data(), src.size(), decodeApprox<Avx2>);
+#elif defined(COLORSPACE_UTILS_USE_SSE2)
+    transformFloats<Sse2>(src.data(), dst.data(), src.size(), decodeApprox<Sse2>);
+#else
+    std::transform(src.begin(), src.end(), dst.begin(), inverseGammaCorrect);
+#endif
+}
+
+void sRGB_from_linRGB(gsl::span<const float> src, gsl::span<float> dst)
+{
+    ASSERT(src.size() == dst.size());
+#if defined(COLORSPACE_UTILS_USE_AVX2)
+    transformFloats<Avx2>(src.data(), dst.data(), src.size(), encodeApprox<Avx2>);
+#elif defined(COLORSPACE_UTILS_USE_SSE2)
+    transformFloats<Sse2>(src.data(), dst.data(), src.size(), encodeApprox<Sse2>);
+#else
+    std::transform(src.begin(), src.end(), dst.begin(), gammaCorrect);
+#endif
+}
+
+
+namespace {
+
+// BT.601 limited range in 8 bit fixed point (the coefficients of Y sum up to 220, those of U and V to 0):
+inline std::uint8_t lumaBT601(int r, int g, int b)
+{
+    return static_cast<std::uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+inline std::uint8_t chromaBlueBT601(int r, int g, int b)
+{
+    return static_cast<std::uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+inline std::uint8_t chromaRedBT601(int r, int g, int b)
+{
+    return static_cast<std::uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+#ifdef COLORSPACE_UTILS_USE_SSE2
+// red, green and blue of 8 RGBA pixels in 16 bit lanes
+struct Channels8 {
+    __m128i r;
+    __m128i g;
+    __m128i b;
+};
+
+inline Channels8 loadChannels8(const std::uint8_t* rgba)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba));
+    const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + 16));
+    auto channel = [&](int shift) {
+        const __m128i c0 = _mm_and_si128(_mm_srli_epi32(p0, shift), mask);
+        const __m128i c1 = _mm_and_si128(_mm_srli_epi32(p1, shift), mask);
+        return _mm_packs_epi32(c0, c1);
+    };
+    return {channel(0), channel(8), channel(16)};
+}
+
+// lumaBT601(..) of 8 pixels. The sum is at most 220 * 255 + 128, so it fits into unsigned 16 bit lanes.
+inline __m128i luma8(const Channels8& c)
+{
+    __m128i sum = _mm_mullo_epi16(c.r, _mm_set1_epi16(66));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(c.g, _mm_set1_epi16(129)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(c.b, _mm_set1_epi16(25)));
+    sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+    return _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+}
+
+// chroma of 8 averaged colors, the signed sum is within +-112 * 255 + 128
+inline __m128i chroma8(const Channels8& c, short kr, short kg, short kb)
+{
+    __m128i sum = _mm_mullo_epi16(c.r, _mm_set1_epi16(kr));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(c.g, _mm_set1_epi16(kg)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(c.b, _mm_set1_epi16(kb)));
+    sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+    return _mm_add_epi16(_mm_srai_epi16(sum, 8), _mm_set1_epi16(128));
+}
+
+// rounded averages of the 2x2 blocks of 8 pixels in two rows, in the lower 4 lanes
+inline __m128i average2x2(__m128i top, __m128i bottom)
+{
+    const __m128i pairs = _mm_madd_epi16(_mm_add_epi16(top, bottom), _mm_set1_epi16(1));
+    return _mm_srli_epi32(_mm_add_epi32(pairs, _mm_set1_epi32(2)), 2);
+}
+
+// 16 pixels of two rows: 16 luma values per row and 8 chroma samples per plane
+inline void yuv420Block16(const std::uint8_t* top, const std::uint8_t* bottom,
+                          std::uint8_t* yTop, std::uint8_t* yBottom, std::uint8_t* u, std::uint8_t* v)
+{
+    const Channels8 t0 = loadChannels8(top);
+    const Channels8 t1 = loadChannels8(top + 32);
+    const Channels8 b0 = loadChannels8(bottom);
+    const Channels8 b1 = loadChannels8(bottom + 32);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(yTop), _mm_packus_epi16(luma8(t0), luma8(t1)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(yBottom), _mm_packus_epi16(luma8(b0), luma8(b1)));
+
+    const Channels8 average = {
+        _mm_packs_epi32(average2x2(t0.r, b0.r), average2x2(t1.r, b1.r)),
+        _mm_packs_epi32(average2x2(t0.g, b0.g), average2x2(t1.g, b1.g)),
+        _mm_packs_epi32(average2x2(t0.b, b0.b), average2x2(t1.b, b1.b))
+    };
+    const __m128i zero = _mm_setzero_si128();
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(u), _mm_packus_epi16(chroma8(average, -38, -74, 112), zero));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(v), _mm_packus_epi16(chroma8(average, 112, -94, -18), zero));
+}
+#endif
+
+} // namespace
+
+
+void yuv420_from_RGBA8(gsl::span<const std::uint8_t> rgba, int width, int height,
+                       gsl::span<std::uint8_t> y, gsl::span<std::uint8_t> u, gsl::span<std::uint8_t> v)
+{
+    const auto w = static_cast<std::size_t>(width);
+    const auto h = static_cast<std::size_t>(height);
+    const std::size_t chromaWidth = (w + 1) / 2;
+    ASSERT(rgba.size() == w * h * 4);
+    ASSERT(y.size() == w * h);
+    ASSERT(u.size() == chromaWidth * ((h + 1) / 2) && v.size() == u.size());
+
+    for (std::size_t row = 0; row < h; row += 2) {
+        // output rows row and row + 1 (repeated at the bottom of odd heights) are source rows h - 1 - row, ...:
+        const std::size_t bottomRow = std::min(row + 1, h - 1);
+        const std::uint8_t* top = rgba.data() + (h - 1 - row) * w * 4;
+        const std::uint8_t* bottom = rgba.data() + (h - 1 - bottomRow) * w * 4;
+        std::uint8_t* yTop = y.data() + row * w;
+        std::uint8_t* yBottom = y.data() + bottomRow * w; // (written twice for the last odd row)
+        std::uint8_t* uRow = u.data() + row / 2 * chromaWidth;
+        std::uint8_t* vRow = v.data() + row / 2 * chromaWidth;
+
+        std::size_t x = 0;
+#ifdef COLORSPACE_UTILS_USE_SSE2
+        for (; x + 16 <= w; x += 16) {
+            yuv420Block16(top + x * 4, bottom + x * 4, yTop + x, yBottom + x, uRow + x / 2, vRow + x / 2);
+        }
+#endif
+        // remainder (or everything without SSE2), 2x2 blocks with the last column repeated for odd widths:
+        for (; x < w; x += 2) {
+            const std::size_t x1 = std::min(x + 1, w - 1);
+            const std::uint8_t* p[4] = {top + x * 4, top + x1 * 4, bottom + x * 4, bottom + x1 * 4};
+            yTop[x] = lumaBT601(p[0][0], p[0][1], p[0][2]);
+            yTop[x1] = lumaBT601(p[1][0], p[1][1], p[1][2]);
+            yBottom[x] = lumaBT601(p[2][0], p[2][1], p[2][2]);
+            yBottom[x1] = lumaBT601(p[3][0], p[3][1], p[3][2]);
+            const int r = (p[0][0] + p[1][0] + p[2][0] + p[3][0] + 2) >> 2;
+            const int g = (p[0][1] + p[1][1] + p[2][1] + p[3][1] + 2) >> 2;
+            const int b = (p[0][2] + p[1][2] + p[2][2] + p[3][2] + 2) >> 2;
+            uRow[x / 2] = chromaBlueBT601(r, g, b);
+            vRow[x / 2] = chromaRedBT601(r, g, b);
+        }
+    }
+}
@@ -0,0 +1,460 @@
+#include "cpu_image_compression.h"
+
+#include <algorithm> // for std::min(..), std::max(..), std::swap(..)
+#include <array>
+#include <cmath>     // for std::sqrt(..)
+#include <cstdint>
+
+#include "debug_utils.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPU_IMAGE_COMPRESSION_USE_SSE2
+#endif
+
+namespace {
+
+// 4x4 texels in structure of arrays layout, so 4 texels can be processed at once
+struct Block {
+    alignas(16) std::array<float, 16> r;
+    alignas(16) std::array<float, 16> g;
+    alignas(16) std::array<float, 16> b;
+    alignas(16) std::array<float, 16> a;
+};
+
+using Color = std::array<float, 3>;
+
+void fetchBlock(const CPUImage& image, int blockX, int blockY, Block& block)
+{
+    for (int y = 0; y < 4; ++y) {
+        // clamp to the border for images that are not a multiple of 4 in size:
+        const int srcY = std::min(4 * blockY + y, image.height - 1);
+        for (int x = 0; x < 4; ++x) {
+            const int srcX = std::min(4 * blockX + x, image.width - 1);
+            const GLubyte* texel = &image.data[(static_cast<std::size_t>(srcY) * static_cast<std::size_t>(image.width)
+                                                + static_cast<std::size_t>(srcX)) * 4];
+            const auto i = static_cast<std::size_t>(4 * y + x);
+            block.r[i] = texel[0];
+            block.g[i] = texel[1];
+            block.b[i] = texel[2];
+            block.a[i] = texel[3];
+        }
+    }
+}
+
+std::uint16_t pack565(const Color& c)
+{
+    auto quantize = [](float v, int maxValue) {
+        int q = static_cast<int>(v * static_cast<float>(maxValue) / 255.f + .5f);
+        return static_cast<std::uint16_t>(std::clamp(q, 0, maxValue));
+    };
+    return static_cast<std::uint16_t>((quantize(c[0], 31) << 11) | (quantize(c[1], 63) << 5) | quantize(c[2], 31));
+}
+
+Color unpack565(std::uint16_t c)
+{
+    // replicate the high bits into the low bits like the hardware does:
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+    return {static_cast<float>((r << 3) | (r >> 2)),
+            static_cast<float>((g << 2) | (g >> 4)),
+            static_cast<float>((b << 3) | (b >> 2))};
+}
+
+// writes the 2 bit index of the nearest palette entry for each texel, returns the summed squared error
+float findColorIndices(const Block& block, const std::array<Color, 4>& palette, std::uint32_t& indices)
+{
+    indices = 0;
+    float error = 0.f;
+#ifdef CPU_IMAGE_COMPRESSION_USE_SSE2
+    for (std::size_t i = 0; i < 16; i += 4) {
+        const __m128 r = _mm_load_ps(&block.r[i]);
+        const __m128 g = _mm_load_ps(&block.g[i]);
+        const __m128 b = _mm_load_ps(&block.b[i]);
+        __m128 bestDist = _mm_set1_ps(1e30f);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (int k = 0; k < 4; ++k) {
+            const Color& p = palette[static_cast<std::size_t>(k)];
+            const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(p[0]));
+            const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(p[1]));
+            const __m128 db = _mm_sub_ps(b, _mm_set1_ps(p[2]));
+            const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+            // strictly less: ties keep the lower index (required for blocks with c0 == c1)
+            const __m128 closer = _mm_cmplt_ps(dist, bestDist);
+            bestDist = _mm_min_ps(dist, bestDist);
+            const __m128i closerMask = _mm_castps_si128(closer);
+            bestIndex = _mm_or_si128(_mm_and_si128(closerMask, _mm_set1_epi32(k)),
+                                     _mm_andnot_si128(closerMask, bestIndex));
+        }
+        alignas(16) std::array<std::int32_t, 4> idx;
+        alignas(16) std::array<float, 4> dist;
+        _mm_store_si128(reinterpret_cast<__m128i*>(idx.data()), bestIndex);
+        _mm_store_ps(dist.data(), bestDist);
+        for (std::size_t j = 0; j < 4; ++j) {
+            indices |= static_cast<std::uint32_t>(idx[j]) << (2 * (i + j));
+            error += dist[j];
+        }
+    }
+#else
+    for (std::size_t i = 0; i < 16; ++i) {
+        float bestDist = 1e30f;
+        std::uint32_t bestIndex = 0;
+        for (std::uint32_t k = 0; k < 4; ++k) {
+            const Color& p = palette[k];
+            const float dr = block.r[i] - p[0];
+            const float dg = block.g[i] - p[1];
+            const float db = block.b[i] - p[2];
+            const float dist = dr * dr + dg * dg + db * db;
+            if (dist < bestDist) {
+                bestDist = dist;
+                bestIndex = k;
+            }
+        }
+        indices |= bestIndex << (2 * i);
+        error += bestDist;
+    }
+#endif
+    return error;
+}
+
+struct ColorBlock {
+    std::uint16_t c0;
+    std::uint16_t c1;
+    std::uint32_t indices;
+};
+
+// quantizes the endpoints, chooses the indices and returns the error of the result
+float makeColorBlock(const Block& block, const Color& e0, const Color& e1, ColorBlock& result)
+{
+    result.c0 = pack565(e0);
+    result.c1 = pack565(e1);
+    // c0 > c1 selects the 4 color mode (c0 == c1 decodes index 0 correctly in either mode):
+    if (result.c0 < result.c1) {
+        std::swap(result.c0, result.c1);
+    }
+    const Color p0 = unpack565(result.c0);
+    const Color p1 = unpack565(result.c1);
+    std::array<Color, 4> palette = {p0, p1, p0, p0};
+    for (std::size_t c = 0; c < 3; ++c) {
+        palette[2][c] = (2.f * p0[c] + p1[c]) / 3.f;
+        palette[3][c] = (p0[c] + 2.f * p1[c]) / 3.f;
+    }
+    return findColorIndices(block, palette, result.indices);
+}
+
+// least squares fit of the endpoints to the texels with the indices fixed.
+// returns false if the system is degenerate (e.g. all texels use the same index)
+bool fitEndpoints(const Block& block, std::uint32_t indices, Color& e0, Color& e1)
+{
+    constexpr std::array<float, 4> weights = {1.f, 0.f, 2.f / 3.f, 1.f / 3.f}; // weight of e0 per index
+    float aa = 0.f, ab = 0.f, bb = 0.f;
+    Color ax = {0.f, 0.f, 0.f};
+    Color bx = {0.f, 0.f, 0.f};
+    for (std::size_t i = 0; i < 16; ++i) {
+        const float w = weights[(indices >> (2 * i)) & 3];
+        const float v = 1.f - w;
+        aa += w * w;
+        ab += w * v;
+        bb += v * v;
+        const Color texel = {block.r[i], block.g[i], block.b[i]};
+        for (std::size_t c = 0; c < 3; ++c) {
+            ax[c] += w * texel[c];
+            bx[c] += v * texel[c];
+        }
+    }
+    const float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f) {
+        return false;
+    }
+    for (std::size_t c = 0; c < 3; ++c) {
+        e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.f, 255.f);
+        e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.f, 255.f);
+    }
+    return true;
+}
+
+void encodeColorBlock(const Block& block, GLubyte* out)
+{
+    // principal axis of the texel colors:
+    Color mean = {0.f, 0.f, 0.f};
+    for (std::size_t i = 0; i < 16; ++i) {
+        mean[0] += block.r[i];
+        mean[1] += block.g[i];
+        mean[2] += block.b[i];
+    }
+    for (float& m : mean) {
+        m /= 16.f;
+    }
+    std::array<float, 6> cov = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f}; // rr, rg, rb, gg, gb, bb
+    for (std::size_t i = 0; i < 16; ++i) {
+        const float r = block.r[i] - mean[0];
+        const float g = block.g[i] - mean[1];
+        const float b = block.b[i] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+    Color axis = {1.f, 1.f, 1.f};
+    for (int iteration = 0; iteration < 4; ++iteration) { // power iteration
+        Color next = {cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                      cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                      cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+        const float len = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (len < 1e-6f) {
+            break; // (nearly) uniform color, keep the previous axis
+        }
+        axis = {next[0] / len, next[1] / len, next[2] / len};
+    }
+
+    // endpoints at the extreme projections onto the axis:
+    float tMin = 1e30f, tMax = -1e30f;
+    for (std::size_t i = 0; i < 16; ++i) {
+        const float t = (block.r[i] - mean[0]) * axis[0] + (block.g[i] - mean[1]) * axis[1] + (block.b[i] - mean[2]) * axis[2];
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    Color e0, e1;
+    for (std::size_t c = 0; c < 3; ++c) {
+        e0[c] = std::clamp(mean[c] + tMax * axis[c], 0.f, 255.f);
+        e1[c] = std::clamp(mean[c] + tMin * axis[c], 0.f, 255.f);
+    }
+
+    ColorBlock best;
+    float bestError = makeColorBlock(block, e0, e1, best);
+    // refine the endpoints for the chosen indices (in palette order of the result):
+    for (int iteration = 0; iteration < 2 && bestError > 0.f; ++iteration) {
+        if (best.c0 == best.c1 || !fitEndpoints(block, best.indices, e0, e1)) {
+            break;
+        }
+        ColorBlock candidate;
+        const float error = makeColorBlock(block, e0, e1, candidate);
+        if (error >= bestError) {
+            break;
+        }
+        best = candidate;
+        bestError = error;
+    }
+
+    out[0] = static_cast<GLubyte>(best.c0 & 0xff);
+    out[1] = static_cast<GLubyte>(best.c0 >> 8);
+    out[2] = static_cast<GLubyte>(best.c1 & 0xff);
+    out[3] = static_cast<GLubyte>(best.c1 >> 8);
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = static_cast<GLubyte>(best.indices >> (8 * i));
+    }
+}
+
+std::array<float, 8> makeAlphaPalette(int a0, int a1)
+{
+    std::array<float, 8> palette;
+    palette[0] = static_cast<float>(a0);
+    palette[1] = static_cast<float>(a1);
+    for (int i = 2; i < 8; ++i) { // 8 value mode (a0 > a1)
+        palette[static_cast<std::size_t>(i)] = static_cast<float>(((8 - i) * a0 + (i - 1) * a1) / 7);
+    }
+    return palette;
+}
+
+void encodeAlphaBlock(const Block& block, GLubyte* out)
+{
+    float aMin = 255.f, aMax = 0.f;
+    for (float a : block.a) {
+        aMin = std::min(aMin, a);
+        aMax = std::max(aMax, a);
+    }
+    const int a0 = static_cast<int>(aMax);
+    const int a1 = static_cast<int>(aMin);
+    out[0] = static_cast<GLubyte>(a0);
+    out[1] = static_cast<GLubyte>(a1);
+    std::uint64_t indices = 0;
+    if (a0 > a1) {
+        const std::array<float, 8> palette = makeAlphaPalette(a0, a1);
+#ifdef CPU_IMAGE_COMPRESSION_USE_SSE2
+        for (std::size_t i = 0; i < 16; i += 4) {
+            const __m128 a = _mm_load_ps(&block.a[i]);
+            __m128 bestDist = _mm_set1_ps(1e30f);
+            __m128i bestIndex = _mm_setzero_si128();
+            for (int k = 0; k < 8; ++k) {
+                const __m128 d = _mm_sub_ps(a, _mm_set1_ps(palette[static_cast<std::size_t>(k)]));
+                const __m128 dist = _mm_mul_ps(d, d);
+                const __m128i closerMask = _mm_castps_si128(_mm_cmplt_ps(dist, bestDist));
+                bestDist = _mm_min_ps(dist, bestDist);
+                bestIndex = _mm_or_si128(_mm_and_si128(closerMask, _mm_set1_epi32(k)),
+                                         _mm_andnot_si128(closerMask, bestIndex));
+            }
+            alignas(16) std::array<std::int32_t, 4> idx;
+            _mm_store_si128(reinterpret_cast<__m128i*>(idx.data()), bestIndex);
+            for (std::size_t j = 0; j < 4; ++j) {
+                indices |= static_cast<std::uint64_t>(idx[j]) << (3 * (i + j));
+            }
+        }
+#else
+        for (std::size_t i = 0; i < 16; ++i) {
+            float bestDist = 1e30f;
+            std::uint64_t bestIndex = 0;
+            for (std::uint64_t k = 0; k < 8; ++k) {
+                const float d = block.a[i] - palette[k];
+                if (d * d < bestDist) {
+                    bestDist = d * d;
+                    bestIndex = k;
+                }
+            }
+            indices |= bestIndex << (3 * i);
+        }
+#endif
+    }
+    // (a0 == a1 -> all indices 0)
+    for (int i = 0; i < 6; ++i) {
+        out[2 + i] = static_cast<GLubyte>(indices >> (8 * i));
+    }
+}
+
+void decodeColorBlock(const GLubyte* in, bool allowThreeColorMode, GLubyte* rgba, std::size_t rowStride)
+{
+    const auto c0 = static_cast<std::uint16_t>(in[0] | (in[1] << 8));
+    const auto c1 = static_cast<std::uint16_t>(in[2] | (in[3] << 8));
+    const Color p0 = unpack565(c0);
+    const Color p1 = unpack565(c1);
+    std::array<std::array<GLubyte, 4>, 4> palette;
+    const bool fourColors = c0 > c1 || !allowThreeColorMode;
+    for (std::size_t c = 0; c < 3; ++c) {
+        palette[0][c] = static_cast<GLubyte>(p0[c]);
+        palette[1][c] = static_cast<GLubyte>(p1[c]);
+        if (fourColors) {
+            palette[2][c] = static_cast<GLubyte>((2.f * p0[c] + p1[c]) / 3.f + .5f);
+            palette[3][c] = static_cast<GLubyte>((p0[c] + 2.f * p1[c]) / 3.f + .5f);
+        } else {
+            palette[2][c] = static_cast<GLubyte>((p0[c] + p1[c]) / 2.f + .5f);
+            palette[3][c] = 0;
+        }
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = fourColors ? 255 : 0;
+    const std::uint32_t indices = static_cast<std::uint32_t>(in[4]) | (static_cast<std::uint32_t>(in[5]) << 8)
+                                  | (static_cast<std::uint32_t>(in[6]) << 16) | (static_cast<std::uint32_t>(in[7]) << 24);
+    for (std::size_t i = 0; i < 16; ++i) {
+        const auto& p = palette[(indices >> (2 * i)) & 3];
+        GLubyte* dst = rgba + (i / 4) * rowStride + (i % 4) * 4;
+        std::copy(p.begin(), p.end(), dst);
+    }
+}
+
+void decodeAlphaBlock(const GLubyte* in, GLubyte* rgba, std::size_t rowStride)
+{
+    const int a0 = in[0];
+    const int a1 = in[1];
+    std::array<float, 8> palette;
+    if (a0 > a1) {
+        palette = makeAlphaPalette(a0, a1);
+    } else { // 6 value mode
+        palette[0] = static_cast<float>(a0);
+        palette[1] = static_cast<float>(a1);
+        for (int i = 2; i < 6; ++i) {
+            palette[static_cast<std::size_t>(i)] = static_cast<float>(((6 - i) * a0 + (i - 1) * a1) / 5);
+        }
+        palette[6] = 0.f;
+        palette[7] = 255.f;
+    }
+    std::uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i) {
+        indices |= static_cast<std::uint64_t>(in[2 + i]) << (8 * i);
+    }
+    for (std::size_t i = 0; i < 16; ++i) {
+        rgba[(i / 4) * rowStride + (i % 4) * 4 + 3] = static_cast<GLubyte>(palette[(indices >> (3 * i)) & 7]);
+    }
+}
+
+} // namespace
+
+
+std::size_t getBlockByteSize(BlockFormat format)
+{
+    return (format == BlockFormat::BC1) ? 8 : 16;
+}
+
+std::size_t getCompressedByteSize(int width, int height, BlockFormat format)
+{
+    const auto blocksX = static_cast<std::size_t>((width + 3) / 4);
+    const auto blocksY = static_cast<std::size_t>((height + 3) / 4);
+    return blocksX * blocksY * getBlockByteSize(format);
+}
+
+CPUCompressedImage compressImage(const CPUImage &image, BlockFormat format, ThreadPool &pool)
+{
+    ASSERT(image.channels == 4);
+    CPUCompressedImage result;
+    result.width = image.width;
+    result.height = image.height;
+    result.blocks.resize(getCompressedByteSize(image.width, image.height, format));
+
+    const int blocksX = (image.width + 3) / 4;
+    const int blocksY = (image.height + 3) / 4;
+    const std::size_t blockSize = getBlockByteSize(format);
+    const std::size_t rowSize = static_cast<std::size_t>(blocksX) * blockSize;
+    pool.parallelFor(static_cast<std::size_t>(blocksY), 1, [&](std::size_t rowBegin, std::size_t rowEnd) {
+        Block block;
+        for (std::size_t by = rowBegin; by < rowEnd; ++by) {
+            GLubyte* out = result.blocks.data() + by * rowSize;
+            for (int bx = 0; bx < blocksX; ++bx) {
+                fetchBlock(image, bx, static_cast<int>(by), block);
+                if (format == BlockFormat::BC3) {
+                    encodeAlphaBlock(block, out);
+                    out += 8;
+                }
+                encodeColorBlock(block, out);
+                out += 8;
+            }
+        }
+    });
+    return result;
+}
+
+CPUCompressedTexture compressTexture(const std::vector<CPUImage> &levels, BlockFormat format, bool sRGB, ThreadPool &pool)
+{
+    CPUCompressedTexture result;
+    result.format = format;
+    result.sRGB = sRGB;
+    result.levels.reserve(levels.size());
+    for (const CPUImage& level : levels) {
+        result.levels.push_back(compressImage(level, format, pool));
+    }
+    return result;
+}
+
+CPUImage decompressImage(const CPUCompressedImage &image, BlockFormat format)
+{
+    const int blocksX = (image.width + 3) / 4;
+    const int blocksY = (image.height + 3) / 4;
+    // decode into an image padded to full blocks, then crop:
+    CPUImage padded;
+    padded.width = 4 * blocksX;
+    padded.height = 4 * blocksY;
+    padded.channels = 4;
+    padded.data.resize(padded.getRowSize() * static_cast<std::size_t>(padded.height));
+    const std::size_t rowStride = padded.getRowSize();
+    const GLubyte* in = image.blocks.data();
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            GLubyte* dst = padded.data.data() + static_cast<std::size_t>(4 * by) * rowStride + static_cast<std::size_t>(16 * bx);
+            if (format == BlockFormat::BC3) {
+                decodeColorBlock(in + 8, false, dst, rowStride);
+                decodeAlphaBlock(in, dst, rowStride);
+                in += 16;
+            } else {
+                decodeColorBlock(in, true, dst, rowStride);
+                in += 8;
+            }
+        }
+    }
+
+    CPUImage result;
+    result.width = image.width;
+    result.height = image.height;
+    result.channels = 4;
+    result.data.resize(result.getRowSize() * static_cast<std::size_t>(result.height));
+    for (int y = 0; y < result.height; ++y) {
+        const GLubyte* src = padded.data.data() + static_cast<std::size_t>(y) * rowStride;
+        std::copy(src, src + result.getRowSize(), result.data.data() + static_cast<std::size_t>(y) * result.getRowSize());
+    }
+    return result;
+}
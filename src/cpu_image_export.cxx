@@ -0,0 +1,318 @@
+#include "cpu_image_export.h"
+
+#include <algorithm> // for std::min(..)
+#include <array>
+#include <cstdint>
+#include <cstdlib>   // for std::abs(..)
+#include <fstream>
+#include <iostream>
+
+#include "debug_utils.h"
+#include "CpuProfiler.h"
+
+namespace {
+
+// PNG and zlib checksums:
+std::uint32_t crc32(const GLubyte* data, std::size_t size, std::uint32_t crc = 0)
+{
+    static const std::array<std::uint32_t, 256> table = []() {
+        std::array<std::uint32_t, 256> t = {};
+        for (std::uint32_t n = 0; n < 256; ++n) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1u) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xffu] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+std::uint32_t adler32(const std::vector<GLubyte>& data)
+{
+    constexpr std::uint32_t mod = 65521;
+    std::uint32_t a = 1;
+    std::uint32_t b = 0;
+    // (5552 bytes is the longest run that cannot overflow before the modulo)
+    for (std::size_t begin = 0; begin < data.size(); begin += 5552) {
+        const std::size_t end = std::min(begin + 5552, data.size());
+        for (std::size_t i = begin; i < end; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= mod;
+        b %= mod;
+    }
+    return (b << 16) | a;
+}
+
+void appendU32(std::vector<GLubyte>& out, std::uint32_t value)
+{
+    out.push_back(static_cast<GLubyte>(value >> 24));
+    out.push_back(static_cast<GLubyte>(value >> 16));
+    out.push_back(static_cast<GLubyte>(value >> 8));
+    out.push_back(static_cast<GLubyte>(value));
+}
+
+void appendChunk(std::vector<GLubyte>& out, const char* type, const std::vector<GLubyte>& data)
+{
+    appendU32(out, static_cast<std::uint32_t>(data.size()));
+    const std::size_t typeBegin = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    // the checksum covers type and data:
+    appendU32(out, crc32(out.data() + typeBegin, out.size() - typeBegin));
+}
+
+int paeth(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+// filter type byte and filtered bytes of each row (the input of the compression)
+std::vector<GLubyte> filterRows(const CPUImage& image, bool flipVertically)
+{
+    const std::size_t rowSize = image.getRowSize();
+    const auto bpp = static_cast<std::size_t>(image.channels);
+    std::vector<GLubyte> filtered;
+    filtered.reserve((rowSize + 1) * static_cast<std::size_t>(image.height));
+    std::array<std::vector<GLubyte>, 5> candidates;
+    for (auto& candidate : candidates) {
+        candidate.resize(rowSize);
+    }
+    const std::vector<GLubyte> zeroRow(rowSize, 0);
+    for (int y = 0; y < image.height; ++y) {
+        const int imageRow = flipVertically ? image.height - 1 - y : y;
+        const int previousRow = flipVertically ? imageRow + 1 : imageRow - 1;
+        const GLubyte* row = image.data.data() + static_cast<std::size_t>(imageRow) * rowSize;
+        const GLubyte* up = (y == 0) ? zeroRow.data() : image.data.data() + static_cast<std::size_t>(previousRow) * rowSize;
+
+        // None, Sub, Up, Average, Paeth:
+        std::size_t best = 0;
+        std::uint64_t bestSum = ~std::uint64_t(0);
+        for (std::size_t f = 0; f < candidates.size(); ++f) {
+            std::vector<GLubyte>& out = candidates[f];
+            std::uint64_t sum = 0;
+            for (std::size_t i = 0; i < rowSize; ++i) {
+                const int left = (i >= bpp) ? row[i - bpp] : 0;
+                const int upLeft = (i >= bpp) ? up[i - bpp] : 0;
+                int predicted = 0;
+                switch (f) {
+                case 1: predicted = left; break;
+                case 2: predicted = up[i]; break;
+                case 3: predicted = (left + up[i]) / 2; break;
+                case 4: predicted = paeth(left, up[i], upLeft); break;
+                default: break;
+                }
+                out[i] = static_cast<GLubyte>(row[i] - predicted);
+                // (residuals as signed bytes, small magnitudes compress best)
+                sum += static_cast<std::uint64_t>(std::abs(static_cast<int>(static_cast<signed char>(out[i]))));
+            }
+            if (sum < bestSum) {
+                bestSum = sum;
+                best = f;
+            }
+        }
+        filtered.push_back(static_cast<GLubyte>(best));
+        filtered.insert(filtered.end(), candidates[best].begin(), candidates[best].end());
+    }
+    return filtered;
+}
+
+// deflate bit stream, least significant bit first
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<GLubyte>& out)
+        : m_out(out)
+    {}
+
+    void write(std::uint32_t bits, int count) {
+        m_buffer |= static_cast<std::uint64_t>(bits) << m_count;
+        m_count += count;
+        while (m_count >= 8) {
+            m_out.push_back(static_cast<GLubyte>(m_buffer & 0xffu));
+            m_buffer >>= 8;
+            m_count -= 8;
+        }
+    }
+    // Huffman codes are defined most significant bit first
+    void writeCode(std::uint32_t code, int length) {
+        std::uint32_t reversed = 0;
+        for (int i = 0; i < length; ++i) {
+            reversed = (reversed << 1) | ((code >> i) & 1u);
+        }
+        write(reversed, length);
+    }
+    void flush() {
+        if (m_count > 0) {
+            write(0, 8 - m_count);
+        }
+    }
+
+private:
+    std::vector<GLubyte>& m_out;
+    std::uint64_t m_buffer = 0;
+    int m_count = 0;
+};
+
+// fixed Huffman code of a literal/length symbol (RFC 1951, 3.2.6)
+void writeLiteralLength(BitWriter& bits, int symbol)
+{
+    if (symbol < 144) {
+        bits.writeCode(static_cast<std::uint32_t>(0x30 + symbol), 8);
+    } else if (symbol < 256) {
+        bits.writeCode(static_cast<std::uint32_t>(0x190 + symbol - 144), 9);
+    } else if (symbol < 280) {
+        bits.writeCode(static_cast<std::uint32_t>(symbol - 256), 7);
+    } else {
+        bits.writeCode(static_cast<std::uint32_t>(0xc0 + symbol - 280), 8);
+    }
+}
+
+void writeMatch(BitWriter& bits, int length, int distance)
+{
+    static constexpr std::array<int, 29> lengthBase = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    static constexpr std::array<int, 29> lengthExtra = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    static constexpr std::array<int, 30> distanceBase = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+        4097, 6145, 8193, 12289, 16385, 24577
+    };
+    static constexpr std::array<int, 30> distanceExtra = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+    std::size_t l = lengthBase.size() - 1;
+    while (lengthBase[l] > length) {
+        --l;
+    }
+    writeLiteralLength(bits, 257 + static_cast<int>(l));
+    bits.write(static_cast<std::uint32_t>(length - lengthBase[l]), lengthExtra[l]);
+    std::size_t d = distanceBase.size() - 1;
+    while (distanceBase[d] > distance) {
+        --d;
+    }
+    bits.writeCode(static_cast<std::uint32_t>(d), 5);
+    bits.write(static_cast<std::uint32_t>(distance - distanceBase[d]), distanceExtra[d]);
+}
+
+// zlib stream of one deflate block with fixed Huffman codes. Matches are searched in hash chains
+// of 3 byte sequences, at most maxChainSteps candidates per position.
+std::vector<GLubyte> compress(const std::vector<GLubyte>& data)
+{
+    constexpr int windowSize = 32768;
+    constexpr int minMatch = 3;
+    constexpr int maxMatch = 258;
+    constexpr int maxChainSteps = 16;
+    constexpr std::size_t hashBits = 15;
+
+    std::vector<GLubyte> out = {0x78, 0x01}; // deflate, 32 KiB window, fastest compression level
+    BitWriter bits(out);
+    bits.write(1, 1); // last block
+    bits.write(1, 2); // fixed Huffman codes
+
+    std::vector<int> head(std::size_t(1) << hashBits, -1);
+    std::vector<int> previous(windowSize, -1);
+    auto hash = [&](std::size_t i) {
+        const std::uint32_t v = (std::uint32_t(data[i]) << 16) | (std::uint32_t(data[i + 1]) << 8) | data[i + 2];
+        return static_cast<std::size_t>((v * 2654435761u) >> (32 - hashBits));
+    };
+    auto insert = [&](std::size_t i) {
+        if (i + minMatch <= data.size()) {
+            const std::size_t h = hash(i);
+            previous[i % windowSize] = head[h];
+            head[h] = static_cast<int>(i);
+        }
+    };
+
+    std::size_t i = 0;
+    while (i < data.size()) {
+        int bestLength = 0;
+        int bestDistance = 0;
+        if (i + minMatch <= data.size()) {
+            const std::size_t maxLength = std::min(data.size() - i, static_cast<std::size_t>(maxMatch));
+            int candidate = head[hash(i)];
+            for (int step = 0; step < maxChainSteps && candidate >= 0; ++step) {
+                const auto distance = static_cast<int>(i) - candidate;
+                if (distance > windowSize - 1) {
+                    break;
+                }
+                std::size_t length = 0;
+                while (length < maxLength && data[static_cast<std::size_t>(candidate) + length] == data[i + length]) {
+                    ++length;
+                }
+                if (static_cast<int>(length) > bestLength) {
+                    bestLength = static_cast<int>(length);
+                    bestDistance = distance;
+                    if (length == maxLength) {
+                        break;
+                    }
+                }
+                candidate = previous[static_cast<std::size_t>(candidate) % windowSize];
+            }
+        }
+        if (bestLength >= minMatch) {
+            writeMatch(bits, bestLength, bestDistance);
+            for (int k = 0; k < bestLength; ++k) {
+                insert(i + static_cast<std::size_t>(k));
+            }
+            i += static_cast<std::size_t>(bestLength);
+        } else {
+            writeLiteralLength(bits, data[i]);
+            insert(i);
+            ++i;
+        }
+    }
+    writeLiteralLength(bits, 256); // end of block
+    bits.flush();
+    appendU32(out, adler32(data));
+    return out;
+}
+
+}
+
+std::vector<GLubyte> encodePNG(const CPUImage &image, bool flipVertically)
+{
+    CPU_PROFILE_FUNCTION();
+    ASSERT(1 <= image.channels && image.channels <= 4);
+    ASSERT(image.data.size() == image.getRowSize() * static_cast<std::size_t>(image.height));
+    static constexpr std::array<GLubyte, 4> colorTypes = {0, 4, 2, 6}; // gray, gray + alpha, RGB, RGBA
+
+    std::vector<GLubyte> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    std::vector<GLubyte> header;
+    appendU32(header, static_cast<std::uint32_t>(image.width));
+    appendU32(header, static_cast<std::uint32_t>(image.height));
+    header.push_back(8); // bits per channel
+    header.push_back(colorTypes[static_cast<std::size_t>(image.channels - 1)]);
+    header.push_back(0); // deflate
+    header.push_back(0); // adaptive filtering
+    header.push_back(0); // not interlaced
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", compress(filterRows(image, flipVertically)));
+    appendChunk(png, "IEND", {});
+    return png;
+}
+
+bool writePNGFile(const std::filesystem::path &filepath, const CPUImage &image, bool flipVertically)
+{
+    const std::vector<GLubyte> png = encodePNG(image, flipVertically);
+    std::ofstream file(filepath, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+    if (!file) {
+        std::cerr << "WARNING: could not write " << filepath << '\n';
+        return false;
+    }
+    return true;
+}
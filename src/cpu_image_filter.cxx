@@ -0,0 +1,189 @@
+#include "cpu_image_filter.h"
+
+#include <algorithm> // for std::clamp(..), std::copy_n(..), std::max(..)
+#include <cmath>     // for std::exp(..), std::abs(..)
+#include <utility>   // for std::move(..)
+
+#include "debug_utils.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPU_IMAGE_FILTER_USE_SSE2
+#endif
+
+namespace {
+
+std::size_t rowGrainSize(int width)
+{
+    // about 16k pixels per task
+    return static_cast<std::size_t>(std::max(1, 16384 / std::max(width, 1)));
+}
+
+// copies row y of the image with radius pixels clamped to the edge on both sides:
+void copyPaddedRow(const CPUImageRGBA32F& image, int y, int radius, std::vector<float>& padded)
+{
+    const std::size_t width = static_cast<std::size_t>(image.width);
+    const std::size_t r = static_cast<std::size_t>(radius);
+    padded.resize((width + 2 * r) * 4);
+    const float* src = image.row(y);
+    for (std::size_t i = 0; i < r; ++i) {
+        std::copy_n(src, 4, padded.data() + i * 4);
+        std::copy_n(src + (width - 1) * 4, 4, padded.data() + (r + width + i) * 4);
+    }
+    std::copy_n(src, width * 4, padded.data() + r * 4);
+}
+
+// one pass of the convolution (the whole 2D kernel or one of the 1D factors):
+void convolvePass(const CPUImageRGBA32F& in, CPUImageRGBA32F& out,
+                  const float* weights, int radiusX, int radiusY, bool outputAbsolute, ThreadPool& pool)
+{
+    const int width = in.width;
+    const int height = in.height;
+    const int kernelWidth = 2 * radiusX + 1;
+    const int kernelHeight = 2 * radiusY + 1;
+
+    // taps with weight 0 (e.g. the center column of the sobel kernel) are skipped:
+    struct Tap {
+        std::size_t row;    // index into the source rows of the output row
+        std::size_t column; // offset in the padded row
+        float weight;
+    };
+    std::vector<Tap> taps;
+    for (int j = 0; j < kernelHeight; ++j) {
+        for (int i = 0; i < kernelWidth; ++i) {
+            const float weight = weights[j * kernelWidth + i];
+            if (weight != 0.f) {
+                taps.push_back(Tap{static_cast<std::size_t>(j), static_cast<std::size_t>(i), weight});
+            }
+        }
+    }
+
+    pool.parallelFor(static_cast<std::size_t>(height), rowGrainSize(width), [&](std::size_t begin, std::size_t end) {
+        // source rows of the current output row (padded only if the kernel reaches left/right):
+        std::vector<std::vector<float>> paddedRows(radiusX > 0 ? static_cast<std::size_t>(kernelHeight) : 0);
+        std::vector<const float*> rows(static_cast<std::size_t>(kernelHeight));
+        for (int y = static_cast<int>(begin); y < static_cast<int>(end); ++y) {
+            for (int j = 0; j < kernelHeight; ++j) {
+                const int srcY = std::clamp(y + radiusY - j, 0, height - 1);
+                if (radiusX > 0) {
+                    copyPaddedRow(in, srcY, radiusX, paddedRows[static_cast<std::size_t>(j)]);
+                    rows[static_cast<std::size_t>(j)] = paddedRows[static_cast<std::size_t>(j)].data();
+                } else {
+                    rows[static_cast<std::size_t>(j)] = in.row(srcY);
+                }
+            }
+            // (in padded rows pixel x + i - radiusX is at index x + i)
+            float* dst = out.row(y);
+            for (int x = 0; x < width; ++x) {
+#ifdef CPU_IMAGE_FILTER_USE_SSE2
+                __m128 sum = _mm_setzero_ps();
+                for (const Tap& tap : taps) {
+                    const float* src = rows[tap.row] + (static_cast<std::size_t>(x) + tap.column) * 4;
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(tap.weight), _mm_loadu_ps(src)));
+                }
+                if (outputAbsolute) {
+                    // clear the sign bits:
+                    sum = _mm_andnot_ps(_mm_set1_ps(-0.f), sum);
+                }
+                _mm_storeu_ps(dst + static_cast<std::size_t>(x) * 4, sum);
+#else
+                float sum[4] = {0.f, 0.f, 0.f, 0.f};
+                for (const Tap& tap : taps) {
+                    const float* src = rows[tap.row] + (static_cast<std::size_t>(x) + tap.column) * 4;
+                    for (std::size_t c = 0; c < 4; ++c) {
+                        sum[c] += tap.weight * src[c];
+                    }
+                }
+                for (std::size_t c = 0; c < 4; ++c) {
+                    dst[static_cast<std::size_t>(x) * 4 + c] = outputAbsolute ? std::abs(sum[c]) : sum[c];
+                }
+#endif
+                dst[static_cast<std::size_t>(x) * 4 + 3] = 1.f;
+            }
+        }
+    });
+}
+
+}
+
+ConvolutionKernel makeKernel(std::string name, int radiusX, int radiusY, std::vector<float> weights, bool absolute)
+{
+    ASSERT(0 <= radiusX && radiusX <= maxConvolutionRadius);
+    ASSERT(0 <= radiusY && radiusY <= maxConvolutionRadius);
+    ASSERT(weights.size() == static_cast<std::size_t>((2 * radiusX + 1) * (2 * radiusY + 1)));
+    ConvolutionKernel kernel;
+    kernel.name = std::move(name);
+    kernel.radiusX = radiusX;
+    kernel.radiusY = radiusY;
+    kernel.weights = std::move(weights);
+    kernel.absolute = absolute;
+    return kernel;
+}
+
+ConvolutionKernel makeSeparableKernel(std::string name, std::vector<float> row, std::vector<float> column, bool absolute)
+{
+    ASSERT(row.size() % 2 == 1 && column.size() % 2 == 1);
+    std::vector<float> weights;
+    weights.reserve(row.size() * column.size());
+    for (float c : column) {
+        for (float r : row) {
+            weights.push_back(c * r);
+        }
+    }
+    ConvolutionKernel kernel = makeKernel(std::move(name), static_cast<int>(row.size() / 2), static_cast<int>(column.size() / 2),
+                                          std::move(weights), absolute);
+    kernel.row = std::move(row);
+    kernel.column = std::move(column);
+    return kernel;
+}
+
+ConvolutionKernel makeSobelKernel()
+{
+    //  1  0 -1
+    //  2  0 -2
+    //  1  0 -1
+    return makeSeparableKernel("sobel", {1.f, 0.f, -1.f}, {1.f, 2.f, 1.f}, true);
+}
+
+ConvolutionKernel makeGaussianKernel(int radius, float sigma)
+{
+    ASSERT(0 <= radius && radius <= maxConvolutionRadius && sigma > 0.f);
+    std::vector<float> weights;
+    float sum = 0.f;
+    for (int i = -radius; i <= radius; ++i) {
+        const float x = static_cast<float>(i);
+        weights.push_back(std::exp(-x * x / (2.f * sigma * sigma)));
+        sum += weights.back();
+    }
+    for (float& w : weights) {
+        w /= sum;
+    }
+    return makeSeparableKernel("gaussian " + std::to_string(2 * radius + 1) + "x" + std::to_string(2 * radius + 1),
+                               weights, weights);
+}
+
+ConvolutionKernel makeLaplacianKernel()
+{
+    return makeKernel("laplacian", 1, 1, {0.f,  1.f, 0.f,
+                                          1.f, -4.f, 1.f,
+                                          0.f,  1.f, 0.f}, true);
+}
+
+void applyConvolution(const ConvolutionKernel &kernel, const CPUImageRGBA32F &in, CPUImageRGBA32F &out, ThreadPool &pool)
+{
+    ASSERT(in.data.size() == static_cast<std::size_t>(in.width) * static_cast<std::size_t>(in.height) * 4);
+    ASSERT(&in != &out);
+    out.width = in.width;
+    out.height = in.height;
+    out.data.resize(in.data.size());
+    if (in.data.empty()) {
+        return;
+    }
+    if (kernel.isSeparable()) {
+        CPUImageRGBA32F tmp{in.width, in.height, std::vector<float>(in.data.size())};
+        convolvePass(in, tmp, kernel.row.data(), kernel.radiusX, 0, false, pool);
+        convolvePass(tmp, out, kernel.column.data(), 0, kernel.radiusY, kernel.absolute, pool);
+    } else {
+        convolvePass(in, out, kernel.weights.data(), kernel.radiusX, kernel.radiusY, kernel.absolute, pool);
+    }
+}
@@ -0,0 +1,38 @@
+#include "cpu_image_import.h"
+
+#include <algorithm> // for std::copy(..)
+#include <iostream>
+
+#include "debug_utils.h"
+#include "CpuProfiler.h"
+#include "stb_image.h"
+
+std::optional<CPUImage> loadImageFile(const std::filesystem::path &filepath, int channels, bool flipVertically)
+{
+    CPU_PROFILE_FUNCTION();
+    ASSERT(1 <= channels && channels <= 4);
+    // the thread local variant does not race with decoders running on other threads:
+    stbi_set_flip_vertically_on_load_thread(flipVertically ? 1 : 0);
+
+    int width, height, channels_in_file;
+    unsigned char* pix_data = nullptr;
+    {
+        CPU_PROFILE_SCOPE("stbi_load");
+        pix_data = stbi_load(filepath.string().c_str(), &width, &height, &channels_in_file, channels);
+    }
+    if (!pix_data) {
+        std::cerr << "WARNING: could not load image " << filepath << ": " << stbi_failure_reason() << '\n';
+        return std::nullopt;
+    }
+    DEBUG_DO(std::cout << "available channels in file " << filepath << ": " << channels_in_file << '\n');
+    ASSERT(channels_in_file >= channels || channels == 4); // missing alpha is filled with opaque
+
+    CPUImage image;
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.data.resize(image.getRowSize() * static_cast<std::size_t>(height));
+    std::copy(pix_data, pix_data + image.data.size(), image.data.begin());
+    stbi_image_free(pix_data);
+    return image;
+}
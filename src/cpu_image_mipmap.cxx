@@ -0,0 +1,276 @@
+#include "cpu_image_mipmap.h"
+
+#include <algorithm> // for std::clamp(..), std::fill(..), std::copy_n(..)
+#include <array>
+#include <cmath>     // for std::sin(..), std::sqrt(..), std::floor(..), std::ceil(..)
+
+#include "colorspace_utils.h"
+#include "debug_utils.h"
+#include "CpuProfiler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPU_IMAGE_MIPMAP_USE_SSE2
+#endif
+
+namespace {
+
+// 4 floats per texel (unused channels are 0), so one texel fills one SSE register
+struct LinearImage {
+    int width = 0;
+    int height = 0;
+    std::vector<float> texels;
+
+    float* row(int y) {
+        return texels.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(width) * 4;
+    }
+    const float* row(int y) const {
+        return texels.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(width) * 4;
+    }
+};
+
+GLubyte encodeLinear(float value)
+{
+    return static_cast<GLubyte>(std::clamp(value, 0.f, 1.f) * 255.f + .5f);
+}
+
+std::size_t rowGrainSize(int width)
+{
+    // about 16k texels per task
+    return static_cast<std::size_t>(std::max(1, 16384 / std::max(width, 1)));
+}
+
+bool isColorChannel(int channel, int channels, bool sRGB)
+{
+    // alpha (4th channel) is always linear
+    return sRGB && channel < 3 && !(channels == 2 && channel == 1);
+}
+
+LinearImage toLinear(const CPUImage& image, bool sRGB, ThreadPool& pool)
+{
+    LinearImage result;
+    result.width = image.width;
+    result.height = image.height;
+    result.texels.assign(static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height) * 4, 0.f);
+    pool.parallelFor(static_cast<std::size_t>(image.height), rowGrainSize(image.width),
+                     [&](std::size_t rowBegin, std::size_t rowEnd) {
+        std::vector<float> decoded(image.getRowSize());
+        for (std::size_t y = rowBegin; y < rowEnd; ++y) {
+            const GLubyte* src = image.data.data() + y * image.getRowSize();
+            if (sRGB) {
+                // whole row through the lookup table, the linear channels are fixed up below:
+                linRGB_from_sRGB8(gsl::span<const GLubyte>(src, decoded.size()), decoded);
+            }
+            float* dst = result.row(static_cast<int>(y));
+            const float* decodedTexel = decoded.data();
+            for (int x = 0; x < image.width; ++x) {
+                for (int c = 0; c < image.channels; ++c) {
+                    const GLubyte v = *src++;
+                    dst[c] = isColorChannel(c, image.channels, sRGB) ? decodedTexel[c]
+                                                                     : static_cast<float>(v) * (1.f / 255.f);
+                }
+                decodedTexel += image.channels;
+                dst += 4;
+            }
+        }
+    });
+    return result;
+}
+
+CPUImage fromLinear(const LinearImage& image, int channels, bool sRGB, ThreadPool& pool)
+{
+    CPUImage result;
+    result.width = image.width;
+    result.height = image.height;
+    result.channels = channels;
+    result.data.resize(result.getRowSize() * static_cast<std::size_t>(result.height));
+    pool.parallelFor(static_cast<std::size_t>(image.height), rowGrainSize(image.width),
+                     [&](std::size_t rowBegin, std::size_t rowEnd) {
+        std::vector<float> packed(result.getRowSize());
+        for (std::size_t y = rowBegin; y < rowEnd; ++y) {
+            // drop the unused channels of the 4 float texels:
+            const float* src = image.row(static_cast<int>(y));
+            float* packedTexel = packed.data();
+            for (int x = 0; x < image.width; ++x, src += 4, packedTexel += channels) {
+                std::copy_n(src, channels, packedTexel);
+            }
+
+            GLubyte* dst = result.data.data() + y * result.getRowSize();
+            gsl::span<GLubyte> dstRow(dst, packed.size());
+            if (sRGB) {
+                sRGB8_from_linRGB(packed, dstRow);
+            }
+            for (std::size_t i = 0; i < packed.size(); ++i) {
+                if (!isColorChannel(static_cast<int>(i % static_cast<std::size_t>(channels)), channels, sRGB)) {
+                    dst[i] = encodeLinear(packed[i]);
+                }
+            }
+        }
+    });
+    return result;
+}
+
+// source indices and weights of every destination texel along one axis
+struct FilterTaps {
+    int tapCount = 0;
+    std::vector<int> indices;    // dstSize * tapCount, already clamped to the source
+    std::vector<float> weights;  // dstSize * tapCount, normalized per destination texel
+};
+
+float besselI0(float x)
+{
+    // power series, converges quickly for the small arguments used here
+    float sum = 1.f;
+    float term = 1.f;
+    for (int k = 1; k < 20; ++k) {
+        const float f = x / (2.f * static_cast<float>(k));
+        term *= f * f;
+        sum += term;
+    }
+    return sum;
+}
+
+float kaiserSinc(float u, float radius)
+{
+    constexpr float pi = 3.14159265358979f;
+    constexpr float beta = 4.f;
+    if (std::abs(u) >= radius) {
+        return 0.f;
+    }
+    const float sinc = (u == 0.f) ? 1.f : std::sin(pi * u) / (pi * u);
+    const float r = u / radius;
+    return sinc * besselI0(beta * std::sqrt(1.f - r * r)) / besselI0(beta);
+}
+
+FilterTaps computeTaps(int srcSize, int dstSize, MipFilter filter)
+{
+    // kernel radius in destination texels:
+    const float radius = (filter == MipFilter::Box) ? .5f : 2.f;
+    const float scale = static_cast<float>(srcSize) / static_cast<float>(dstSize);
+
+    FilterTaps taps;
+    taps.tapCount = static_cast<int>(std::ceil(2.f * radius * scale)) + 1;
+    const auto count = static_cast<std::size_t>(dstSize) * static_cast<std::size_t>(taps.tapCount);
+    taps.indices.resize(count);
+    taps.weights.resize(count);
+    for (int d = 0; d < dstSize; ++d) {
+        const float center = (static_cast<float>(d) + .5f) * scale; // in source coordinates
+        const int first = static_cast<int>(std::floor(center - radius * scale));
+        const std::size_t base = static_cast<std::size_t>(d) * static_cast<std::size_t>(taps.tapCount);
+        float sum = 0.f;
+        for (int t = 0; t < taps.tapCount; ++t) {
+            const int s = first + t;
+            float w;
+            if (filter == MipFilter::Box) {
+                // overlap of the source texel [s, s+1] with the footprint of the destination texel
+                const float lo = std::max(static_cast<float>(s), center - .5f * scale);
+                const float hi = std::min(static_cast<float>(s + 1), center + .5f * scale);
+                w = std::max(hi - lo, 0.f);
+            } else {
+                w = kaiserSinc((static_cast<float>(s) + .5f - center) / scale, radius);
+            }
+            taps.indices[base + static_cast<std::size_t>(t)] = std::clamp(s, 0, srcSize - 1);
+            taps.weights[base + static_cast<std::size_t>(t)] = w;
+            sum += w;
+        }
+        for (int t = 0; t < taps.tapCount; ++t) {
+            taps.weights[base + static_cast<std::size_t>(t)] /= sum;
+        }
+    }
+    return taps;
+}
+
+// dst[0..3] += w * src[0..3]
+inline void accumulateTexel(float* dst, const float* src, float w)
+{
+#ifdef CPU_IMAGE_MIPMAP_USE_SSE2
+    _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_mul_ps(_mm_set1_ps(w), _mm_loadu_ps(src))));
+#else
+    for (int c = 0; c < 4; ++c) {
+        dst[c] += w * src[c];
+    }
+#endif
+}
+
+// dst[0..n) += w * src[0..n), n is a multiple of 4
+inline void accumulateRow(float* dst, const float* src, float w, std::size_t n)
+{
+#ifdef CPU_IMAGE_MIPMAP_USE_SSE2
+    const __m128 wv = _mm_set1_ps(w);
+    for (std::size_t i = 0; i < n; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(wv, _mm_loadu_ps(src + i))));
+    }
+#else
+    for (std::size_t i = 0; i < n; ++i) {
+        dst[i] += w * src[i];
+    }
+#endif
+}
+
+LinearImage downsample(const LinearImage& src, int dstWidth, int dstHeight, MipFilter filter, ThreadPool& pool)
+{
+    const FilterTaps hTaps = computeTaps(src.width, dstWidth, filter);
+    const FilterTaps vTaps = computeTaps(src.height, dstHeight, filter);
+
+    // horizontal pass: dstWidth x src.height
+    LinearImage tmp;
+    tmp.width = dstWidth;
+    tmp.height = src.height;
+    tmp.texels.assign(static_cast<std::size_t>(dstWidth) * static_cast<std::size_t>(src.height) * 4, 0.f);
+    pool.parallelFor(static_cast<std::size_t>(src.height), rowGrainSize(src.width),
+                     [&](std::size_t rowBegin, std::size_t rowEnd) {
+        for (std::size_t y = rowBegin; y < rowEnd; ++y) {
+            const float* srcRow = src.row(static_cast<int>(y));
+            float* dstTexel = tmp.row(static_cast<int>(y));
+            for (std::size_t x = 0; x < static_cast<std::size_t>(dstWidth); ++x, dstTexel += 4) {
+                const std::size_t base = x * static_cast<std::size_t>(hTaps.tapCount);
+                for (std::size_t t = 0; t < static_cast<std::size_t>(hTaps.tapCount); ++t) {
+                    const float w = hTaps.weights[base + t];
+                    if (w != 0.f) {
+                        accumulateTexel(dstTexel, srcRow + 4 * static_cast<std::size_t>(hTaps.indices[base + t]), w);
+                    }
+                }
+            }
+        }
+    });
+
+    // vertical pass: dstWidth x dstHeight
+    LinearImage result;
+    result.width = dstWidth;
+    result.height = dstHeight;
+    result.texels.assign(static_cast<std::size_t>(dstWidth) * static_cast<std::size_t>(dstHeight) * 4, 0.f);
+    const std::size_t rowFloats = static_cast<std::size_t>(dstWidth) * 4;
+    pool.parallelFor(static_cast<std::size_t>(dstHeight), rowGrainSize(dstWidth),
+                     [&](std::size_t rowBegin, std::size_t rowEnd) {
+        for (std::size_t y = rowBegin; y < rowEnd; ++y) {
+            float* dstRow = result.row(static_cast<int>(y));
+            const std::size_t base = y * static_cast<std::size_t>(vTaps.tapCount);
+            for (std::size_t t = 0; t < static_cast<std::size_t>(vTaps.tapCount); ++t) {
+                const float w = vTaps.weights[base + t];
+                if (w != 0.f) {
+                    accumulateRow(dstRow, tmp.row(vTaps.indices[base + t]), w, rowFloats);
+                }
+            }
+        }
+    });
+    return result;
+}
+
+} // namespace
+
+
+std::vector<CPUImage> generateMipChain(const CPUImage &image, bool sRGB, MipFilter filter, ThreadPool &pool)
+{
+    CPU_PROFILE_FUNCTION();
+    ASSERT(1 <= image.channels && image.channels <= 4);
+    ASSERT(image.width > 0 && image.height > 0);
+    std::vector<CPUImage> levels;
+    levels.push_back(image);
+
+    LinearImage linear = toLinear(image, sRGB, pool);
+    while (linear.width > 1 || linear.height > 1) {
+        linear = downsample(linear, std::max(linear.width / 2, 1), std::max(linear.height / 2, 1), filter, pool);
+        levels.push_back(fromLinear(linear, image.channels, sRGB, pool));
+    }
+    return levels;
+}
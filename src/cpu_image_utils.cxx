@@ -0,0 +1,29 @@
+#include "cpu_image_utils.h"
+
+#include <cmath>     // for std::log10(..)
+#include <limits>
+
+#include "debug_utils.h"
+
+double computePSNR(const CPUImage &reference, const CPUImage &test, int channelCount)
+{
+    ASSERT(reference.width == test.width && reference.height == test.height);
+    ASSERT(channelCount <= reference.channels && channelCount <= test.channels);
+
+    const std::size_t texelCount = static_cast<std::size_t>(reference.width) * static_cast<std::size_t>(reference.height);
+    const auto refChannels = static_cast<std::size_t>(reference.channels);
+    const auto testChannels = static_cast<std::size_t>(test.channels);
+    double sumSqErr = 0.0;
+    for (std::size_t i = 0; i < texelCount; ++i) {
+        for (std::size_t c = 0; c < static_cast<std::size_t>(channelCount); ++c) {
+            double diff = static_cast<double>(reference.data[i * refChannels + c])
+                          - static_cast<double>(test.data[i * testChannels + c]);
+            sumSqErr += diff * diff;
+        }
+    }
+    if (sumSqErr == 0.0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    double mse = sumSqErr / static_cast<double>(texelCount * static_cast<std::size_t>(channelCount));
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
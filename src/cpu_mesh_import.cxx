@@ -7,6 +7,7 @@
 #include <regex>
 
 #include "debug_utils.h"
+#include "CpuProfiler.h"
 
 #include <algorithm>
 
@@ -362,6 +363,7 @@ inline CPUMesh<GLuint> wavefrontObjectToMesh(const WavefrontObject& obj, bool* s
 
 std::vector<CPUMesh<GLuint>> loadOBJfile(const std::filesystem::path& filepath, bool invert_z)
 {
+    CPU_PROFILE_FUNCTION();
     ifstream ifs {filepath};
     if (!ifs) {
         cerr << "error opening file " << filepath << '\n';
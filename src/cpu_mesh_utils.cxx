@@ -1,4 +1,126 @@
 #include "cpu_mesh_utils.h"
 
+#include <cstring> // for std::memcpy()
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPU_MESH_UTILS_USE_SSE2
+#endif
 
+
+#ifdef CPU_MESH_UTILS_USE_SSE2
+// 12 byte elements (e.g. 3D positions) into a tightly packed destination:
+// gathers 4 elements into 3 registers per iteration.
+// each load reads 4 bytes past the end of the element it is interested in. This is
+// only safe as long as there is at least one more element after the 4 loaded ones.
+// -> returns the number of elements that were copied, the caller has to copy the rest.
+static std::size_t copyStrided12Packed(GLbyte* dst, const GLbyte* src, std::size_t srcStride, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 4 < count; i += 4) {
+        const GLbyte* s = src + i * srcStride;
+        __m128 a = _mm_loadu_ps(reinterpret_cast<const float*>(s));                 // a0 a1 a2 --
+        __m128 b = _mm_loadu_ps(reinterpret_cast<const float*>(s + srcStride));     // b0 b1 b2 --
+        __m128 c = _mm_loadu_ps(reinterpret_cast<const float*>(s + 2 * srcStride)); // c0 c1 c2 --
+        __m128 d = _mm_loadu_ps(reinterpret_cast<const float*>(s + 3 * srcStride)); // d0 d1 d2 --
+
+        __m128 a2b0 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 2, 2));                // a2 a2 b0 b0
+        __m128 out0 = _mm_shuffle_ps(a, a2b0, _MM_SHUFFLE(2, 0, 1, 0));             // a0 a1 a2 b0
+        __m128 out1 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 2, 1));                // b1 b2 c0 c1
+        __m128 c2d0 = _mm_shuffle_ps(c, d, _MM_SHUFFLE(0, 0, 2, 2));                // c2 c2 d0 d0
+        __m128 out2 = _mm_shuffle_ps(c2d0, d, _MM_SHUFFLE(2, 1, 2, 0));             // c2 d0 d1 d2
+
+        float* o = reinterpret_cast<float*>(dst + i * 12);
+        _mm_storeu_ps(o, out0);
+        _mm_storeu_ps(o + 4, out1);
+        _mm_storeu_ps(o + 8, out2);
+    }
+    return i;
+}
+#endif
+
+void copyStrided(GLbyte* dst, std::size_t dstStride,
+                 const GLbyte* src, std::size_t srcStride,
+                 std::size_t elemSize, std::size_t count)
+{
+    std::size_t i = 0;
+#ifdef CPU_MESH_UTILS_USE_SSE2
+    switch (elemSize) {
+    case 16:
+        for (; i < count; ++i) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * srcStride));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * dstStride), v);
+        }
+        break;
+    case 12:
+        if (dstStride == 12) {
+            i = copyStrided12Packed(dst, src, srcStride, count);
+        }
+        break;
+    case 8:
+        for (; i < count; ++i) {
+            __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i * srcStride));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * dstStride), v);
+        }
+        break;
+    default:
+        break;
+    }
+#endif
+    // remaining elements (or everything if there is no SIMD kernel for elemSize):
+    for (; i < count; ++i) {
+        std::memcpy(dst + i * dstStride, src + i * srcStride, elemSize);
+    }
+}
+
+std::vector<CPUVertexArray> splitVertexArray(const CPUVertexArray& va,
+                                             const std::vector<std::vector<VertexBufferLayout::count_type>>& attribsPerStream)
+{
+    const auto& attrs = va.layout.getAttributes();
+    const auto srcStride = static_cast<std::size_t>(va.layout.getStride());
+    ASSERT(srcStride > 0 && va.data.size() % srcStride == 0);
+    const std::size_t vertCount = va.data.size() / srcStride;
+
+    std::vector<CPUVertexArray> streams;
+    streams.reserve(attribsPerStream.size());
+    for (const auto& attribIndices : attribsPerStream) {
+        CPUVertexArray stream;
+        for (auto i_a : attribIndices) {
+            ASSERT(i_a < attrs.size());
+            stream.layout.append(attrs[i_a]);
+        }
+        const auto dstStride = static_cast<std::size_t>(stream.layout.getStride());
+        stream.data.resize(vertCount * dstStride);
+        // copy one attribute at a time over all vertices:
+        const auto& streamAttrs = stream.layout.getAttributes();
+        for (VertexBufferLayout::count_type j = 0; j < attribIndices.size(); ++j) {
+            const VertexAttributeLayout& srcAttr = attrs[attribIndices[j]];
+            copyStrided(stream.data.data() + streamAttrs[j].offset, dstStride,
+                        va.data.data() + srcAttr.offset, srcStride,
+                        VertexBufferLayout::getAttributeSize(srcAttr), vertCount);
+        }
+        streams.push_back(std::move(stream));
+    }
+    return streams;
+}
+
+std::vector<CPUVertexArray> splitPositionStream(const CPUVertexArray& va, const std::string& positionName)
+{
+    using count_type = VertexBufferLayout::count_type;
+    std::optional<count_type> posIndex = va.layout.findAttribute(positionName);
+    if (!posIndex) {
+        std::cerr << "warning: vertex array has no attribute " << positionName
+                  << ". Can not split off a position stream.\n";
+        return std::vector<CPUVertexArray>{va};
+    }
+    std::vector<count_type> others;
+    for (count_type i = 0; i < va.layout.getAttributes().size(); ++i) {
+        if (i != *posIndex) {
+            others.push_back(i);
+        }
+    }
+    if (others.empty()) {
+        return std::vector<CPUVertexArray>{va};
+    }
+    return splitVertexArray(va, {{*posIndex}, others});
+}
@@ -0,0 +1,131 @@
+#include "cpu_texture_packing.h"
+
+#include <algorithm> // for std::max(..), std::clamp(..), std::copy_n(..), std::stable_sort(..)
+#include <map>
+
+#include "debug_utils.h"
+
+namespace {
+
+// copies image into layer at (x, y) and repeats its edge texels `padding` times around it
+void blitPadded(const CPUImage& image, CPUImage& layer, int x, int y, int padding)
+{
+    const auto channels = static_cast<std::size_t>(image.channels);
+    const int x0 = std::max(x - padding, 0);
+    const int x1 = std::min(x + image.width + padding, layer.width);
+    const int y0 = std::max(y - padding, 0);
+    const int y1 = std::min(y + image.height + padding, layer.height);
+    for (int ly = y0; ly < y1; ++ly) {
+        const int srcY = std::clamp(ly - y, 0, image.height - 1);
+        const GLubyte* srcRow = &image.data[static_cast<std::size_t>(srcY) * image.getRowSize()];
+        GLubyte* dstRow = &layer.data[static_cast<std::size_t>(ly) * layer.getRowSize()];
+        for (int lx = x0; lx < x1; ++lx) {
+            const int srcX = std::clamp(lx - x, 0, image.width - 1);
+            std::copy_n(&srcRow[static_cast<std::size_t>(srcX) * channels], channels,
+                        &dstRow[static_cast<std::size_t>(lx) * channels]);
+        }
+    }
+}
+
+struct Shelf {
+    int y;
+    int height;
+    int usedWidth;
+};
+
+struct AtlasLayer {
+    int layer;
+    std::vector<Shelf> shelves;
+    int usedHeight = 0;
+};
+
+} // namespace
+
+
+TexturePacking packTextures(const std::vector<CPUImage> &images, bool sRGB, int padding)
+{
+    ASSERT(padding >= 0);
+    TexturePacking packing;
+    packing.entries.resize(images.size());
+
+    // group by format:
+    std::map<int, std::vector<std::size_t>> imagesByChannels;
+    for (std::size_t i = 0; i < images.size(); ++i) {
+        ASSERT(images[i].width > 0 && images[i].height > 0);
+        imagesByChannels[images[i].channels].push_back(i);
+    }
+
+    for (auto& [channels, indices] : imagesByChannels) {
+        const std::size_t packIndex = packing.packs.size();
+        CPUTexturePack& pack = packing.packs.emplace_back();
+        pack.sRGB = sRGB;
+        pack.channels = channels;
+
+        int width = 0;
+        int height = 0;
+        for (std::size_t i : indices) {
+            width = std::max(width, images[i].width);
+            height = std::max(height, images[i].height);
+        }
+        auto addLayer = [&]() {
+            CPUImage& layer = pack.layers.emplace_back();
+            layer = CPUImage{width, height, channels,
+                             std::vector<GLubyte>(static_cast<std::size_t>(width) * static_cast<std::size_t>(height)
+                                                  * static_cast<std::size_t>(channels), 0)};
+            return static_cast<int>(pack.layers.size() - 1);
+        };
+        auto place = [&](std::size_t i, int layer, int x, int y) {
+            const CPUImage& image = images[i];
+            blitPadded(image, pack.layers[static_cast<std::size_t>(layer)], x, y, padding);
+            packing.entries[i] = TexturePackEntry{
+                    packIndex, layer,
+                    {static_cast<float>(image.width) / static_cast<float>(width),
+                     static_cast<float>(image.height) / static_cast<float>(height),
+                     static_cast<float>(x) / static_cast<float>(width),
+                     static_cast<float>(y) / static_cast<float>(height)}};
+        };
+
+        // largest first: full size images, then the atlas candidates by decreasing height
+        std::stable_sort(indices.begin(), indices.end(), [&images](std::size_t a, std::size_t b) {
+            return images[a].height > images[b].height;
+        });
+
+        std::vector<AtlasLayer> atlases;
+        for (std::size_t i : indices) {
+            const int w = images[i].width + 2 * padding;
+            const int h = images[i].height + 2 * padding;
+            if ((images[i].width == width && images[i].height == height) || w > width || h > height) {
+                // does not share its layer (the unused part of a smaller image stays black):
+                place(i, addLayer(), 0, 0);
+                continue;
+            }
+
+            bool placed = false;
+            for (AtlasLayer& atlas : atlases) {
+                // first shelf with enough space, the shelves are sorted by decreasing height:
+                for (Shelf& shelf : atlas.shelves) {
+                    if (h <= shelf.height && shelf.usedWidth + w <= width) {
+                        place(i, atlas.layer, shelf.usedWidth + padding, shelf.y + padding);
+                        shelf.usedWidth += w;
+                        placed = true;
+                        break;
+                    }
+                }
+                if (!placed && atlas.usedHeight + h <= height) {
+                    atlas.shelves.push_back(Shelf{atlas.usedHeight, h, w});
+                    place(i, atlas.layer, padding, atlas.usedHeight + padding);
+                    atlas.usedHeight += h;
+                    placed = true;
+                }
+                if (placed) {
+                    break;
+                }
+            }
+            if (!placed) {
+                AtlasLayer& atlas = atlases.emplace_back(AtlasLayer{addLayer(), {Shelf{0, h, w}}, h});
+                place(i, atlas.layer, padding, padding);
+            }
+        }
+    }
+    return packing;
+}
@@ -1,7 +1,10 @@
 #include "demos/Demo.h"
 #include "imgui.h"
+#include "debug_utils.h"
+#include "GpuMemoryRegistry.h"
+#include "CpuProfiler.h"
 
-#include <algorithm> // for std::find_if()
+#include <algorithm> // for std::find_if(), std::remove_if()
 #include <iostream>
 
 #include <GLFW/glfw3.h> // for GLFW_KEY_ESCAPE / GLFW_PRESS in OnKeyPressed(...)
@@ -35,7 +38,8 @@ DemoSuite::DemoSuite(GLRenderer &renderer)
 
 DemoSuite::~DemoSuite()
 {
-
+    // report what the demo leaks before the allocations of its members are gone:
+    CloseDemo();
 }
 
 void DemoSuite::OnWindowSizeChanged(int width, int height)
@@ -55,8 +59,7 @@ bool DemoSuite::OnKeyPressed(int key, int scancode, int action, int mods)
     if (m_currentDemo && m_currentDemo->OnKeyPressed(key, scancode, action, mods)) {
         return true;
     } else if (m_currentDemo && key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-        m_currentDemo.reset();
-        getRenderer().setClearColor();
+        CloseDemo();
         return true;
     } else {
         return false;
@@ -66,6 +69,7 @@ bool DemoSuite::OnKeyPressed(int key, int scancode, int action, int mods)
 void DemoSuite::OnUpdate(float deltaSeconds)
 {
     if (m_currentDemo) {
+        GpuMemoryScope memoryScope(m_currentDemoName);
         m_currentDemo->OnUpdate(deltaSeconds);
     }
 }
@@ -73,6 +77,7 @@ void DemoSuite::OnUpdate(float deltaSeconds)
 void DemoSuite::OnRender()
 {
     if (m_currentDemo) {
+        GpuMemoryScope memoryScope(m_currentDemoName);
         m_currentDemo->OnRender();
     } else {
         getRenderer().clear(GL_COLOR_BUFFER_BIT);
@@ -83,24 +88,22 @@ void DemoSuite::OnImGuiRender()
 {
     if (m_currentDemo) {
         if (ImGui::Button("<-")) {
-            m_currentDemo.reset();
-            getRenderer().setClearColor();
+            CloseDemo();
         } else {
+            GpuMemoryScope memoryScope(m_currentDemoName);
             m_currentDemo->OnImGuiRender();
         }
     } else {
         for (auto& p : m_demos) {
             if (ImGui::Button(p.first.c_str())) {
-                m_currentDemo = p.second(getRenderer());
-                if (m_width >= 0) {
-                    m_currentDemo->OnWindowSizeChanged(m_width, m_height);
-                }
+                startDemo(p.first, p.second);
             }
         }
     }
+    GpuMemoryRegistry::shared().OnImGuiRender();
 }
 
-void DemoSuite::SelectDemo(std::string_view name)
+bool DemoSuite::SelectDemo(std::string_view name)
 {
     auto search = std::find_if(m_demos.begin(), m_demos.end(),
                                [&](const auto& value) { return value.first == name; });
@@ -109,17 +112,64 @@ void DemoSuite::SelectDemo(std::string_view name)
     //       how exactly does this generic lambda stuff work in c++?
     if (search != m_demos.end()) {
         // clean up old demo:
-        m_currentDemo.reset();
-        getRenderer().setClearColor();
+        CloseDemo();
 
         // initialize new demo:
-        m_currentDemo = search->second(getRenderer());
-        if (m_width >= 0) {
-            m_currentDemo->OnWindowSizeChanged(m_width, m_height);
-        }
+        startDemo(search->first, search->second);
+        return true;
     } else {
         std::cout << "sorry demo " << name << " was not found. Stay in main-menu.\n";
+        return false;
+    }
+}
+
+std::vector<std::string> DemoSuite::getDemoNames() const
+{
+    std::vector<std::string> names;
+    names.reserve(m_demos.size());
+    for (const auto& p : m_demos) {
+        names.push_back(p.first);
+    }
+    return names;
+}
+
+void DemoSuite::startDemo(const std::string &name, const std::function<std::unique_ptr<Demo>(GLRenderer &)> &factory)
+{
+    CPU_PROFILE_SCOPE("start demo");
+    ASSERT(!m_currentDemo);
+    m_currentDemoName = name;
+    m_demoFirstMemoryId = GpuMemoryRegistry::shared().getNextId();
+    GpuMemoryScope memoryScope(m_currentDemoName);
+    m_currentDemo = factory(getRenderer());
+    if (m_width >= 0) {
+        m_currentDemo->OnWindowSizeChanged(m_width, m_height);
+    }
+}
+
+void DemoSuite::CloseDemo()
+{
+    if (!m_currentDemo) {
+        return;
+    }
+    CPU_PROFILE_SCOPE("close demo");
+    m_currentDemo.reset();
+    getRenderer().setClearColor();
+
+    // everything the demo allocated should be gone with it
+    // (allocations outside of its GpuMemoryScope while it ran, e.g. of a FrameCapture, belong to others):
+    std::vector<GpuAllocationInfo> leaks = GpuMemoryRegistry::shared().getAllocations(m_demoFirstMemoryId);
+    leaks.erase(std::remove_if(leaks.begin(), leaks.end(), [this](const GpuAllocationInfo& allocation) {
+        return allocation.scope != m_currentDemoName && allocation.scope.rfind(m_currentDemoName + "/", 0) != 0;
+    }), leaks.end());
+    if (!leaks.empty()) {
+        std::cerr << "WARNING: demo " << m_currentDemoName << " leaked " << leaks.size() << " GPU allocations:\n";
+        for (const GpuAllocationInfo& leak : leaks) {
+            std::cerr << "  " << GpuMemoryRegistry::getCategoryName(leak.category) << " " << leak.label
+                      << " (" << leak.bytes << " bytes) created in " << leak.scope
+                      << " at " << leak.site.file << ":" << leak.site.line << '\n';
+        }
     }
+    m_currentDemoName.clear();
 }
 
 }
@@ -0,0 +1,545 @@
+#include "demos/DemoBenchmark.h"
+
+#include <algorithm>
+#include <charconv> // for std::from_chars(..)
+#include <chrono>
+#include <cctype> // for std::isalnum(..), std::toupper(..)
+#include <cmath> // for std::ceil(..), std::lround(..), std::sin(..)
+#include <cstdlib> // for std::strtod(..)
+#include <cstring> // for std::strcmp(..)
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <utility> // for std::move(..)
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h> // for getrusage(..)
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h> // for GLFW_PRESS / GLFW_RELEASE (the key codes of letters and digits are their ASCII codes)
+
+#include "demos/Demo.h"
+#include "demos/InputRecording.h"
+#include "CpuProfiler.h"
+#include "FrameCapture.h"
+#include "GLImageFilter.h"
+#include "GpuMemoryRegistry.h"
+#include "GpuProfiler.h"
+#include "RenderTargetPool.h"
+#include "cpu_image_filter.h"
+
+namespace {
+
+std::size_t getPeakResidentBytes()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<std::size_t>(usage.ru_maxrss); // bytes
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#else
+    return 0;
+#endif
+}
+
+bool parseCount(const char* s, std::size_t& count)
+{
+    const char* end = s + std::strlen(s);
+    auto [ptr, error] = std::from_chars(s, end, count);
+    return error == std::errc() && ptr == end;
+}
+
+bool parseSize(const char* s, int& width, int& height)
+{
+    const char* end = s + std::strlen(s);
+    auto [x, error] = std::from_chars(s, end, width);
+    if (error != std::errc() || x == end || (*x != 'x' && *x != 'X')) {
+        return false;
+    }
+    auto [ptr, error2] = std::from_chars(x + 1, end, height);
+    return error2 == std::errc() && ptr == end && width > 0 && height > 0;
+}
+
+void writeJsonString(std::ostream& os, const char* s)
+{
+    os << '"';
+    for (; *s != '\0'; ++s) {
+        if (*s == '"' || *s == '\\') {
+            os << '\\';
+        }
+        os << *s;
+    }
+    os << '"';
+}
+
+void writeStatsJson(std::ostream& os, const demo::FrameTimeStats& stats)
+{
+    os << "{\"count\": " << stats.count << ", \"mean\": " << stats.mean_ms << ", \"p50\": " << stats.p50_ms
+       << ", \"p90\": " << stats.p90_ms << ", \"p99\": " << stats.p99_ms << ", \"max\": " << stats.max_ms << '}';
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// the GPU and the CPU sum the same products in a different order (and the separable path
+// rounds its intermediate result), far below what a wrong tap or edge would cause:
+constexpr double maxConvolutionError = 1e-4;
+
+// gradients, hard edges and values above 1 (HDR) in a size that is not a multiple of the
+// tile size or the line size of the convolution shaders (partial work groups, edges)
+CPUImageRGBA32F makeConvolutionTestImage(int width, int height)
+{
+    CPUImageRGBA32F image;
+    image.width = width;
+    image.height = height;
+    image.data.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4);
+    for (int y = 0; y < height; ++y) {
+        float* pixel = image.row(y);
+        for (int x = 0; x < width; ++x, pixel += 4) {
+            const float u = static_cast<float>(x) / static_cast<float>(width - 1);
+            const float v = static_cast<float>(y) / static_cast<float>(height - 1);
+            const bool edge = ((x / 7 + y / 5) % 3) == 0;
+            pixel[0] = u;
+            pixel[1] = edge ? 2.f : v;
+            pixel[2] = .5f + .5f * std::sin(23.f * u) * std::cos(17.f * v);
+            pixel[3] = 1.f;
+        }
+    }
+    return image;
+}
+
+}
+
+namespace demo {
+
+FrameTimeStats FrameTimeStats::compute(std::vector<double> times_ms)
+{
+    FrameTimeStats stats;
+    stats.count = times_ms.size();
+    if (times_ms.empty()) {
+        return stats;
+    }
+    std::sort(times_ms.begin(), times_ms.end());
+    for (double time_ms : times_ms) {
+        stats.mean_ms += time_ms;
+    }
+    stats.mean_ms /= static_cast<double>(times_ms.size());
+    // smallest time that is >= percent % of all times:
+    auto percentile = [&](double percent) {
+        const auto rank = static_cast<std::size_t>(std::ceil(percent / 100. * static_cast<double>(times_ms.size())));
+        return times_ms[std::clamp(rank, std::size_t(1), times_ms.size()) - 1];
+    };
+    stats.p50_ms = percentile(50.);
+    stats.p90_ms = percentile(90.);
+    stats.p99_ms = percentile(99.);
+    stats.max_ms = times_ms.back();
+    return stats;
+}
+
+DemoBenchmark::DemoBenchmark(DemoSuite &suite, BenchmarkOptions options)
+    : m_suite(suite),
+      m_options(std::move(options))
+{}
+
+bool DemoBenchmark::isRequested(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--benchmark") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<BenchmarkOptions> DemoBenchmark::parseArguments(int argc, char **argv)
+{
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool valid = true;
+        if (arg == "--benchmark") {
+            continue;
+        } else if (arg == "--frames") {
+            valid = value && parseCount(value, options.frames) && options.frames > 0;
+        } else if (arg == "--warmup") {
+            valid = value && parseCount(value, options.warmupFrames);
+        } else if (arg == "--delta") {
+            char* end = nullptr;
+            const double deltaSeconds = value ? std::strtod(value, &end) : 0.;
+            valid = value && *end == '\0' && deltaSeconds > 0.;
+            options.deltaSeconds = static_cast<float>(deltaSeconds);
+        } else if (arg == "--size") {
+            valid = value && parseSize(value, options.width, options.height);
+        } else if (arg == "--output") {
+            valid = value && *value != '\0';
+            if (valid) {
+                options.output = value;
+            }
+        } else if (arg == "--keys") {
+            valid = value && *value != '\0' && std::all_of(value, value + std::strlen(value), [](char c) {
+                return std::isalnum(static_cast<unsigned char>(c)) != 0;
+            });
+            if (valid) {
+                options.keys = value;
+            }
+        } else if (arg == "--replay") {
+            valid = value && *value != '\0';
+            if (valid) {
+                options.replay = value;
+            }
+        } else if (arg == "--capture") {
+            valid = value && *value != '\0';
+            if (valid) {
+                options.capture = value;
+            }
+        } else if (arg == "--stream") {
+            valid = value && *value != '\0';
+            if (valid) {
+                options.stream = value;
+            }
+        } else if (arg == "--check-convolution") {
+            options.checkConvolution = true;
+            continue;
+        } else if (arg.substr(0, 2) == "--") {
+            std::cerr << "error: unknown benchmark option " << arg << '\n';
+            return std::nullopt;
+        } else {
+            options.demos.emplace_back(arg);
+            continue;
+        }
+        if (!valid) {
+            std::cerr << "error: " << arg << " needs a valid value, usage:\n"
+                         "  --benchmark [--frames N] [--warmup N] [--delta SECONDS] [--size WIDTHxHEIGHT]"
+                         " [--output FILE] [--keys KEYS] [--replay FILE] [--capture DIRECTORY] [--stream FILE]"
+                         " [--check-convolution] [DEMO ...]\n";
+            return std::nullopt;
+        }
+        ++i; // (skip the value)
+    }
+    return options;
+}
+
+bool DemoBenchmark::run()
+{
+    m_suite.OnWindowSizeChanged(m_options.width, m_options.height);
+    if (!m_options.capture.empty() || !m_options.stream.empty()) {
+        m_capture = std::make_unique<FrameCapture>(m_options.capture);
+        if (!m_options.stream.empty()) {
+            m_capture->setDropFrames(false);
+            const int framesPerSecond = std::max(1, static_cast<int>(std::lround(1. / m_options.deltaSeconds)));
+            if (!m_capture->startStream(m_options.stream, m_options.width, m_options.height, framesPerSecond)) {
+                return false;
+            }
+        }
+    }
+    bool success = runAll();
+    if (m_capture) {
+        m_streamedFrames = m_capture->stopStream();
+        m_capture.reset();
+    }
+    if (m_options.checkConvolution) {
+        success = checkConvolution() && success;
+    }
+    return success;
+}
+
+bool DemoBenchmark::runAll()
+{
+    if (!m_options.replay.empty()) {
+        std::cout << "benchmark: replay of " << m_options.replay << '\n' << std::flush;
+        std::optional<DemoBenchmarkResult> result = runReplay();
+        if (result) {
+            m_results.push_back(std::move(*result));
+        }
+        m_suite.CloseDemo();
+        return result.has_value();
+    }
+
+    const std::vector<std::string> names = m_options.demos.empty() ? m_suite.getDemoNames() : m_options.demos;
+    bool allFound = true;
+    for (const std::string& name : names) {
+        std::cout << "benchmark: " << name << '\n' << std::flush;
+        std::optional<DemoBenchmarkResult> result = runDemo(name);
+        if (result) {
+            m_results.push_back(std::move(*result));
+        } else {
+            allFound = false;
+        }
+    }
+    m_suite.CloseDemo();
+    return allFound;
+}
+
+void DemoBenchmark::writeJson(std::ostream &os) const
+{
+    const auto* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    const auto* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    os << "{\n  \"renderer\": ";
+    writeJsonString(os, renderer ? renderer : "");
+    os << ",\n  \"version\": ";
+    writeJsonString(os, version ? version : "");
+    os << ",\n  \"width\": " << m_options.width << ", \"height\": " << m_options.height
+       << ", \"frames\": " << m_options.frames << ", \"warmupFrames\": " << m_options.warmupFrames
+       << ", \"deltaSeconds\": " << m_options.deltaSeconds << ",\n  \"keys\": ";
+    writeJsonString(os, m_options.keys.c_str());
+    os << ", \"replay\": ";
+    writeJsonString(os, m_options.replay.string().c_str());
+    os << ",\n  \"demos\": [";
+    for (std::size_t i = 0; i < m_results.size(); ++i) {
+        const DemoBenchmarkResult& result = m_results[i];
+        os << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+        writeJsonString(os, result.name.c_str());
+        os << ", \"load_ms\": " << result.load_ms << ",\n     \"cpu_ms\": ";
+        writeStatsJson(os, result.cpu);
+        os << ",\n     \"gpu_ms\": ";
+        writeStatsJson(os, result.gpu);
+        os << ",\n     \"gpuMemoryPeakBytes\": " << result.gpuMemoryPeak
+           << ", \"peakResidentBytes\": " << result.peakResident << ",\n     \"glCallsPerFrame\": ";
+        GLCallStats::writeJson(os, result.glCalls, result.cpu.count);
+        if (!m_options.capture.empty() || !m_options.stream.empty()) {
+            os << ",\n     \"capture\": {\"frames\": " << result.capturedFrames << ", \"dropped\": "
+               << result.droppedFrames << ", \"glThread_ms\": ";
+            writeStatsJson(os, result.capture);
+            os << '}';
+        }
+        os << '}';
+    }
+    os << "\n  ],\n  \"convolutionChecks\": [";
+    for (std::size_t i = 0; i < m_convolutionChecks.size(); ++i) {
+        const ConvolutionCheckResult& check = m_convolutionChecks[i];
+        os << (i == 0 ? "\n" : ",\n") << "    {\"kernel\": ";
+        writeJsonString(os, check.kernel.c_str());
+        os << ", \"path\": \"" << check.path << "\", \"maxError\": " << check.maxError
+           << ", \"passed\": " << (check.passed ? "true" : "false") << '}';
+    }
+    os << "\n  ],\n  \"stream\": ";
+    writeJsonString(os, m_options.stream.string().c_str());
+    os << ", \"streamedFrames\": " << m_streamedFrames << ",\n  \"synchronousGLQueries\": [";
+    const std::vector<GLSynchronousQuerySite> sites = GLCallStats::shared().getSynchronousQuerySites();
+    for (std::size_t i = 0; i < sites.size(); ++i) {
+        os << (i == 0 ? "\n" : ",\n") << "    {\"function\": \"" << GLCallStats::getFunctionName(sites[i].function)
+           << "\", \"site\": ";
+        writeJsonString(os, sites[i].file ? sites[i].file : "");
+        os << ", \"line\": " << sites[i].line << ", \"calls\": " << sites[i].calls << ", \"frames\": " << sites[i].frames
+           << '}';
+    }
+    os << "\n  ]\n}\n";
+}
+
+bool DemoBenchmark::writeResults() const
+{
+    writeJson(std::cout);
+    std::ofstream file(m_options.output);
+    if (!file) {
+        std::cerr << "WARNING: could not open " << m_options.output << " for writing\n";
+        return false;
+    }
+    writeJson(file);
+    std::cout << "wrote " << m_options.output << '\n';
+    return static_cast<bool>(file);
+}
+
+std::optional<DemoBenchmarkResult> DemoBenchmark::runDemo(const std::string &name)
+{
+    CPU_PROFILE_FUNCTION();
+    // the peaks of the previous demo do not count:
+    m_suite.CloseDemo();
+    GpuMemoryRegistry::shared().resetHighWaterMarks();
+
+    DemoBenchmarkResult result;
+    result.name = name;
+    const auto loadBegin = std::chrono::steady_clock::now();
+    if (!m_suite.SelectDemo(name)) {
+        return std::nullopt;
+    }
+    glFinish();
+    result.load_ms = elapsed_ms(loadBegin);
+
+    for (char c : m_options.keys) {
+        const int key = std::toupper(static_cast<unsigned char>(c));
+        m_suite.OnKeyPressed(key, 0, GLFW_PRESS, 0);
+        m_suite.OnKeyPressed(key, 0, GLFW_RELEASE, 0);
+    }
+
+    measureFrames(m_options.frames, [&]() { return m_options.deltaSeconds; }, result);
+    return result;
+}
+
+std::optional<DemoBenchmarkResult> DemoBenchmark::runReplay()
+{
+    CPU_PROFILE_FUNCTION();
+    InputReplay replay(m_options.replay);
+    if (!replay.isValid()) {
+        return std::nullopt;
+    }
+    const std::size_t frameCount = replay.getFrames().size();
+    if (frameCount <= m_options.warmupFrames) {
+        std::cerr << "WARNING: " << m_options.replay << " has only " << frameCount << " frames, that is not more than "
+                  << m_options.warmupFrames << " warm-up frames\n";
+        return std::nullopt;
+    }
+
+    // the recording starts in the main menu:
+    m_suite.CloseDemo();
+    GpuMemoryRegistry::shared().resetHighWaterMarks();
+
+    DemoBenchmarkResult result;
+    result.name = "replay " + m_options.replay.filename().string();
+    result.load_ms = 0.;
+    auto nextFrame = [&]() {
+        const std::string demoBefore = m_suite.getCurrentDemoName();
+        const auto eventsBegin = std::chrono::steady_clock::now();
+        const float deltaSeconds = replay.replayFrame(m_suite, false);
+        if (m_suite.getCurrentDemoName() != demoBefore) {
+            // (the load time sums up all demos the recording selects)
+            glFinish();
+            result.load_ms += elapsed_ms(eventsBegin);
+        }
+        return deltaSeconds;
+    };
+    measureFrames(frameCount - m_options.warmupFrames, nextFrame, result);
+    return result;
+}
+
+void DemoBenchmark::measureFrames(std::size_t frames, const std::function<float()>& nextFrame,
+                                  DemoBenchmarkResult& result)
+{
+    GpuProfiler& profiler = m_suite.getRenderer().getProfiler();
+    GpuMemoryRegistry& registry = GpuMemoryRegistry::shared();
+    GLCallStats& callStats = GLCallStats::shared();
+
+    std::vector<double> cpuTimes_ms;
+    cpuTimes_ms.reserve(frames);
+    std::vector<double> captureTimes_ms;
+    const std::uint64_t capturedBefore = m_capture ? m_capture->getCapturedCount() : 0;
+    const std::uint64_t droppedBefore = m_capture ? m_capture->getDroppedCount() : 0;
+    if (m_capture) {
+        // PNG files only with --capture:
+        m_capture->setRecording(!m_options.capture.empty());
+        if (!m_options.capture.empty()) {
+            m_capture->setDirectory(m_options.capture / result.name);
+        }
+        captureTimes_ms.reserve(frames);
+    }
+    profiler.setTraceFrameCount(frames);
+    for (std::size_t frame = 0; frame < m_options.warmupFrames + frames; ++frame) {
+        if (frame == m_options.warmupFrames) {
+            // measure only the frames after the warm-up:
+            profiler.flush();
+            profiler.clearTrace();
+            callStats.resetTotals();
+        }
+        const float deltaSeconds = nextFrame();
+        profiler.beginFrame();
+        callStats.beginFrame();
+        const auto frameBegin = std::chrono::steady_clock::now();
+        {
+            CPU_PROFILE_SCOPE("OnUpdate");
+            m_suite.OnUpdate(deltaSeconds);
+        }
+        {
+            CPU_PROFILE_SCOPE("OnRender");
+            GpuProfileScope profile(profiler, "OnRender");
+            m_suite.OnRender();
+        }
+        if (frame >= m_options.warmupFrames) {
+            cpuTimes_ms.push_back(elapsed_ms(frameBegin));
+            if (m_capture) {
+                m_capture->poll();
+                m_capture->capture(m_options.width, m_options.height);
+                m_capture->endFrame();
+                captureTimes_ms.push_back(m_capture->getLastGLThread_ms());
+            }
+        }
+        callStats.endFrame();
+        profiler.endFrame();
+        CpuProfiler::shared().collect();
+    }
+    profiler.flush();
+    result.glCalls = callStats.getTotals();
+    result.capturedFrames = 0;
+    result.droppedFrames = 0;
+    if (m_capture) {
+        m_capture->finish();
+        m_capture->setRecording(false);
+        result.capturedFrames = m_capture->getCapturedCount() - capturedBefore;
+        result.droppedFrames = m_capture->getDroppedCount() - droppedBefore;
+    }
+    result.capture = FrameTimeStats::compute(std::move(captureTimes_ms));
+
+    result.cpu = FrameTimeStats::compute(std::move(cpuTimes_ms));
+    result.gpu = FrameTimeStats::compute(profiler.getFrameTimes_ms("OnRender"));
+    result.gpuMemoryPeak = registry.getHighWaterBytes();
+    result.peakResident = getPeakResidentBytes();
+    profiler.clearTrace();
+    profiler.setTraceFrameCount(GpuProfiler::defaultTraceFrameCount);
+}
+
+bool DemoBenchmark::checkConvolution()
+{
+    CPU_PROFILE_FUNCTION();
+    constexpr int width = 301;
+    constexpr int height = 203;
+    const CPUImageRGBA32F input = makeConvolutionTestImage(width, height);
+    const std::vector<ConvolutionKernel> kernels = {
+        makeSobelKernel(), makeGaussianKernel(maxConvolutionRadius, 3.f), makeLaplacianKernel()
+    };
+
+    GLRenderer& renderer = m_suite.getRenderer();
+    RenderTargetPool pool;
+    GLImageFilter filter;
+    glActiveTexture(GL_TEXTURE0);
+    GLTexture& inputTexture = pool.acquireTexture({width, height, GL_RGBA32F});
+    inputTexture.setSubImage(0, 0, 0, width, height, input.data.data());
+    GLTexture& outputTexture = pool.acquireTexture({width, height, GL_RGBA32F});
+    CPUImageRGBA32F reference;
+    CPUImageRGBA32F output;
+    output.width = width;
+    output.height = height;
+    output.data.resize(input.data.size());
+
+    bool allPassed = true;
+    for (const ConvolutionKernel& kernel : kernels) {
+        applyConvolution(kernel, input, reference);
+        // without its 1D factors the kernel runs in the tiled path:
+        ConvolutionKernel tiled = kernel;
+        tiled.row.clear();
+        tiled.column.clear();
+        std::vector<const ConvolutionKernel*> paths = {&tiled};
+        if (kernel.isSeparable()) {
+            paths.push_back(&kernel);
+        }
+        for (const ConvolutionKernel* pathKernel : paths) {
+            filter.apply(renderer, *pathKernel, inputTexture, outputTexture, width, height, pool, 0);
+            GLFramebufferObject& readFBO = pool.acquireFramebuffer({&outputTexture}, nullptr);
+            readFBO.readPixels(0, 0, width, height, GL_RGBA, GL_FLOAT, output.data.data());
+            readFBO.unbind();
+
+            ConvolutionCheckResult check;
+            check.kernel = kernel.name;
+            check.path = pathKernel->isSeparable() ? "separable" : "tiled";
+            check.maxError = 0.;
+            for (std::size_t i = 0; i < output.data.size(); ++i) {
+                check.maxError = std::max(check.maxError,
+                                          static_cast<double>(std::abs(output.data[i] - reference.data[i])));
+            }
+            check.passed = check.maxError <= maxConvolutionError;
+            std::cout << "convolution check: " << check.kernel << " (" << check.path << "): max error "
+                      << check.maxError << (check.passed ? "" : " FAILED") << '\n';
+            allPassed = allPassed && check.passed;
+            m_convolutionChecks.push_back(std::move(check));
+        }
+    }
+    return allPassed;
+}
+
+}
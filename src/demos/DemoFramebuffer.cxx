@@ -1,5 +1,8 @@
 #include "demos/DemoFramebuffer.h"
 
+#include <algorithm> // for std::any_of(..)
+#include <chrono>
+#include <cmath>     // for std::abs(..)
 #include <filesystem>
 
 #include "debug_utils.h"
@@ -7,6 +10,7 @@
 #include "imgui.h"
 
 #include "cpu_mesh_import.h"
+#include "TextureLoader.h"
 
 #include "VertexBufferLayout.h"
 
@@ -33,7 +37,16 @@ demo::DemoFramebuffer::DemoFramebuffer(GLRenderer &renderer)
       m_k_s_sRGB(.5f, .5f, .5f),
       // m_k_d(.8f, .2f, .8f), from texture
       // m_k_a(.8f, .2f, .8f), just set k_a := k_d (:= texture color)
-      m_shininess(150.f)
+      m_shininess(150.f),
+      m_width(0),
+      m_height(0),
+      m_samples(1),
+      m_negotiateFormats(true),
+      m_sceneColorFormat(GL_RGBA32F),
+      m_filteredColorFormat(GL_RGBA32F),
+      m_identityKernel(makeKernel("none", 0, 0, {1.f})),
+      m_kernelIndex(0),
+      m_backend(static_cast<int>(FilterBackend::COMPUTE_SHADER))
 {
     namespace fs = std::filesystem;
 
@@ -47,24 +60,27 @@ demo::DemoFramebuffer::DemoFramebuffer(GLRenderer &renderer)
     m_phongReflModelSP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/TexturedPhongRefl.shader",
                                                            fs::path::format::generic_format));
 
+    // start loading the block compressed texture on a worker thread
+    // (the first run compresses the image and writes the cache file):
+    TextureLoader texLoader;
+    TextureLoader::Ticket texTicket = texLoader.requestCompressed(fs::path("res/meshes/3rd_party/3D_Model_Haven/GothicBed_01/GothicBed_01_Textures/GothicBed_01_8-bit_Diffuse.png",
+                                                                           fs::path::format::generic_format),
+                                                                  BlockFormat::BC1, true);
+
     // load meshes from file:
     std::vector<CPUMesh<GLuint>> cpu_meshes = loadOBJfile(fs::path("res/meshes/3rd_party/3D_Model_Haven/GothicBed_01/GothicBed_01.obj",
                                                                    fs::path::format::generic_format));
     for (auto& cpu_mesh : cpu_meshes) {
-        GLVertexBuffer vbo(cpu_mesh.va.data.size(), cpu_mesh.va.data.data());
-        GLVertexArray vao;
-        cpu_mesh.va.layout.setLocations(*m_phongReflModelSP);
-        vao.addBuffer(vbo, cpu_mesh.va.layout);
-        GLIndexBuffer ibo(GL_UNSIGNED_INT, static_cast<GLIndexBuffer::count_type>(cpu_mesh.ib.indices.size()),
-                          reinterpret_cast<GLvoid*>(cpu_mesh.ib.indices.data()));
-        m_glMeshes.push_back(std::tuple{std::move(vbo), std::move(vao), std::move(ibo)});
+        // positions are uploaded into their own vertex buffer for the depth pre-pass:
+        m_glMeshes.push_back(m_depthPrepass.makeMesh(cpu_mesh, *m_phongReflModelSP));
     }
 
-    // load texture from file:
-     m_texBaseColor = std::make_unique<GLTexture>(fs::path("res/meshes/3rd_party/3D_Model_Haven/GothicBed_01/GothicBed_01_Textures/GothicBed_01_8-bit_Diffuse.png",
-                                                          fs::path::format::generic_format),
-                                                  3, true);
-     m_texBaseColor->bind(texUnitDiffuse);
+    // wait for the texture, most of its decoding happened while the meshes were loaded:
+     m_texBaseColor = texLoader.wait(texTicket);
+     // (nullptr if the image could not be loaded, the shader samples black then)
+     if (m_texBaseColor) {
+         m_texBaseColor->bind(texUnitDiffuse);
+     }
      m_phongReflModelSP->bind();
      m_phongReflModelSP->setUniform1i("tex", texUnitDiffuse);
 
@@ -74,17 +90,7 @@ demo::DemoFramebuffer::DemoFramebuffer(GLRenderer &renderer)
 
     // 2. init fbo stuff
     // -----------------
-
-    // init textures to be used in framebuffer:
-    // m_texColorBuffer = see OnWindowSizeChanged()
-    // m_texDepthBuffer = see OnWindowSizeChanged()
-
-    // init framebuffer:
-    m_fbo = std::make_unique<GLFramebufferObject>();
-    // attach m_texColorBuffer and m_texColorBuffer, see OnWindowSizeChanged()
-    std::array<GLenum, 1> drawBuffers = { GL_COLOR_ATTACHMENT0 };
-    m_fbo->bind();
-    m_fbo->setDrawBuffers(drawBuffers);
+    // textures and framebuffers are acquired from m_renderTargets by the render graph in OnRender()
 
     // 3. init stuff to render from fbo to screen
     // ------------------------------------------
@@ -93,6 +99,13 @@ demo::DemoFramebuffer::DemoFramebuffer(GLRenderer &renderer)
                                                            fs::path::format::generic_format));
     m_filterSP->setUniform1i("tex", texUnitColorBuffer);
 
+    // filter kernels (the same for every backend):
+    m_kernels.push_back(makeSobelKernel());
+    m_kernels.push_back(makeGaussianKernel(maxConvolutionRadius, 3.f));
+    m_kernels.push_back(makeLaplacianKernel());
+    m_filterTimers.resize(m_kernels.size());
+    m_cpuFilterTime_ms.resize(m_kernels.size(), 0.);
+    m_imageFilter = std::make_unique<GLImageFilter>();
 
     // init screen filling quad (VertexBuffer, IndexBuffer, VertexArray):
     //  3--2
@@ -133,25 +146,9 @@ void demo::DemoFramebuffer::OnWindowSizeChanged(int width, int height)
     getRenderer().setViewport(0, 0, width, height);
     m_camera.setAspect(static_cast<float>(width) / static_cast<float>(height));
 
-    // clear existing attachments if any (is this necessary?):
-//    m_fbo->bind();
-//    m_fbo->unattachTexture(GL_COLOR_ATTACHMENT0);
-//    m_fbo->unattachTexture(GL_DEPTH_ATTACHMENT);
-
-    // allocate new textures of appropriate size (delete old textures if any):
-    glActiveTexture(GL_TEXTURE0 + texUnitUnused); // avoid unbinding the texture currently bound to texUnit in the constructors
-                                                  // of the following two textures:
-    m_texColorBuffer = std::make_unique<GLTexture>(width, height, GL_RGBA32F, texture_sampling_presets::noFilter);
-    m_texDepthBuffer = std::make_unique<GLTexture>(width, height, GL_DEPTH_COMPONENT16, texture_sampling_presets::noFilter);
-    m_texColorBuffer->bind(texUnitColorBuffer);
-
-    // attach new textures to framebuffer:
-    m_fbo->bind();
-    m_fbo->attachTexture(GL_COLOR_ATTACHMENT0, *m_texColorBuffer);
-    m_fbo->attachTexture(GL_DEPTH_ATTACHMENT, *m_texDepthBuffer);
-
-    // check framebuffer completeness:
-    ASSERT(m_fbo->checkFramebufferStatus() == GL_FRAMEBUFFER_COMPLETE);
+    // the buffers of this size are acquired from the pool in OnRender():
+    m_width = width;
+    m_height = height;
 }
 
 bool demo::DemoFramebuffer::OnKeyPressed(int key, int scancode, int action, int mods)
@@ -166,23 +163,187 @@ void demo::DemoFramebuffer::OnUpdate(float deltaSeconds)
 
 void demo::DemoFramebuffer::OnRender()
 {
-    ASSERT(m_texColorBuffer); // otherwise OnWindowSizeChanged(..) has not been called yet.
+    ASSERT(m_width > 0 && m_height > 0); // otherwise OnWindowSizeChanged(..) has not been called yet.
+
+    m_renderTargets.beginFrame();
+    // the passes depend on the settings in the gui -> rebuild the graph every frame:
+    buildRenderGraph();
+    bool compiled = m_renderGraph.compile();
+    ASSERT(compiled);
+
+    glActiveTexture(GL_TEXTURE0 + texUnitUnused); // avoid unbinding the texture currently bound to texUnit
+                                                  // when the pool has to create textures
+    m_renderGraph.execute(getRenderer(), m_renderTargets);
+
+    const std::size_t kernelIndex = static_cast<std::size_t>(m_kernelIndex);
+    m_filterTimers[kernelIndex][static_cast<std::size_t>(m_backend)].poll();
+}
+
+void demo::DemoFramebuffer::buildRenderGraph()
+{
+    m_renderGraph.clear();
+    const std::size_t kernelIndex = static_cast<std::size_t>(m_kernelIndex);
+    m_sceneColorFormat = m_negotiateFormats
+            ? RenderTargetPool::chooseFormat(getSceneColorRequirements(m_kernels[kernelIndex])) : GL_RGBA32F;
+    m_filteredColorFormat = m_negotiateFormats
+            ? RenderTargetPool::chooseFormat(getFilteredColorRequirements(m_kernels[kernelIndex])) : GL_RGBA32F;
+    // (the buffers can be larger than the window, the viewport still has the size of the window)
+    const RenderTargetDesc colorDesc{m_width, m_height, m_sceneColorFormat};
+    const RenderTargetDesc filteredDesc{m_width, m_height, m_filteredColorFormat};
+
+    // the handles each pass needs when it executes:
+    struct TargetData {
+        RGTexture color;
+    };
+    struct FilterData {
+        RGTexture input;
+        RGTexture output;
+    };
 
     // I. render into fbo:
     // -------------------
-    m_fbo->bind();
+    RGTexture colorBuffer;
+    if (m_samples > 1) {
+        const TargetData& sceneMS = m_renderGraph.addPass<TargetData>("scene (MSAA)", [&](RenderGraphBuilder& builder, TargetData& data) {
+            // (resolving requires the same format for both color buffers)
+            data.color = builder.createTexture("color buffer MS", {m_width, m_height, m_sceneColorFormat, m_samples});
+            builder.writeColor(data.color);
+            builder.writeDepth(builder.createTexture("depth buffer MS", {m_width, m_height, GL_DEPTH_COMPONENT16, m_samples}));
+        }, [this](const TargetData&, RenderGraphContext&) {
+            renderScene();
+        });
+        const RGTexture colorBufferMS = sceneMS.color;
+        colorBuffer = m_renderGraph.addPass<FilterData>("resolve", [&](RenderGraphBuilder& builder, FilterData& data) {
+            data.input = colorBufferMS;
+            builder.read(data.input);
+            data.output = builder.createTexture("color buffer", colorDesc);
+            builder.writeColor(data.output);
+        }, [this](const FilterData& data, RenderGraphContext& context) {
+            GLFramebufferObject& sceneFBO = context.getPool().acquireFramebuffer({&context.getTexture(data.input)}, nullptr);
+            sceneFBO.blitTo(*context.getFramebuffer(), m_width, m_height);
+        }).output;
+    } else {
+        colorBuffer = m_renderGraph.addPass<TargetData>("scene", [&](RenderGraphBuilder& builder, TargetData& data) {
+            data.color = builder.createTexture("color buffer", colorDesc);
+            builder.writeColor(data.color);
+            builder.writeDepth(builder.createTexture("depth buffer", {m_width, m_height, GL_DEPTH_COMPONENT16}));
+        }, [this](const TargetData&, RenderGraphContext&) {
+            renderScene();
+        }).color;
+    }
+
+    // II. filter:
+    // -----------
+    // both backends are added, the graph culls the one that is not presented:
+    const RGTexture filteredCompute = m_renderGraph.addPass<FilterData>("filter (compute shader)", [&](RenderGraphBuilder& builder, FilterData& data) {
+        data.input = colorBuffer;
+        builder.read(data.input);
+        data.output = builder.createTexture("filtered (compute shader)", filteredDesc);
+        builder.writeStorage(data.output);
+    }, [this, kernelIndex](const FilterData& data, RenderGraphContext& context) {
+        GLTimerQuery& timer = m_filterTimers[kernelIndex][static_cast<std::size_t>(FilterBackend::COMPUTE_SHADER)];
+        timer.begin();
+        m_imageFilter->apply(context.getRenderer(), m_kernels[kernelIndex], context.getTexture(data.input),
+                             context.getTexture(data.output), m_width, m_height, context.getPool(), texUnitColorBuffer);
+        timer.end();
+    }).output;
+    const RGTexture filteredCPU = m_renderGraph.addPass<FilterData>("filter (CPU)", [&](RenderGraphBuilder& builder, FilterData& data) {
+        data.input = colorBuffer;
+        builder.read(data.input);
+        data.output = builder.createTexture("filtered (CPU)", filteredDesc);
+        builder.writeStorage(data.output);
+    }, [this, kernelIndex](const FilterData& data, RenderGraphContext& context) {
+        GLTimerQuery& timer = m_filterTimers[kernelIndex][static_cast<std::size_t>(FilterBackend::CPU)];
+        timer.begin();
+        auto start = std::chrono::steady_clock::now();
+        m_cpuInput.width = m_width;
+        m_cpuInput.height = m_height;
+        m_cpuInput.data.resize(static_cast<std::size_t>(m_width) * static_cast<std::size_t>(m_height) * 4);
+        GLFramebufferObject& readFBO = context.getPool().acquireFramebuffer({&context.getTexture(data.input)}, nullptr);
+        readFBO.readPixels(0, 0, m_width, m_height, GL_RGBA, GL_FLOAT, m_cpuInput.data.data());
+        readFBO.unbind();
+        applyConvolution(m_kernels[kernelIndex], m_cpuInput, m_cpuOutput);
+        context.getTexture(data.output).setSubImage(0, 0, 0, m_width, m_height, m_cpuOutput.data.data());
+        m_cpuFilterTime_ms[kernelIndex] = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count();
+        timer.end();
+    }).output;
+
+    // III. render to screen:
+    // ----------------------
+    const FilterBackend backend = static_cast<FilterBackend>(m_backend);
+    const RGTexture shown = (backend == FilterBackend::COMPUTE_SHADER) ? filteredCompute
+                          : (backend == FilterBackend::CPU) ? filteredCPU
+                          : colorBuffer;
+    m_renderGraph.addPass<TargetData>("present", [&](RenderGraphBuilder& builder, TargetData& data) {
+        data.color = shown;
+        builder.read(data.color);
+        builder.setSideEffects(); // draws into the default framebuffer
+    }, [this, kernelIndex, backend](const TargetData& data, RenderGraphContext& context) {
+        context.getRenderer().disableDepthTest();
+        context.getTexture(data.color).bind(texUnitColorBuffer);
+        m_filterSP->bind(); // binding needed to set the uniforms
+        m_filterSP->setUniform2i("u_maxCoord", m_width - 1, m_height - 1);
+        if (backend == FilterBackend::FRAGMENT_SHADER) {
+            // the filter is applied while drawing to the screen:
+            GLTimerQuery& timer = m_filterTimers[kernelIndex][static_cast<std::size_t>(FilterBackend::FRAGMENT_SHADER)];
+            GLImageFilter::setKernelUniforms(*m_filterSP, m_kernels[kernelIndex]);
+            timer.begin();
+            context.getRenderer().draw(*m_rectVAO, *m_rectIBO, *m_filterSP);
+            timer.end();
+        } else {
+            GLImageFilter::setKernelUniforms(*m_filterSP, m_identityKernel);
+            context.getRenderer().draw(*m_rectVAO, *m_rectIBO, *m_filterSP);
+        }
+    });
+}
+
+RenderTargetRequirements demo::DemoFramebuffer::getSceneColorRequirements(const ConvolutionKernel &kernel)
+{
+    RenderTargetRequirements requirements;
+    requirements.channels = 3; // the filters output alpha = 1
+    requirements.hdr = true;   // lighting is not clamped
+    // filters whose weights sum to 0 (sobel, laplacian) turn the quantization steps of smooth
+    // gradients into visible noise -> they need half float precision. For the others the
+    // precision of the output (8 bit sRGB) is enough:
+    float weightSum = 0.f;
+    for (float weight : kernel.weights) {
+        weightSum += weight;
+    }
+    requirements.precisionBits = (std::abs(weightSum) < 1e-6f) ? 10 : 5;
+    return requirements;
+}
+
+RenderTargetRequirements demo::DemoFramebuffer::getFilteredColorRequirements(const ConvolutionKernel &kernel)
+{
+    RenderTargetRequirements requirements;
+    requirements.channels = 3;
+    requirements.hdr = true;
+    requirements.negative = !kernel.absolute && std::any_of(kernel.weights.begin(), kernel.weights.end(),
+                                                            [](float weight) { return weight < 0.f; });
+    requirements.precisionBits = 5; // only displayed
+    return requirements;
+}
+
+void demo::DemoFramebuffer::renderScene()
+{
     getRenderer().enableDepthTest();
     getRenderer().setClearColor(glm::vec4(linRGB_from_sRGB(m_clearColor_sRGB), 1.f));
     getRenderer().clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // set matrix uniforms:
-    m_phongReflModelSP->bind(); // binding needed to set the uniforms
     glm::mat4 ndc_from_cc = m_camera.mat_ndc_from_cc();
     glm::mat4 cc_from_wc = m_camera.mat_cc_from_wc();
     glm::mat4 wc_from_oc(1.f);
 
     glm::mat4 cc_from_oc = cc_from_wc * wc_from_oc;
     glm::mat4 ndc_from_oc = ndc_from_cc * cc_from_oc;
+
+    // optional depth pre-pass (binds its own shader program):
+    m_depthPrepass.beginScene();
+    m_depthPrepass.renderDepth(getRenderer(), m_glMeshes, ndc_from_oc);
+
+    m_phongReflModelSP->bind(); // binding needed to set the uniforms
     m_phongReflModelSP->setUniformMat4f("u_cc_from_oc", cc_from_oc);
     m_phongReflModelSP->setUniformMat4f("u_ndc_from_oc", ndc_from_oc);
 
@@ -201,21 +362,16 @@ void demo::DemoFramebuffer::OnRender()
     // m_shaderP->setUniform3f("u_k_a", m_k_a); // -> we just set u_k_a := u_k_d
     m_phongReflModelSP->setUniform1f("u_shininess", m_shininess);
 
+    m_depthPrepass.beginShadingPass(getRenderer());
     for (auto& glMesh : m_glMeshes) {
-        getRenderer().draw(std::get<GLVertexArray>(glMesh),
-                           std::get<GLIndexBuffer>(glMesh),
-                           *m_phongReflModelSP);
-        // note: while we did not need to pass the GLVertexBuffer here it was still necessary to
-        //          store it. otherwise its destructor would have deallocated the vb's data
+        getRenderer().draw(glMesh.va, glMesh.ib, *m_phongReflModelSP);
+        // note: while we did not need to pass the GLVertexBuffers here it was still necessary to
+        //          store them. otherwise their destructors would have deallocated the vb's data
         //          on the GPU as well. But the data on the GPU is needed as it is referenced
-        //          by the GLVertexArray.
+        //          by the GLVertexArrays.
     }
-
-    // II. render from fbo to screen:
-    // ------------------------------
-    m_fbo->unbind();
-    getRenderer().disableDepthTest();
-    getRenderer().draw(*m_rectVAO, *m_rectIBO, *m_filterSP);
+    m_depthPrepass.endShadingPass(getRenderer());
+    m_depthPrepass.endScene();
 }
 
 void demo::DemoFramebuffer::OnImGuiRender()
@@ -237,6 +393,71 @@ void demo::DemoFramebuffer::OnImGuiRender()
     ImGui::Text("k_d := k_a := texture color");
     ImGui::SliderFloat("shininess", &m_shininess, 1.f, 500.f);
 
+    // render path:
+    m_depthPrepass.OnImGuiRender();
+
+    // render targets:
+    constexpr std::array<int, 4> sampleCounts = {1, 2, 4, 8};
+    ImGui::Text("MSAA:");
+    for (int samples : sampleCounts) {
+        ImGui::SameLine();
+        ImGui::RadioButton((samples == 1) ? "off" : (samples == 2) ? "2x" : (samples == 4) ? "4x" : "8x",
+                           &m_samples, samples);
+    }
+    RenderTargetPoolStats poolStats = m_renderTargets.getStats();
+    ImGui::Text("render target pool: %zu textures (%.1f MiB), %zu fbos", poolStats.textureCount,
+                static_cast<double>(poolStats.byteSize) / (1024. * 1024.), poolStats.framebufferCount);
+    ImGui::Text("textures created: %zu, evicted: %zu", poolStats.allocationsTotal, poolStats.evictionsTotal);
+    RenderGraphStats graphStats = m_renderGraph.getStats();
+    ImGui::Text("render graph: %zu passes (%zu culled), %zu textures on %zu physical textures", graphStats.passes,
+                graphStats.culledPasses, graphStats.textures, graphStats.physicalTextures);
+    constexpr double MiB = 1024. * 1024.;
+    for (std::size_t pass = 0; pass < m_renderGraph.getPassCount(); ++pass) {
+        if (m_renderGraph.isCulled(pass)) {
+            ImGui::BulletText("%s (culled)", m_renderGraph.getPassName(pass).c_str());
+        } else {
+            ImGui::BulletText("%s: read %.1f MiB, write %.1f MiB", m_renderGraph.getPassName(pass).c_str(),
+                              static_cast<double>(m_renderGraph.getPassBytesRead(pass)) / MiB,
+                              static_cast<double>(m_renderGraph.getPassBytesWritten(pass)) / MiB);
+        }
+    }
+    ImGui::Checkbox("negotiate render target formats", &m_negotiateFormats);
+    ImGui::Text("scene color: %s, filtered: %s", RenderTargetPool::getFormatName(m_sceneColorFormat),
+                RenderTargetPool::getFormatName(m_filteredColorFormat));
+    // (estimate, see RenderGraphStats)
+    const double frameBytes = static_cast<double>(graphStats.bytesRead + graphStats.bytesWritten);
+    ImGui::Text("render target traffic: %.1f MiB/frame (%.2f GiB/s at %.0f fps)", frameBytes / MiB,
+                frameBytes * static_cast<double>(ImGui::GetIO().Framerate) / (1024. * MiB),
+                static_cast<double>(ImGui::GetIO().Framerate));
+    ImGui::Separator();
+
+    // post processing filter:
+    ImGui::Text("filter:");
+    for (std::size_t i = 0; i < m_kernels.size(); ++i) {
+        ImGui::SameLine();
+        ImGui::RadioButton(m_kernels[i].name.c_str(), &m_kernelIndex, static_cast<int>(i));
+    }
+    ImGui::Text("backend:");
+    ImGui::SameLine();
+    ImGui::RadioButton("fragment shader", &m_backend, static_cast<int>(FilterBackend::FRAGMENT_SHADER));
+    ImGui::SameLine();
+    ImGui::RadioButton("compute shader", &m_backend, static_cast<int>(FilterBackend::COMPUTE_SHADER));
+    ImGui::SameLine();
+    ImGui::RadioButton("CPU", &m_backend, static_cast<int>(FilterBackend::CPU));
+    // last measured GPU times (the fragment shader time includes drawing to the screen,
+    // the CPU backend stalls the GPU for the readback):
+    ImGui::Text("GPU time [ms]: fragment | compute | CPU backend (CPU wall clock)");
+    for (std::size_t i = 0; i < m_kernels.size(); ++i) {
+        const auto& timers = m_filterTimers[i];
+        auto ms = [&timers](FilterBackend b) {
+            return timers[static_cast<std::size_t>(b)].getLastResult_ms().value_or(0.);
+        };
+        ImGui::Text("%-14s %7.3f | %7.3f | %7.3f (%.1f)", m_kernels[i].name.c_str(),
+                    ms(FilterBackend::FRAGMENT_SHADER), ms(FilterBackend::COMPUTE_SHADER), ms(FilterBackend::CPU),
+                    m_cpuFilterTime_ms[i]);
+    }
+    ImGui::Separator();
+
     // camera controls:
     m_camereController.OnImGuiRender();
 }
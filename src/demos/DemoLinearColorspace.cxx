@@ -7,6 +7,7 @@
 #include "imgui.h"
 
 #include "cpu_mesh_import.h"
+#include "TextureLoader.h"
 
 #include "VertexBufferLayout.h"
 
@@ -42,24 +43,27 @@ demo::DemoLinearColorspace::DemoLinearColorspace(GLRenderer &renderer)
     m_shaderP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/TexturedPhongRefl.shader",
                                                            fs::path::format::generic_format));
 
+    // start loading the block compressed texture on a worker thread
+    // (the first run compresses the image and writes the cache file):
+    TextureLoader texLoader;
+    TextureLoader::Ticket texTicket = texLoader.requestCompressed(fs::path("res/meshes/3rd_party/3D_Model_Haven/GothicBed_01/GothicBed_01_Textures/GothicBed_01_8-bit_Diffuse.png",
+                                                                           fs::path::format::generic_format),
+                                                                  BlockFormat::BC1, true);
+
     // load meshes from file:
     std::vector<CPUMesh<GLuint>> cpu_meshes = loadOBJfile(fs::path("res/meshes/3rd_party/3D_Model_Haven/GothicBed_01/GothicBed_01.obj",
                                                                    fs::path::format::generic_format));
     for (auto& cpu_mesh : cpu_meshes) {
-        GLVertexBuffer vbo(cpu_mesh.va.data.size(), cpu_mesh.va.data.data());
-        GLVertexArray vao;
-        cpu_mesh.va.layout.setLocations(*m_shaderP);
-        vao.addBuffer(vbo, cpu_mesh.va.layout);
-        GLIndexBuffer ibo(GL_UNSIGNED_INT, static_cast<GLIndexBuffer::count_type>(cpu_mesh.ib.indices.size()),
-                          reinterpret_cast<GLvoid*>(cpu_mesh.ib.indices.data()));
-        m_glMeshes.push_back(std::tuple{std::move(vbo), std::move(vao), std::move(ibo)});
+        // positions are uploaded into their own vertex buffer for the depth pre-pass:
+        m_glMeshes.push_back(m_depthPrepass.makeMesh(cpu_mesh, *m_shaderP));
     }
 
-    // load texture from file:
-     m_texBaseColor = std::make_unique<GLTexture>(fs::path("res/meshes/3rd_party/3D_Model_Haven/GothicBed_01/GothicBed_01_Textures/GothicBed_01_8-bit_Diffuse.png",
-                                                          fs::path::format::generic_format),
-                                                  3, true);
-     m_texBaseColor->bind(texUnit);
+    // wait for the texture, most of its decoding happened while the meshes were loaded:
+     m_texBaseColor = texLoader.wait(texTicket);
+     // (nullptr if the image could not be loaded, the shader samples black then)
+     if (m_texBaseColor) {
+         m_texBaseColor->bind(texUnit);
+     }
      m_shaderP->bind();
      m_shaderP->setUniform1i("tex", texUnit);
 
@@ -100,13 +104,18 @@ void demo::DemoLinearColorspace::OnRender()
     getRenderer().clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // set matrix uniforms:
-    m_shaderP->bind(); // binding needed to set the uniforms
     glm::mat4 ndc_from_cc = m_camera.mat_ndc_from_cc();
     glm::mat4 cc_from_wc = m_camera.mat_cc_from_wc();
     glm::mat4 wc_from_oc(1.f);
 
     glm::mat4 cc_from_oc = cc_from_wc * wc_from_oc;
     glm::mat4 ndc_from_oc = ndc_from_cc * cc_from_oc;
+
+    // optional depth pre-pass (binds its own shader program):
+    m_depthPrepass.beginScene();
+    m_depthPrepass.renderDepth(getRenderer(), m_glMeshes, ndc_from_oc);
+
+    m_shaderP->bind(); // binding needed to set the uniforms
     m_shaderP->setUniformMat4f("u_cc_from_oc", cc_from_oc);
     m_shaderP->setUniformMat4f("u_ndc_from_oc", ndc_from_oc);
 
@@ -125,15 +134,16 @@ void demo::DemoLinearColorspace::OnRender()
     // m_shaderP->setUniform3f("u_k_a", m_k_a); // -> we just set u_k_a := u_k_d
     m_shaderP->setUniform1f("u_shininess", m_shininess);
 
+    m_depthPrepass.beginShadingPass(getRenderer());
     for (auto& glMesh : m_glMeshes) {
-        getRenderer().draw(std::get<GLVertexArray>(glMesh),
-                           std::get<GLIndexBuffer>(glMesh),
-                           *m_shaderP);
-        // note: while we did not need to pass the GLVertexBuffer here it was still necessary to
-        //          store it. otherwise its destructor would have deallocated the vb's data
+        getRenderer().draw(glMesh.va, glMesh.ib, *m_shaderP);
+        // note: while we did not need to pass the GLVertexBuffers here it was still necessary to
+        //          store them. otherwise their destructors would have deallocated the vb's data
         //          on the GPU as well. But the data on the GPU is needed as it is referenced
-        //          by the GLVertexArray.
+        //          by the GLVertexArrays.
     }
+    m_depthPrepass.endShadingPass(getRenderer());
+    m_depthPrepass.endScene();
 }
 
 void demo::DemoLinearColorspace::OnImGuiRender()
@@ -155,6 +165,9 @@ void demo::DemoLinearColorspace::OnImGuiRender()
     ImGui::Text("k_d := k_a := texture color");
     ImGui::SliderFloat("shininess", &m_shininess, 1.f, 500.f);
 
+    // render path:
+    m_depthPrepass.OnImGuiRender();
+
     // camera controls:
     m_camereController.OnImGuiRender();
 }
@@ -7,6 +7,7 @@
 #include "imgui.h"
 
 #include "cpu_mesh_import.h"
+#include "TextureLoader.h"
 
 #include "VertexBufferLayout.h"
 
@@ -31,6 +32,12 @@ demo::DemoLoadOBJ::DemoLoadOBJ(GLRenderer &renderer)
     m_shaderP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/ShadelessTexture.shader",
                                                            fs::path::format::generic_format));
 
+    // start decoding the texture on a worker thread:
+    TextureLoader texLoader;
+    TextureLoader::Ticket texTicket = texLoader.request(fs::path("res/meshes/3rd_party/3D_Model_Haven/GothicBed_01/GothicBed_01_Textures/GothicBed_01_8-bit_Diffuse.png",
+                                                                 fs::path::format::generic_format),
+                                                        3);
+
     // load meshes from file:
     std::vector<CPUMesh<GLuint>> cpu_meshes = loadOBJfile(fs::path("res/meshes/3rd_party/3D_Model_Haven/GothicBed_01/GothicBed_01.obj",
                                                                    fs::path::format::generic_format));
@@ -44,10 +51,12 @@ demo::DemoLoadOBJ::DemoLoadOBJ(GLRenderer &renderer)
         m_glMeshes.push_back(std::tuple{std::move(vbo), std::move(vao), std::move(ibo)});
     }
 
-    // load texture from file:
-     m_texBaseColor = std::make_unique<GLTexture>(fs::path("res/meshes/3rd_party/3D_Model_Haven/GothicBed_01/GothicBed_01_Textures/GothicBed_01_8-bit_Diffuse.png",
-                                                          fs::path::format::generic_format), 3);
-     m_texBaseColor->bind(texUnit);
+    // wait for the texture, most of its decoding happened while the meshes were loaded:
+     m_texBaseColor = texLoader.wait(texTicket);
+     // (nullptr if the image could not be loaded, the shader samples black then)
+     if (m_texBaseColor) {
+         m_texBaseColor->bind(texUnit);
+     }
      m_shaderP->bind();
      m_shaderP->setUniform1i("tex", texUnit);
 
@@ -12,6 +12,9 @@
 #include "cpu_mesh_utils.h" // to test addIndexBuffer(...)
 #include "cpu_mesh_generate.h" // to test generateStar(...)
 #include "cpu_mesh_import.h"
+#include "cpu_image_import.h"
+#include "cpu_texture_packing.h"
+#include "ThreadPool.h"
 
 #include "VertexBufferLayout.h"
 
@@ -82,14 +85,21 @@ demo::DemoMultipleConcepts::DemoMultipleConcepts(GLRenderer &renderer)
                                                  static_cast<GLIndexBuffer::count_type>(houseCPUMesh.ib.indices.size()),
                                                  houseCPUMesh.ib.indices.data());
 
-    // initialize shader for textured stuff:
-    m_texturedSP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/ShadelessTexture.shader",
+    // initialize shader for textured stuff (all textures are layers of one texture array):
+    m_texturedSP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/ShadelessTextureArray.shader",
                                                               fs::path::format::generic_format));
 
+    // both textures are decoded on worker threads while the meshes are set up
+    // (uv_grid is expanded to 4 channels, so both end up in the same texture array):
+    auto loadImage = [](const char* path) {
+        return ThreadPool::shared().submit([path]() {
+            return loadImageFile(fs::path(path, fs::path::format::generic_format), 4).value_or(CPUImage{});
+        });
+    };
+    std::future<CPUImage> alphaImage = loadImage("res/textures/alpha_texture_test.png");
+    std::future<CPUImage> gridImage = loadImage("res/textures/uv_grid.png");
+
     // initialize rectangle:
-    m_alphaTexture = std::make_unique<GLTexture>(fs::path("res/textures/alpha_texture_test.png",
-                                                          fs::path::format::generic_format),
-                                                 4);
     struct TexVertex {
         std::array<float, 2> pos;
         std::array<float, 2> texCoord;
@@ -157,10 +167,32 @@ demo::DemoMultipleConcepts::DemoMultipleConcepts(GLRenderer &renderer)
                                          std::move(ib)});
     }
 
-    m_gridTexture = std::make_unique<GLTexture>(fs::path("res/textures/uv_grid.png",
-                                                         fs::path::format::generic_format));
+    // the smaller alpha texture is packed into an atlas layer:
+    TexturePacking packing = packTextures({alphaImage.get(), gridImage.get()}, false);
+    ASSERT(packing.packs.size() == 1);
+    m_alphaTexture = packing.entries[0];
+    m_gridTexture = packing.entries[1];
+    m_textures = std::make_unique<GLTextureArray>(packing.packs[0]);
+    // the only texture binding of this demo:
+    m_textures->bind(texUnit);
+    m_texturedSP->bind();
     m_texturedSP->setUniform1i("tex", texUnit);
 
+    // materials for the render queue:
+    m_houseMaterial = RenderMaterial{m_shaderProgram.get(), [](GLShaderProgram& sp) {
+        sp.setUniform4f("u_Color", .5f, .5f, .5f, 1.0f);
+    }};
+    m_starMaterial = RenderMaterial{m_shaderProgram.get(), [this](GLShaderProgram& sp) {
+        sp.setUniform4fv("u_Color", m_starColor);
+    }};
+    m_gridMaterial = RenderMaterial{m_texturedSP.get(), [this](GLShaderProgram&) {
+        setTextureUniforms(m_gridTexture);
+    }};
+    m_alphaMaterial = RenderMaterial{m_texturedSP.get(), [this](GLShaderProgram&) {
+        setTextureUniforms(m_alphaTexture);
+    }};
+    m_renderQueue.setBackToFront(1, true);
+
 
     getRenderer().setClearColor(.2f, .8f, .2f, 0.f);
     getRenderer().enableFaceCulling();
@@ -207,46 +239,58 @@ void demo::DemoMultipleConcepts::OnRender()
     /* Render here */
     getRenderer().clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // 0 draw house:
-    m_shaderProgram->bind(); // must be bound first to set a uniform
-    glm::mat4 wc_from_houseoc(1.f);
-    m_shaderProgram->setUniformMat4f("u_ndc_from_oc", ndc_from_wc * wc_from_houseoc);
-    m_shaderProgram->setUniform4f("u_Color", .5f, .5f, .5f, 1.0f);
+    m_renderQueue.clear();
+    auto addDraw = [&](unsigned int pass, const RenderMaterial& material, GLVertexArray& va, GLIndexBuffer& ib,
+                       const glm::mat4& wc_from_oc) {
+        const float depth = -(cc_from_wc * wc_from_oc[3]).z;
+        m_renderQueue.add(pass, material, va, ib, ndc_from_wc * wc_from_oc, depth);
+    };
 
-    getRenderer().draw(*m_houseVAO, *m_houseIBO, *m_shaderProgram);
+    // 0 draw house:
+    addDraw(0, m_houseMaterial, *m_houseVAO, *m_houseIBO, glm::mat4(1.f));
 
     // 2 draw star:
-    m_shaderProgram->bind(); // must be bound first to set a uniform
     glm::mat4 wc_from_staroc(1.f);
     wc_from_staroc = glm::rotate(wc_from_staroc, glm::radians(m_starRot_deg), glm::vec3(0.f, 0.f, 1.f));
     wc_from_staroc = glm::translate(wc_from_staroc, glm::vec3(0.f, 0.f, .5f));
-    m_shaderProgram->setUniformMat4f("u_ndc_from_oc", ndc_from_wc * wc_from_staroc);
-    m_shaderProgram->setUniform4fv("u_Color", m_starColor);
-    getRenderer().draw(*m_starVAO, *m_starIBO, *m_shaderProgram);
+    addDraw(0, m_starMaterial, *m_starVAO, *m_starIBO, wc_from_staroc);
 
     // 3 draw suzanne:
-    m_texturedSP->bind(); // must be bound first to set a uniform
     glm::mat4 wc_from_suzanneoc = glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, 1.f));
-    m_texturedSP->setUniformMat4f("u_ndc_from_oc", ndc_from_wc * wc_from_suzanneoc);
-    m_gridTexture->bind(texUnit);
     for (auto& mesh : m_suzanneMeshes) {
-        getRenderer().draw(mesh.va, mesh.ib, *m_texturedSP);
+        addDraw(0, m_gridMaterial, mesh.va, mesh.ib, wc_from_suzanneoc);
     }
 
-    // 1 draw rectangle:
-    getRenderer().enableBlending();
-    m_texturedSP->bind(); // must be bound first to set a uniform
+    // 1 draw rectangle (blended, after everything opaque):
     glm::mat4 wc_from_rectoc = glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, 2.f));
-    m_texturedSP->setUniformMat4f("u_ndc_from_oc", ndc_from_wc * wc_from_rectoc);
-    m_alphaTexture->bind(texUnit);
-    getRenderer().draw(*m_rectVAO, *m_rectIBO, *m_texturedSP);
-    getRenderer().disableBlending();
+    addDraw(1, m_alphaMaterial, *m_rectVAO, *m_rectIBO, wc_from_rectoc);
+
+    {
+        GpuProfileScope profile(getRenderer().getProfiler(), "opaque");
+        m_renderQueue.submit(getRenderer(), 0);
+    }
+    {
+        GpuProfileScope profile(getRenderer().getProfiler(), "blended");
+        getRenderer().enableBlending();
+        m_renderQueue.submit(getRenderer(), 1);
+        getRenderer().disableBlending();
+    }
+}
+
+void demo::DemoMultipleConcepts::setTextureUniforms(const TexturePackEntry &texture)
+{
+    m_texturedSP->setUniform1f("u_layer", static_cast<float>(texture.layer));
+    m_texturedSP->setUniform4fv("u_uv_scale_offset", texture.uvScaleOffset.data());
 }
 
 void demo::DemoMultipleConcepts::OnImGuiRender()
 {
     ImGui::ColorEdit4("Star Color", m_starColor);
 
+    const RenderQueueStats& stats = m_renderQueue.getStats();
+    ImGui::Text("draws: %zu", stats.items);
+    ImGui::Text("state changes unsorted: %zu, sorted: %zu", stats.unsorted.total(), stats.sorted.total());
+
     // camera controls:
     m_cameraController.OnImGuiRender();
 }
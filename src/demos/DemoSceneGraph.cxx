@@ -0,0 +1,371 @@
+#include "demos/DemoSceneGraph.h"
+
+#include <algorithm> // for std::min(..)
+#include <chrono>
+#include <filesystem>
+#include <string> // for std::to_string(..)
+
+#include "debug_utils.h"
+
+#include "imgui.h"
+
+#include <GLFW/glfw3.h> // for the GLFW_KEY_* in OnKeyPressed(..)
+
+#include "cpu_mesh_generate.h"
+#include "ThreadPool.h"
+
+#include "glm/glm.hpp"
+#include "glm/ext/scalar_constants.hpp"
+
+namespace {
+
+// outer radius of the star every body is drawn as (bounding sphere in object coordinates):
+constexpr float starRadius = 1.f;
+
+// of the slider and of the key N:
+constexpr int maxStressNodes = 100000;
+constexpr int stressNodesPerKey = 10000;
+
+}
+
+demo::DemoSceneGraph::DemoSceneGraph(GLRenderer &renderer)
+    : demo::Demo(renderer),
+      m_camera(glm::radians(45.f), 1.f, .1f, 100.f),
+      m_cameraController(m_camera),
+      m_colors{glm::vec4(1.f, .8f, .2f, 1.f), glm::vec4(.2f, .5f, 1.f, 1.f), glm::vec4(.7f, .7f, .7f, 1.f)},
+      m_renderPath(static_cast<int>(RenderPath::RENDER_QUEUE)),
+      m_usedCommandLists(0),
+      m_avgRenderTime_ms(-1.f),
+      m_occlusionCulling(true),
+      m_width(0),
+      m_height(0),
+      m_stressNodeTarget(0),
+      m_drawStressNodes(false),
+      m_rng(42),
+      m_time_s(0.f),
+      m_avgUpdateTime_ms(-1.f)
+{
+    namespace fs = std::filesystem;
+
+    m_camera.translate_global(glm::vec3(0.f, 0.f, 30.f));
+
+    m_shaderP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/BlendVertColUniCol.shader",
+                                                           fs::path::format::generic_format));
+
+    // every body is drawn as a star:
+    CPUMesh<GLuint> starCPUMesh = generateStar(5, .5f, starRadius, {0.f, 0.f, 0.f, 0.f}, {1.f, 1.f, 1.f, .5f});
+    m_starVBO = std::make_unique<GLVertexBuffer>(starCPUMesh.va.data.size(), starCPUMesh.va.data.data());
+    m_starVAO = std::make_unique<GLVertexArray>();
+    starCPUMesh.va.layout.setLocations(*m_shaderP);
+    m_starVAO->addBuffer(*m_starVBO, starCPUMesh.va.layout);
+    // the same vertices with the locations of the program of the GPU culling path:
+    m_objectsSP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/BlendVertColObjects.shader",
+                                                             fs::path::format::generic_format));
+    m_culledStarVAO = std::make_unique<GLVertexArray>();
+    starCPUMesh.va.layout.setLocations(*m_objectsSP);
+    m_culledStarVAO->addBuffer(*m_starVBO, starCPUMesh.va.layout);
+    m_starIBO = std::make_unique<GLIndexBuffer>(GL_UNSIGNED_INT,
+                                                static_cast<GLIndexBuffer::count_type>(starCPUMesh.ib.indices.size()),
+                                                starCPUMesh.ib.indices.data());
+
+    for (std::size_t i = 0; i < m_materials.size(); ++i) {
+        m_materials[i].program = m_shaderP.get();
+        m_materials[i].apply = [color = &m_colors[i]](GLShaderProgram& sp) {
+            sp.setUniform4f("u_Color", color->r, color->g, color->b, color->a);
+        };
+    }
+    // (the colors never change, the GPU culling path reads them by the material index of each object)
+    m_objectsSP->bind();
+    for (std::size_t i = 0; i < m_colors.size(); ++i) {
+        m_objectsSP->setUniform4f("u_colors[" + std::to_string(i) + "]",
+                                  m_colors[i].r, m_colors[i].g, m_colors[i].b, m_colors[i].a);
+    }
+    m_objectsSP->unbind();
+
+    std::array<GLenum, 1> drawBuffers = { GL_COLOR_ATTACHMENT0 };
+    m_sceneFBO.bind();
+    m_sceneFBO.setDrawBuffers(drawBuffers);
+    m_sceneFBO.unbind();
+
+    // suns -> planets -> moons:
+    const SceneGraph::NodeId root = m_scene.createNode();
+    addOrbits(root, 8, 10.f, 1.f, .2f, 0);
+}
+
+demo::DemoSceneGraph::~DemoSceneGraph()
+{
+}
+
+void demo::DemoSceneGraph::addOrbits(SceneGraph::NodeId parent, int count, float radius, float scale,
+                                     float speed_radPerSec, int depth)
+{
+    constexpr float pi_f = glm::pi<float>();
+    for (int i = 0; i < count; ++i) {
+        const float angle_rad = 2.f * pi_f * static_cast<float>(i) / static_cast<float>(count);
+        const SceneGraph::NodeId pivot = m_scene.createNode(parent, glm::vec3(0.f),
+                                                            glm::angleAxis(angle_rad, glm::vec3(0.f, 0.f, 1.f)));
+        const SceneGraph::NodeId body = m_scene.createNode(pivot, glm::vec3(radius, 0.f, 0.f),
+                                                           glm::quat(1.f, 0.f, 0.f, 0.f), glm::vec3(scale));
+        m_orbits.push_back(Orbit{pivot, body, angle_rad, speed_radPerSec, static_cast<std::size_t>(depth)});
+        if (depth < 2) {
+            // the children orbit the body (the scale of the body is inherited):
+            addOrbits(body, (depth == 0) ? 12 : 8, 3.f, .3f, 3.f * speed_radPerSec, depth + 1);
+        }
+    }
+}
+
+void demo::DemoSceneGraph::resizeStressNodes(int count)
+{
+    // nodes cannot be removed, only ever add more (in groups of 100 scattered around the origin):
+    std::uniform_real_distribution<float> position(-20.f, 20.f);
+    while (m_stressNodes.size() < static_cast<std::size_t>(count)) {
+        const SceneGraph::NodeId group = m_scene.createNode(SceneGraph::noParent,
+                                                            glm::vec3(position(m_rng), position(m_rng), -10.f),
+                                                            glm::quat(1.f, 0.f, 0.f, 0.f), glm::vec3(.1f));
+        for (int i = 0; i < 100; ++i) {
+            m_stressNodes.push_back(m_scene.createNode(group, glm::vec3(static_cast<float>(i % 10) * 3.f,
+                                                                        static_cast<float>(i / 10) * 3.f, 0.f)));
+        }
+    }
+}
+
+SceneGraph::NodeId demo::DemoSceneGraph::getDrawNode(std::size_t i) const
+{
+    return (i < m_orbits.size()) ? m_orbits[i].body : m_stressNodes[i - m_orbits.size()];
+}
+
+std::size_t demo::DemoSceneGraph::getDrawMaterialIndex(std::size_t i) const
+{
+    return (i < m_orbits.size()) ? m_orbits[i].materialIndex : m_materials.size() - 1;
+}
+
+void demo::DemoSceneGraph::OnWindowSizeChanged(int width, int height)
+{
+    getRenderer().setViewport(0, 0, width, height);
+    m_camera.setAspect(static_cast<float>(width) / static_cast<float>(height));
+
+    m_width = width;
+    m_height = height;
+    m_sceneColor = std::make_unique<GLTexture>(width, height, GL_RGBA8, texture_sampling_presets::noFilter);
+    m_sceneDepth = std::make_unique<GLTexture>(width, height, GL_DEPTH_COMPONENT32F, texture_sampling_presets::noFilter);
+    m_sceneFBO.bind();
+    m_sceneFBO.attachTexture(GL_COLOR_ATTACHMENT0, *m_sceneColor);
+    m_sceneFBO.attachTexture(GL_DEPTH_ATTACHMENT, *m_sceneDepth);
+    ASSERT(m_sceneFBO.checkFramebufferStatus() == GL_FRAMEBUFFER_COMPLETE);
+    m_sceneFBO.unbind();
+}
+
+bool demo::DemoSceneGraph::OnKeyPressed(int key, int scancode, int action, int mods)
+{
+    if (m_cameraController.OnKeyPressed(key, scancode, action, mods)) {
+        return true;
+    }
+    if (action != GLFW_PRESS) {
+        return false;
+    }
+    switch (key) {
+    case GLFW_KEY_1:
+        m_renderPath = static_cast<int>(RenderPath::RENDER_QUEUE);
+        break;
+    case GLFW_KEY_2:
+        m_renderPath = static_cast<int>(RenderPath::COMMAND_LISTS);
+        break;
+    case GLFW_KEY_3:
+        m_renderPath = static_cast<int>(RenderPath::GPU_CULLING);
+        break;
+    case GLFW_KEY_N:
+        m_stressNodeTarget = std::min(m_stressNodeTarget + stressNodesPerKey, maxStressNodes);
+        m_drawStressNodes = true;
+        break;
+    case GLFW_KEY_M:
+        m_drawStressNodes = !m_drawStressNodes;
+        break;
+    case GLFW_KEY_H:
+        m_occlusionCulling = !m_occlusionCulling;
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+void demo::DemoSceneGraph::OnUpdate(float deltaSeconds)
+{
+    m_cameraController.OnUpdate(deltaSeconds);
+    m_time_s += deltaSeconds;
+
+    for (Orbit& orbit : m_orbits) {
+        orbit.angle_rad += orbit.speed_radPerSec * deltaSeconds;
+        m_scene.setRotation(orbit.pivot, glm::angleAxis(orbit.angle_rad, glm::vec3(0.f, 0.f, 1.f)));
+    }
+
+    resizeStressNodes(m_stressNodeTarget);
+    if (!m_stressNodes.empty()) {
+        std::uniform_int_distribution<std::size_t> pick(0, m_stressNodes.size() - 1);
+        for (std::size_t i = 0; i < m_stressNodes.size() / 100; ++i) {
+            m_scene.setRotation(m_stressNodes[pick(m_rng)], glm::angleAxis(m_time_s, glm::vec3(0.f, 1.f, 0.f)));
+        }
+    }
+
+    auto time_start = std::chrono::high_resolution_clock::now();
+    m_scene.update();
+    auto time_end = std::chrono::high_resolution_clock::now();
+    const float time_ms = std::chrono::duration<float, std::milli>(time_end - time_start).count();
+    m_avgUpdateTime_ms = (m_avgUpdateTime_ms < 0.f) ? time_ms : .95f * m_avgUpdateTime_ms + .05f * time_ms;
+}
+
+void demo::DemoSceneGraph::OnRender()
+{
+    getRenderer().clear(GL_COLOR_BUFFER_BIT);
+
+    auto time_start = std::chrono::high_resolution_clock::now();
+    const glm::mat4 cc_from_wc = m_camera.mat_cc_from_wc();
+    const glm::mat4 ndc_from_wc = m_camera.mat_ndc_from_cc() * cc_from_wc;
+    const std::size_t drawCount = m_orbits.size() + (m_drawStressNodes ? m_stressNodes.size() : 0);
+    const RenderPath renderPath = static_cast<RenderPath>(m_renderPath);
+    if (renderPath == RenderPath::GPU_CULLING) {
+        GpuProfileScope profile(getRenderer().getProfiler(), "GPU culling");
+        renderGpuCulled(ndc_from_wc, drawCount);
+    } else {
+        // the depth buffer of the GPU culling path is outdated once it is used again:
+        m_gpuCulling.invalidateHiZ();
+        if (renderPath == RenderPath::COMMAND_LISTS) {
+            GpuProfileScope profile(getRenderer().getProfiler(), "command lists");
+            renderCommandLists(ndc_from_wc, drawCount);
+        } else {
+            GpuProfileScope profile(getRenderer().getProfiler(), "render queue");
+            renderQueued(cc_from_wc, ndc_from_wc, drawCount);
+        }
+    }
+    auto time_end = std::chrono::high_resolution_clock::now();
+    const float time_ms = std::chrono::duration<float, std::milli>(time_end - time_start).count();
+    m_avgRenderTime_ms = (m_avgRenderTime_ms < 0.f) ? time_ms : .95f * m_avgRenderTime_ms + .05f * time_ms;
+}
+
+void demo::DemoSceneGraph::renderQueued(const glm::mat4 &cc_from_wc, const glm::mat4 &ndc_from_wc,
+                                        std::size_t drawCount)
+{
+    m_renderQueue.clear();
+    for (std::size_t i = 0; i < drawCount; ++i) {
+        const glm::mat4& wc_from_oc = m_scene.getWorldTransform(getDrawNode(i));
+        const float depth = -(cc_from_wc * wc_from_oc[3]).z;
+        m_renderQueue.add(0, m_materials[getDrawMaterialIndex(i)], *m_starVAO, *m_starIBO,
+                          ndc_from_wc * wc_from_oc, depth);
+    }
+    m_renderQueue.submit(getRenderer(), 0);
+}
+
+void demo::DemoSceneGraph::renderCommandLists(const glm::mat4 &ndc_from_wc, std::size_t drawCount)
+{
+    // uniform locations are looked up here, the workers must not touch GL:
+    const GLint ndc_from_oc_location = m_shaderP->getUniformLocation("u_ndc_from_oc");
+    const GLint color_location = m_shaderP->getUniformLocation("u_Color");
+
+    constexpr std::size_t grainSize = 1024;
+    m_usedCommandLists = (drawCount + grainSize - 1) / grainSize;
+    if (m_commandLists.size() < m_usedCommandLists) {
+        m_commandLists.resize(m_usedCommandLists);
+    }
+    // each chunk is recorded by exactly one thread into its own list:
+    ThreadPool::shared().parallelFor(drawCount, grainSize, [&](std::size_t begin, std::size_t end) {
+        CommandList& list = m_commandLists[begin / grainSize];
+        list.reset();
+        list.bindProgram(*m_shaderP);
+        list.bindVertexArray(*m_starVAO, *m_starIBO);
+        std::size_t materialIndex = m_materials.size(); // none yet
+        for (std::size_t i = begin; i < end; ++i) {
+            if (getDrawMaterialIndex(i) != materialIndex) {
+                materialIndex = getDrawMaterialIndex(i);
+                list.setUniform4f(color_location, m_colors[materialIndex]);
+            }
+            list.setUniformMat4f(ndc_from_oc_location, ndc_from_wc * m_scene.getWorldTransform(getDrawNode(i)));
+            list.draw();
+        }
+    });
+    CommandList::replay(getRenderer(), gsl::span<const CommandList>(m_commandLists.data(), m_usedCommandLists));
+}
+
+void demo::DemoSceneGraph::renderGpuCulled(const glm::mat4 &ndc_from_wc, std::size_t drawCount)
+{
+    ASSERT(m_sceneColor); // otherwise OnWindowSizeChanged(..) has not been called yet.
+    if (m_gpuCulling.getObjectCount() != drawCount) {
+        // only when the stress nodes are toggled or added:
+        const auto starIndexCount = static_cast<GLuint>(m_starIBO->getCount());
+        std::vector<GpuCullingObject> objects(drawCount);
+        for (std::size_t i = 0; i < drawCount; ++i) {
+            objects[i] = GpuCullingObject{glm::vec4(0.f, 0.f, 0.f, starRadius), starIndexCount, 0, 0,
+                                          static_cast<GLuint>(getDrawMaterialIndex(i))};
+        }
+        m_gpuCulling.setObjects(objects);
+    }
+
+    // the GL thread only maps and unmaps, the workers copy the transforms:
+    glm::mat4* transforms = m_gpuCulling.mapTransforms();
+    if (transforms) {
+        constexpr std::size_t grainSize = 4096;
+        ThreadPool::shared().parallelFor(drawCount, grainSize, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                transforms[i] = m_scene.getWorldTransform(getDrawNode(i));
+            }
+        });
+        m_gpuCulling.unmapTransforms();
+    }
+    m_gpuCulling.cull(getRenderer(), ndc_from_wc);
+
+    m_sceneFBO.bind();
+    getRenderer().clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    getRenderer().enableDepthTest();
+    m_objectsSP->bind();
+    m_objectsSP->setUniformMat4f("u_ndc_from_wc", ndc_from_wc);
+    m_gpuCulling.draw(getRenderer(), *m_culledStarVAO, *m_starIBO);
+    m_culledStarVAO->unbind();
+    m_objectsSP->unbind();
+    getRenderer().disableDepthTest();
+    m_sceneFBO.unbind();
+
+    m_sceneFBO.blitToDefault(m_width, m_height);
+    if (m_occlusionCulling) {
+        // the visible objects occlude the objects of the next frame:
+        m_gpuCulling.buildHiZ(getRenderer(), *m_sceneDepth, ndc_from_wc, 0);
+    } else {
+        m_gpuCulling.invalidateHiZ();
+    }
+}
+
+void demo::DemoSceneGraph::OnImGuiRender()
+{
+    ImGui::Text("nodes: %zu (%zu depth levels)", m_scene.getNodeCount(), m_scene.getDepthCount());
+    ImGui::Text("drawn: %zu", m_orbits.size() + (m_drawStressNodes ? m_stressNodes.size() : 0));
+    ImGui::Text("recomputed last frame: %zu", m_scene.getLastUpdateCount());
+    ImGui::Text("transform update: %.3f ms", static_cast<double>(m_avgUpdateTime_ms));
+    ImGui::SliderInt("stress nodes (1%% change per frame)", &m_stressNodeTarget, 0, maxStressNodes);
+    ImGui::Text("(stress nodes are never removed, key N adds %d)", stressNodesPerKey);
+    ImGui::Checkbox("draw stress nodes (M)", &m_drawStressNodes);
+    ImGui::Separator();
+
+    ImGui::RadioButton("render queue (1)", &m_renderPath, static_cast<int>(RenderPath::RENDER_QUEUE));
+    ImGui::SameLine();
+    ImGui::RadioButton("command lists on worker threads (2)", &m_renderPath, static_cast<int>(RenderPath::COMMAND_LISTS));
+    ImGui::SameLine();
+    ImGui::RadioButton("GPU culling (3)", &m_renderPath, static_cast<int>(RenderPath::GPU_CULLING));
+    ImGui::Text("CPU time of OnRender: %.3f ms", static_cast<double>(m_avgRenderTime_ms));
+    const RenderPath renderPath = static_cast<RenderPath>(m_renderPath);
+    if (renderPath == RenderPath::COMMAND_LISTS) {
+        ImGui::Text("%zu command lists, %u worker threads", m_usedCommandLists, ThreadPool::shared().getThreadCount());
+    } else if (renderPath == RenderPath::GPU_CULLING) {
+        ImGui::Checkbox("occlusion culling with the depth buffer of the last frame (H)", &m_occlusionCulling);
+        const GpuCullingStats stats = m_gpuCulling.getStats();
+        ImGui::Text("visible: %zu of %zu (%s)", stats.visible, stats.objects,
+                    stats.occlusion ? "frustum + Hi-Z of the last frame" : "frustum only");
+        ImGui::Text("indirect draw count: %s", GLRenderer::supportsIndirectCount()
+                    ? "yes" : "no (hidden objects are drawn with 0 instances)");
+    } else {
+        const RenderQueueStats& stats = m_renderQueue.getStats();
+        ImGui::Text("state changes unsorted: %zu (materials: %zu)", stats.unsorted.total(), stats.unsorted.materials);
+        ImGui::Text("state changes sorted:   %zu (materials: %zu)", stats.sorted.total(), stats.sorted.materials);
+        ImGui::Text("sorting %zu draws: %.3f ms", stats.items, static_cast<double>(stats.sort_ms));
+    }
+
+    // camera controls:
+    m_cameraController.OnImGuiRender();
+}
@@ -0,0 +1,191 @@
+#include "demos/DemoVirtualTexture.h"
+
+#include <array>
+#include <filesystem>
+#include <iostream>
+
+#include "debug_utils.h"
+
+#include "imgui.h"
+
+#include "cpu_image_import.h"
+
+#include "VertexBufferLayout.h"
+
+#include "glm/glm.hpp"
+
+
+const GLuint demo::DemoVirtualTexture::texUnitPhysical = 0;
+const GLuint demo::DemoVirtualTexture::texUnitPageTable = 1;
+
+namespace {
+
+// 4x4 differently tinted copies of the uv grid (too big to comfortably keep resident)
+CPUImage makeDemoImage(const std::filesystem::path& tilePath)
+{
+    CPUImage tile = loadImageFile(tilePath, 4).value();
+    constexpr int tiles = 4;
+    CPUImage image{tile.width * tiles, tile.height * tiles, 4, {}};
+    image.data.resize(static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height) * 4);
+    for (int ty = 0; ty < tiles; ++ty) {
+        for (int tx = 0; tx < tiles; ++tx) {
+            const std::array<int, 3> tint = {128 + 127 * (tx & 1), 128 + 127 * (ty & 1), 128 + 127 * ((tx + ty) / 3 % 2)};
+            for (int y = 0; y < tile.height; ++y) {
+                const GLubyte* src = &tile.data[static_cast<std::size_t>(y) * tile.getRowSize()];
+                GLubyte* dst = &image.data[static_cast<std::size_t>(ty * tile.height + y) * image.getRowSize()
+                                           + static_cast<std::size_t>(tx * tile.width) * 4];
+                for (int x = 0; x < tile.width; ++x, src += 4, dst += 4) {
+                    for (std::size_t c = 0; c < 3; ++c) {
+                        dst[c] = static_cast<GLubyte>(src[c] * tint[c] / 255);
+                    }
+                    dst[3] = src[3];
+                }
+            }
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+
+demo::DemoVirtualTexture::DemoVirtualTexture(GLRenderer &renderer)
+    : demo::Demo(renderer),
+      m_camera(glm::radians(45.f), 1.f, .1f, 100.f),
+      m_cameraController(m_camera),
+      m_feedbackPageCount(0),
+      m_maxUploadsPerFrame(8),
+      m_showLevels(false)
+{
+    namespace fs = std::filesystem;
+
+    // look at the ground plane from slightly above:
+    m_camera.translate_global(glm::vec3(0.f, 1.f, 8.f));
+    m_camera.rotatePitch(glm::radians(-15.f));
+
+    // load shaders:
+    m_vtSP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/VirtualTexture.shader",
+                                                        fs::path::format::generic_format));
+    m_feedbackSP = std::make_unique<GLShaderProgram>(fs::path("res/shaders/VirtualTextureFeedback.shader",
+                                                              fs::path::format::generic_format));
+
+    // the page file is generated on the first run (it is not part of the repository):
+    const fs::path pageFilePath("res/textures/vt_demo.vtpf", fs::path::format::generic_format);
+    if (!fs::exists(pageFilePath)) {
+        std::cout << "generating " << pageFilePath << " ...\n";
+        VTPageFile::write(pageFilePath, makeDemoImage(fs::path("res/textures/uv_grid.png", fs::path::format::generic_format)), true);
+    }
+    std::optional<VTPageFile> pageFile = VTPageFile::open(pageFilePath);
+    ASSERT(pageFile);
+    // about 1/8 of the 4096x4096 texture without its mip levels:
+    m_virtualTex = std::make_unique<GLVirtualTexture>(std::move(*pageFile), 8 << 20);
+
+    // init ground plane (VertexBuffer, IndexBuffer, VertexArrays):
+    //  3--2
+    //  | /|
+    //  |/ |
+    //  0--1
+    constexpr float s = 20.f;
+    std::array<GLfloat, 4 * 5> vertices {
+        -s, 0.f,  s,  0.f, 0.f,
+         s, 0.f,  s,  1.f, 0.f,
+         s, 0.f, -s,  1.f, 1.f,
+        -s, 0.f, -s,  0.f, 1.f
+    };
+    std::array<GLuint, 2 * 3> indices {
+        0, 1, 2,
+        0, 2, 3
+    };
+    m_groundVBO = std::make_unique<GLVertexBuffer>(vertices.size() * sizeof(GLfloat), vertices.data());
+    m_groundIBO = std::make_unique<GLIndexBuffer>(GL_UNSIGNED_INT, indices.size(), indices.data());
+
+    VertexBufferLayout layout;
+    layout.append<float>(3, "position_oc");
+    layout.append<float>(2, "texCoord");
+    layout.setLocations(*m_vtSP);
+    m_groundVAO = std::make_unique<GLVertexArray>();
+    m_groundVAO->addBuffer(*m_groundVBO, layout);
+    layout.setLocations(*m_feedbackSP);
+    m_groundFeedbackVAO = std::make_unique<GLVertexArray>();
+    m_groundFeedbackVAO->addBuffer(*m_groundVBO, layout);
+
+    getRenderer().enableDepthTest();
+    getRenderer().enable_framebuffer_sRGB(); // the physical page cache has an sRGB format
+}
+
+demo::DemoVirtualTexture::~DemoVirtualTexture()
+{
+    getRenderer().disable_framebuffer_sRGB();
+    getRenderer().disableDepthTest();
+}
+
+void demo::DemoVirtualTexture::OnWindowSizeChanged(int width, int height)
+{
+    getRenderer().setViewport(0, 0, width, height);
+    m_camera.setAspect(static_cast<float>(width) / static_cast<float>(height));
+    m_feedback.OnWindowSizeChanged(width, height);
+}
+
+bool demo::DemoVirtualTexture::OnKeyPressed(int key, int scancode, int action, int mods)
+{
+    return m_cameraController.OnKeyPressed(key, scancode, action, mods);
+}
+
+void demo::DemoVirtualTexture::OnUpdate(float deltaSeconds)
+{
+    m_cameraController.OnUpdate(deltaSeconds);
+}
+
+void demo::DemoVirtualTexture::OnRender()
+{
+    const glm::mat4 ndc_from_oc = m_camera.mat_ndc_from_cc() * m_camera.mat_cc_from_wc();
+    const VTLayout& layout = m_virtualTex->getLayout();
+
+    GpuProfiler& profiler = getRenderer().getProfiler();
+
+    // 1. feedback pass (read back asynchronously):
+    profiler.beginScope("feedback");
+    m_feedback.begin(getRenderer(), *m_feedbackSP, layout);
+    m_feedbackSP->setUniformMat4f("u_ndc_from_oc", ndc_from_oc);
+    getRenderer().draw(*m_groundFeedbackVAO, *m_groundIBO, *m_feedbackSP);
+    m_feedback.end(getRenderer());
+    profiler.endScope();
+
+    // 2. stream the pages of the latest feedback that arrived:
+    profiler.beginScope("page uploads");
+    const std::vector<VTPageId>& pages = m_feedback.poll(layout);
+    m_feedbackPageCount = pages.size();
+    m_virtualTex->update(pages, static_cast<std::size_t>(m_maxUploadsPerFrame));
+    profiler.endScope();
+
+    // 3. shading pass:
+    profiler.beginScope("shading");
+    getRenderer().setClearColor(.1f, .1f, .1f, 1.f);
+    getRenderer().clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_virtualTex->bind(*m_vtSP, texUnitPhysical, texUnitPageTable);
+    m_vtSP->setUniformMat4f("u_ndc_from_oc", ndc_from_oc);
+    m_vtSP->setUniform1i("u_show_levels", m_showLevels);
+    getRenderer().draw(*m_groundVAO, *m_groundIBO, *m_vtSP);
+    profiler.endScope();
+}
+
+void demo::DemoVirtualTexture::OnImGuiRender()
+{
+    const VTResidency& residency = m_virtualTex->getResidency();
+    const VTLayout& layout = m_virtualTex->getLayout();
+    ImGui::Text("virtual texture: %d x %d, %d levels, %zu pages", layout.size, layout.size,
+                layout.getLevelCount(), layout.getTotalPageCount());
+    ImGui::Text("GPU memory: %.1f MiB (fully resident: %.1f MiB)",
+                static_cast<double>(m_virtualTex->getGPUMemorySize()) / (1 << 20),
+                static_cast<double>(layout.getTotalPageCount() * layout.getPaddedPageSize() * layout.getPaddedPageSize() * 4) / (1 << 20));
+    ImGui::Text("resident pages: %zu / %zu", residency.getResidentCount(), residency.getCapacity());
+    ImGui::Text("feedback pages: %zu (%d x %d texels)", m_feedbackPageCount, m_feedback.getWidth(), m_feedback.getHeight());
+    ImGui::Text("queued: %zu, in flight: %zu", residency.getQueuedCount(), residency.getInFlightCount());
+    ImGui::Text("loads: %llu, evictions: %llu", static_cast<unsigned long long>(residency.getLoadCount()),
+                static_cast<unsigned long long>(residency.getEvictionCount()));
+    ImGui::SliderInt("max. uploads per frame", &m_maxUploadsPerFrame, 1, 64);
+    ImGui::Checkbox("tint by resident level", &m_showLevels);
+
+    // camera controls:
+    m_cameraController.OnImGuiRender();
+}
@@ -0,0 +1,250 @@
+#include "demos/InputRecording.h"
+
+#include <algorithm> // for std::min(..)
+#include <array>
+#include <cstring> // for std::memcpy(..)
+#include <iostream>
+#include <iterator> // for std::istreambuf_iterator
+#include <limits>
+
+#include "demos/Demo.h"
+#include "debug_utils.h"
+
+namespace {
+
+constexpr std::array<char, 4> magic = {'G', 'L', 'I', 'R'};
+constexpr std::uint32_t version = 1;
+
+constexpr std::uint8_t frameTag = 0;
+
+void writeU8(std::ostream& os, std::uint8_t value)
+{
+    os.put(static_cast<char>(value));
+}
+
+void writeU16(std::ostream& os, std::uint16_t value)
+{
+    writeU8(os, static_cast<std::uint8_t>(value & 0xffu));
+    writeU8(os, static_cast<std::uint8_t>(value >> 8));
+}
+
+void writeU32(std::ostream& os, std::uint32_t value)
+{
+    writeU16(os, static_cast<std::uint16_t>(value & 0xffffu));
+    writeU16(os, static_cast<std::uint16_t>(value >> 16));
+}
+
+void writeI32(std::ostream& os, int value)
+{
+    writeU32(os, static_cast<std::uint32_t>(value));
+}
+
+// reads the little endian values InputRecorder wrote, fails (and stays failed) at the end of the data
+class Reader
+{
+public:
+    explicit Reader(const std::vector<char>& data)
+        : m_data(data)
+    {}
+
+    bool failed() const {
+        return m_failed;
+    }
+    bool atEnd() const {
+        return m_pos >= m_data.size();
+    }
+
+    std::uint8_t u8() {
+        if (m_pos >= m_data.size()) {
+            m_failed = true;
+            return 0;
+        }
+        return static_cast<std::uint8_t>(m_data[m_pos++]);
+    }
+    std::uint16_t u16() {
+        const std::uint16_t low = u8();
+        return static_cast<std::uint16_t>(low | (u8() << 8));
+    }
+    std::uint32_t u32() {
+        const std::uint32_t low = u16();
+        return low | (static_cast<std::uint32_t>(u16()) << 16);
+    }
+    int i32() {
+        return static_cast<int>(static_cast<std::int32_t>(u32()));
+    }
+    std::string string(std::size_t length) {
+        if (m_data.size() - m_pos < length) {
+            m_failed = true;
+            return {};
+        }
+        std::string s(m_data.data() + m_pos, length);
+        m_pos += length;
+        return s;
+    }
+
+private:
+    const std::vector<char>& m_data;
+    std::size_t m_pos = 0;
+    bool m_failed = false;
+};
+
+}
+
+namespace demo {
+
+// InputRecorder:
+InputRecorder::InputRecorder(const std::filesystem::path &path)
+    : m_file(path, std::ios::binary)
+{
+    if (!m_file) {
+        std::cerr << "WARNING: could not open " << path << " to record the input\n";
+        return;
+    }
+    m_file.write(magic.data(), magic.size());
+    writeU32(m_file, version);
+}
+
+void InputRecorder::recordKey(int key, int scancode, int action, int mods)
+{
+    writeU8(m_file, static_cast<std::uint8_t>(InputEvent::Type::KEY));
+    writeI32(m_file, key);
+    writeI32(m_file, scancode);
+    // (GLFW actions are 0..2, the modifiers are 6 bits)
+    writeU8(m_file, static_cast<std::uint8_t>(action));
+    writeU8(m_file, static_cast<std::uint8_t>(mods));
+}
+
+void InputRecorder::recordWindowSize(int width, int height)
+{
+    writeU8(m_file, static_cast<std::uint8_t>(InputEvent::Type::WINDOW_SIZE));
+    writeI32(m_file, width);
+    writeI32(m_file, height);
+}
+
+void InputRecorder::recordDemo(const std::string &name)
+{
+    if (m_demoName == name) {
+        return;
+    }
+    m_demoName = name;
+    const std::size_t length = std::min(name.size(), std::size_t(std::numeric_limits<std::uint16_t>::max()));
+    writeU8(m_file, static_cast<std::uint8_t>(InputEvent::Type::DEMO));
+    writeU16(m_file, static_cast<std::uint16_t>(length));
+    m_file.write(name.data(), static_cast<std::streamsize>(length));
+}
+
+void InputRecorder::recordFrame(float deltaSeconds)
+{
+    std::uint32_t bits;
+    static_assert(sizeof(bits) == sizeof(deltaSeconds));
+    std::memcpy(&bits, &deltaSeconds, sizeof(bits));
+    writeU8(m_file, frameTag);
+    writeU32(m_file, bits);
+    ++m_frameCount;
+}
+
+// InputReplay:
+InputReplay::InputReplay(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "WARNING: could not open the input recording " << path << '\n';
+        return;
+    }
+    const std::vector<char> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    Reader reader(data);
+    const std::string fileMagic = reader.string(magic.size());
+    if (reader.failed() || fileMagic != std::string(magic.data(), magic.size()) || reader.u32() != version) {
+        std::cerr << "WARNING: " << path << " is not an input recording of this version\n";
+        return;
+    }
+
+    InputFrame frame;
+    while (!reader.atEnd()) {
+        const std::uint8_t tag = reader.u8();
+        if (tag == frameTag) {
+            const std::uint32_t bits = reader.u32();
+            std::memcpy(&frame.deltaSeconds, &bits, sizeof(bits));
+            if (reader.failed()) {
+                break;
+            }
+            m_frames.push_back(std::move(frame));
+            frame = InputFrame();
+            continue;
+        }
+        InputEvent event;
+        event.type = static_cast<InputEvent::Type>(tag);
+        switch (event.type) {
+        case InputEvent::Type::KEY:
+            event.key = reader.i32();
+            event.scancode = reader.i32();
+            event.action = reader.u8();
+            event.mods = reader.u8();
+            break;
+        case InputEvent::Type::WINDOW_SIZE:
+            event.width = reader.i32();
+            event.height = reader.i32();
+            break;
+        case InputEvent::Type::DEMO:
+            event.demoName = reader.string(reader.u16());
+            break;
+        default:
+            std::cerr << "WARNING: unknown event " << static_cast<int>(tag) << " in " << path
+                      << ", the replay stops at frame " << m_frames.size() << '\n';
+            m_valid = true;
+            return;
+        }
+        if (reader.failed()) {
+            break;
+        }
+        frame.events.push_back(std::move(event));
+    }
+    // (a crashed session leaves an incomplete last frame behind)
+    if (reader.failed() || !frame.events.empty()) {
+        std::cerr << "WARNING: " << path << " ends within a frame, the replay stops at frame "
+                  << m_frames.size() << '\n';
+    }
+    m_valid = true;
+}
+
+std::optional<std::pair<int, int>> InputReplay::getInitialWindowSize() const
+{
+    for (const InputFrame& frame : m_frames) {
+        for (const InputEvent& event : frame.events) {
+            if (event.type == InputEvent::Type::WINDOW_SIZE) {
+                return std::pair(event.width, event.height);
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+float InputReplay::replayFrame(DemoSuite &suite, bool applyWindowSize)
+{
+    ASSERT(!isFinished());
+    const InputFrame& frame = m_frames[m_currentFrame++];
+    for (const InputEvent& event : frame.events) {
+        switch (event.type) {
+        case InputEvent::Type::KEY:
+            suite.OnKeyPressed(event.key, event.scancode, event.action, event.mods);
+            break;
+        case InputEvent::Type::WINDOW_SIZE:
+            if (applyWindowSize) {
+                suite.OnWindowSizeChanged(event.width, event.height);
+            }
+            break;
+        case InputEvent::Type::DEMO:
+            if (event.demoName == suite.getCurrentDemoName()) {
+                // (e.g. the recorded escape key already closed the demo)
+            } else if (event.demoName.empty()) {
+                suite.CloseDemo();
+            } else {
+                suite.SelectDemo(event.demoName);
+            }
+            break;
+        }
+    }
+    return frame.deltaSeconds;
+}
+
+}
@@ -0,0 +1,34 @@
+#include "gl_format_utils.h"
+
+GLFormatSize getGLFormatSize(GLenum internalformat)
+{
+    switch (internalformat) {
+    case GL_R8:
+        return {8, 0};
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        return {16, 0};
+    case GL_RG16F:
+    case GL_R32F:
+    case GL_RGB10_A2:
+    case GL_R11F_G11F_B10F:
+    case GL_DEPTH_COMPONENT24: // (usually padded to 32 bits)
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH_COMPONENT32F:
+        return {32, 0};
+    case GL_RGBA16F:
+    case GL_RG32F:
+        return {64, 0};
+    case GL_RGBA32F:
+        return {128, 0};
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        return {0, 8};
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+        return {0, 16};
+    default: // GL_RGBA8, GL_SRGB8_ALPHA8, ...
+        return {32, 0};
+    }
+}
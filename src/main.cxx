@@ -8,11 +8,21 @@
 #include <iostream>
 #include <memory>
 #include <chrono>
+#include <optional>
+#include <filesystem>
+#include <string_view>
 
 #include "debug_utils.h"
+#include "CpuProfiler.h"
+#include "FrameCapture.h"
+#include "GLCallStats.h"
+#include "HeadlessContext.h"
 
 #include "GLRenderer.h"
 
+#include "demos/DemoBenchmark.h"
+#include "demos/InputRecording.h"
+
 #include "demos/DemoClearColor.h"
 #include "demos/DemoMultipleConcepts.h"
 #include "demos/DemoLoadOBJ.h"
@@ -20,6 +30,8 @@
 #include "demos/DemoPhongReflectionModelTextured.h"
 #include "demos/DemoLinearColorspace.h"
 #include "demos/DemoFramebuffer.h"
+#include "demos/DemoVirtualTexture.h"
+#include "demos/DemoSceneGraph.h"
 
 
 namespace raii_fy {
@@ -119,6 +131,10 @@ namespace raii_fy {
 
 
 std::weak_ptr<demo::Demo> demo_global_ptr;
+// --record FILE: what the demos get from the glfw-callbacks is written to the recorder
+demo::InputRecorder* input_recorder_global_ptr = nullptr;
+// --replay FILE: while the replay runs the demos get no input from the glfw-callbacks
+bool input_replay_active = false;
 
 // OpenGL callback:
 void GLAPIENTRY gl_debug_output_callback(GLenum source, GLenum type,
@@ -133,6 +149,78 @@ void GLAPIENTRY gl_debug_output_callback(GLenum source, GLenum type,
     ASSERT(severity == GL_DEBUG_SEVERITY_NOTIFICATION);
 }
 
+void enable_gl_debug_output() {
+#ifndef NDEBUG
+    // the OpenGL-context was created in Debug mode (GLFW_OPENGL_DEBUG_CONTEXT / HeadlessContext(.., debug))
+    glEnable(GL_DEBUG_OUTPUT);
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(gl_debug_output_callback, nullptr);
+#endif
+}
+
+void register_demos(demo::DemoSuite& suite) {
+    suite.RegisterDemo<demo::DemoClearColor>("Clear Color");
+    suite.RegisterDemo<demo::DemoMultipleConcepts>("a bunch of stuff");
+    suite.RegisterDemo<demo::DemoLoadOBJ>("Load WavefrontOBJ-file");
+    suite.RegisterDemo<demo::DemoPhongReflectionModel>("Phong Reflection Model");
+    suite.RegisterDemo<demo::DemoPhongReflectionModelTextured>("Phong Reflection Model with Texture");
+    suite.RegisterDemo<demo::DemoLinearColorspace>("Linear Colorspace");
+    suite.RegisterDemo<demo::DemoFramebuffer>("Framebuffer");
+    suite.RegisterDemo<demo::DemoVirtualTexture>("Virtual Texture");
+    suite.RegisterDemo<demo::DemoSceneGraph>("Scene Graph");
+}
+
+// --benchmark: runs the demos without a window (e.g. on Mesa llvmpipe without display or GPU)
+int run_benchmark(int argc, char **argv) {
+    const std::optional<demo::BenchmarkOptions> options = demo::DemoBenchmark::parseArguments(argc, argv);
+    if (!options) {
+        return -1;
+    }
+#ifdef NDEBUG
+    HeadlessContext context(options->width, options->height, 4, 3, false);
+#else
+    HeadlessContext context(options->width, options->height, 4, 3, true);
+#endif
+    if (!context.isValid()) {
+        std::cout << "error: no headless OpenGL context: " << context.getError() << '\n';
+        return -1;
+    }
+    if (!context.hasDefaultFramebuffer()) {
+        // (the capture reads the back buffer of the default framebuffer, which does not exist)
+        if (!options->capture.empty() || !options->stream.empty()) {
+            std::cout << "error: --capture and --stream need a default framebuffer, but only a surfaceless context"
+                         " could be created\n";
+            return -1;
+        }
+        std::cerr << "WARNING: surfaceless context, drawing to the default framebuffer is discarded\n";
+    }
+
+    GLenum glewError = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW looks for the GLX extensions after the OpenGL ones, which fails without an X display:
+    if (glewError == GLEW_ERROR_NO_GLX_DISPLAY) {
+        glewError = GLEW_OK;
+    }
+#endif
+    if (glewError != GLEW_OK) {
+        std::cout << "error: glewInit() failed!\n";
+        return -1;
+    }
+    std::cout << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << '\n';
+    enable_gl_debug_output();
+    GLCallStats::shared().install();
+
+    // (destroyed before the context)
+    GLRenderer renderer;
+    demo::DemoSuite suite(renderer);
+    register_demos(suite);
+
+    demo::DemoBenchmark benchmark(suite, *options);
+    const bool allFound = benchmark.run();
+    const bool written = benchmark.writeResults();
+    return (allFound && written) ? 0 : -1;
+}
+
 
 // GLFW callbacks:
 void error_callback(int error, const char* description) {
@@ -141,6 +229,9 @@ void error_callback(int error, const char* description) {
 
 // uncomment unused parameter name to avoid -Wunused-parameter warning:
 void update_window_size(GLFWwindow* /*window*/, int width, int height) {
+    if (input_recorder_global_ptr) {
+        input_recorder_global_ptr->recordWindowSize(width, height);
+    }
     if (auto demo_sp = demo_global_ptr.lock()) {
         demo_sp->OnWindowSizeChanged(width, height);
     }
@@ -149,7 +240,15 @@ void update_window_size(GLFWwindow* /*window*/, int width, int height) {
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (ImGui::GetIO().WantCaptureKeyboard) {
         // do nothing Dear ImGui handles it for us
+    } else if (input_replay_active) {
+        // the replay decides what the demos get, only escape still closes the window:
+        if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
     } else {
+        if (input_recorder_global_ptr) {
+            input_recorder_global_ptr->recordKey(key, scancode, action, mods);
+        }
         auto demo_sp = demo_global_ptr.lock();
         if (demo_sp && demo_sp->OnKeyPressed(key, scancode, action, mods)) {
             // do nothing the demo handled it for us
@@ -168,6 +267,7 @@ int main(int argc, char **argv)
     // disable old c-style I/O to improve performance
     // (see Stroustrup a tour of c++ Second Edition Section 10.9):
     std::ios_base::sync_with_stdio(false);
+    CpuProfiler::setThreadName("main");
 
     #ifdef NDEBUG
     std::cout << "RELEASE VERSION\n";
@@ -175,6 +275,30 @@ int main(int argc, char **argv)
     std::cout << "DEBUG VERSION\n";
     #endif
 
+    if (demo::DemoBenchmark::isRequested(argc, argv)) {
+        return run_benchmark(argc, argv);
+    }
+
+    // [DEMO] [--record FILE | --replay FILE]
+    const char* demo_name = nullptr;
+    std::filesystem::path record_path;
+    std::filesystem::path replay_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if ((arg == "--record" || arg == "--replay") && i + 1 < argc) {
+            (arg == "--record" ? record_path : replay_path) = argv[++i];
+        } else if (arg.substr(0, 2) == "--") {
+            std::cout << "error: unknown option " << arg << ", usage: [DEMO] [--record FILE | --replay FILE]\n";
+            return -1;
+        } else {
+            demo_name = argv[i];
+        }
+    }
+    if (!record_path.empty() && !replay_path.empty()) {
+        std::cout << "error: --record and --replay cannot be combined\n";
+        return -1;
+    }
+
     /* Initialize GLFW */
     glfwSetErrorCallback(error_callback);
     raii_fy::GLFWInitialization init; // constructor calls GLFWInit()
@@ -183,8 +307,8 @@ int main(int argc, char **argv)
     }
 
     /* Create a windowed mode window and its OpenGL context */
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);  // glTexStorage2D(...) requires OpenGL 4.2
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);  // glTexStorage2D(...) requires OpenGL 4.2,
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);  // compute shaders (GLImageFilter) require OpenGL 4.3
     //glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4); // for anisotropic filtering without extension
     //glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -215,13 +339,8 @@ int main(int argc, char **argv)
     std::cout << glGetString(GL_VERSION) << '\n';
 
     // set up OpenGL Debug Output:
-#ifndef NDEBUG
-    // rememeber we did: glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
-    // so our OpenGL-context should be in Debug mode now
-    glEnable(GL_DEBUG_OUTPUT);
-    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-    glDebugMessageCallback(gl_debug_output_callback, nullptr);
-#endif
+    enable_gl_debug_output();
+    GLCallStats::shared().install();
 
     // Setup Dear ImGui context:
     IMGUI_CHECKVERSION();
@@ -239,15 +358,9 @@ int main(int argc, char **argv)
 
     std::shared_ptr<demo::DemoSuite> myDemoP = std::make_shared<demo::DemoSuite>(renderer);
     // we use a shared pointer to share it with the glfw-callbacks, which can only access the global namespace
-    myDemoP->RegisterDemo<demo::DemoClearColor>("Clear Color");
-    myDemoP->RegisterDemo<demo::DemoMultipleConcepts>("a bunch of stuff");
-    myDemoP->RegisterDemo<demo::DemoLoadOBJ>("Load WavefrontOBJ-file");
-    myDemoP->RegisterDemo<demo::DemoPhongReflectionModel>("Phong Reflection Model");
-    myDemoP->RegisterDemo<demo::DemoPhongReflectionModelTextured>("Phong Reflection Model with Texture");
-    myDemoP->RegisterDemo<demo::DemoLinearColorspace>("Linear Colorspace");
-    myDemoP->RegisterDemo<demo::DemoFramebuffer>("Framebuffer");
-    if (argc >= 2) {
-        myDemoP->SelectDemo(argv[1]);
+    register_demos(*myDemoP);
+    if (demo_name) {
+        myDemoP->SelectDemo(demo_name);
     }
 
     demo_global_ptr = myDemoP;
@@ -258,6 +371,30 @@ int main(int argc, char **argv)
     glfwGetFramebufferSize(window.get(), &width, &height);
     myDemoP->OnWindowSizeChanged(width, height);
 
+    std::optional<demo::InputRecorder> recorder;
+    if (!record_path.empty()) {
+        recorder.emplace(record_path);
+        if (!recorder->isValid()) {
+            return -1;
+        }
+        recorder->recordWindowSize(width, height);
+        recorder->recordDemo(myDemoP->getCurrentDemoName());
+        input_recorder_global_ptr = &*recorder;
+    }
+    std::optional<demo::InputReplay> replay;
+    if (!replay_path.empty()) {
+        replay.emplace(replay_path);
+        if (!replay->isValid()) {
+            return -1;
+        }
+        // (the recording selects its demos itself)
+        myDemoP->CloseDemo();
+        input_replay_active = !replay->isFinished();
+    }
+
+    // (destroyed before the OpenGL context)
+    FrameCapture frameCapture;
+
     auto t_old = std::chrono::steady_clock::now();
     while (!glfwWindowShouldClose(window.get()))
     {
@@ -277,15 +414,54 @@ int main(int argc, char **argv)
         // convert to seconds:
         using secondsPerTick = std::ratio<1>;
         float deltaSeconds = chr::duration_cast<chr::duration<float, secondsPerTick>>(deltaTime).count();
+        if (input_replay_active) {
+            // the recorded delta time instead of the measured one (the window keeps its own size):
+            deltaSeconds = replay->replayFrame(*myDemoP, false);
+            if (replay->isFinished()) {
+                std::cout << "replay of " << replay_path << " finished after " << replay->getFrames().size()
+                          << " frames\n";
+                input_replay_active = false;
+            }
+        }
+        if (recorder) {
+            recorder->recordFrame(deltaSeconds);
+        }
 
-        myDemoP->OnUpdate(deltaSeconds);
-        myDemoP->OnRender();
+        renderer.getProfiler().beginFrame();
+        GLCallStats::shared().beginFrame();
+        {
+            CPU_PROFILE_SCOPE("OnUpdate");
+            myDemoP->OnUpdate(deltaSeconds);
+        }
+        {
+            CPU_PROFILE_SCOPE("OnRender");
+            GpuProfileScope profile(renderer.getProfiler(), "OnRender");
+            myDemoP->OnRender();
+        }
+        // (screenshots without the user interface)
+        frameCapture.poll();
+        if (frameCapture.isCaptureRequested()) {
+            glfwGetFramebufferSize(window.get(), &width, &height);
+            frameCapture.capture(width, height);
+        }
+        frameCapture.endFrame();
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        myDemoP->OnImGuiRender();
+        {
+            CPU_PROFILE_SCOPE("OnImGuiRender");
+            myDemoP->OnImGuiRender();
+        }
+        if (recorder) {
+            // (the menu and the escape key can select or close demos)
+            recorder->recordDemo(myDemoP->getCurrentDemoName());
+        }
+        renderer.getProfiler().OnImGuiRender();
+        CpuProfiler::shared().OnImGuiRender();
+        GLCallStats::shared().OnImGuiRender();
+        frameCapture.OnImGuiRender();
         // if (show_demo_window) {
         //     ImGui::ShowDemoWindow(&show_demo_window);
         // }
@@ -293,10 +469,20 @@ int main(int argc, char **argv)
         bool sRGB = renderer.isEnabled_framebuffer_sRGB();
         if (sRGB) renderer.disable_framebuffer_sRGB();
         ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            CPU_PROFILE_SCOPE("ImGui");
+            GpuProfileScope profile(renderer.getProfiler(), "ImGui");
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
         if (sRGB) renderer.enable_framebuffer_sRGB();
+        GLCallStats::shared().endFrame();
+        renderer.getProfiler().endFrame();
+        CpuProfiler::shared().collect();
 
-        glfwSwapBuffers(window.get());
+        {
+            CPU_PROFILE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(window.get());
+        }
     }
 
     // The following are called after(!) the destructor of myDemo:
@@ -0,0 +1,506 @@
+#include "texture_cache.h"
+
+#include <algorithm> // for std::copy(..)
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>  // for std::istreambuf_iterator
+#include <string>
+#include <vector>
+
+#include "cpu_image_compression.h"
+#include "cpu_image_import.h"
+#include "debug_utils.h"
+
+namespace {
+
+constexpr std::array<GLubyte, 12> ktx2Identifier = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// VkFormat values:
+constexpr std::uint32_t VK_FORMAT_R8_UNORM = 9;
+constexpr std::uint32_t VK_FORMAT_R8G8_UNORM = 16;
+constexpr std::uint32_t VK_FORMAT_R8G8B8A8_UNORM = 37;
+constexpr std::uint32_t VK_FORMAT_R8G8B8A8_SRGB = 43;
+constexpr std::uint32_t VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+constexpr std::uint32_t VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132;
+constexpr std::uint32_t VK_FORMAT_BC3_UNORM_BLOCK = 137;
+constexpr std::uint32_t VK_FORMAT_BC3_SRGB_BLOCK = 138;
+
+// sizes of the fixed parts of the file:
+constexpr std::size_t headerSize = 12 + 9 * 4;
+constexpr std::size_t indexSize = 4 * 4 + 2 * 8;
+constexpr std::size_t levelIndexEntrySize = 3 * 8;
+
+std::optional<std::uint32_t> getVkFormat(int channels, bool sRGB)
+{
+    switch (channels) {
+    case 1: return sRGB ? std::nullopt : std::optional<std::uint32_t>(VK_FORMAT_R8_UNORM);
+    case 2: return sRGB ? std::nullopt : std::optional<std::uint32_t>(VK_FORMAT_R8G8_UNORM);
+    case 4: return sRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    default: return std::nullopt;
+    }
+}
+
+std::uint32_t getVkFormat(BlockFormat format, bool sRGB)
+{
+    if (format == BlockFormat::BC1) {
+        return sRGB ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    }
+    return sRGB ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+}
+
+std::size_t alignUp(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// little endian serialization:
+class ByteWriter {
+public:
+    void u8(std::uint8_t v) {
+        m_bytes.push_back(v);
+    }
+    void u32(std::uint32_t v) {
+        for (int i = 0; i < 4; ++i) {
+            u8(static_cast<std::uint8_t>(v >> (8 * i)));
+        }
+    }
+    void u64(std::uint64_t v) {
+        for (int i = 0; i < 8; ++i) {
+            u8(static_cast<std::uint8_t>(v >> (8 * i)));
+        }
+    }
+    void bytes(const GLubyte* data, std::size_t size) {
+        m_bytes.insert(m_bytes.end(), data, data + size);
+    }
+    void padTo(std::size_t alignment) {
+        m_bytes.resize(alignUp(m_bytes.size(), alignment), 0);
+    }
+    std::size_t size() const {
+        return m_bytes.size();
+    }
+    std::vector<GLubyte>& get() {
+        return m_bytes;
+    }
+private:
+    std::vector<GLubyte> m_bytes;
+};
+
+std::uint32_t readU32(const std::vector<GLubyte>& bytes, std::size_t offset)
+{
+    std::uint32_t v = 0;
+    for (std::size_t i = 0; i < 4; ++i) {
+        v |= static_cast<std::uint32_t>(bytes[offset + i]) << (8 * i);
+    }
+    return v;
+}
+
+std::uint64_t readU64(const std::vector<GLubyte>& bytes, std::size_t offset)
+{
+    return static_cast<std::uint64_t>(readU32(bytes, offset))
+           | (static_cast<std::uint64_t>(readU32(bytes, offset + 4)) << 32);
+}
+
+constexpr std::uint32_t KHR_DF_MODEL_RGBSDA = 1;
+constexpr std::uint32_t KHR_DF_MODEL_BC1A = 128;
+constexpr std::uint32_t KHR_DF_MODEL_BC3 = 130;
+constexpr std::uint32_t KHR_DF_CHANNEL_RED = 0; // also the color channel of BC1 / BC3
+constexpr std::uint32_t KHR_DF_CHANNEL_GREEN = 1;
+constexpr std::uint32_t KHR_DF_CHANNEL_BLUE = 2;
+constexpr std::uint32_t KHR_DF_CHANNEL_ALPHA = 15; // also the alpha channel of BC3
+constexpr std::uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+struct DFDSample {
+    std::uint32_t bitOffset;
+    std::uint32_t bitLength;
+    std::uint32_t channelType;
+    std::uint32_t sampleUpper;
+};
+
+// basic data format descriptor of the KTX specification
+void writeDFD(ByteWriter& out, std::uint32_t colorModel, bool sRGB, std::uint32_t texelBlockDimension,
+              std::uint32_t bytesPlane0, const std::vector<DFDSample>& samples)
+{
+    constexpr std::uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+    constexpr std::uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+    constexpr std::uint32_t KHR_DF_TRANSFER_SRGB = 2;
+
+    const auto blockSize = static_cast<std::uint32_t>(24 + 16 * samples.size());
+    out.u32(4 + blockSize); // dfdTotalSize
+    out.u32(0); // vendorId = KHR, descriptorType = basic
+    out.u32(2 | (blockSize << 16)); // versionNumber, descriptorBlockSize
+    out.u32(colorModel
+            | (KHR_DF_PRIMARIES_BT709 << 8)
+            | ((sRGB ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16)); // flags = 0 (straight alpha)
+    out.u32(texelBlockDimension | (texelBlockDimension << 8)); // texel block dimensions - 1
+    out.u32(bytesPlane0); // bytesPlane0..3
+    out.u32(0); // bytesPlane4..7
+    for (const DFDSample& sample : samples) {
+        out.u32(sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channelType << 24));
+        out.u32(0); // sample position
+        out.u32(0); // sampleLower
+        out.u32(sample.sampleUpper);
+    }
+}
+
+void writeDFD(ByteWriter& out, int channels, bool sRGB)
+{
+    constexpr std::array<std::uint32_t, 4> channelTypes = {KHR_DF_CHANNEL_RED, KHR_DF_CHANNEL_GREEN,
+                                                           KHR_DF_CHANNEL_BLUE, KHR_DF_CHANNEL_ALPHA};
+    std::vector<DFDSample> samples;
+    for (std::uint32_t c = 0; c < static_cast<std::uint32_t>(channels); ++c) {
+        std::uint32_t channelType = channelTypes[c];
+        if (sRGB && channelType == KHR_DF_CHANNEL_ALPHA) {
+            channelType |= KHR_DF_SAMPLE_DATATYPE_LINEAR; // alpha is never sRGB encoded
+        }
+        samples.push_back({8 * c, 8, channelType, 255});
+    }
+    writeDFD(out, KHR_DF_MODEL_RGBSDA, sRGB, 0, static_cast<std::uint32_t>(channels), samples);
+}
+
+void writeDFD(ByteWriter& out, BlockFormat format, bool sRGB)
+{
+    std::vector<DFDSample> samples;
+    if (format == BlockFormat::BC3) {
+        // alpha is never sRGB encoded:
+        samples.push_back({0, 64, KHR_DF_CHANNEL_ALPHA | (sRGB ? KHR_DF_SAMPLE_DATATYPE_LINEAR : 0), 0xffffffffu});
+        samples.push_back({64, 64, KHR_DF_CHANNEL_RED, 0xffffffffu});
+    } else {
+        samples.push_back({0, 64, KHR_DF_CHANNEL_RED, 0xffffffffu});
+    }
+    writeDFD(out, (format == BlockFormat::BC3) ? KHR_DF_MODEL_BC3 : KHR_DF_MODEL_BC1A, sRGB,
+             3, static_cast<std::uint32_t>(getBlockByteSize(format)), samples);
+}
+
+void writeKeyValue(ByteWriter& out, const std::string& key, const std::string& value)
+{
+    out.u32(static_cast<std::uint32_t>(key.size() + 1 + value.size() + 1));
+    out.bytes(reinterpret_cast<const GLubyte*>(key.c_str()), key.size() + 1);
+    out.bytes(reinterpret_cast<const GLubyte*>(value.c_str()), value.size() + 1);
+    out.padTo(4);
+}
+
+struct KTX2Contents {
+    std::uint32_t vkFormat = 0;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::vector<std::vector<GLubyte>> levels;
+};
+
+bool writeKTX2(const std::filesystem::path &filepath, std::uint32_t vkFormat, int width, int height,
+               std::size_t levelAlignment, const std::function<void(ByteWriter&)>& writeFormatDescriptor,
+               const std::vector<const std::vector<GLubyte>*>& levels)
+{
+    ASSERT(!levels.empty());
+    const std::size_t levelCount = levels.size();
+    ByteWriter out;
+
+    out.bytes(ktx2Identifier.data(), ktx2Identifier.size());
+    out.u32(vkFormat);
+    out.u32(1); // typeSize
+    out.u32(static_cast<std::uint32_t>(width));
+    out.u32(static_cast<std::uint32_t>(height));
+    out.u32(0); // pixelDepth
+    out.u32(0); // layerCount
+    out.u32(1); // faceCount
+    out.u32(static_cast<std::uint32_t>(levelCount));
+    out.u32(0); // supercompressionScheme
+
+    // the index is patched once the offsets are known:
+    const std::size_t indexOffset = out.size();
+    out.get().resize(headerSize + indexSize + levelCount * levelIndexEntrySize, 0);
+
+    const auto dfdOffset = static_cast<std::uint32_t>(out.size());
+    writeFormatDescriptor(out);
+    const auto dfdLength = static_cast<std::uint32_t>(out.size()) - dfdOffset;
+
+    const auto kvdOffset = static_cast<std::uint32_t>(out.size());
+    writeKeyValue(out, "KTXorientation", "ru");
+    writeKeyValue(out, "KTXwriter", "OpenGLDemos");
+    const auto kvdLength = static_cast<std::uint32_t>(out.size()) - kvdOffset;
+
+    // mip levels are stored from the smallest to the largest one:
+    std::vector<std::uint64_t> levelOffsets(levelCount);
+    for (std::size_t level = levelCount; level-- > 0;) {
+        out.padTo(levelAlignment);
+        levelOffsets[level] = out.size();
+        out.bytes(levels[level]->data(), levels[level]->size());
+    }
+
+    ByteWriter index;
+    index.u32(dfdOffset);
+    index.u32(dfdLength);
+    index.u32(kvdOffset);
+    index.u32(kvdLength);
+    index.u64(0); // sgdByteOffset
+    index.u64(0); // sgdByteLength
+    for (std::size_t level = 0; level < levelCount; ++level) {
+        const auto size = static_cast<std::uint64_t>(levels[level]->size());
+        index.u64(levelOffsets[level]);
+        index.u64(size); // byteLength
+        index.u64(size); // uncompressedByteLength
+    }
+    std::copy(index.get().begin(), index.get().end(), out.get().begin() + static_cast<std::ptrdiff_t>(indexOffset));
+
+    // write to a temporary file first, so a crash never leaves a truncated cache file behind:
+    std::filesystem::path tmpPath = filepath;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "WARNING: could not open " << tmpPath << " for writing\n";
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(out.get().data()), static_cast<std::streamsize>(out.size()));
+        if (!file) {
+            std::cerr << "WARNING: could not write " << tmpPath << '\n';
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, filepath, ec);
+    if (ec) {
+        std::cerr << "WARNING: could not rename " << tmpPath << " to " << filepath << ": " << ec.message() << '\n';
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+// levelByteSize(width, height) is the expected size of a level
+std::optional<KTX2Contents> readKTX2(const std::filesystem::path &filepath,
+                                     const std::function<std::optional<std::size_t>(std::uint32_t, int, int)>& levelByteSize)
+{
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+    const std::vector<GLubyte> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    auto fail = [&filepath](const char* reason) -> std::optional<KTX2Contents> {
+        std::cerr << "WARNING: can not read " << filepath << ": " << reason << '\n';
+        return std::nullopt;
+    };
+    if (bytes.size() < headerSize + indexSize
+            || !std::equal(ktx2Identifier.begin(), ktx2Identifier.end(), bytes.begin())) {
+        return fail("not a KTX2 file");
+    }
+
+    KTX2Contents contents;
+    contents.vkFormat = readU32(bytes, 12);
+    contents.width = readU32(bytes, 20);
+    contents.height = readU32(bytes, 24);
+    const std::uint32_t depth = readU32(bytes, 28);
+    const std::uint32_t layerCount = readU32(bytes, 32);
+    const std::uint32_t faceCount = readU32(bytes, 36);
+    const std::uint32_t levelCount = readU32(bytes, 40);
+    const std::uint32_t supercompression = readU32(bytes, 44);
+    if (depth != 0 || layerCount != 0 || faceCount != 1 || supercompression != 0
+            || levelCount == 0 || levelCount > 32 || contents.width == 0 || contents.height == 0) {
+        return fail("unsupported texture layout");
+    }
+    if (bytes.size() < headerSize + indexSize + levelCount * levelIndexEntrySize) {
+        return fail("truncated level index");
+    }
+
+    for (std::uint32_t level = 0; level < levelCount; ++level) {
+        const std::size_t entry = headerSize + indexSize + level * levelIndexEntrySize;
+        const std::uint64_t offset = readU64(bytes, entry);
+        const std::uint64_t length = readU64(bytes, entry + 8);
+        const auto width = static_cast<int>(std::max(contents.width >> level, 1u));
+        const auto height = static_cast<int>(std::max(contents.height >> level, 1u));
+        std::optional<std::size_t> expectedLength = levelByteSize(contents.vkFormat, width, height);
+        if (!expectedLength) {
+            return fail("unsupported vkFormat");
+        }
+        if (length != *expectedLength || offset > bytes.size() || length > bytes.size() - offset) {
+            return fail("invalid level index");
+        }
+        const auto begin = bytes.begin() + static_cast<std::ptrdiff_t>(offset);
+        contents.levels.emplace_back(begin, begin + static_cast<std::ptrdiff_t>(length));
+    }
+    return contents;
+}
+
+std::optional<int> getChannelCount(std::uint32_t vkFormat, bool& sRGB)
+{
+    sRGB = (vkFormat == VK_FORMAT_R8G8B8A8_SRGB);
+    switch (vkFormat) {
+    case VK_FORMAT_R8_UNORM: return 1;
+    case VK_FORMAT_R8G8_UNORM: return 2;
+    case VK_FORMAT_R8G8B8A8_UNORM: return 4;
+    case VK_FORMAT_R8G8B8A8_SRGB: return 4;
+    default: return std::nullopt;
+    }
+}
+
+std::optional<BlockFormat> getBlockFormat(std::uint32_t vkFormat, bool& sRGB)
+{
+    sRGB = (vkFormat == VK_FORMAT_BC1_RGB_SRGB_BLOCK || vkFormat == VK_FORMAT_BC3_SRGB_BLOCK);
+    switch (vkFormat) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return BlockFormat::BC1;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK: return BlockFormat::BC1;
+    case VK_FORMAT_BC3_UNORM_BLOCK: return BlockFormat::BC3;
+    case VK_FORMAT_BC3_SRGB_BLOCK: return BlockFormat::BC3;
+    default: return std::nullopt;
+    }
+}
+
+// checks whether the cache file exists and is at least as new as the image file
+bool isCacheValid(const std::filesystem::path& imagePath, const std::filesystem::path& cachePath)
+{
+    std::error_code ec;
+    const auto imageTime = std::filesystem::last_write_time(imagePath, ec);
+    const bool imageExists = !ec;
+    const auto cacheTime = std::filesystem::last_write_time(cachePath, ec);
+    return !ec && (!imageExists || cacheTime >= imageTime);
+}
+
+std::string getMipFilterName(MipFilter filter)
+{
+    return (filter == MipFilter::Box) ? "box" : "kaiser";
+}
+
+} // namespace
+
+
+bool writeKTX2File(const std::filesystem::path &filepath, const CPUTexture &texture)
+{
+    ASSERT(!texture.levels.empty());
+    const int channels = texture.levels[0].channels;
+    std::optional<std::uint32_t> vkFormat = getVkFormat(channels, texture.sRGB);
+    ASSERT(vkFormat);
+    if (!vkFormat) {
+        return false;
+    }
+    std::vector<const std::vector<GLubyte>*> levels;
+    for (const CPUImage& level : texture.levels) {
+        levels.push_back(&level.data);
+    }
+    return writeKTX2(filepath, *vkFormat, texture.levels[0].width, texture.levels[0].height,
+                     4, // lcm(texel size, 4)
+                     [&](ByteWriter& out) { writeDFD(out, channels, texture.sRGB); },
+                     levels);
+}
+
+bool writeKTX2File(const std::filesystem::path &filepath, const CPUCompressedTexture &texture)
+{
+    ASSERT(!texture.levels.empty());
+    std::vector<const std::vector<GLubyte>*> levels;
+    for (const CPUCompressedImage& level : texture.levels) {
+        levels.push_back(&level.blocks);
+    }
+    return writeKTX2(filepath, getVkFormat(texture.format, texture.sRGB),
+                     texture.levels[0].width, texture.levels[0].height,
+                     getBlockByteSize(texture.format), // lcm(block size, 4)
+                     [&](ByteWriter& out) { writeDFD(out, texture.format, texture.sRGB); },
+                     levels);
+}
+
+std::optional<CPUTexture> readKTX2File(const std::filesystem::path &filepath)
+{
+    std::optional<KTX2Contents> contents = readKTX2(filepath, [](std::uint32_t vkFormat, int width, int height) {
+        bool sRGB;
+        std::optional<int> channels = getChannelCount(vkFormat, sRGB);
+        return channels ? std::optional<std::size_t>(static_cast<std::size_t>(width * height * *channels))
+                        : std::nullopt;
+    });
+    if (!contents) {
+        return std::nullopt;
+    }
+    CPUTexture texture;
+    const int channels = *getChannelCount(contents->vkFormat, texture.sRGB);
+    for (std::size_t level = 0; level < contents->levels.size(); ++level) {
+        CPUImage image;
+        image.width = static_cast<int>(std::max(contents->width >> level, 1u));
+        image.height = static_cast<int>(std::max(contents->height >> level, 1u));
+        image.channels = channels;
+        image.data = std::move(contents->levels[level]);
+        texture.levels.push_back(std::move(image));
+    }
+    return texture;
+}
+
+std::optional<CPUCompressedTexture> readCompressedKTX2File(const std::filesystem::path &filepath)
+{
+    std::optional<KTX2Contents> contents = readKTX2(filepath, [](std::uint32_t vkFormat, int width, int height) {
+        bool sRGB;
+        std::optional<BlockFormat> format = getBlockFormat(vkFormat, sRGB);
+        return format ? std::optional<std::size_t>(getCompressedByteSize(width, height, *format))
+                      : std::nullopt;
+    });
+    if (!contents) {
+        return std::nullopt;
+    }
+    CPUCompressedTexture texture;
+    texture.format = *getBlockFormat(contents->vkFormat, texture.sRGB);
+    for (std::size_t level = 0; level < contents->levels.size(); ++level) {
+        CPUCompressedImage image;
+        image.width = static_cast<int>(std::max(contents->width >> level, 1u));
+        image.height = static_cast<int>(std::max(contents->height >> level, 1u));
+        image.blocks = std::move(contents->levels[level]);
+        texture.levels.push_back(std::move(image));
+    }
+    return texture;
+}
+
+std::filesystem::path getTextureCachePath(const std::filesystem::path &imagePath, int channels, bool sRGB, MipFilter filter)
+{
+    ASSERT(channels != 3);
+    constexpr std::array<const char*, 4> formatNames = {".r8", ".rg8", ".rgb8", ".rgba8"};
+    std::filesystem::path cachePath = imagePath;
+    cachePath += formatNames[static_cast<std::size_t>(channels - 1)];
+    cachePath += (sRGB ? "_srgb_" : "_") + getMipFilterName(filter) + ".ktx2";
+    return cachePath;
+}
+
+std::filesystem::path getTextureCachePath(const std::filesystem::path &imagePath, BlockFormat format, bool sRGB, MipFilter filter)
+{
+    std::filesystem::path cachePath = imagePath;
+    cachePath += (format == BlockFormat::BC1) ? ".bc1" : ".bc3";
+    cachePath += (sRGB ? "_srgb_" : "_") + getMipFilterName(filter) + ".ktx2";
+    return cachePath;
+}
+
+std::optional<CPUTexture> loadTexture(const std::filesystem::path &imagePath, int channels, bool sRGB, MipFilter filter)
+{
+    const std::filesystem::path cachePath = getTextureCachePath(imagePath, channels, sRGB, filter);
+    if (isCacheValid(imagePath, cachePath)) {
+        std::optional<CPUTexture> cached = readKTX2File(cachePath);
+        if (cached && cached->sRGB == sRGB && cached->levels[0].channels == channels) {
+            return cached;
+        }
+    }
+
+    std::optional<CPUImage> image = loadImageFile(imagePath, channels);
+    if (!image) {
+        return std::nullopt;
+    }
+    CPUTexture texture{sRGB, generateMipChain(*image, sRGB, filter)};
+    DEBUG_DO(std::cout << "writing texture cache " << cachePath << '\n');
+    writeKTX2File(cachePath, texture); // failing to write the cache only costs time on the next load
+    return texture;
+}
+
+std::optional<CPUCompressedTexture> loadCompressedTexture(const std::filesystem::path &imagePath, BlockFormat format,
+                                                          bool sRGB, MipFilter filter)
+{
+    const std::filesystem::path cachePath = getTextureCachePath(imagePath, format, sRGB, filter);
+    if (isCacheValid(imagePath, cachePath)) {
+        std::optional<CPUCompressedTexture> cached = readCompressedKTX2File(cachePath);
+        if (cached && cached->format == format && cached->sRGB == sRGB) {
+            return cached;
+        }
+    }
+
+    std::optional<CPUImage> image = loadImageFile(imagePath, 4);
+    if (!image) {
+        return std::nullopt;
+    }
+    CPUCompressedTexture texture = compressTexture(generateMipChain(*image, sRGB, filter), format, sRGB);
+    DEBUG_DO(std::cout << "writing texture cache " << cachePath << '\n');
+    writeKTX2File(cachePath, texture); // failing to write the cache only costs time on the next load
+    return texture;
+}